@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include "benchmark_utils.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/entry.h"
+
+namespace {
+
+// A device with the CiA 402 dictionary. The core is never started, so only
+// the cache is accessed.
+struct DictionaryFixture {
+  kaco::Core core;
+  std::unique_ptr<kaco::Device> device;
+
+  DictionaryFixture() : device(new kaco::Device(core, 1)) {
+    device->load_dictionary_from_eds(kaco::benchmarks::eds_402_path());
+    device->set_entry("Controlword", static_cast<uint16_t>(0x0f),
+                      kaco::WriteAccessMethod::cache);
+  }
+};
+
+DictionaryFixture& fixture() {
+  static DictionaryFixture instance;
+  return instance;
+}
+
+}  // end anonymous namespace
+
+static void BM_Dictionary_HasEntryByName(benchmark::State& state) {
+  kaco::Device& device = *fixture().device;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(device.has_entry("Position Actual Value"));
+  }
+}
+BENCHMARK(BM_Dictionary_HasEntryByName);
+
+static void BM_Dictionary_HasEntryByAddress(benchmark::State& state) {
+  kaco::Device& device = *fixture().device;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(device.has_entry(0x6064, 0));
+  }
+}
+BENCHMARK(BM_Dictionary_HasEntryByAddress);
+
+static void BM_Dictionary_GetEntryAddress(benchmark::State& state) {
+  kaco::Device& device = *fixture().device;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(device.get_entry_address("Position Actual Value"));
+  }
+}
+BENCHMARK(BM_Dictionary_GetEntryAddress);
+
+static void BM_Dictionary_GetCachedEntryByName(benchmark::State& state) {
+  kaco::Device& device = *fixture().device;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        device.get_entry("Controlword", kaco::ReadAccessMethod::cache));
+  }
+}
+BENCHMARK(BM_Dictionary_GetCachedEntryByName);
+
+static void BM_Dictionary_GetCachedEntryByAddress(benchmark::State& state) {
+  kaco::Device& device = *fixture().device;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        device.get_entry(0x6040, 0, kaco::ReadAccessMethod::cache));
+  }
+}
+BENCHMARK(BM_Dictionary_GetCachedEntryByAddress);
+
+// Entry::set_value() with the given number of value changed callbacks.
+static void BM_Entry_SetValue(benchmark::State& state) {
+  kaco::Entry entry(0x6064, 0, "position_actual_value", kaco::Type::int32,
+                    kaco::AccessType::read_only);
+  size_t calls = 0;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    entry.add_value_changed_callback(
+        [&calls](const kaco::Value&) { ++calls; });
+  }
+  int32_t position = 0;
+  for (auto _ : state) {
+    entry.set_value(kaco::Value(++position));
+  }
+  benchmark::DoNotOptimize(calls);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Entry_SetValue)->Arg(0)->Arg(1)->Arg(4)->Arg(16);
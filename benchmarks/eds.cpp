@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <benchmark/benchmark.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "benchmark_utils.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/device.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// All EDS files of the library, sorted for reproducible runs.
+std::vector<std::string> library_eds_files() {
+  std::vector<std::string> files;
+  const fs::path root(kaco::benchmarks::eds_library_path());
+  if (!fs::is_directory(root)) {
+    return files;
+  }
+  for (fs::recursive_directory_iterator it(root), end; it != end; ++it) {
+    if (fs::is_regular_file(it->path()) && it->path().extension() == ".eds") {
+      files.push_back(it->path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+}  // end anonymous namespace
+
+// Loads the dictionary of every EDS file in the library into a fresh Device.
+static void BM_EDS_LoadLibrary(benchmark::State& state) {
+  const std::vector<std::string> files = library_eds_files();
+  if (files.empty()) {
+    state.SkipWithError("EDS library not found.");
+    return;
+  }
+  kaco::Core core;
+  size_t failed = 0;
+  for (auto _ : state) {
+    for (const std::string& file : files) {
+      kaco::Device device(core, 1);
+      try {
+        device.load_dictionary_from_eds(file);
+      } catch (const kaco::canopen_error&) {
+        ++failed;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * files.size());
+  state.counters["files"] = files.size();
+  state.counters["failed"] = failed / state.iterations();
+}
+BENCHMARK(BM_EDS_LoadLibrary)->Unit(benchmark::kMillisecond);
+
+// Loads the CiA 402 profile only.
+static void BM_EDS_Load402(benchmark::State& state) {
+  kaco::Core core;
+  for (auto _ : state) {
+    kaco::Device device(core, 1);
+    device.load_dictionary_from_eds(kaco::benchmarks::eds_402_path());
+  }
+}
+BENCHMARK(BM_EDS_Load402)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+#include "benchmark_utils.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/message.h"
+#include "kacanopen/core/virtual_bus.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/mapping.h"
+#include "kacanopen/master/pdo_batch_decoder.h"
+
+// PDO::process_incoming_message() with the given number of plain callbacks
+// registered for the received COB-ID and 16 callbacks for other COB-IDs.
+static void BM_PDO_ProcessIncomingMessage(benchmark::State& state) {
+  kaco::Core core;
+  size_t calls = 0;
+  for (uint16_t node_id = 2; node_id < 18; ++node_id) {
+    core.pdo.add_pdo_received_callback(
+        0x180 + node_id, [&calls](std::vector<uint8_t>) { ++calls; });
+  }
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    core.pdo.add_pdo_received_callback(
+        0x181, [&calls](std::vector<uint8_t>) { ++calls; });
+  }
+  const kaco::Message message = {0x181, 0, 8, {1, 2, 3, 4, 5, 6, 7, 8}};
+  for (auto _ : state) {
+    core.pdo.process_incoming_message(message);
+  }
+  benchmark::DoNotOptimize(calls);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PDO_ProcessIncomingMessage)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+// A received PDO which is decoded into the dictionary cache of a Device via
+// receive PDO mappings.
+static void BM_PDO_ReceivePDOMapping(benchmark::State& state) {
+  kaco::Core core;
+  kaco::Device device(core, 1);
+  device.load_dictionary_from_eds(kaco::benchmarks::eds_402_path());
+  device.add_receive_pdo_mapping(0x181, "Statusword", 0);
+  device.add_receive_pdo_mapping(0x181, "Position Actual Value", 2);
+  kaco::Message message = {0x181, 0, 6, {0x37, 0x02, 0, 0, 0, 0, 0, 0}};
+  uint8_t position = 0;
+  for (auto _ : state) {
+    // Change the value so that the cache is actually updated.
+    message.data[2] = ++position;
+    core.pdo.process_incoming_message(message);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PDO_ReceivePDOMapping);
+
+// Decoding 256 frames of one COB-ID into columns with PDOBatchDecoder, using
+// the scalar (0) or the AVX2 (1) kernel.
+static void BM_PDO_BatchDecode(benchmark::State& state) {
+  const auto kernel =
+      static_cast<kaco::PDOBatchDecoder::Kernel>(state.range(0));
+  if (kernel != kaco::PDOBatchDecoder::Kernel::scalar &&
+      kernel != kaco::PDOBatchDecoder::best_kernel()) {
+    state.SkipWithError("Kernel not supported by this CPU.");
+    return;
+  }
+  const kaco::PDOBatchDecoder decoder({{kaco::Type::uint16, 0},
+                                       {kaco::Type::int32, 2},
+                                       {kaco::Type::int8, 6}},
+                                      kernel);
+  std::vector<kaco::Message> frames(256);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    frames[i] = {0x181, 0, 7, {0x37, 0x02, uint8_t(i), 0, 0, 0, 0xFE, 0}};
+  }
+  kaco::PDOBatchDecoder::Columns columns;
+  for (auto _ : state) {
+    columns.integers.clear();
+    decoder.decode(frames.data(), frames.size(), columns);
+    benchmark::DoNotOptimize(columns.integers.data());
+  }
+  state.SetItemsProcessed(state.iterations() * frames.size());
+}
+BENCHMARK(BM_PDO_BatchDecode)->Arg(0)->Arg(1);
+
+// TransmitPDOMapping::send() via Device::send_transmit_pdo() on an in-process
+// bus.
+static void BM_PDO_TransmitPDOMappingSend(benchmark::State& state) {
+  kaco::VirtualBus bus;
+  kaco::Core core;
+  core.nmt.set_node_management(false);
+  if (!core.start(bus)) {
+    state.SkipWithError("Starting core failed.");
+    return;
+  }
+  {
+    kaco::Device device(core, 1);
+    device.load_dictionary_from_eds(kaco::benchmarks::eds_402_path());
+    device.set_entry("Controlword", static_cast<uint16_t>(0x0f),
+                     kaco::WriteAccessMethod::cache);
+    device.set_entry("Target Position", static_cast<int32_t>(1000),
+                     kaco::WriteAccessMethod::cache);
+    device.add_transmit_pdo_mapping(
+        0x201, std::vector<kaco::Mapping>{{"Controlword", 0},
+                                          {"Target Position", 2}},
+        kaco::TransmissionType::ON_REQUEST);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(device.send_transmit_pdo(0x201));
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  core.stop();
+}
+BENCHMARK(BM_PDO_TransmitPDOMappingSend);
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "benchmark_utils.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/virtual_bus.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/device_farm.h"
+#include "kacanopen/master/slave.h"
+
+namespace {
+
+// A client core and a simulated CiA 402 server (node 1) on an in-process bus.
+struct SDOLoopback {
+  kaco::VirtualBus bus;
+  kaco::Core server_core;
+  kaco::Core client_core;
+  kaco::DeviceFarm farm;
+  bool started = false;
+
+  SDOLoopback() : farm(server_core) {
+    server_core.nmt.set_node_management(false);
+    client_core.nmt.set_node_management(false);
+    if (!server_core.start(bus) || !client_core.start(bus)) {
+      return;
+    }
+    try {
+      kaco::Slave& node = farm.add_node(1, kaco::benchmarks::eds_402_path());
+      node.set_entry(0x1008, 0,
+                     std::string("kacanopen simulated CiA 402 drive"));
+    } catch (const kaco::canopen_error&) {
+      return;
+    }
+    farm.set_tpdo_period(std::chrono::microseconds(0));
+    farm.start();
+    started = true;
+  }
+};
+
+}  // end anonymous namespace
+
+// Expedited upload of the device type (0x1000).
+static void BM_SDO_UploadExpedited(benchmark::State& state) {
+  SDOLoopback loopback;
+  if (!loopback.started) {
+    state.SkipWithError("Starting the loopback failed.");
+    return;
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(loopback.client_core.sdo.upload(1, 0x1000, 0));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SDO_UploadExpedited)->UseRealTime();
+
+// Segmented upload of the manufacturer device name (0x1008).
+static void BM_SDO_UploadSegmented(benchmark::State& state) {
+  SDOLoopback loopback;
+  if (!loopback.started) {
+    state.SkipWithError("Starting the loopback failed.");
+    return;
+  }
+  size_t bytes = 0;
+  for (auto _ : state) {
+    bytes += loopback.client_core.sdo.upload(1, 0x1008, 0).size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_SDO_UploadSegmented)->UseRealTime();
+
+// Expedited download of the controlword (0x6040).
+static void BM_SDO_DownloadExpedited(benchmark::State& state) {
+  SDOLoopback loopback;
+  if (!loopback.started) {
+    state.SkipWithError("Starting the loopback failed.");
+    return;
+  }
+  const std::vector<uint8_t> controlword = {0x0f, 0x00};
+  for (auto _ : state) {
+    loopback.client_core.sdo.download(1, 0x6040, 0, 2, controlword);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SDO_DownloadExpedited)->UseRealTime();
+
+// Full stack: Device::get_entry() via SDO including the Value conversion.
+static void BM_SDO_DeviceGetEntry(benchmark::State& state) {
+  SDOLoopback loopback;
+  if (!loopback.started) {
+    state.SkipWithError("Starting the loopback failed.");
+    return;
+  }
+  kaco::Device device(loopback.client_core, 1);
+  device.load_dictionary_from_eds(kaco::benchmarks::eds_402_path());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        device.get_entry("Statusword", kaco::ReadAccessMethod::sdo));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SDO_DeviceGetEntry)->UseRealTime();
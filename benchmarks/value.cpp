@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+#include "kacanopen/master/types.h"
+#include "kacanopen/master/utils.h"
+#include "kacanopen/master/value.h"
+
+namespace {
+
+// Little-endian test bytes matching the size of the given type.
+std::vector<uint8_t> bytes_of(kaco::Type type) {
+  std::vector<uint8_t> bytes = {0x11, 0x22, 0x33, 0x44,
+                                0x55, 0x66, 0x77, 0x08};
+  if (type != kaco::Type::string) {
+    bytes.resize(kaco::Utils::get_type_size(type));
+  }
+  return bytes;
+}
+
+}  // end anonymous namespace
+
+// Value(Type, bytes) is called for every mapped entry of every received PDO
+// and for every SDO upload.
+static void BM_Value_FromBytes(benchmark::State& state) {
+  const auto type = static_cast<kaco::Type>(state.range(0));
+  const std::vector<uint8_t> bytes = bytes_of(type);
+  for (auto _ : state) {
+    kaco::Value value(type, bytes);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetLabel(kaco::Utils::type_to_string(type));
+}
+BENCHMARK(BM_Value_FromBytes)
+    ->Arg(static_cast<int>(kaco::Type::uint8))
+    ->Arg(static_cast<int>(kaco::Type::uint16))
+    ->Arg(static_cast<int>(kaco::Type::int32))
+    ->Arg(static_cast<int>(kaco::Type::uint64))
+    ->Arg(static_cast<int>(kaco::Type::real32))
+    ->Arg(static_cast<int>(kaco::Type::string));
+
+// get_bytes() is called for every mapped entry of every transmitted PDO and
+// for every SDO download.
+static void BM_Value_GetBytes(benchmark::State& state) {
+  const auto type = static_cast<kaco::Type>(state.range(0));
+  const kaco::Value value(type, bytes_of(type));
+  for (auto _ : state) {
+    std::vector<uint8_t> bytes = value.get_bytes();
+    benchmark::DoNotOptimize(bytes.data());
+  }
+  state.SetLabel(kaco::Utils::type_to_string(type));
+}
+BENCHMARK(BM_Value_GetBytes)
+    ->Arg(static_cast<int>(kaco::Type::uint8))
+    ->Arg(static_cast<int>(kaco::Type::uint16))
+    ->Arg(static_cast<int>(kaco::Type::int32))
+    ->Arg(static_cast<int>(kaco::Type::uint64))
+    ->Arg(static_cast<int>(kaco::Type::real32))
+    ->Arg(static_cast<int>(kaco::Type::string));
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <signal.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/master/cyclic_drive.h"
+#include "kacanopen/master/cyclic_executor.h"
+#include "kacanopen/master/master.h"
+
+static volatile int keepRunning = 1;
+
+void intHandler(int dummy) {
+  (void)dummy;
+  keepRunning = 0;
+}
+
+int main() {
+  // Signal handling
+  signal(SIGINT, intHandler);
+
+  // ----------- //
+  // Preferences //
+  // ----------- //
+
+  // The node IDs of the CiA 402 drives we want to control.
+  const std::vector<uint8_t> node_ids = {2, 3, 4};
+
+  // Set the name of your CAN bus. "slcan0" is a common bus name
+  // for the first SocketCAN device on a Linux system.
+  const std::string busname = "slcan0";
+
+  // Set the baudrate of your CAN bus. Most drivers support the values
+  // "1M", "500K", "125K", "100K", "50K", "20K", "10K" and "5K".
+  const std::string baudrate = "1M";
+
+  // 1 kHz communication cycle. Control tasks start 300 us after each SYNC
+  // and must have sent their setpoints 900 us after the SYNC.
+  const auto cycle_period = std::chrono::microseconds(1000);
+  const auto phase = std::chrono::microseconds(300);
+  const auto window = std::chrono::microseconds(900);
+
+  // -------------- //
+  // Initialization //
+  // -------------- //
+
+  std::cout << "This is an example which streams cyclic synchronous position "
+               "setpoints to several CiA 402 drives without SDO traffic in "
+               "steady state."
+            << std::endl;
+
+  kaco::Master master;
+  if (!master.start(busname, baudrate)) {
+    std::cout << "Starting master failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Waiting for the drives..." << std::endl;
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  kaco::CyclicExecutor executor(master.core, phase, window);
+  std::vector<std::unique_ptr<kaco::CyclicDrive>> drives;
+
+  for (size_t i = 0; i < master.num_devices(); ++i) {
+    kaco::Device& device = master.get_device(i);
+    if (std::find(node_ids.begin(), node_ids.end(), device.get_node_id()) ==
+        node_ids.end()) {
+      continue;
+    }
+
+    std::cout << "Configuring drive " << (unsigned)device.get_node_id()
+              << " via SDO..." << std::endl;
+    try {
+      device.load_dictionary_from_library();
+      drives.emplace_back(new kaco::CyclicDrive(
+          device, kaco::CyclicDrive::Mode::position));
+      drives.back()->configure(cycle_period);
+      drives.back()->attach(executor);
+      device.start();
+    } catch (const kaco::canopen_error& error) {
+      std::cout << "Configuring drive " << (unsigned)device.get_node_id()
+                << " failed: " << error.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (drives.empty()) {
+    std::cout << "No drive found." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Each drive follows a sine around the position where it got enabled.
+  // The generator is called in every cycle while operation is enabled.
+  for (auto& drive : drives) {
+    auto start_position = std::make_shared<int32_t>(0);
+    auto cycles = std::make_shared<uint64_t>(0);
+    drive->set_setpoint_generator(
+        [start_position, cycles](const kaco::CyclicDrive::Feedback& feedback) {
+          if ((*cycles)++ == 0) {
+            *start_position = feedback.position;
+          }
+          const double t = *cycles * 0.001;
+          return static_cast<int32_t>(*start_position +
+                                      10000.0 * std::sin(2.0 * M_PI * t));
+        });
+    drive->enable();
+  }
+
+  executor.start();
+  master.core.sync.start_producer(cycle_period);
+
+  while (keepRunning) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    for (const auto& drive : drives) {
+      const kaco::CyclicDrive::Feedback feedback = drive->get_feedback();
+      std::cout << "statusword=0x" << std::hex << feedback.statusword
+                << std::dec << " position=" << feedback.position << "  ";
+    }
+    std::cout << std::endl;
+    executor.print_statistics();
+  }
+
+  for (auto& drive : drives) {
+    drive->disable();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  master.core.sync.stop_producer();
+  executor.stop();
+
+  std::cout << "Finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ros/package.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/virtual_bus.h"
+#include "kacanopen/master/device_farm.h"
+#include "kacanopen/master/master.h"
+
+// Consumed CPU time (user + system) of this process.
+static std::chrono::microseconds cpu_time() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+         std::chrono::microseconds(usage.ru_utime.tv_usec +
+                                   usage.ru_stime.tv_usec);
+}
+
+int main(int argc, char* argv[]) {
+  // ----------- //
+  // Preferences //
+  // ----------- //
+
+  // EDS file of the simulated devices.
+  std::string eds_path = ros::package::getPath("kacanopen") +
+                         "/resources/eds_library/CiA_profiles/402.eds";
+
+  // The benchmark doubles the number of nodes up to this value (max. 127).
+  size_t max_nodes = 64;
+
+  // "virtual" runs everything on an in-process bus. Use e.g. "vcan0"
+  // for a SocketCAN bus.
+  std::string busname = "virtual";
+
+  // Baudrate in case of a SocketCAN bus.
+  const std::string baudrate = "1M";
+
+  // Transmit PDO period of each simulated node.
+  const auto tpdo_period = std::chrono::milliseconds(10);
+
+  // Duration of each measurement.
+  const auto duration = std::chrono::seconds(2);
+
+  if (argc > 1) eds_path = argv[1];
+  if (argc > 2) max_nodes = std::min<size_t>(std::stoul(argv[2]), 127);
+  if (argc > 3) busname = argv[3];
+
+  std::cout << "This example benchmarks Master/Device against a farm of "
+               "simulated devices ("
+            << eds_path << ", bus " << busname << ")." << std::endl;
+
+  std::cout << std::setw(6) << "nodes" << std::setw(12) << "tpdo/s"
+            << std::setw(10) << "sdo/s" << std::setw(12) << "sdo avg us"
+            << std::setw(12) << "sdo p99 us" << std::setw(12) << "sdo max us"
+            << std::setw(8) << "cpu %" << std::endl;
+
+  for (size_t num_nodes = 1; num_nodes <= max_nodes;
+       num_nodes = (num_nodes == max_nodes) ? max_nodes + 1
+                                            : std::min(2 * num_nodes, max_nodes)) {
+    // -------------- //
+    // Initialization //
+    // -------------- //
+
+    kaco::VirtualBus bus;
+    kaco::Core farm_core;
+    farm_core.nmt.set_node_management(false);
+    kaco::Master master;
+
+    const bool started = (busname == "virtual")
+                             ? farm_core.start(bus) && master.start(bus)
+                             : farm_core.start(busname, baudrate) &&
+                                   master.start(busname, baudrate);
+    if (!started) {
+      std::cout << "Starting cores failed." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    kaco::DeviceFarm farm(farm_core);
+    try {
+      farm.add_nodes(1, num_nodes, eds_path);
+    } catch (const kaco::canopen_error& error) {
+      std::cout << "Creating the farm failed: " << error.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    farm.set_tpdo_period(tpdo_period);
+    farm.start();
+
+    // Master answers the boot-up messages with node guarding requests.
+    const auto discovery_deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (master.num_devices() < num_nodes &&
+           std::chrono::steady_clock::now() < discovery_deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (master.num_devices() < num_nodes) {
+      std::cout << "Only " << master.num_devices() << " of " << num_nodes
+                << " nodes have been discovered." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::atomic<size_t> received_tpdos{0};
+    for (size_t i = 0; i < master.num_devices(); ++i) {
+      kaco::Device& device = master.get_device(i);
+      if (!device.has_entry(0x1000)) {
+        device.add_entry(0x1000, 0, "device_type", kaco::Type::uint32,
+                         kaco::AccessType::read_only);
+      }
+      master.core.pdo.add_pdo_received_callback(
+          0x180 + device.get_node_id(),
+          [&received_tpdos](std::vector<uint8_t>) { ++received_tpdos; });
+    }
+
+    master.core.nmt.broadcast_nmt_message(kaco::NMT::Command::start_node);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // ----------- //
+    // Measurement //
+    // ----------- //
+
+    std::vector<double> sdo_latencies_us;
+    const size_t tpdos_before = received_tpdos;
+    const auto cpu_before = cpu_time();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; std::chrono::steady_clock::now() - start < duration;
+         ++i) {
+      kaco::Device& device = master.get_device(i % master.num_devices());
+      const auto sdo_start = std::chrono::steady_clock::now();
+      try {
+        device.get_entry(0x1000, 0, kaco::ReadAccessMethod::sdo);
+      } catch (const kaco::canopen_error& error) {
+        std::cout << "SDO failed: " << error.what() << std::endl;
+        continue;
+      }
+      sdo_latencies_us.push_back(
+          std::chrono::duration<double, std::micro>(
+              std::chrono::steady_clock::now() - sdo_start)
+              .count());
+    }
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+    const double cpu_seconds =
+        std::chrono::duration<double>(cpu_time() - cpu_before).count();
+    const size_t tpdos = received_tpdos - tpdos_before;
+
+    std::sort(sdo_latencies_us.begin(), sdo_latencies_us.end());
+    double sdo_sum_us = 0;
+    for (double latency : sdo_latencies_us) {
+      sdo_sum_us += latency;
+    }
+    const size_t num_sdos = sdo_latencies_us.size();
+
+    std::cout << std::fixed << std::setprecision(0) << std::setw(6)
+              << num_nodes << std::setw(12) << tpdos / seconds << std::setw(10)
+              << num_sdos / seconds << std::setw(12)
+              << (num_sdos ? sdo_sum_us / num_sdos : 0) << std::setw(12)
+              << (num_sdos ? sdo_latencies_us[num_sdos * 99 / 100] : 0)
+              << std::setw(12) << (num_sdos ? sdo_latencies_us.back() : 0)
+              << std::setw(8) << 100 * cpu_seconds / seconds << std::endl;
+
+    farm.stop();
+    master.stop();
+    farm_core.stop();
+  }
+
+  std::cout << "Finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <signal.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/master/io_module.h"
+#include "kacanopen/master/master.h"
+
+static volatile int keepRunning = 1;
+
+void intHandler(int dummy) {
+  (void)dummy;
+  keepRunning = 0;
+}
+
+int main() {
+  // Signal handling
+  signal(SIGINT, intHandler);
+
+  // ----------- //
+  // Preferences //
+  // ----------- //
+
+  // Set the name of your CAN bus. "slcan0" is a common bus name
+  // for the first SocketCAN device on a Linux system.
+  const std::string busname = "slcan0";
+
+  // Set the baudrate of your CAN bus. Most drivers support the values
+  // "1M", "500K", "125K", "100K", "50K", "20K", "10K" and "5K".
+  const std::string baudrate = "500K";
+
+  // -------------- //
+  // Initialization //
+  // -------------- //
+
+  std::cout << "This is an example which reads the packed process image of a "
+               "CiA 401 I/O module and toggles its digital outputs."
+            << std::endl;
+
+  kaco::Master master;
+  if (!master.start(busname, baudrate)) {
+    std::cout << "Starting master failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Waiting for the I/O module..." << std::endl;
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  std::unique_ptr<kaco::IOModule> io;
+  for (size_t i = 0; i < master.num_devices() && !io; ++i) {
+    kaco::Device& device = master.get_device(i);
+    device.load_dictionary_from_library();
+    if (device.get_device_profile_number() != 401) {
+      continue;
+    }
+
+    try {
+      io.reset(new kaco::IOModule(device));
+      io->configure();
+    } catch (const kaco::canopen_error& error) {
+      std::cout << "Configuring I/O module " << (unsigned)device.get_node_id()
+                << " failed: " << error.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    device.start();
+  }
+
+  if (!io) {
+    std::cout << "No CiA 401 device found." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Mapped " << io->get_digital_input_count()
+            << " digital inputs, " << io->get_analog_input_count()
+            << " analog inputs, " << io->get_digital_output_count()
+            << " digital outputs and " << io->get_analog_output_count()
+            << " analog outputs." << std::endl;
+
+  // Analog inputs in volts, assuming +-10 V on the full int16 range.
+  io->set_analog_input_scaling(10.0f / 32767, 0.0f);
+  io->set_analog_deadband(16);
+
+  // Called once per received PDO, no matter how many channels it carries.
+  io->set_input_callback([&io](const kaco::IOModule::InputImage& image) {
+    for (size_t channel = 0; channel < io->get_digital_input_count();
+         ++channel) {
+      if (image.digital_has_changed(channel)) {
+        std::cout << "DI " << channel << " = " << image.get_digital(channel)
+                  << std::endl;
+      }
+    }
+    for (size_t channel = 0; channel < io->get_analog_input_count();
+         ++channel) {
+      if (image.analog_has_changed(channel)) {
+        std::cout << "AI " << channel << " = " << image.analog[channel]
+                  << " V" << std::endl;
+      }
+    }
+  });
+
+  // Running light on the digital outputs
+  size_t channel = 0;
+  while (keepRunning && io->get_digital_output_count() > 0) {
+    io->set_digital_output(channel, false);
+    channel = (channel + 1) % io->get_digital_output_count();
+    io->set_digital_output(channel, true);
+    io->flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  }
+
+  std::cout << "Finished." << std::endl;
+  return EXIT_SUCCESS;
+}
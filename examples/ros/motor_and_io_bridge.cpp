@@ -106,9 +106,11 @@ int main(int argc, char* argv[]) {
       device.set_entry("Write output 8-bit/Digital Outputs 1-8", (uint8_t)0xFF);
 
       // create a publisher for reading second 8-bit input and add it to the
-      // bridge communication via POD
+      // bridge communication via POD. It is event-driven, so it publishes
+      // whenever the PDO changes the input, at most every 10 ms.
       auto iopub = std::make_shared<kaco::EntryPublisher>(
-          device, "Read input 8-bit/Digital Inputs 9-16");
+          device, "Read input 8-bit/Digital Inputs 9-16",
+          std::chrono::milliseconds(10));
       bridge.add_publisher(iopub);
 
       // create a subscriber for editing IO output and add it to the bridge
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <signal.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/master/master.h"
+#include "kacanopen/master/shared_process_image.h"
+#include "kacanopen/master/shared_process_image_reader.h"
+
+static volatile int keepRunning = 1;
+
+void intHandler(int dummy) {
+  (void)dummy;
+  keepRunning = 0;
+}
+
+// Reads the process image published by another instance of this example.
+int read_image(const std::string& segment) {
+  try {
+    kaco::SharedProcessImageReader reader(segment);
+    while (keepRunning) {
+      for (size_t slot = 0; slot < reader.get_slot_count(); ++slot) {
+        const auto info = reader.get_slot_info(slot);
+        const auto sample = reader.read(slot);
+        std::cout << "Node " << (unsigned)info.node_id << " " << info.name
+                  << " = "
+                  << (sample.valid ? sample.value.to_string() : "(no value)")
+                  << " (" << sample.updates << " updates)" << std::endl;
+      }
+      std::cout << std::endl;
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  } catch (const kaco::canopen_error& error) {
+    std::cout << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+  // Signal handling
+  signal(SIGINT, intHandler);
+
+  // ----------- //
+  // Preferences //
+  // ----------- //
+
+  // Set the name of your CAN bus. "slcan0" is a common bus name
+  // for the first SocketCAN device on a Linux system.
+  const std::string busname = "slcan0";
+
+  // Set the baudrate of your CAN bus. Most drivers support the values
+  // "1M", "500K", "125K", "100K", "50K", "20K", "10K" and "5K".
+  const std::string baudrate = "500K";
+
+  // Name of the shared memory segment
+  const std::string segment = "/kacanopen";
+
+  if (argc > 1 && std::strcmp(argv[1], "--read") == 0) {
+    return read_image(segment);
+  }
+
+  // -------------- //
+  // Initialization //
+  // -------------- //
+
+  std::cout << "This is an example which publishes the process images of all "
+               "devices in shared memory. Run it with --read in another "
+               "terminal to read them."
+            << std::endl;
+
+  kaco::Master master;
+  if (!master.start(busname, baudrate)) {
+    std::cout << "Starting master failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Waiting for devices..." << std::endl;
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  kaco::SharedProcessImage image(segment);
+
+  for (size_t i = 0; i < master.num_devices(); ++i) {
+    kaco::Device& device = master.get_device(i);
+    device.start();
+    device.load_dictionary_from_library();
+
+    // The process image consists of all PDO-mapped entries. Here we just
+    // add the standard mappings of CiA 402 drives.
+    if (device.get_device_profile_number() == 402) {
+      const uint16_t tpdo1 = 0x180 + device.get_node_id();
+      device.add_receive_pdo_mapping(tpdo1, "statusword", 0);
+      device.add_receive_pdo_mapping(tpdo1, "position_actual_value", 2);
+    }
+
+    std::cout << "Exported " << image.add_device(device)
+              << " entries of node " << (unsigned)device.get_node_id() << "."
+              << std::endl;
+  }
+
+  while (keepRunning) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  std::cout << "Finished." << std::endl;
+  return EXIT_SUCCESS;
+}
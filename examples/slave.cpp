@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/slave.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+int main() {
+  // ----------- //
+  // Preferences //
+  // ----------- //
+
+  // The node ID of the simulated slave.
+  const uint8_t node_id = 2;
+
+  // Set the name of your CAN bus. "slcan0" is a common bus name
+  // for the first SocketCAN device on a Linux system.
+  const std::string busname = "slcan0";
+
+  // Set the baudrate of your CAN bus. Most drivers support the values
+  // "1M", "500K", "125K", "100K", "50K", "20K", "10K" and "5K".
+  const std::string baudrate = "500K";
+
+  // -------------- //
+  // Initialization //
+  // -------------- //
+
+  std::cout << "This is an example which shows how to implement a slave node "
+               "(a simple CiA 401 I/O device)."
+            << std::endl;
+
+  // Create core.
+  kaco::Core core;
+
+  // This core doesn't host a master, so it shouldn't answer other nodes'
+  // state messages.
+  core.nmt.set_node_management(false);
+
+  std::cout << "Starting Core (connect to the driver and start the receiver "
+               "thread)..."
+            << std::endl;
+  if (!core.start(busname, baudrate)) {
+    std::cout << "Starting core failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  kaco::Slave slave(core, node_id);
+
+  // As an alternative, you can load the dictionary including default values
+  // from an EDS file:
+  // slave.load_dictionary_from_eds("/path/to/slave.eds");
+
+  std::cout << "Building the dictionary..." << std::endl;
+  slave.add_entry(0x1000, 0, "Device type", kaco::Type::uint32,
+                  kaco::AccessType::read_only);
+  slave.add_entry(0x1008, 0, "Manufacturer device name", kaco::Type::string,
+                  kaco::AccessType::constant);
+  slave.add_entry(0x6000, 1, "Read input 8-bit/Digital Inputs 1-8",
+                  kaco::Type::uint8, kaco::AccessType::read_only);
+  slave.add_entry(0x6200, 1, "Write output 8-bit/Digital Outputs 1-8",
+                  kaco::Type::uint8, kaco::AccessType::read_write);
+
+  slave.set_entry("Device type", static_cast<uint32_t>(0x00030191));
+  slave.set_entry("Manufacturer device name", "KaCanOpen slave example");
+  slave.set_entry("Read input 8-bit/Digital Inputs 1-8",
+                  static_cast<uint8_t>(0));
+  slave.set_entry("Write output 8-bit/Digital Outputs 1-8",
+                  static_cast<uint8_t>(0));
+
+  // Inputs are sent via TPDO1, outputs are received via RPDO1.
+  slave.add_transmit_pdo_mapping(
+      0x180 + node_id, {{"Read input 8-bit/Digital Inputs 1-8", 0}});
+  slave.add_receive_pdo_mapping(0x200 + node_id,
+                                "Write output 8-bit/Digital Outputs 1-8", 0);
+
+  slave.add_value_changed_callback(
+      "Write output 8-bit/Digital Outputs 1-8", [](const kaco::Value& value) {
+        std::cout << "Outputs changed: " << value << std::endl;
+      });
+
+  std::cout << "Sending boot-up message. Waiting for the master..."
+            << std::endl;
+  slave.start();
+
+  // ------------ //
+  // Slave usage  //
+  // ------------ //
+
+  // Inputs count up once per second. The TPDO is sent only while the node is
+  // operational (after NMT start_node).
+  uint8_t inputs = 0;
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    slave.set_entry("Read input 8-bit/Digital Inputs 1-8", ++inputs);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2016, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <signal.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/cyclic_executor.h"
+#include "kacanopen/master/master.h"
+
+static volatile int keepRunning = 1;
+
+void intHandler(int dummy) {
+  (void)dummy;
+  keepRunning = 0;
+}
+
+int main() {
+  // Signal handling
+  signal(SIGINT, intHandler);
+
+  // ----------- //
+  // Preferences //
+  // ----------- //
+
+  // The node ID of the CiA 402 drive we want to control.
+  const uint8_t node_id = 2;
+
+  // Set the name of your CAN bus. "slcan0" is a common bus name
+  // for the first SocketCAN device on a Linux system.
+  const std::string busname = "slcan0";
+
+  // Set the baudrate of your CAN bus. Most drivers support the values
+  // "1M", "500K", "125K", "100K", "50K", "20K", "10K" and "5K".
+  const std::string baudrate = "500K";
+
+  // Communication cycle period. The master produces one SYNC per cycle.
+  const auto cycle_period = std::chrono::milliseconds(2);
+
+  // The control task starts 'phase' after each SYNC. Until then the drive's
+  // synchronous TPDO has been received. The new target position must be sent
+  // before 'window' has passed since the SYNC.
+  const auto phase = std::chrono::microseconds(500);
+  const auto window = std::chrono::microseconds(1500);
+
+  // -------------- //
+  // Initialization //
+  // -------------- //
+
+  std::cout << "This is an example which runs a position control loop in "
+               "cyclic synchronous position mode, driven by SYNC messages."
+            << std::endl;
+
+  kaco::Master master;
+  if (!master.start(busname, baudrate)) {
+    std::cout << "Starting master failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  kaco::Device* device_pointer = nullptr;
+  while (!device_pointer && keepRunning) {
+    for (size_t i = 0; i < master.num_devices(); ++i) {
+      if (master.get_device(i).get_node_id() == node_id) {
+        device_pointer = &master.get_device(i);
+      }
+    }
+    if (!device_pointer) {
+      std::cout << "Device with ID " << (unsigned)node_id
+                << " has not been found yet. Waiting one more second."
+                << std::endl;
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  }
+  if (!device_pointer) {
+    return EXIT_SUCCESS;
+  }
+  kaco::Device& device = *device_pointer;
+
+  // Inputs and outputs must be exchanged via synchronous PDOs. The drive
+  // samples statusword and position on each SYNC (transmission type 1) and
+  // applies controlword and target position on the next SYNC.
+  try {
+    device.load_dictionary_from_library();
+    device.map_tpdo_in_device(kaco::TPDO_NO::TPDO_1, {0x60410010, 0x60640020},
+                              1);
+    device.map_rpdo_in_device(kaco::RPDO_NO::RPDO_1, {0x60400010, 0x607A0020},
+                              1);
+    device.add_receive_pdo_mapping(0x180 + node_id, "statusword", 0);
+    device.add_receive_pdo_mapping(0x180 + node_id, "position_actual_value",
+                                   2);
+    device.set_entry("controlword", static_cast<uint16_t>(0x0006),
+                     kaco::WriteAccessMethod::cache);
+    device.set_entry("target_position", static_cast<int32_t>(0),
+                     kaco::WriteAccessMethod::cache);
+    device.add_transmit_pdo_mapping(
+        0x200 + node_id, {{"controlword", 0}, {"target_position", 2}},
+        kaco::TransmissionType::SYNCHRONOUS);
+    // cyclic synchronous position mode
+    device.set_entry("modes_of_operation", static_cast<int8_t>(8),
+                     kaco::WriteAccessMethod::sdo);
+    device.start();
+  } catch (const kaco::canopen_error& error) {
+    std::cout << "Configuring the device failed: " << error.what()
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // ------------ //
+  // Control loop //
+  // ------------ //
+
+  kaco::CyclicExecutor executor(master.core, phase, window);
+  const size_t statusword = executor.add_input(device, "statusword");
+  const size_t position = executor.add_input(device, "position_actual_value");
+  const size_t controlword = executor.add_output(device, "controlword");
+  const size_t target = executor.add_output(device, "target_position");
+
+  int32_t start_position = 0;
+  bool enabled = false;
+
+  executor.add_task([&](kaco::CyclicExecutor::CycleContext& cycle) {
+    if (cycle.get_input(statusword).type == kaco::Type::invalid) {
+      // No TPDO from the drive yet.
+      return;
+    }
+
+    // CiA 402 state machine: shutdown -> switch on -> enable operation
+    const uint16_t status = cycle.get_input(statusword);
+    const int32_t actual = cycle.get_input(position);
+    if ((status & 0x6F) == 0x27) {
+      if (!enabled) {
+        enabled = true;
+        start_position = actual;
+      }
+      // Sine movement with an amplitude of 10000 increments and 2 s period
+      const double t = cycle.cycle * 0.002;
+      cycle.set_output(target, static_cast<int32_t>(
+                                   start_position +
+                                   10000.0 * std::sin(2.0 * M_PI * t / 2.0)));
+      cycle.set_output(controlword, static_cast<uint16_t>(0x000F));
+    } else if ((status & 0x6F) == 0x23) {
+      cycle.set_output(target, actual);
+      cycle.set_output(controlword, static_cast<uint16_t>(0x000F));
+    } else if ((status & 0x6F) == 0x21) {
+      cycle.set_output(controlword, static_cast<uint16_t>(0x0007));
+    } else {
+      cycle.set_output(controlword, static_cast<uint16_t>(0x0006));
+    }
+  });
+
+  executor.start();
+  master.core.sync.start_producer(cycle_period);
+
+  while (keepRunning) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    executor.print_statistics();
+  }
+
+  master.core.sync.stop_producer();
+  executor.stop();
+
+  std::cout << "Finished." << std::endl;
+  return EXIT_SUCCESS;
+}
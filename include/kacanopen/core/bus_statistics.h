@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/message.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace kaco {
+
+/// This class counts the traffic of a Core per COB-ID: received and sent
+/// frames and bytes, send failures, the inter-arrival time of received
+/// frames and a histogram of the dispatch latency, i.e. the time from
+/// receiving a frame until all protocol handlers and PDO callbacks have
+/// processed it. In addition, it measures SDO round trip times per node
+/// from request frames (sent or received) to the next response frame. This
+/// works for transfers of this Core as well as for transfers of other
+/// masters on the bus. Segmented transfers yield one sample per segment.
+///
+/// Counters are updated with relaxed atomics and without locks. snapshot()
+/// copies them out and sums them up per function code. The counters are
+/// only collected if the library has been built with the CMake option
+/// BUS_STATISTICS (default: ON). Otherwise, the recording calls in Core are
+/// compiled out and snapshots are empty.
+///
+/// All methods are thread-safe.
+class BusStatistics {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Number of histogram buckets. Bucket 0 counts durations below 1 us,
+  /// bucket i > 0 counts durations in [2^(i-1), 2^i) us and the last bucket
+  /// counts everything above.
+  static const size_t histogram_buckets = 20;
+
+  /// Histogram of durations, see histogram_buckets
+  struct Histogram {
+    /// Number of samples per bucket
+    std::array<uint64_t, histogram_buckets> buckets{};
+
+    /// Returns the total number of samples.
+    uint64_t samples() const;
+
+    /// Returns an upper bound for the given percentile (0..1) in
+    /// microseconds or 0 if there are no samples.
+    uint64_t percentile_us(double percentile) const;
+
+    /// Adds the samples of another histogram.
+    void add(const Histogram& other);
+  };
+
+  /// Counters of a COB-ID or a function code
+  struct Counters {
+    /// COB-ID or function code
+    uint16_t id = 0;
+
+    /// Received frames
+    uint64_t rx_frames = 0;
+
+    /// Sent frames
+    uint64_t tx_frames = 0;
+
+    /// Received data bytes
+    uint64_t rx_bytes = 0;
+
+    /// Sent data bytes
+    uint64_t tx_bytes = 0;
+
+    /// Frames which the driver failed to send
+    uint64_t send_failures = 0;
+
+    /// Minimum time between two received frames in microseconds
+    uint64_t interarrival_min_us = 0;
+
+    /// Maximum time between two received frames in microseconds
+    uint64_t interarrival_max_us = 0;
+
+    /// Average time between two received frames in microseconds
+    double interarrival_avg_us = 0;
+
+    /// Time of the last received frame. Default-constructed if none.
+    Clock::time_point last_received;
+
+    /// Dispatch latency of received frames
+    Histogram latency;
+
+    /// Adds the counters of another COB-ID.
+    void add(const Counters& other);
+  };
+
+  /// Copy of all counters
+  struct Snapshot {
+    /// False if statistics have been disabled at compile time
+    bool enabled = false;
+
+    /// Time since construction or the last reset()
+    Clock::duration duration{0};
+
+    /// Counters of all COB-IDs with traffic, sorted by COB-ID
+    std::vector<Counters> cob_ids;
+
+    /// Counters summed up per function code (index = function code)
+    std::array<Counters, 16> function_codes;
+
+    /// Counters of all frames
+    Counters total;
+
+    /// SDO round trip times (index = node ID)
+    std::array<Histogram, 128> sdo_round_trips;
+  };
+
+  /// Constructor
+  BusStatistics();
+
+  /// Destructor
+  ~BusStatistics();
+
+  /// Copy constructor deleted because of atomics.
+  BusStatistics(const BusStatistics&) = delete;
+
+  /// Returns true if statistics have been enabled at compile time.
+  static bool enabled();
+
+  /// Records a received frame. Called by the receive thread only.
+  void received(const Message& message, Clock::time_point time);
+
+  /// Records that a received frame has been dispatched.
+  void dispatched(const Message& message, Clock::time_point received);
+
+  /// Records a sent frame.
+  void sent(const Message& message, bool success);
+
+  /// Copies out all counters.
+  Snapshot snapshot() const;
+
+  /// Resets all counters. Updates running concurrently may get lost.
+  void reset();
+
+ private:
+  struct Slot;
+  struct SdoSlot;
+
+  static const size_t cob_id_count = 2048;
+
+  std::unique_ptr<Slot[]> m_slots;
+  std::unique_ptr<SdoSlot[]> m_sdo_slots;
+  std::atomic<int64_t> m_reset_time{0};
+};
+
+}  // end namespace kaco
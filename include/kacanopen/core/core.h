@@ -40,10 +40,14 @@
 #include <thread>
 #include <vector>
 
+#include "kacanopen/core/bus_statistics.h"
+#include "kacanopen/core/frame_recorder.h"
 #include "kacanopen/core/message.h"
 #include "kacanopen/core/nmt.h"
 #include "kacanopen/core/pdo.h"
 #include "kacanopen/core/sdo.h"
+#include "kacanopen/core/sync.h"
+#include "kacanopen/core/virtual_bus.h"
 
 namespace kaco {
 
@@ -53,7 +57,7 @@ namespace kaco {
 /// It communicates with the CAN driver, sends
 /// CAN messages and listens for incoming
 /// CAN messages. You can access CanOpen sub-
-/// protocols using public members nmt, sdo and pdo.
+/// protocols using public members nmt, sdo, pdo and sync.
 ///
 /// All methods except start() and stop() are thread-safe.
 class Core {
@@ -95,18 +99,38 @@ class Core {
   /// \remark Core must not run yet.
   bool start(const std::string busname, const unsigned baudrate);
 
+  /// Attaches to an in-process bus instead of a CAN driver and starts CAN
+  /// message receive loop.
+  /// \param bus The virtual bus. It must outlive the running Core.
+  /// \returns true if successful
+  /// \remark Core must not run yet.
+  bool start(VirtualBus& bus);
+
   /// Stops the receive loop and closes the driver.
   /// \remark Core must be running.
   void stop();
 
   /// Sends a message
+  /// \returns false if the message could not be sent, e.g. because the Core
+  ///   is not running.
   /// \remark thread-safe if m_lock_send==true or driver is thread-safe.
   bool send(const Message& message);
 
+  /// Sends several messages back-to-back without letting other messages of
+  /// this Core in between.
+  /// \returns true if all messages have been sent
+  /// \remark thread-safe
+  bool send(const std::vector<Message>& messages);
+
   /// Registers a callback function which is called when a message has been
   /// received. \remark thread-safe
   void register_receive_callback(const MessageReceivedCallback& callback);
 
+  /// Attaches a recorder which captures all received and sent messages.
+  /// Pass nullptr to detach it. The recorder must stay open while attached.
+  /// \remark thread-safe
+  void set_recorder(FrameRecorder* recorder);
+
   /// The NMT sub-protocol
   NMT nmt;
 
@@ -116,15 +140,31 @@ class Core {
   /// The PDO sub-protocol
   PDO pdo;
 
+  /// The SYNC sub-protocol
+  SYNC sync;
+
+  /// Traffic statistics of this Core. Use statistics.snapshot() to read
+  /// them.
+  BusStatistics statistics;
+
  private:
+  friend class FrameReplayer;
+
   void receive_loop(std::atomic<bool>& running);
+  void dispatch(const Message& message);
   void received_message(const Message& m);
+  void record_sent(const Message& message, bool sent);
 
   static const bool debug = false;
 
   std::atomic<bool> m_running{false};
   std::thread m_loop_thread;
-  void* m_handle;
+  void* m_handle = nullptr;
+
+  VirtualBus* m_virtual_bus = nullptr;
+  std::shared_ptr<VirtualBus::Endpoint> m_virtual_endpoint;
+
+  std::atomic<FrameRecorder*> m_recorder{nullptr};
 
   std::vector<MessageReceivedCallback> m_receive_callbacks;
   mutable std::mutex m_receive_callbacks_mutex;
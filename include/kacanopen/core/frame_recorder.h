@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "kacanopen/core/message.h"
+
+namespace kaco {
+
+/// This class appends CAN frames to a compact binary log file, e.g. to
+/// capture field traffic for later analysis or replay with FrameReplayer.
+///
+/// The file is preallocated and memory-mapped when it is opened, so
+/// record() never performs a system call and never blocks: it reserves a
+/// slot with a single atomic increment and copies the frame into the
+/// mapping. When the file is full, further frames are dropped and counted.
+///
+/// File layout (little-endian): a 64 byte FileHeader followed by fixed-size
+/// 24 byte Records. Records which have not been written have zero flags,
+/// so a log is readable even if the process crashed before close().
+///
+/// Usage:
+///
+///     kaco::FrameRecorder recorder;
+///     recorder.open("capture.kacorec", 1 << 20);
+///     core.set_recorder(&recorder);
+///     // ...
+///     core.set_recorder(nullptr);
+///     recorder.close();
+///
+/// record() is thread-safe. open() and close() must not be called while
+/// frames are recorded, i.e. while the recorder is attached to a Core.
+class FrameRecorder {
+ public:
+  /// Direction of a recorded frame.
+  enum class Direction : uint8_t { received = 1, transmitted = 2 };
+
+  /// Flags of a Record.
+  enum Flags : uint8_t {
+    flag_received = static_cast<uint8_t>(Direction::received),
+    flag_transmitted = static_cast<uint8_t>(Direction::transmitted),
+    flag_rtr = 0x04
+  };
+
+  /// Magic number at the start of every log file ("KACOREC1").
+  static const uint64_t magic = 0x314345524f43414bULL;
+
+  /// Header at the start of a log file.
+  struct FileHeader {
+    /// Always FrameRecorder::magic.
+    uint64_t magic;
+
+    /// Size of FileHeader in bytes.
+    uint32_t header_size;
+
+    /// Size of Record in bytes.
+    uint32_t record_size;
+
+    /// Number of record slots in the file.
+    uint64_t capacity;
+
+    /// Number of written records. Set by close(), zero before.
+    uint64_t count;
+
+    /// Number of frames which did not fit into the file. Set by close().
+    uint64_t dropped;
+
+    /// Wall clock time of open() in nanoseconds since the Unix epoch.
+    int64_t start_time_ns;
+
+    /// Reserved, zero.
+    uint64_t reserved[2];
+  };
+
+  /// A recorded frame.
+  struct Record {
+    /// Nanoseconds since open() (steady clock).
+    uint64_t timestamp_ns;
+
+    /// COB-ID
+    uint16_t cob_id;
+
+    /// Bus ID passed to open().
+    uint8_t bus_id;
+
+    /// Combination of Flags. Zero marks an unwritten record.
+    uint8_t flags;
+
+    /// Data length (0-8)
+    uint8_t len;
+
+    /// Reserved, zero.
+    uint8_t reserved[3];
+
+    /// Data bytes
+    uint8_t data[8];
+  };
+
+  /// Constructor.
+  FrameRecorder() = default;
+
+  /// Closes the file if open.
+  ~FrameRecorder();
+
+  /// Copy constructor deleted because the recorder owns a mapping.
+  FrameRecorder(const FrameRecorder&) = delete;
+
+  /// Creates (or truncates) a log file, preallocates space for the given
+  /// number of frames and maps it into memory.
+  /// \param path File path
+  /// \param capacity Maximum number of frames
+  /// \param bus_id ID stored in every record to tell apart several buses
+  /// \returns true if successful
+  bool open(const std::string& path, size_t capacity, uint8_t bus_id = 0);
+
+  /// Completes the header, flushes the mapping and closes the file.
+  void close();
+
+  /// Returns true if a file is open.
+  bool is_open() const { return m_records != nullptr; }
+
+  /// Appends a frame. Does nothing if no file is open.
+  /// \remark thread-safe, lock-free
+  void record(const Message& message, Direction direction);
+
+  /// Returns the number of recorded frames.
+  size_t get_count() const;
+
+  /// Returns the number of frames which have been dropped because the file
+  /// was full.
+  size_t get_dropped() const;
+
+ private:
+  static const bool debug = false;
+
+  int m_fd = -1;
+  void* m_mapping = nullptr;
+  size_t m_mapping_size = 0;
+  FileHeader* m_header = nullptr;
+  Record* m_records = nullptr;
+  size_t m_capacity = 0;
+  uint8_t m_bus_id = 0;
+  std::chrono::steady_clock::time_point m_start;
+  std::atomic<size_t> m_next{0};
+};
+
+static_assert(sizeof(FrameRecorder::FileHeader) == 64,
+              "Unexpected FrameRecorder::FileHeader layout");
+static_assert(sizeof(FrameRecorder::Record) == 24,
+              "Unexpected FrameRecorder::Record layout");
+
+}  // end namespace kaco
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "kacanopen/core/frame_recorder.h"
+
+namespace kaco {
+
+class Core;
+
+/// This class reads a log file written by FrameRecorder and feeds the frames
+/// into a Core as if they had been received from the bus. Replayed frames
+/// are dispatched in the calling thread and run the normal protocol
+/// handlers, which may answer them (e.g. NMT resetting an unknown node).
+/// On a Core which has not been started, these answers are dropped. Start
+/// the Core on a VirtualBus to observe them.
+///
+/// Frames are replayed either time-faithfully (speed 1), time-scaled
+/// (e.g. speed 10) or as fast as possible (speed 0). The latter turns a
+/// production capture into a CPU benchmark of the receive path.
+///
+/// Usage:
+///
+///     kaco::FrameReplayer replayer;
+///     if (replayer.open("capture.kacorec")) {
+///       replayer.replay(core, 0);
+///     }
+///
+/// stop() is thread-safe. All other methods must not be called concurrently.
+class FrameReplayer {
+ public:
+  /// Result of a replay.
+  struct Result {
+    /// Number of dispatched frames.
+    size_t frames;
+
+    /// Duration of the replay.
+    std::chrono::steady_clock::duration elapsed;
+
+    /// Largest delay of a frame behind its schedule. Zero at maximum speed.
+    std::chrono::steady_clock::duration max_lag;
+  };
+
+  /// Constructor.
+  FrameReplayer() = default;
+
+  /// Closes the file if open.
+  ~FrameReplayer();
+
+  /// Copy constructor deleted because the replayer owns a mapping.
+  FrameReplayer(const FrameReplayer&) = delete;
+
+  /// Maps a log file into memory.
+  /// \returns false if the file cannot be read or is not a valid log
+  bool open(const std::string& path);
+
+  /// Unmaps the file.
+  void close();
+
+  /// Returns the header of the open file.
+  const FrameRecorder::FileHeader& get_header() const { return *m_header; }
+
+  /// Returns the number of records in the open file.
+  size_t size() const { return m_size; }
+
+  /// Returns a record of the open file.
+  const FrameRecorder::Record& get_record(size_t i) const {
+    return m_records[i];
+  }
+
+  /// Converts a record back into a message.
+  static Message to_message(const FrameRecorder::Record& record);
+
+  /// Dispatches the received frames of the open file to a core.
+  /// Transmitted frames are skipped since they originated from the
+  /// application.
+  /// \param core The core which processes the frames
+  /// \param speed Time scale factor. 1 replays in real time, 0 replays as
+  ///   fast as possible.
+  /// \param bus_id Replay only frames of this bus ID. -1 replays all.
+  Result replay(Core& core, double speed = 1.0, int bus_id = -1);
+
+  /// Makes a running replay() return early.
+  /// \remark thread-safe
+  void stop();
+
+ private:
+  static const bool debug = false;
+
+  int m_fd = -1;
+  const void* m_mapping = nullptr;
+  size_t m_mapping_size = 0;
+  const FrameRecorder::FileHeader* m_header = nullptr;
+  const FrameRecorder::Record* m_records = nullptr;
+  size_t m_size = 0;
+  std::atomic<bool> m_stop{false};
+};
+
+}  // end namespace kaco
@@ -50,6 +50,14 @@ class Config {
   /// Number of repetitions when an SDO timeout occurs in SDO download/upload
   static size_t repeats_on_sdo_timeout;
 
+  /// Maximum number of bytes a local SDO server accepts in a single
+  /// segmented or block download.
+  static size_t sdo_server_max_transfer_size;
+
+  /// Time in milliseconds after which a local SDO server drops a transfer
+  /// the client has stopped talking to.
+  static size_t sdo_server_transfer_timeout_ms;
+
   /// If this is set to true, EDSReader will mark all entries as generic
   /// (Entry::is_generic) This is used internally. Do not modify this unless you
   /// know what you do!
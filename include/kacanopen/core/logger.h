@@ -31,18 +31,115 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 // DO NOT INCLUDE THIS IN A LIBRARY HEADER!
 
 // defined/not defined by CMake
 // #define EXHAUSTIVE_DEBUGGING
 
-#define PRINT(x) std::cout << x << std::endl;
-#define WARN(x) PRINT("WARNING: " << x);
-#define ERROR(x) std::cerr << "ERROR: " << x << std::endl;
-#define DUMP(x) PRINT(#x << " = " << std::dec << x);
-#define DUMP_HEX(x) PRINT(#x << " = 0x" << std::hex << x);
+// Compile-time filter: 0 = everything (default), 1 = warnings and errors,
+// 2 = errors only, 3 = nothing. PRINT, DUMP and the DEBUG macros count as
+// info.
+#ifndef KACO_LOG_LEVEL
+#define KACO_LOG_LEVEL 0
+#endif
+
+namespace kaco {
+
+/// Asynchronous logger behind the PRINT, WARN, ERROR and DUMP macros.
+///
+/// Messages are formatted by the calling thread into a string and handed to
+/// a bounded lock-free queue. A background thread writes them to stdout
+/// (stderr for errors), so callers don't block on terminal I/O. If the
+/// queue is full, messages are dropped and the writer reports how many.
+/// WARN and ERROR are rate limited per call site, so fault storms can't fill
+/// the queue.
+///
+/// Pending messages are written at exit. Call flush() before printing
+/// directly to std::cout if the order matters.
+class Logger {
+ public:
+  /// Log level
+  enum class Level : uint8_t { info, warning, error };
+
+  /// Per call site rate limit. Allows a burst of max_per_second messages per
+  /// one second window.
+  class RateLimit {
+   public:
+    static const uint32_t max_per_second = 20;
+
+    /// Returns true if the message may be logged.
+    bool allow();
+
+    /// Returns and resets the number of suppressed messages.
+    uint64_t take_suppressed() { return m_suppressed.exchange(0); }
+
+   private:
+    std::atomic<int64_t> m_window_start_ms{0};
+    std::atomic<uint32_t> m_count{0};
+    std::atomic<uint64_t> m_suppressed{0};
+  };
+
+  /// Queues a message.
+  static void log(Level level, std::string text);
+
+  /// Queues a message if the rate limit allows it.
+  static void log(Level level, RateLimit& rate_limit, std::string text);
+
+  /// Blocks until all queued messages have been written.
+  static void flush();
+
+  /// Enables (default) or disables the background writer. When disabled,
+  /// messages are written immediately by the calling thread.
+  static void set_asynchronous(bool asynchronous);
+};
+
+}  // end namespace kaco
+
+#define KACO_LOG_(level, x)                          \
+  {                                                  \
+    std::ostringstream kaco_log_stream_;             \
+    kaco_log_stream_ << x;                           \
+    kaco::Logger::log(level, kaco_log_stream_.str()); \
+  }
+
+#define KACO_LOG_LIMITED_(level, x)                                     \
+  {                                                                     \
+    static kaco::Logger::RateLimit kaco_rate_limit_;                    \
+    if (kaco_rate_limit_.allow()) {                                     \
+      std::ostringstream kaco_log_stream_;                              \
+      kaco_log_stream_ << x;                                            \
+      kaco::Logger::log(level, kaco_rate_limit_, kaco_log_stream_.str()); \
+    }                                                                   \
+  }
+
+#if KACO_LOG_LEVEL < 1
+#define PRINT(x) KACO_LOG_(kaco::Logger::Level::info, x)
+#define DUMP(x) PRINT(#x << " = " << std::dec << x)
+#define DUMP_HEX(x) PRINT(#x << " = 0x" << std::hex << x)
+#else
+#define PRINT(x) {}
+#define DUMP(x) {}
+#define DUMP_HEX(x) {}
+#endif
+
+#if KACO_LOG_LEVEL < 2
+#define WARN(x) \
+  KACO_LOG_LIMITED_(kaco::Logger::Level::warning, "WARNING: " << x)
+#else
+#define WARN(x) {}
+#endif
+
+#if KACO_LOG_LEVEL < 3
+#define ERROR(x) KACO_LOG_LIMITED_(kaco::Logger::Level::error, "ERROR: " << x)
+#else
+#define ERROR(x) {}
+#endif
 
 #ifdef NDEBUG
 #define DEBUG(x)
@@ -80,6 +80,14 @@ class NMT {
     preoperational = 0x7F
   };
 
+  /// Type of a callback which is called when a local node receives an NMT
+  /// command (either addressed to it or broadcast).
+  using CommandCallback = std::function<void(Command)>;
+
+  /// Type of a callback which is called when a local node receives a node
+  /// guarding request (RTR on 0x700+node_id).
+  using GuardRequestCallback = std::function<void()>;
+
   /// Constructor.
   /// \param core Reference to the Core
   NMT(Core& core);
@@ -129,8 +137,39 @@ class NMT {
   void register_device_dead_callback(const DeviceAliveCallback& callback);
 
   void change_alive_check_interval(size_t interval);
-  
+
+  /// Process incoming NMT module control message (COB-ID 0x000).
+  /// Commands are passed to the local nodes they are addressed to.
+  /// \param message The received CanOpen message.
+  /// \remark thread-safe
+  void process_incoming_command(const Message& message);
+
+  /// Registers a local (slave) node, so it receives NMT commands and node
+  /// guarding requests. Callbacks are called synchronously from the receive
+  /// loop and must not block.
+  /// \param node_id Node id of the local node
+  /// \param on_command Called for each NMT command addressed to the node.
+  /// \param on_guard_request Called for each node guarding request.
+  /// \remark thread-safe
+  void register_local_node(uint8_t node_id, const CommandCallback& on_command,
+                           const GuardRequestCallback& on_guard_request);
+
+  /// Removes a local node registered with register_local_node().
+  /// \remark thread-safe
+  void remove_local_node(uint8_t node_id);
+
+  /// Enables or disables master behaviour: Answering boot-up messages with
+  /// node guarding requests and resetting unknown operational nodes.
+  /// Disable this if the Core is used for slave nodes only. Default: enabled.
+  /// \remark thread-safe
+  void set_node_management(bool enabled);
+
  private:
+  struct LocalNode {
+    CommandCallback on_command;
+    GuardRequestCallback on_guard_request;
+  };
+
   static const bool debug = false;
   Core& m_core;
 
@@ -146,8 +185,13 @@ class NMT {
 
   std::atomic<size_t> alive_check_interval_;
   std::unordered_map<size_t, DeviceState> alive_devices_;
+  mutable std::mutex alive_devices_mutex_;
   bool thread_alive_;
   std::thread alive_devices_thread_;
+
+  std::atomic<bool> node_management_{true};
+  std::unordered_map<uint8_t, LocalNode> local_nodes_;
+  mutable std::mutex local_nodes_mutex_;
 };
 
 }  // end namespace kaco
@@ -64,6 +64,9 @@ class PDO {
 
     /// The callback
     Callback callback;
+
+    /// ID returned by add_pdo_received_callback()
+    uint32_t id;
   };
 
   /// Constructor
@@ -89,11 +92,34 @@ class PDO {
   /// given COB-ID. \param cob_id COB-ID to listen for \param callback Callback
   /// function, which takes a const Message reference as argument. \todo Rename
   /// this to add_tpdo_received_callback() and add add_rpdo_received_callback()
+  /// \returns An ID which can be passed to remove_pdo_received_callback().
+  /// \remark thread-safe
+  uint32_t add_pdo_received_callback(uint16_t cob_id,
+                                     PDOReceivedCallback::Callback callback);
+
+  /// Removes the callback with the given ID. Other callbacks for the same
+  /// COB-ID stay registered.
+  /// \param id ID returned by add_pdo_received_callback()
+  /// \remark thread-safe
+  void remove_pdo_received_callback(uint32_t id);
+
+  /// Handler for an incoming receive PDO (master->slave direction, function
+  /// codes 4, 6, 8 and 10). This is used by local slave nodes.
+  /// \param message The message from the network
   /// \remark thread-safe
-  void add_pdo_received_callback(uint16_t cob_id,
-                                 PDOReceivedCallback::Callback callback);
+  void process_incoming_rpdo(const Message& message) const;
 
-  void remove_pdo_received_callback(uint16_t cob_id);
+  /// Adds a callback which will be called when a receive PDO has been received
+  /// with the given COB-ID. This is used by local slave nodes.
+  /// \param cob_id COB-ID to listen for
+  /// \param callback Callback function, which takes the data bytes as argument.
+  /// \remark thread-safe
+  void add_rpdo_received_callback(uint16_t cob_id,
+                                  PDOReceivedCallback::Callback callback);
+
+  /// Removes all receive PDO callbacks with the given COB-ID.
+  /// \remark thread-safe
+  void remove_rpdo_received_callbacks(uint16_t cob_id);
 
  private:
   static const bool debug = false;
@@ -101,6 +127,10 @@ class PDO {
 
   std::vector<PDOReceivedCallback> m_receive_callbacks;
   mutable std::mutex m_receive_callbacks_mutex;
+  uint32_t m_next_callback_id = 0;
+
+  std::vector<PDOReceivedCallback> m_rpdo_receive_callbacks;
+  mutable std::mutex m_rpdo_receive_callbacks_mutex;
 };
 
 }  // end namespace kaco
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+// DO NOT INCLUDE THIS IN A LIBRARY HEADER!
+
+// USDT (user-level statically defined tracing) probes of provider
+// "kacanopen". They are compiled in with the CMake option USDT_PROBES, which
+// requires <sys/sdt.h> (systemtap-sdt-dev). An unused probe is a single nop
+// instruction; arguments must therefore be cheap to evaluate. Without
+// USDT_PROBES, the macros expand to nothing.
+//
+// Probes and arguments:
+//
+//   frame_receive(uint16 cob_id, uint8 len, uint8* data)
+//     A frame has been received from the driver or virtual bus.
+//   dispatch_begin(uint16 cob_id), dispatch_end(uint16 cob_id)
+//     Around the synchronous processing of a received frame by all protocol
+//     handlers and PDO callbacks in the receive thread.
+//   pdo_unpack(uint8 node_id, uint16 cob_id, uint16 index, uint8 subindex)
+//     A received PDO is unpacked into a dictionary entry of a Device.
+//   entry_set_value(uint16 index, uint8 subindex, bool changed)
+//     Entry::set_value() has stored a value, before value-changed callbacks.
+//   tpdo_send(uint16 cob_id, uint8 len)
+//     A transmit PDO of the master has been packed for sending.
+//   sdo_start(uint8 node_id, uint16 index, uint8 subindex, uint8 command)
+//     An SDO request is about to be sent.
+//   sdo_complete(uint8 node_id, uint16 index, uint8 subindex, uint8 command)
+//     The response to an SDO request has been received (command is the
+//     server command specifier, 0x80 = abort).
+//   sdo_timeout(uint8 node_id, uint16 index, uint8 subindex)
+//     No response has been received within the SDO timeout.
+//   nmt_state(uint8 node_id, uint8 state)
+//     A heartbeat or boot-up message has been received. Emitted for every
+//     message, so filter for changes, e.g. in bpftrace:
+//       usdt:./libkacanopen_core.so:kacanopen:nmt_state
+//         /@s[arg0] != arg1/ { printf("%d -> %d\n", arg0, arg1);
+//                              @s[arg0] = arg1; }
+
+#ifdef USDT_PROBES
+
+#include <sys/sdt.h>
+
+#define KACO_PROBE1(name, a) DTRACE_PROBE1(kacanopen, name, a)
+#define KACO_PROBE2(name, a, b) DTRACE_PROBE2(kacanopen, name, a, b)
+#define KACO_PROBE3(name, a, b, c) DTRACE_PROBE3(kacanopen, name, a, b, c)
+#define KACO_PROBE4(name, a, b, c, d) \
+  DTRACE_PROBE4(kacanopen, name, a, b, c, d)
+
+#else
+
+#define KACO_PROBE1(name, a)
+#define KACO_PROBE2(name, a, b)
+#define KACO_PROBE3(name, a, b, c)
+#define KACO_PROBE4(name, a, b, c, d)
+
+#endif
@@ -31,6 +31,7 @@
 
 #pragma once
 
+#include <array>
 #include <functional>
 #include <list>
 #include <mutex>
@@ -49,13 +50,9 @@ class Core;
 ///
 /// This class implements the CanOpen SDO protocol
 ///
-/// \todo Add add_client_sdo_callback(SDOReceivedCallback) (callback signature
-/// void(const SDOResponse&)) and/or
-///		add_request_callback(node_id, SDORequestCallback) (listening only
-///for SDOs with slave's own node_id, callback signature void(index, subindex)).
-/// \todo Add send_response(node_id, index, subindex, vector<uint8_t> data)
-/// (chooses segmented/expedited transfer on it's own). \todo Add
-/// abort_transfer(node_id, index, subindex, errorcode).
+/// Client SDOs (requests addressed to a local slave node) are passed to
+/// callbacks registered with register_request_callback(). See SDOServer for
+/// a complete server implementation.
 ///
 /// All methods are thread-safe.
 class SDO {
@@ -65,6 +62,12 @@ class SDO {
   ///   from within (-> deadlock)!
   using SDOReceivedCallback = std::function<void(SDOResponse)>;
 
+  /// Type of a client SDO (request) receiver function. It gets the raw
+  /// message, which has been sent to the local node's COB-ID 0x600+node_id.
+  /// Important: Never call register_request_callback() or
+  ///   remove_request_callback() from within (-> deadlock)!
+  using SDORequestCallback = std::function<void(const Message&)>;
+
   /// Constructor
   /// \param core Reference to the Core
   SDO(Core& core);
@@ -94,10 +97,29 @@ class SDO {
 
   /// Process incoming SDO message.
   /// \param message The received CanOpen message.
-  /// \todo Rename this to process_incoming_server_sdo() and add
-  /// process_incoming_client_sdo() \remark thread-safe
+  /// \todo Rename this to process_incoming_server_sdo()
+  /// \remark thread-safe
   void process_incoming_message(const Message& message);
 
+  /// Process incoming client SDO message (request from a remote SDO client
+  /// to a local node).
+  /// \param message The received CanOpen message.
+  /// \remark thread-safe
+  void process_incoming_client_sdo(const Message& message);
+
+  /// Registers a callback which will be called for every client SDO message
+  /// addressed to the given local node id. Replaces a previously registered
+  /// callback for this node id.
+  /// \param node_id Node id of the local node
+  /// \param callback The callback
+  /// \remark thread-safe
+  void register_request_callback(uint8_t node_id,
+                                 const SDORequestCallback& callback);
+
+  /// Removes the request callback of the given local node id.
+  /// \remark thread-safe
+  void remove_request_callback(uint8_t node_id);
+
   /// Sends an SDO message and waits for the response.
   /// \param command SDO command specifier
   /// \param node_id Node id of remote device
@@ -151,6 +173,12 @@ class SDO {
   // could be confused and because m_receivers manipulation must be synchronized
   mutable std::array<std::mutex, 256> m_send_and_wait_mutex;
 
+  // Request receivers of local nodes (client SDOs) on per-node basis.
+  std::array<SDORequestCallback, 256> m_request_receivers;
+
+  // We must synchronize access to the m_request_receivers array entries.
+  mutable std::array<std::mutex, 256> m_request_receiver_mutexes;
+
   uint8_t size_flag(uint8_t size);
 
   /// Dummy callback. Prints a debug message.
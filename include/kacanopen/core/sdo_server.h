@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "kacanopen/core/message.h"
+
+namespace kaco {
+
+// forward declaration
+class Core;
+
+/// \class SDOServer
+///
+/// This class implements the server side of the CanOpen SDO protocol
+/// (CiA 301) for a local node: expedited, segmented and block transfers in
+/// both directions. It listens for client SDOs on COB-ID 0x600+node_id and
+/// answers on 0x580+node_id. The object dictionary itself is not part of
+/// this class. It is accessed via the upload and download handlers.
+///
+/// A transfer which the client does not continue within
+/// Config::sdo_server_transfer_timeout_ms is dropped. During a block
+/// download, requests are only recognized after the client has aborted the
+/// transfer or it has been dropped.
+///
+/// Handlers may throw sdo_error. The transfer is then aborted with the
+/// corresponding abort code (or general error for custom error types).
+///
+/// All methods are thread-safe.
+class SDOServer {
+ public:
+  /// Type of a function which returns the value of a dictionary entry
+  /// as little-endian bytes (SDO upload).
+  using UploadHandler =
+      std::function<std::vector<uint8_t>(uint16_t index, uint8_t subindex)>;
+
+  /// Type of a function which writes little-endian bytes into a dictionary
+  /// entry (SDO download).
+  using DownloadHandler = std::function<void(
+      uint16_t index, uint8_t subindex, const std::vector<uint8_t>& data)>;
+
+  /// Constructor. Registers the server at core.sdo.
+  /// \param core Reference to the Core
+  /// \param node_id Node id of the local node
+  /// \param upload_handler Called when a client reads an entry.
+  /// \param download_handler Called when a client has written an entry.
+  SDOServer(Core& core, uint8_t node_id, UploadHandler upload_handler,
+            DownloadHandler download_handler);
+
+  /// Destructor. Unregisters the server.
+  ~SDOServer();
+
+  /// Copy constructor deleted because of mutexes.
+  SDOServer(const SDOServer&) = delete;
+
+  /// Returns the node id of the local node.
+  uint8_t get_node_id() const;
+
+  /// Process a client SDO message. This is called by core.sdo.
+  /// \param message The received CanOpen message.
+  /// \remark thread-safe
+  void process_request(const Message& message);
+
+ private:
+  enum class State {
+    idle,
+    download_segmented,
+    upload_segmented,
+    download_block,
+    download_block_end,
+    upload_block_initiated,
+    upload_block,
+    upload_block_end
+  };
+
+  static const bool debug = false;
+
+  /// Maximum number of segments per block (CiA 301).
+  static const uint8_t max_block_size = 127;
+
+  void initiate_download(const Message& message);
+  void download_segment(const Message& message);
+  void initiate_upload(const Message& message);
+  void upload_segment(const Message& message);
+  void block_download(const Message& message);
+  void block_download_segment(const Message& message);
+  void block_upload(const Message& message);
+  void send_upload_block();
+
+  void send(const std::vector<uint8_t>& data);
+  void abort(uint16_t index, uint8_t subindex, uint32_t code);
+  void reset();
+
+  static uint16_t crc16(const std::vector<uint8_t>& data, size_t length);
+
+  Core& m_core;
+  const uint8_t m_node_id;
+  UploadHandler m_upload_handler;
+  DownloadHandler m_download_handler;
+
+  // state of the current transfer
+  std::mutex m_mutex;
+  State m_state = State::idle;
+  uint16_t m_index = 0;
+  uint8_t m_subindex = 0;
+  std::vector<uint8_t> m_buffer;
+  size_t m_expected_size = 0;
+  bool m_size_indicated = false;
+  size_t m_position = 0;
+  bool m_toggle = false;
+  bool m_crc_supported = false;
+  uint8_t m_block_size = max_block_size;
+  uint8_t m_sequence_number = 0;
+  uint8_t m_last_block_segments = 0;
+  bool m_last_segment_received = false;
+  std::chrono::steady_clock::time_point m_last_request;
+};
+
+}  // end namespace kaco
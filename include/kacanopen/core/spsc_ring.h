@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace kaco {
+
+/// A bounded lock-free ring buffer for exactly one producer thread and
+/// exactly one consumer thread.
+///
+/// push() must only be called by the producer, pop() only by the consumer.
+/// size() can be called from any thread, but the result is only a snapshot.
+template <typename T>
+class SPSCRing {
+ public:
+  /// Constructor.
+  /// \param capacity Maximum number of elements
+  explicit SPSCRing(size_t capacity) : m_buffer(capacity + 1) {}
+
+  /// Copy constructor deleted because of atomics.
+  SPSCRing(const SPSCRing&) = delete;
+
+  /// Appends an element.
+  /// \returns false if the ring is full.
+  bool push(const T& element) {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    const size_t next = increment(tail);
+    if (next == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    m_buffer[tail] = element;
+    m_tail.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /// Removes the oldest element.
+  /// \returns false if the ring is empty.
+  bool pop(T& element) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    element = m_buffer[head];
+    m_head.store(increment(head), std::memory_order_release);
+    return true;
+  }
+
+  /// Returns the number of elements.
+  size_t size() const {
+    const size_t head = m_head.load(std::memory_order_acquire);
+    const size_t tail = m_tail.load(std::memory_order_acquire);
+    return (tail >= head) ? tail - head : m_buffer.size() - head + tail;
+  }
+
+  /// Returns the maximum number of elements.
+  size_t capacity() const { return m_buffer.size() - 1; }
+
+ private:
+  size_t increment(size_t position) const {
+    return (position + 1 == m_buffer.size()) ? 0 : position + 1;
+  }
+
+  std::vector<T> m_buffer;
+  std::atomic<size_t> m_head{0};
+  std::atomic<size_t> m_tail{0};
+};
+
+}  // end namespace kaco
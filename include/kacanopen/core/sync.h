@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kacanopen/core/message.h"
+
+namespace kaco {
+
+// forward declaration
+class Core;
+
+/// \class SYNC
+///
+/// This class implements the CanOpen SYNC protocol (COB-ID 0x80).
+/// It can consume SYNC messages from another producer on the bus
+/// or act as SYNC producer itself.
+///
+/// All methods are thread-safe.
+class SYNC {
+ public:
+  /// Type of a SYNC receiver function. The argument is the SYNC counter
+  /// (1-240) or 0 if the SYNC message has no counter.
+  /// Important: Never call add_sync_received_callback() or
+  ///   remove_sync_received_callback() from within (-> deadlock)!
+  using SyncReceivedCallback = std::function<void(uint8_t counter)>;
+
+  /// Constructor
+  /// \param core Reference to the Core
+  SYNC(Core& core);
+
+  /// Destructor. Stops the producer.
+  ~SYNC();
+
+  /// Copy constructor deleted because of mutexes.
+  SYNC(const SYNC&) = delete;
+
+  /// Handler for an incoming SYNC message
+  /// \param message The message from the network
+  /// \remark thread-safe
+  void process_incoming_message(const Message& message) const;
+
+  /// Sends a SYNC message. Local SYNC callbacks are called as well
+  /// because a node doesn't receive its own messages.
+  /// \param counter SYNC counter (1-240) or 0 for a SYNC without counter.
+  /// \remark thread-safe
+  void send(uint8_t counter = 0) const;
+
+  /// Starts producing SYNC messages in a separate thread. The period is
+  /// kept without drift by sleeping until absolute points in time.
+  /// \param period Communication cycle period (like object 0x1006).
+  /// \param counter_overflow SYNC counter overflow value (2-240, like object
+  ///   0x1019) or 0 for SYNC messages without counter.
+  /// \remark thread-safe
+  void start_producer(std::chrono::microseconds period,
+                      uint8_t counter_overflow = 0);
+
+  /// Stops the SYNC producer if running.
+  /// \remark thread-safe
+  void stop_producer();
+
+  /// Returns true if the SYNC producer is running.
+  /// \remark thread-safe
+  bool is_producing() const;
+
+  /// Adds a callback which will be called when a SYNC message has been
+  /// received or produced. Callbacks are called synchronously from the
+  /// receive loop (or the producer thread), so they see all PDOs received
+  /// before the SYNC and none after it. They must return quickly.
+  /// \returns An ID which can be passed to remove_sync_received_callback().
+  /// \remark thread-safe
+  uint32_t add_sync_received_callback(SyncReceivedCallback callback);
+
+  /// Removes a SYNC callback.
+  /// \param id ID returned by add_sync_received_callback().
+  /// \remark thread-safe
+  void remove_sync_received_callback(uint32_t id);
+
+ private:
+  struct SyncReceiver {
+    uint32_t id;
+    SyncReceivedCallback callback;
+  };
+
+  void call_callbacks(uint8_t counter) const;
+  void produce(std::chrono::microseconds period, uint8_t counter_overflow);
+
+  static const bool debug = false;
+  Core& m_core;
+
+  std::vector<SyncReceiver> m_receive_callbacks;
+  mutable std::mutex m_receive_callbacks_mutex;
+  uint32_t m_next_callback_id = 0;
+
+  std::thread m_producer_thread;
+  bool m_producing = false;
+  mutable std::mutex m_producer_mutex;
+  std::condition_variable m_producer_condition;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace kaco {
+
+/// This class records a timeline of spans (e.g. SDO requests, lock waits and
+/// retry sleeps) and exports it in the Chrome trace event format, which can
+/// be opened in chrome://tracing or Perfetto.
+///
+/// Tracing is disabled by default. While disabled, TraceSpan costs a single
+/// relaxed atomic load. While enabled, every thread appends events to its own
+/// buffer without locks. A buffer stops recording when it is full; the
+/// number of dropped events is reported in the exported trace.
+///
+/// Usage:
+///
+///     kaco::Tracer::start();
+///     // bring up devices...
+///     kaco::Tracer::stop();
+///     kaco::Tracer::save_chrome_trace("bringup.json");
+///
+/// start() and stop() are thread-safe. write_chrome_trace() may run
+/// concurrently with recording and exports the events completed so far, but
+/// it must not run concurrently with clear(). clear() must only be called
+/// while no spans are recorded, i.e. after stop() and after the traced
+/// operations have returned.
+class Tracer {
+ public:
+  /// Enables recording.
+  /// \param events_per_thread Capacity of buffers created from now on
+  static void start(size_t events_per_thread = 1 << 16);
+
+  /// Disables recording. Recorded events are kept.
+  static void stop();
+
+  /// Returns true if recording is enabled.
+  static bool is_enabled() {
+    return m_enabled.load(std::memory_order_relaxed);
+  }
+
+  /// Discards all recorded events.
+  static void clear();
+
+  /// Writes all recorded events as Chrome trace event JSON.
+  static void write_chrome_trace(std::ostream& stream);
+
+  /// Writes all recorded events as Chrome trace event JSON into a file.
+  /// \returns false if the file cannot be written
+  static bool save_chrome_trace(const std::string& path);
+
+  /// Records a complete span. Called by TraceSpan.
+  static void record(const char* category, const char* name,
+                     int64_t start_ns, int64_t duration_ns, uint8_t node_id,
+                     uint16_t index, uint8_t subindex);
+
+  /// Returns a timestamp in nanoseconds for record().
+  static int64_t now_ns();
+
+ private:
+  static std::atomic<bool> m_enabled;
+};
+
+/// RAII helper which records a span from construction to destruction if
+/// tracing is enabled. Category and name must be string literals.
+class TraceSpan {
+ public:
+  TraceSpan(const char* category, const char* name, uint8_t node_id = 0,
+            uint16_t index = 0, uint8_t subindex = 0)
+      : m_category(category),
+        m_name(name),
+        m_node_id(node_id),
+        m_index(index),
+        m_subindex(subindex),
+        m_start_ns(Tracer::is_enabled() ? Tracer::now_ns() : 0) {}
+
+  ~TraceSpan() {
+    if (m_start_ns != 0) {
+      Tracer::record(m_category, m_name, m_start_ns,
+                     Tracer::now_ns() - m_start_ns, m_node_id, m_index,
+                     m_subindex);
+    }
+  }
+
+  /// Copy constructor deleted because a span is recorded once.
+  TraceSpan(const TraceSpan&) = delete;
+
+  /// Renames the span, e.g. to mark a timeout.
+  void rename(const char* name) { m_name = name; }
+
+ private:
+  const char* m_category;
+  const char* m_name;
+  uint8_t m_node_id;
+  uint16_t m_index;
+  uint8_t m_subindex;
+  int64_t m_start_ns;
+};
+
+}  // end namespace kaco
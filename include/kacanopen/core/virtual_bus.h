@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "kacanopen/core/message.h"
+
+namespace kaco {
+
+/// \class VirtualBus
+///
+/// This class implements an in-process CAN bus. Cores started with
+/// Core::start(VirtualBus&) exchange messages through it instead of a CAN
+/// driver. Like on a real bus, a message is delivered to all other attached
+/// cores but not to the sender. This allows testing masters against
+/// simulated slaves (see DeviceFarm) without any CAN hardware.
+///
+/// All methods are thread-safe.
+class VirtualBus {
+ public:
+  /// Constructor
+  VirtualBus() = default;
+
+  /// Copy constructor deleted because of mutexes.
+  VirtualBus(const VirtualBus&) = delete;
+
+  /// Returns the number of messages sent on the bus so far.
+  /// \remark thread-safe
+  size_t get_message_count() const;
+
+ private:
+  friend class Core;
+
+  struct Endpoint {
+    std::deque<Message> queue;
+    std::condition_variable condition;
+    std::mutex mutex;
+    bool open = true;
+  };
+
+  /// Attaches a new endpoint (used by Core::start()).
+  std::shared_ptr<Endpoint> attach();
+
+  /// Closes an endpoint and removes it from the bus. A blocking receive()
+  /// returns false. The caller's reference keeps the endpoint alive until
+  /// the receiving thread has returned.
+  void detach(Endpoint* endpoint);
+
+  /// Delivers a message to all endpoints except the sender.
+  void send(const Endpoint* sender, const Message& message);
+
+  /// Waits for the next message.
+  /// \returns false if the endpoint has been detached.
+  bool receive(Endpoint* endpoint, Message& message);
+
+  mutable std::mutex m_endpoints_mutex;
+  std::vector<std::shared_ptr<Endpoint>> m_endpoints;
+  size_t m_message_count = 0;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/nmt.h"
+#include "kacanopen/master/bus_protocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kaco {
+
+/// \class BusClient
+///
+/// This class connects to a BusManager over its Unix domain socket and
+/// gives access to the shared buses: SDO transfers, PDO subscriptions and
+/// NMT commands. Requests block until the manager responds.
+///
+/// ### Remarks on thread-safety:
+///
+///   All methods are thread-safe. PDO callbacks are called from the
+///   receive thread of the client and must not call methods of the client.
+class BusClient {
+ public:
+  /// Type of a PDO callback
+  using PDOCallback = std::function<void(const std::vector<uint8_t>& data)>;
+
+  /// Constructor. Connects to the manager.
+  /// \param socket_path Path of the manager's Unix domain socket
+  /// \throws canopen_error if the connection fails.
+  BusClient(const std::string& socket_path);
+
+  /// Destructor. Closes the connection.
+  ~BusClient();
+
+  /// Copy constructor deleted because of mutexes.
+  BusClient(const BusClient&) = delete;
+
+  /// SDO upload: reads an entry from a node.
+  /// \returns The data bytes in little-endian order
+  /// \throws sdo_error
+  /// \throws canopen_error if the connection is lost or the request is
+  ///   invalid.
+  std::vector<uint8_t> upload(uint8_t bus, uint8_t node_id, uint16_t index,
+                              uint8_t subindex,
+                              BusPriority priority = BusPriority::normal);
+
+  /// SDO download: writes an entry of a node.
+  /// \throws sdo_error
+  /// \throws canopen_error if the connection is lost or the request is
+  ///   invalid.
+  void download(uint8_t bus, uint8_t node_id, uint16_t index,
+                uint8_t subindex, const std::vector<uint8_t>& data,
+                BusPriority priority = BusPriority::normal);
+
+  /// Sends an NMT command. Node ID 0 broadcasts it.
+  /// \throws canopen_error
+  void send_nmt(uint8_t bus, uint8_t node_id, NMT::Command command);
+
+  /// Subscribes to PDOs with the given COB-ID. A previous callback for the
+  /// same PDO is replaced.
+  /// \throws canopen_error
+  void subscribe_pdo(uint8_t bus, uint16_t cob_id,
+                     const PDOCallback& callback);
+
+  /// Unsubscribes from PDOs with the given COB-ID.
+  /// \throws canopen_error
+  void unsubscribe_pdo(uint8_t bus, uint16_t cob_id);
+
+ private:
+  struct Response {
+    BusStatus status;
+    std::vector<uint8_t> payload;
+  };
+
+  Response request(BusMessageHeader header,
+                   const std::vector<uint8_t>& payload = {});
+  void check(const Response& response, const std::string& method);
+  void receive_loop();
+
+  static const bool debug = false;
+
+  int m_fd = -1;
+  std::thread m_receive_thread;
+  std::atomic<bool> m_connected{false};
+
+  uint32_t m_next_request_id = 0;
+  std::map<uint32_t, std::promise<Response>> m_pending;
+  std::mutex m_pending_mutex;
+  std::mutex m_write_mutex;
+
+  std::map<uint32_t, PDOCallback> m_pdo_callbacks;
+  std::mutex m_pdo_callbacks_mutex;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/bus_protocol.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kaco {
+
+/// \class BusManager
+///
+/// This class shares one or more buses with many local processes. It owns
+/// the SDO client channels of all nodes and accepts requests from BusClient
+/// instances over a Unix domain socket:
+///
+///   - SDO uploads and downloads are queued and executed by a pool of
+///     workers, at most one transfer per node at a time. Queued requests with
+///     a higher BusPriority go first, but requests for the same entry are
+///     executed in order.
+///   - Identical queued requests are merged: an upload is answered by one
+///     transfer for all clients unless a download to the same entry is
+///     queued in between, and identical downloads are sent only once.
+///   - PDOs are received once per bus and COB-ID and forwarded to all
+///     subscribed clients. PDOs are dropped for clients which don't read
+///     them fast enough.
+///   - Messages to clients are queued per client and never block the
+///     receive thread or the I/O thread. Clients which stop reading
+///     responses are disconnected.
+///   - NMT commands are sent immediately.
+///
+/// The daemon kacanopen_daemon (src/daemon) runs a BusManager for one or more
+/// CAN buses.
+class BusManager {
+ public:
+  /// Statistics since start()
+  struct Statistics {
+    /// Number of accepted client connections
+    uint64_t clients = 0;
+
+    /// Number of received requests
+    uint64_t requests = 0;
+
+    /// Number of executed SDO transfers
+    uint64_t sdo_transfers = 0;
+
+    /// Number of SDO requests merged into a queued transfer
+    uint64_t merged_requests = 0;
+
+    /// Number of PDOs forwarded to clients
+    uint64_t forwarded_pdos = 0;
+
+    /// Number of PDOs dropped because a client was too slow
+    uint64_t dropped_pdos = 0;
+  };
+
+  /// Constructor.
+  /// \param socket_path Path of the Unix domain socket
+  /// \param workers Number of SDO workers, i.e. the maximum number of nodes
+  ///   with concurrent SDO transfers
+  BusManager(const std::string& socket_path, size_t workers = 4);
+
+  /// Destructor. Calls stop().
+  ~BusManager();
+
+  /// Copy constructor deleted because of mutexes.
+  BusManager(const BusManager&) = delete;
+
+  /// Adds a bus. The core must be started and must outlive the manager.
+  /// \returns The bus number used by clients
+  /// \remark Must be called before start().
+  uint8_t add_bus(Core& core);
+
+  /// Creates the socket and starts the I/O thread and the SDO workers.
+  /// An existing socket file is replaced.
+  /// \throws canopen_error if the socket can't be created.
+  void start();
+
+  /// Closes all connections and stops all threads. Pending requests are
+  /// discarded.
+  void stop();
+
+  /// Returns the statistics.
+  Statistics get_statistics() const;
+
+ private:
+  struct Client;
+  struct Waiter {
+    std::shared_ptr<Client> client;
+    uint32_t request_id;
+  };
+  struct Job {
+    uint64_t sequence;
+    BusMessageType type;
+    uint8_t bus;
+    uint8_t node_id;
+    uint16_t index;
+    uint8_t subindex;
+    uint8_t priority;
+    std::vector<uint8_t> data;
+    std::vector<Waiter> waiters;
+  };
+
+  void io_loop();
+  void accept_client();
+  bool read_client(const std::shared_ptr<Client>& client);
+  void close_client(const std::shared_ptr<Client>& client);
+  void handle_request(const std::shared_ptr<Client>& client,
+                      const BusMessageHeader& header,
+                      std::vector<uint8_t> payload);
+  void enqueue(const std::shared_ptr<Client>& client,
+               const BusMessageHeader& header, std::vector<uint8_t> payload);
+  void worker_loop();
+  void execute(Job& job);
+  void forward_pdo(uint8_t bus, uint16_t cob_id,
+                   const std::vector<uint8_t>& data);
+  void respond(Client& client, uint32_t request_id, BusStatus status,
+               const std::vector<uint8_t>& payload = {});
+
+  static const bool debug = false;
+
+  /// Pending bytes per client above which PDOs are dropped
+  static const size_t max_pdo_backlog = 64 * 1024;
+
+  /// Pending bytes per client above which the client is disconnected
+  static const size_t max_backlog = 16 * 1024 * 1024;
+
+  const std::string m_socket_path;
+  const size_t m_worker_count;
+  std::vector<Core*> m_buses;
+
+  int m_listen_fd = -1;
+  int m_wake_pipe[2] = {-1, -1};
+  std::atomic<bool> m_running{false};
+  std::thread m_io_thread;
+  std::vector<std::thread> m_workers;
+
+  std::vector<std::shared_ptr<Client>> m_clients;
+
+  // queued SDO jobs, nodes with a running transfer (bus << 8 | node)
+  std::list<Job> m_jobs;
+  std::set<uint16_t> m_busy_nodes;
+  uint64_t m_next_sequence = 0;
+  std::mutex m_jobs_mutex;
+  std::condition_variable m_jobs_condition;
+
+  // subscribers and registered PDO callback IDs per (bus << 16 | cob_id)
+  std::map<uint32_t, std::vector<std::shared_ptr<Client>>> m_subscribers;
+  std::map<uint32_t, uint32_t> m_registered_pdos;
+  std::mutex m_subscribers_mutex;
+
+  Statistics m_statistics;
+  mutable std::mutex m_statistics_mutex;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace kaco {
+
+/// Priority of a request to the BusManager. Queued requests with a higher
+/// priority are executed first.
+enum class BusPriority : uint8_t { low = 0, normal = 1, high = 2 };
+
+/// Type of a message between BusManager and BusClient
+enum class BusMessageType : uint8_t {
+  /// Client -> manager: SDO upload of node_id/index/subindex
+  sdo_upload = 1,
+
+  /// Client -> manager: SDO download of the payload to node_id/index/subindex
+  sdo_download = 2,
+
+  /// Client -> manager: NMT command (subindex) to node_id (0 = broadcast)
+  nmt = 3,
+
+  /// Client -> manager: forward PDOs with COB-ID index
+  subscribe_pdo = 4,
+
+  /// Client -> manager: stop forwarding PDOs with COB-ID index
+  unsubscribe_pdo = 5,
+
+  /// Manager -> client: response to the request with the same request_id
+  response = 16,
+
+  /// Manager -> client: PDO with COB-ID index, data in the payload
+  pdo = 17
+};
+
+/// Status of a response
+enum class BusStatus : uint8_t {
+  /// Success. The payload contains the uploaded data, if any.
+  ok = 0,
+
+  /// SDO error. The payload contains the 32 bit error code (little endian)
+  /// followed by the error message.
+  sdo_error = 1,
+
+  /// Malformed request. The payload contains the error message.
+  invalid_request = 2,
+
+  /// There is no bus with the given number.
+  unknown_bus = 3
+};
+
+/// Header of every message on the bus manager socket. It is followed by
+/// size payload bytes. Both sides run on the same machine, so the header is
+/// sent in native byte order.
+struct BusMessageHeader {
+  /// Set by the client, copied into the response
+  uint32_t request_id;
+
+  /// Payload size in bytes
+  uint16_t size;
+
+  /// BusMessageType
+  uint8_t type;
+
+  /// BusStatus (responses only)
+  uint8_t status;
+
+  /// Bus number, see BusManager::add_bus()
+  uint8_t bus;
+
+  /// Node ID
+  uint8_t node_id;
+
+  /// Dictionary index or COB-ID
+  uint16_t index;
+
+  /// Dictionary sub-index or NMT command
+  uint8_t subindex;
+
+  /// BusPriority
+  uint8_t priority;
+
+  /// Reserved, must be zero
+  uint16_t reserved;
+};
+
+static_assert(sizeof(BusMessageHeader) == 16,
+              "BusMessageHeader must not contain padding.");
+
+}  // end namespace kaco
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/spsc_ring.h"
+#include "kacanopen/master/cyclic_executor.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/drive_state_machine.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace kaco {
+
+/// This class streams setpoints to a CiA 402 drive in one of the cyclic
+/// synchronous modes (CSP, CSV, CST) or in interpolated position mode (IP).
+///
+/// configure() sets up the drive once via SDO: mode of operation,
+/// interpolation time period and synchronous PDOs. Afterwards, all
+/// communication is done via PDOs:
+///
+///   - TPDO1 (drive -> master): statusword, position actual value
+///   - TPDO2 (drive -> master): velocity actual value, torque actual value
+///   - RPDO1 (master -> drive): controlword, target position / velocity /
+///     torque (controlword only in IP mode)
+///   - RPDO2 (master -> drive, IP mode only): interpolation data record
+///     (0x60C1sub1), asynchronous so that the drive queues every point
+///
+/// In IP mode, trajectory points are queued with push_point() into a
+/// lock-free ring. In every cycle, the task tops up the drive's input buffer
+/// (0x60C4) from this ring. The drive's buffer level is tracked on the host:
+/// one point is consumed per cycle while IP mode is active (statusword bit
+/// 12). An underrun is recorded whenever the drive runs out of points.
+///
+/// attach() adds a task to a CyclicExecutor, which runs the CiA 402 power
+/// state machine without blocking on feedback and sends the controlword and
+/// the current target in every SYNC cycle.
+///
+/// ### Remarks on thread-safety:
+///
+///   configure(), attach() and set_setpoint_generator() should be run in
+///   sequence before the executor is started. push_point() must only be
+///   called from one thread at a time. All other methods are thread-safe.
+class CyclicDrive {
+ public:
+  /// Supported modes of operation (object 0x6060)
+  enum class Mode : int8_t {
+    interpolated_position = 7,
+    position = 8,
+    velocity = 9,
+    torque = 10
+  };
+
+  /// CiA 402 power states, see DriveStateMachine
+  using State = DriveStateMachine::State;
+
+  /// Feedback from the last cycle
+  struct Feedback {
+    /// False until the first TPDO has been received
+    bool valid = false;
+
+    /// Raw statusword
+    uint16_t statusword = 0;
+
+    /// Decoded power state
+    State state = State::unknown;
+
+    /// Position actual value (0x6064)
+    int32_t position = 0;
+
+    /// Velocity actual value (0x606C)
+    int32_t velocity = 0;
+
+    /// Torque actual value (0x6077)
+    int16_t torque = 0;
+  };
+
+  /// Buffer statistics in IP mode
+  struct BufferStatistics {
+    /// Number of points in the host-side ring
+    size_t ring_level = 0;
+
+    /// Capacity of the host-side ring
+    size_t ring_capacity = 0;
+
+    /// Estimated number of points in the drive's input buffer
+    size_t drive_level = 0;
+
+    /// Size of the drive's input buffer (0x60C4sub2)
+    size_t drive_capacity = 0;
+
+    /// Minimum drive_level while IP mode was active
+    size_t min_drive_level = 0;
+
+    /// Number of points sent to the drive
+    uint64_t points_sent = 0;
+
+    /// Number of cycles in which the drive had no point left
+    uint64_t underruns = 0;
+  };
+
+  /// Type of a setpoint generator. It is called once per cycle while
+  /// operation is enabled and returns the new target.
+  using SetpointGenerator = std::function<int32_t(const Feedback&)>;
+
+  /// Constructor.
+  /// \param device The drive. Its dictionary must contain the CiA 402
+  ///   entries, e.g. by load_dictionary_from_library().
+  /// \param mode Mode of operation
+  /// \param ring_capacity Capacity of the host-side point ring in IP mode
+  CyclicDrive(Device& device, Mode mode, size_t ring_capacity = 1024);
+
+  /// Copy constructor deleted because of mutexes.
+  CyclicDrive(const CyclicDrive&) = delete;
+
+  /// Configures the drive via SDO and adds the local PDO mappings. In IP
+  /// mode, linear interpolation (0x60C0) is selected and the drive's input
+  /// buffer (0x60C4) is set to its maximum size and cleared if supported.
+  /// \param cycle_period The SYNC period. It is written into the interpolation
+  ///   time period (0x60C2) if the drive supports it.
+  /// \param map_in_device If false, the drive's PDOs are expected to be
+  ///   configured already and only the local mappings are added.
+  /// \throws sdo_error
+  /// \throws dictionary_error
+  void configure(std::chrono::microseconds cycle_period,
+                 bool map_in_device = true);
+
+  /// Registers the PDO entries at the executor and adds the cyclic task.
+  void attach(CyclicExecutor& executor);
+
+  /// Requests the transition to operation enabled. Faults are reset
+  /// automatically. When operation gets enabled, the target is set to the
+  /// current position (CSP) or to zero (CSV, CST).
+  void enable();
+
+  /// Requests the transition to switched on (operation disabled).
+  void disable();
+
+  /// Sets the target which is streamed to the drive in every cycle. The unit
+  /// depends on the mode: position increments, velocity units or per mille
+  /// of rated torque.
+  void set_target(int32_t target);
+
+  /// Sets a generator which computes the target in every cycle instead of
+  /// set_target(). Not used in IP mode.
+  void set_setpoint_generator(const SetpointGenerator& generator);
+
+  /// Queues a trajectory point (position increments) in IP mode.
+  /// \returns false if the ring is full.
+  bool push_point(int32_t position);
+
+  /// Returns the buffer statistics in IP mode.
+  BufferStatistics get_buffer_statistics() const;
+
+  /// Resets points_sent, underruns and min_drive_level.
+  void reset_buffer_statistics();
+
+  /// Returns the feedback of the last cycle.
+  Feedback get_feedback() const;
+
+  /// Returns the mode of operation.
+  Mode get_mode() const;
+
+  /// Returns the drive.
+  Device& get_device();
+
+ private:
+  void configure_interpolation();
+  void cycle(CyclicExecutor::CycleContext& context);
+  void feed_points(const Feedback& feedback);
+  uint16_t next_controlword(State state);
+  Value make_target(int32_t target) const;
+
+  static const bool debug = false;
+
+  Device& m_device;
+  const Mode m_mode;
+
+  size_t m_statusword_input = 0;
+  size_t m_position_input = 0;
+  size_t m_velocity_input = 0;
+  size_t m_torque_input = 0;
+  size_t m_controlword_output = 0;
+  size_t m_target_output = 0;
+  uint16_t m_point_cob_id = 0;
+
+  std::atomic<bool> m_enable{false};
+  std::atomic<int32_t> m_target{0};
+  SetpointGenerator m_generator;
+
+  // only accessed by the executor thread
+  State m_last_state = State::unknown;
+  uint16_t m_last_controlword = 0;
+
+  Feedback m_feedback;
+  mutable std::mutex m_feedback_mutex;
+
+  SPSCRing<int32_t> m_points;
+  BufferStatistics m_buffer_statistics;
+  mutable std::mutex m_buffer_statistics_mutex;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/value.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kaco {
+
+/// This class runs control tasks once per communication cycle at a fixed
+/// phase after each SYNC. The SYNC can be produced by the local Core
+/// (core.sync.start_producer()) or consumed from another producer.
+///
+/// Each cycle works like this:
+///
+///   1. When the SYNC arrives, all registered inputs are copied into a
+///      snapshot. This happens in the receive loop, so the snapshot contains
+///      all PDOs received before the SYNC and none after it.
+///   2. At SYNC time + phase, all tasks are called in the order they were
+///      added. They read the snapshot and set outputs via CycleContext.
+///   3. The outputs are written into the device caches (ON_CHANGE mappings
+///      are sent immediately) and all SYNCHRONOUS transmit PDO mappings of
+///      the output devices are sent in one burst, optionally delayed until
+///      SYNC time + output phase (see set_output_phase()). If a task or
+///      writing the outputs throws, no PDOs are sent in this cycle.
+///   4. If step 3 finished after SYNC time + window, the cycle counts as
+///      deadline miss. If a SYNC arrives before the previous cycle has
+///      been started, the previous cycle is skipped and counts as overrun.
+///
+/// Example:
+///
+///     kaco::CyclicExecutor executor(core, std::chrono::microseconds(200),
+///                                   std::chrono::microseconds(800));
+///     const size_t position = executor.add_input(device, "Position actual value");
+///     const size_t target = executor.add_output(device, "Target position");
+///     device.add_transmit_pdo_mapping(0x401, {{"Target position", 0}},
+///                                     kaco::TransmissionType::SYNCHRONOUS);
+///     executor.add_task([&](kaco::CyclicExecutor::CycleContext& cycle) {
+///       const int32_t actual = cycle.get_input(position);
+///       cycle.set_output(target, actual + 100);
+///     });
+///     executor.start();
+///     core.sync.start_producer(std::chrono::milliseconds(1));
+///
+/// ### Remarks on thread-safety:
+///
+///   add_input(), add_output() and add_task() must be called before start().
+///   Tasks run in a separate executor thread. get_statistics() and
+///   reset_statistics() are thread-safe.
+class CyclicExecutor {
+ public:
+  /// Number of execution time histogram buckets.
+  static const size_t histogram_size = 16;
+
+  /// Input snapshot and output collector of one cycle.
+  class CycleContext {
+   public:
+    /// Returns an input value from the snapshot.
+    /// \param input Handle returned by add_input().
+    /// \returns The value, which is invalid if the entry had no value yet.
+    const Value& get_input(size_t input) const;
+
+    /// Sets an output value which will be written after all tasks have run.
+    /// \param output Handle returned by add_output().
+    /// \param value The value. It must have the type of the entry.
+    void set_output(size_t output, const Value& value);
+
+    /// Number of the cycle since start().
+    uint64_t cycle;
+
+    /// SYNC counter (1-240) or 0 if the SYNC message has no counter.
+    uint8_t sync_counter;
+
+    /// Point in time at which the SYNC has been received or produced.
+    std::chrono::steady_clock::time_point sync_time;
+
+   private:
+    friend class CyclicExecutor;
+    std::vector<Value> m_inputs;
+    std::vector<Value> m_outputs;
+  };
+
+  /// Type of a cyclic task
+  using Task = std::function<void(CycleContext&)>;
+
+  /// Result of one cycle, see set_cycle_callback().
+  struct CycleResult {
+    /// Number of the cycle since start()
+    uint64_t cycle;
+
+    /// Delay between the intended start (SYNC + phase) and the actual start
+    std::chrono::microseconds start_latency;
+
+    /// Time the tasks and writing the outputs took, excluding the wait for
+    /// the output phase and the transmission
+    std::chrono::microseconds execution_time;
+
+    /// True if the outputs were sent after SYNC + window
+    bool deadline_missed;
+  };
+
+  /// Accumulated statistics since start() or reset_statistics().
+  struct Statistics {
+    /// Number of executed cycles
+    uint64_t cycles = 0;
+
+    /// Number of cycles which finished after SYNC + window
+    uint64_t deadline_misses = 0;
+
+    /// Number of SYNCs which arrived before the previous cycle was started
+    uint64_t overruns = 0;
+
+    /// Number of exceptions thrown by tasks or while sending outputs
+    uint64_t errors = 0;
+
+    /// Maximum start latency
+    std::chrono::microseconds max_start_latency{0};
+
+    /// Maximum execution time
+    std::chrono::microseconds max_execution_time{0};
+
+    /// Execution time histogram: Bucket 0 counts cycles with less than 1 us,
+    /// bucket i counts cycles with [2^(i-1), 2^i) us, and the last bucket
+    /// counts everything above.
+    std::array<uint64_t, histogram_size> execution_time_histogram{};
+  };
+
+  /// Constructor.
+  /// \param core Reference of a Core instance
+  /// \param phase Delay between the SYNC and the start of the tasks.
+  /// \param window Time after the SYNC until which outputs must be sent
+  ///   (like the synchronous window length in object 0x1007).
+  CyclicExecutor(Core& core, std::chrono::microseconds phase,
+                 std::chrono::microseconds window);
+
+  /// Copy constructor deleted because of mutexes.
+  CyclicExecutor(const CyclicExecutor&) = delete;
+
+  /// Stops the executor.
+  ~CyclicExecutor();
+
+  /// Registers a dictionary entry which is copied into the input snapshot
+  /// on each SYNC. Usually this entry is mapped to a receive PDO.
+  /// \returns Handle for CycleContext::get_input()
+  /// \throws dictionary_error if there is no entry with the given name.
+  size_t add_input(Device& device, const std::string& entry_name);
+
+  /// Registers a dictionary entry which can be written by tasks. Usually
+  /// this entry is mapped to a SYNCHRONOUS transmit PDO.
+  /// \returns Handle for CycleContext::set_output()
+  /// \throws dictionary_error if there is no entry with the given name.
+  size_t add_output(Device& device, const std::string& entry_name);
+
+  /// Adds a task. Tasks are called in the order they have been added.
+  void add_task(const Task& task);
+
+  /// Sets a callback which is called after each cycle from the executor
+  /// thread.
+  void set_cycle_callback(const std::function<void(const CycleResult&)>& callback);
+
+  /// Delays the output burst until SYNC time + output_phase, e.g. to send
+  /// all setpoints just before the next SYNC. Zero (default) sends them
+  /// right after the tasks.
+  void set_output_phase(std::chrono::microseconds output_phase);
+
+  /// Registers the SYNC callback and starts the executor thread.
+  void start();
+
+  /// Stops the executor thread and unregisters the SYNC callback.
+  void stop();
+
+  /// Returns the accumulated statistics.
+  /// \remark thread-safe
+  Statistics get_statistics() const;
+
+  /// Resets the accumulated statistics.
+  /// \remark thread-safe
+  void reset_statistics();
+
+  /// Prints the accumulated statistics to command line.
+  void print_statistics() const;
+
+ private:
+  struct EntryReference {
+    Device* device;
+    std::string entry_name;
+  };
+
+  void sync_received(uint8_t counter);
+  void run();
+  void write_outputs(const CycleContext& context);
+  void record(const CycleResult& result);
+
+  static const bool debug = false;
+
+  Core& m_core;
+  const std::chrono::microseconds m_phase;
+  const std::chrono::microseconds m_window;
+  std::chrono::microseconds m_output_phase{0};
+
+  // output burst of the current cycle, only accessed by the executor thread
+  std::vector<Message> m_output_messages;
+
+  std::vector<EntryReference> m_inputs;
+  std::vector<EntryReference> m_outputs;
+  std::vector<Device*> m_output_devices;
+  std::vector<Task> m_tasks;
+  std::function<void(const CycleResult&)> m_cycle_callback;
+
+  // Protected by m_mutex
+  bool m_running = false;
+  bool m_pending = false;
+  CycleContext m_next_cycle;
+  uint64_t m_cycle_counter = 0;
+  Statistics m_statistics;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::thread m_thread;
+  uint32_t m_sync_callback_id = 0;
+};
+
+}  // end namespace kaco
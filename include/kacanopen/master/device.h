@@ -105,6 +105,10 @@ class Device {
   /// \remark thread-safe
   uint8_t get_node_id() const;
 
+  /// Returns the core the device is attached to.
+  /// \remark thread-safe
+  Core& get_core();
+
   /// \name (1) Methods which manipulate the dictionary structure
   ///@{
 
@@ -171,6 +175,20 @@ class Device {
   /// \throws dictionary_error if there is no entry with the given name
   Type get_entry_type(const uint16_t index, const uint8_t subindex = 0);
 
+  /// Returns the index and sub-index of a dictionary entry identified by name.
+  /// \param entry_name Name of the dictionary entry
+  /// \throws dictionary_error if there is no entry with the given name
+  Address get_entry_address(const std::string& entry_name);
+
+  /// Returns the names of all entries with a receive or transmit PDO mapping,
+  /// i.e. the process image of the device.
+  std::vector<std::string> get_pdo_mapped_entries();
+
+  /// Returns all receive PDO mappings added via add_receive_pdo_mapping().
+  /// Entry names are escaped.
+  /// \remark thread-safe
+  std::vector<ReceivePDOMapping> get_receive_pdo_mappings();
+
   /// Gets the value of a dictionary entry by name internally.
   /// If there is no cached value or the entry is configured to send an SDO on
   /// request, the new value is fetched from the device via SDO. Otherwise it
@@ -226,6 +244,22 @@ class Device {
       const uint16_t index, const uint8_t subindex, const Value& value,
       const WriteAccessMethod access_method = WriteAccessMethod::use_default);
 
+  /// Registers a callback which is called when the cached value of the entry
+  /// changes, e.g. due to a received PDO. Callbacks are called synchronously
+  /// from the thread which changes the value and must return quickly.
+  /// \returns An ID which can be passed to remove_value_changed_callback().
+  /// \throws dictionary_error if there is no entry with the given name.
+  uint32_t add_value_changed_callback(const std::string& entry_name,
+                                      Entry::ValueChangedCallback callback);
+
+  /// Removes a callback registered with add_value_changed_callback(). When
+  /// this returns, the callback is neither running nor called again.
+  /// \param entry_name The name of the entry the callback was added to.
+  /// \param id ID returned by add_value_changed_callback()
+  /// \throws dictionary_error if there is no entry with the given name.
+  void remove_value_changed_callback(const std::string& entry_name,
+                                     uint32_t id);
+
   /// Adds an entry to the dictionary. You have to take care that exactly this
   /// entry exists on the device for yourself! \param index Index \param
   /// subindex Sub-index \param name Name \param type Data type \param
@@ -293,7 +327,9 @@ class Device {
   /// \param cob_id The cob_id of the PDO to transmit
   /// \param mappings A vector of mappings. A mapping maps a dictionary entry
   /// (by name) to a part of a PDO (by first and last byte index) \param
-  /// transmission_type Send PDO "ON_CHANGE" or "PERIODIC" \param repeat_time If
+  /// transmission_type Send PDO "ON_CHANGE", "PERIODIC", "SYNCHRONOUS" (see
+  /// send_synchronous_pdos()) or "ON_REQUEST" (see send_transmit_pdo())
+  /// \param repeat_time If
   /// transmission_type==TransmissionType::PERIODIC, PDO is sent periodically
   /// according to repeat_time. \throws dictionary_error
   void add_transmit_pdo_mapping(
@@ -306,6 +342,23 @@ class Device {
       TransmissionType transmission_type = TransmissionType::ON_CHANGE,
       std::chrono::milliseconds repeat_time = std::chrono::milliseconds(0));
 
+  /// Sends all transmit PDOs with TransmissionType::SYNCHRONOUS using the
+  /// currently cached values. CyclicExecutor calls this once per cycle.
+  /// \returns Number of sent PDOs
+  size_t send_synchronous_pdos();
+
+  /// Appends the messages of all transmit PDOs with
+  /// TransmissionType::SYNCHRONOUS to the given vector without sending them,
+  /// e.g. for sending the PDOs of several devices in one burst via
+  /// Core::send(const std::vector<Message>&).
+  /// \returns Number of appended messages
+  size_t collect_synchronous_pdos(std::vector<Message>& messages);
+
+  /// Sends the transmit PDO with the given COB-ID using the currently cached
+  /// values, regardless of its transmission type.
+  /// \returns false if there is no transmit PDO mapping with this COB-ID.
+  bool send_transmit_pdo(uint16_t cob_id);
+
   /// Prints the dictionary together with currently cached values to command
   /// line.
   void print_dictionary() const;
@@ -402,7 +455,7 @@ class Device {
   static const Value m_dummy_value;
   EDSLibrary m_eds_library;
 
-  std::vector<uint16_t> cob_ids_;
+  std::vector<uint32_t> pdo_callback_ids_;
   std::shared_ptr<std::thread> request_heartbeat_thread_;
   std::atomic_bool terminating_;
 };
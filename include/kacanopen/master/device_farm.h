@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/address.h"
+#include "kacanopen/master/slave.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kaco {
+
+/// This class simulates a network of CanOpen slave devices for testing and
+/// load testing masters.
+///
+/// Each simulated node is a Slave whose dictionary and default values are
+/// loaded from an EDS file (e.g. from resources/eds_library). Nodes answer
+/// SDOs, follow NMT commands, produce heartbeats and periodic transmit PDOs
+/// and react to receive PDOs:
+///
+///   - PDOs are mapped like configured in the EDS file. If the first
+///     transmit / receive PDO mapping is empty, a profile-specific default
+///     is used (CiA 401: digital inputs / outputs, CiA 402: statusword and
+///     actual position / controlword and target position).
+///   - CiA 401 outputs are echoed to the inputs. CiA 402 target values are
+///     echoed to actual values and the statusword follows the controlword.
+///   - Additional reactions can be added with add_echo() or via
+///     Slave::add_value_changed_callback().
+///
+/// All nodes share one Core (e.g. started on a VirtualBus or vcan) and one
+/// scheduler thread, so hundreds of nodes are cheap.
+///
+/// Methods which add nodes or reactions must be called before start().
+/// Rate setters are thread-safe and can be used while running.
+class DeviceFarm {
+ public:
+  /// Constructor.
+  /// \param core Reference of a Core instance. It should not host a master.
+  explicit DeviceFarm(Core& core);
+
+  /// Copy constructor deleted because of callbacks with self-references.
+  DeviceFarm(const DeviceFarm&) = delete;
+
+  /// Destructor. Stops the farm if it's running.
+  ~DeviceFarm();
+
+  /// Adds a simulated node.
+  /// \param node_id Node id (1-127)
+  /// \param eds_path Path to the EDS file of the device
+  /// \returns Reference to the node for further customization.
+  /// \throws canopen_error if the EDS file cannot be loaded or the node id
+  /// already exists.
+  Slave& add_node(uint8_t node_id, const std::string& eds_path);
+
+  /// Adds count simulated nodes with consecutive node ids.
+  /// \throws canopen_error
+  void add_nodes(uint8_t first_node_id, size_t count,
+                 const std::string& eds_path);
+
+  /// Returns the node with the given id.
+  /// \throws canopen_error if there is no such node.
+  Slave& get_node(uint8_t node_id);
+
+  /// Returns the number of nodes.
+  size_t num_nodes() const;
+
+  /// Copies the value of an entry to another entry whenever it changes,
+  /// e.g. a received target value to the actual value.
+  /// \throws dictionary_error if an entry doesn't exist or types don't match.
+  void add_echo(uint8_t node_id, const Address& from, const Address& to);
+
+  /// Sets the transmit PDO period of all nodes. Zero disables periodic
+  /// transmit PDOs. Default: 10ms.
+  /// \remark thread-safe
+  void set_tpdo_period(std::chrono::microseconds period);
+
+  /// Sets the transmit PDO period of one node.
+  /// \remark thread-safe
+  void set_tpdo_period(uint8_t node_id, std::chrono::microseconds period);
+
+  /// Sets the heartbeat period of all nodes. Zero means: use the producer
+  /// heartbeat time (0x1017) of each node. Default: zero.
+  /// \remark thread-safe
+  void set_heartbeat_period(std::chrono::milliseconds period);
+
+  /// Starts all nodes (boot-up) and the scheduler thread.
+  void start();
+
+  /// Stops the scheduler thread and all nodes.
+  void stop();
+
+  /// Returns the number of sent transmit PDOs.
+  /// \remark thread-safe
+  size_t get_tpdo_count() const;
+
+  /// Returns the number of sent heartbeats.
+  /// \remark thread-safe
+  size_t get_heartbeat_count() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Node {
+    std::unique_ptr<Slave> slave;
+    std::atomic<int64_t> tpdo_period_us{10000};
+    Clock::time_point next_tpdo;
+    Clock::time_point next_heartbeat;
+  };
+
+  void scheduler_loop();
+  void add_default_pdo_mappings(Slave& slave, uint16_t profile);
+  void add_profile_reactions(Slave& slave, uint16_t profile);
+  Node* find_node(uint8_t node_id);
+
+  static const bool debug = false;
+
+  Core& m_core;
+  std::vector<std::unique_ptr<Node>> m_nodes;
+
+  std::atomic<int64_t> m_heartbeat_period_ms{0};
+  std::atomic<size_t> m_tpdo_count{0};
+  std::atomic<size_t> m_heartbeat_count{0};
+
+  bool m_running = false;
+  std::thread m_scheduler_thread;
+  std::mutex m_scheduler_mutex;
+  std::condition_variable m_scheduler_condition;
+};
+
+}  // end namespace kaco
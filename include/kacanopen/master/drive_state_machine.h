@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/master/device.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
+
+namespace kaco {
+
+/// This class implements the CiA 402 power state machine of one drive
+/// without blocking.
+///
+/// It reacts to statusword updates (usually from a TPDO) and writes the
+/// next controlword transition into the device's cache with
+/// WriteAccessMethod::pdo, so that an ON_CHANGE transmit PDO mapping sends it
+/// immediately. Faults are reset automatically while a target state is
+/// requested. Mode specific controlword bits (4-6, 8-15) are preserved.
+///
+/// Example for enabling many axes concurrently:
+///
+///     for (auto& machine : machines) {
+///       machine->request(kaco::DriveStateMachine::State::operation_enabled);
+///     }
+///     for (auto& machine : machines) {
+///       machine->wait(std::chrono::milliseconds(500));
+///     }
+///
+/// Requirements: The device's dictionary contains "statusword" and
+/// "controlword". The statusword is mapped to a receive PDO and the
+/// controlword to a transmit PDO mapping, e.g.:
+///
+///     device.add_receive_pdo_mapping(0x180 + node_id, "statusword", 0);
+///     device.add_transmit_pdo_mapping(0x200 + node_id, {{"controlword", 0}});
+///
+/// All methods are thread-safe.
+class DriveStateMachine {
+ public:
+  /// CiA 402 power states as decoded from the statusword
+  enum class State {
+    unknown,
+    not_ready_to_switch_on,
+    switch_on_disabled,
+    ready_to_switch_on,
+    switched_on,
+    operation_enabled,
+    quick_stop_active,
+    fault_reaction_active,
+    fault
+  };
+
+  /// Type of a state change callback. It is called from the thread which
+  /// received the statusword (usually the receive loop) and must return
+  /// quickly.
+  using StateChangedCallback = std::function<void(State)>;
+
+  /// Constructor. Registers the statusword callback.
+  /// \param device The drive
+  /// \throws dictionary_error if statusword or controlword don't exist.
+  DriveStateMachine(Device& device);
+
+  /// Destructor. Unlinks the statusword callback.
+  ~DriveStateMachine();
+
+  /// Copy constructor deleted because of mutexes.
+  DriveStateMachine(const DriveStateMachine&) = delete;
+
+  /// Requests a target state and sends the first controlword transition
+  /// immediately if the current state is known. Returns at once.
+  /// \param target One of switch_on_disabled, ready_to_switch_on,
+  ///   switched_on, operation_enabled or quick_stop_active.
+  void request(State target);
+
+  /// Waits until the requested target state has been reached.
+  /// \returns false on timeout or if the drive is in fault state and
+  ///   automatic fault reset is disabled.
+  bool wait(std::chrono::milliseconds timeout);
+
+  /// Requests a target state and returns a future which becomes true when
+  /// the state has been reached and false on timeout.
+  std::future<bool> request_async(State target,
+                                  std::chrono::milliseconds timeout);
+
+  /// Enables or disables automatic fault reset (enabled by default).
+  void set_auto_fault_reset(bool enabled);
+
+  /// Sends a fault reset (rising edge of controlword bit 7) once.
+  void reset_fault();
+
+  /// Returns the current state as decoded from the last statusword.
+  State get_state() const;
+
+  /// Returns the requested target state.
+  State get_target() const;
+
+  /// Adds a callback which is called whenever the state changes.
+  void add_state_changed_callback(const StateChangedCallback& callback);
+
+  /// Decodes the power state from a statusword.
+  static State decode_state(uint16_t statusword);
+
+  /// Returns the controlword command bits (0-3 and 7) for the next
+  /// transition from current towards target. Bit 7 is set in fault state;
+  /// the caller must clear it in between to generate a new rising edge.
+  static uint16_t next_command(State current, State target);
+
+  /// Returns the name of a state.
+  static const char* state_to_string(State state);
+
+ private:
+  void statusword_changed(uint16_t statusword);
+  void send_transition();
+  void send_controlword(uint16_t command);
+
+  static const bool debug = false;
+
+  Device& m_device;
+  uint32_t m_callback_id = 0;
+
+  State m_state = State::unknown;
+  State m_target = State::unknown;
+  bool m_auto_fault_reset = true;
+  uint16_t m_controlword = 0;
+  std::vector<StateChangedCallback> m_callbacks;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+};
+
+}  // end namespace kaco
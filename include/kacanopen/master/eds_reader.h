@@ -64,6 +64,14 @@ class EDSReader {
   /// \returns true if successful
   bool import_entries();
 
+  /// Sets the values of all dictionary entries to the DefaultValue fields of
+  /// the EDS file. This is used to initialize the dictionary of local slave
+  /// nodes. Entries must have been imported before. "$NODEID" is replaced by
+  /// the given node id. Unparsable default values are skipped.
+  /// \param node_id Node id of the device
+  /// \returns true if successful
+  bool import_default_values(uint8_t node_id);
+
  private:
   /// Enable debug logging.
   static const bool debug = false;
@@ -89,6 +97,11 @@ class EDSReader {
   /// Parse an index section which has ObjectType array or record.
   bool parse_array_or_record(const std::string& section, uint16_t index);
 
+  /// Parses a DefaultValue field according to the given type.
+  /// \returns true if successful
+  bool parse_default_value(const std::string& str, Type type, uint8_t node_id,
+                           Value& value) const;
+
   /// Parses a regex error. This is just for debugging purposes.
   std::string parse_regex_error(const std::regex_constants::error_type& etype,
                                 const std::string element_name) const;
@@ -54,8 +54,8 @@ namespace kaco {
 class Entry {
  public:
   /// type of a callback for a value changed event
-  /// Important: Never call add_value_changed_callback()
-  ///   from within (-> deadlock)!
+  /// Important: Never call add_value_changed_callback() or
+  ///   remove_value_changed_callback() from within (-> deadlock)!
   using ValueChangedCallback = std::function<void(const Value& value)>;
 
   /// Constructs an empty entry.
@@ -102,8 +102,15 @@ class Entry {
   Type get_type() const;
 
   /// Registers a given function to be called when the value is changed.
+  /// \returns An ID which can be passed to remove_value_changed_callback().
   /// \remark thread-safe
-  void add_value_changed_callback(ValueChangedCallback callback);
+  uint32_t add_value_changed_callback(ValueChangedCallback callback);
+
+  /// Removes the callback with the given ID. When this returns, the callback
+  /// is neither running nor called again.
+  /// \param id ID returned by add_value_changed_callback()
+  /// \remark thread-safe
+  void remove_value_changed_callback(uint32_t id);
 
   /// Prints relevant information concerning this entry on standard output -
   /// name, index, possibly value, ... This is used by
@@ -165,8 +172,14 @@ class Entry {
   bool m_valid = false;
   Value m_dummy_value;
 
-  std::vector<ValueChangedCallback> m_value_changed_callbacks;
+  struct ValueChangedReceiver {
+    uint32_t id;
+    ValueChangedCallback callback;
+  };
+
+  std::vector<ValueChangedReceiver> m_value_changed_callbacks;
   std::unique_ptr<std::mutex> m_value_changed_callbacks_mutex;
+  uint32_t m_next_callback_id = 0;
 
   /// read_write_mutex locks get_value() and set_value() because a PDO
   /// transmitter thread could read a value reference while it is
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/master/device.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace kaco {
+
+/// This class writes dictionary entries of one device in a background
+/// thread, so that callers like ROS callbacks never block on SDO round trips
+/// or timeouts.
+///
+/// The queue holds at most one pending value per entry ("latest value
+/// wins"): pushing a value for an entry which hasn't been written yet
+/// replaces the pending value. Entries are written in the order in which
+/// they were first queued. Because intermediate values are dropped, don't
+/// use the queue for sequences which must arrive completely, e.g. the
+/// controlword transitions of the CiA 402 state machine.
+///
+/// Use shared() to get the queue of a device which is shared by all users
+/// within the process, e.g. all EntrySubscribers of a device.
+///
+/// All methods are thread-safe.
+class EntryWriteQueue {
+ public:
+  /// Statistics since construction
+  struct Statistics {
+    /// Number of push() calls
+    uint64_t pushed = 0;
+
+    /// Number of pushed values which replaced a pending value
+    uint64_t coalesced = 0;
+
+    /// Number of successful writes
+    uint64_t written = 0;
+
+    /// Number of writes which failed with an exception
+    uint64_t failed = 0;
+  };
+
+  /// Constructor. Starts the write thread.
+  /// \param device The device, which must outlive the queue.
+  explicit EntryWriteQueue(Device& device);
+
+  /// Destructor. Waits for the current write and discards pending values,
+  /// which are logged as a warning.
+  ~EntryWriteQueue();
+
+  /// Copy constructor deleted because of mutexes.
+  EntryWriteQueue(const EntryWriteQueue&) = delete;
+
+  /// Returns the queue of the given device, which is created on first use
+  /// and destroyed when the last user releases it.
+  static std::shared_ptr<EntryWriteQueue> shared(Device& device);
+
+  /// Queues a value for writing via Device::set_entry() and returns
+  /// immediately. Errors are logged and counted.
+  /// \param entry_name The name of the entry
+  /// \param value The value to write
+  /// \param access_method Access method for Device::set_entry()
+  void push(const std::string& entry_name, const Value& value,
+            WriteAccessMethod access_method = WriteAccessMethod::use_default);
+
+  /// Blocks until all values pushed so far have been written.
+  void flush();
+
+  /// Returns the number of pending values.
+  size_t get_pending() const;
+
+  /// Returns the statistics.
+  Statistics get_statistics() const;
+
+ private:
+  struct Pending {
+    Value value;
+    WriteAccessMethod access_method;
+  };
+
+  void run();
+
+  static const bool debug = false;
+
+  Device& m_device;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::condition_variable m_idle_condition;
+  std::deque<std::string> m_order;
+  std::map<std::string, Pending> m_pending;
+  bool m_writing = false;
+  bool m_running = true;
+  Statistics m_statistics;
+
+  std::thread m_thread;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/device.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace kaco {
+
+/// This class is a fast path for CiA 401 I/O modules. Instead of one
+/// dictionary entry per input byte or channel, the process data is kept in
+/// a packed process image:
+///
+///   - Digital inputs and outputs are bitfields. Channel i is bit i % 64 of
+///     word i / 64.
+///   - Analog inputs and outputs are arrays of raw 16-bit counts and of
+///     scaled values in engineering units (raw * gain + offset).
+///
+/// Every received PDO is decoded as a whole into the input image together
+/// with change masks, and the input callback is called once per frame, e.g.
+/// once for 64 digital inputs in one PDO. Outputs are encoded into their
+/// PDOs on flush(), which sends all changed output PDOs in one burst.
+///
+/// The layout is either read from the PDO mapping of the device with
+/// configure() or added manually with the map_*() methods.
+///
+/// ### Remarks on thread-safety:
+///
+///   configure(), the map_*() methods, the scaling setters and
+///   set_input_callback() must be called before the device's PDOs are
+///   transmitted. All other methods are thread-safe.
+class IOModule {
+ public:
+  /// The input process image
+  struct InputImage {
+    /// Packed digital inputs
+    std::vector<uint64_t> digital;
+
+    /// Digital inputs which changed in the last frame
+    std::vector<uint64_t> digital_changed;
+
+    /// Analog inputs in raw counts
+    std::vector<int16_t> analog_raw;
+
+    /// Analog inputs in engineering units
+    std::vector<float> analog;
+
+    /// Analog inputs which changed by more than the deadband in the last
+    /// frame, one bit per channel
+    std::vector<uint64_t> analog_changed;
+
+    /// Number of decoded frames
+    uint64_t frames = 0;
+
+    /// Returns the value of a digital input channel.
+    bool get_digital(size_t channel) const {
+      return (digital[channel / 64] >> (channel % 64)) & 1;
+    }
+
+    /// Returns true if a digital input changed in the last frame.
+    bool digital_has_changed(size_t channel) const {
+      return (digital_changed[channel / 64] >> (channel % 64)) & 1;
+    }
+
+    /// Returns true if an analog input changed in the last frame.
+    bool analog_has_changed(size_t channel) const {
+      return (analog_changed[channel / 64] >> (channel % 64)) & 1;
+    }
+  };
+
+  /// Type of the input callback. It is called from the receive thread once
+  /// per received input frame and therefore must not block.
+  using InputCallback = std::function<void(const InputImage&)>;
+
+  /// Constructor.
+  /// \param device The I/O module
+  IOModule(Device& device);
+
+  /// Destructor. Removes the PDO callbacks.
+  ~IOModule();
+
+  /// Copy constructor deleted because of mutexes.
+  IOModule(const IOModule&) = delete;
+
+  /// Reads the PDO mapping (TPDO 1-4 and RPDO 1-4) from the device via SDO
+  /// and maps all byte-aligned digital inputs and outputs (0x6000, 0x6100,
+  /// 0x6120, 0x6200, 0x6300, 0x6320) and 16-bit analog inputs and outputs
+  /// (0x6401, 0x6411). Other mapped entries are skipped.
+  /// \throws sdo_error
+  void configure();
+
+  /// Maps digital inputs from a PDO sent by the device.
+  /// \param cob_id COB-ID of the PDO
+  /// \param byte_offset Offset of the first byte in the PDO
+  /// \param num_bytes Number of bytes (8 channels per byte)
+  /// \param first_channel Channel of the least significant bit
+  void map_digital_inputs(uint16_t cob_id, uint8_t byte_offset,
+                          uint8_t num_bytes, size_t first_channel);
+
+  /// Maps 16-bit analog inputs from a PDO sent by the device.
+  /// \param cob_id COB-ID of the PDO
+  /// \param byte_offset Offset of the first channel in the PDO
+  /// \param num_channels Number of channels
+  /// \param first_channel Channel of the first value
+  void map_analog_inputs(uint16_t cob_id, uint8_t byte_offset,
+                         uint8_t num_channels, size_t first_channel);
+
+  /// Maps digital outputs to a PDO received by the device.
+  /// \see map_digital_inputs()
+  void map_digital_outputs(uint16_t cob_id, uint8_t byte_offset,
+                           uint8_t num_bytes, size_t first_channel);
+
+  /// Maps 16-bit analog outputs to a PDO received by the device.
+  /// \see map_analog_inputs()
+  void map_analog_outputs(uint16_t cob_id, uint8_t byte_offset,
+                          uint8_t num_channels, size_t first_channel);
+
+  /// Sets the scaling of all analog inputs: value = raw * gain + offset.
+  void set_analog_input_scaling(float gain, float offset);
+
+  /// Sets the scaling of one analog input: value = raw * gain + offset.
+  void set_analog_input_scaling(size_t channel, float gain, float offset);
+
+  /// Sets the scaling of all analog outputs: value = raw * gain + offset.
+  void set_analog_output_scaling(float gain, float offset);
+
+  /// Sets the scaling of one analog output: value = raw * gain + offset.
+  void set_analog_output_scaling(size_t channel, float gain, float offset);
+
+  /// Sets the deadband in raw counts below which analog input changes are
+  /// not flagged in InputImage::analog_changed. Default: 0.
+  void set_analog_deadband(uint16_t counts);
+
+  /// Sets the input callback.
+  void set_input_callback(const InputCallback& callback);
+
+  /// Returns a copy of the input image.
+  InputImage get_inputs() const;
+
+  /// Returns the number of digital input channels.
+  size_t get_digital_input_count() const;
+
+  /// Returns the number of analog input channels.
+  size_t get_analog_input_count() const;
+
+  /// Returns the number of digital output channels.
+  size_t get_digital_output_count() const;
+
+  /// Returns the number of analog output channels.
+  size_t get_analog_output_count() const;
+
+  /// Sets a digital output. It is sent on the next flush().
+  void set_digital_output(size_t channel, bool value);
+
+  /// Sets the digital outputs 64 * word ... 64 * word + 63 where mask is set.
+  /// They are sent on the next flush().
+  void set_digital_outputs(size_t word, uint64_t values, uint64_t mask);
+
+  /// Sets an analog output in engineering units. The raw value is rounded
+  /// and clamped to the int16 range. It is sent on the next flush().
+  void set_analog_output(size_t channel, float value);
+
+  /// Sets an analog output in raw counts. It is sent on the next flush().
+  void set_analog_output_raw(size_t channel, int16_t value);
+
+  /// Sends all output PDOs with changed channels in one burst.
+  /// \param all Send all output PDOs.
+  /// \returns Number of sent PDOs
+  size_t flush(bool all = false);
+
+ private:
+  /// A contiguous block of channels in a PDO
+  struct Segment {
+    uint8_t byte_offset;
+    uint8_t size;  // bytes for digital, channels for analog
+    size_t first_channel;
+  };
+
+  /// A PDO and the channels mapped into it
+  struct Frame {
+    uint16_t cob_id;
+    uint8_t length = 0;
+    std::vector<Segment> digital;
+    std::vector<Segment> analog;
+    bool dirty = false;
+  };
+
+  Frame& get_frame(std::vector<Frame>& frames, uint16_t cob_id);
+  void process_frame(size_t frame_index, const std::vector<uint8_t>& data);
+  void resize_inputs(size_t digital_channels, size_t analog_channels);
+  void resize_outputs(size_t digital_channels, size_t analog_channels);
+  void mark_dirty(size_t channel, bool digital);
+
+  static const bool debug = false;
+
+  Device& m_device;
+  Core& m_core;
+
+  std::vector<Frame> m_input_frames;
+  std::vector<uint32_t> m_pdo_callback_ids;
+  size_t m_digital_input_count = 0;
+  size_t m_analog_input_count = 0;
+  std::vector<float> m_input_gain;
+  std::vector<float> m_input_offset;
+  uint16_t m_analog_deadband = 0;
+  InputCallback m_input_callback;
+
+  InputImage m_inputs;
+  // last reported raw analog values for the deadband
+  std::vector<int16_t> m_analog_reported;
+  mutable std::mutex m_inputs_mutex;
+
+  // copy of m_inputs for the callback, only accessed by the receive thread
+  InputImage m_callback_inputs;
+
+  std::vector<Frame> m_output_frames;
+  size_t m_digital_output_count = 0;
+  size_t m_analog_output_count = 0;
+  std::vector<float> m_output_gain;
+  std::vector<float> m_output_offset;
+  std::vector<uint64_t> m_digital_outputs;
+  std::vector<int16_t> m_analog_outputs;
+  mutable std::mutex m_outputs_mutex;
+};
+
+}  // end namespace kaco
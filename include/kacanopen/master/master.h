@@ -35,6 +35,7 @@
 #include "kacanopen/master/device.h"
 
 #include <bitset>
+#include <mutex>
 #include <vector>
 
 namespace kaco {
@@ -82,6 +83,11 @@ class Master {
   /// \remark Master must not run yet.
   bool start(const std::string busname, const unsigned baudrate);
 
+  /// Starts master on an in-process bus (see VirtualBus).
+  /// \returns true if successful
+  /// \remark Master must not run yet.
+  bool start(VirtualBus& bus);
+
   /// Stops master and core.
   void stop();
 
@@ -102,6 +108,7 @@ class Master {
 
   std::vector<std::unique_ptr<Device>> m_devices;
   std::bitset<265> m_device_alive;
+  mutable std::mutex m_devices_mutex;
 
   NMT::DeviceAliveCallback m_device_alive_callback_functional;
   bool m_running{false};
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/master/cyclic_drive.h"
+#include "kacanopen/master/cyclic_executor.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace kaco {
+
+/// This class moves several CiA 402 drives in cyclic synchronous position
+/// mode as one group.
+///
+/// The application commits the setpoints of all axes at once with commit().
+/// At the beginning of every SYNC cycle, the group takes one consistent
+/// snapshot of the committed setpoints, so that all axes always receive
+/// setpoints of the same commit. The CyclicExecutor sends the resulting
+/// RPDOs of all axes in one burst, which can be shifted just before the next
+/// SYNC with CyclicExecutor::set_output_phase().
+///
+/// In addition, the group monitors the following error of every axis: the
+/// position actual value is compared to the setpoint which has been sent
+/// following_error_delay cycles earlier (default: 2 cycles, one for the RPDO
+/// to take effect at the next SYNC and one for the TPDO to report the
+/// reached position).
+///
+/// Usage:
+///
+///     kaco::CyclicExecutor executor(core, phase, window);
+///     kaco::MotionGroup group;
+///     group.add_axis(drive_x);
+///     group.add_axis(drive_y);
+///     group.attach(executor);
+///     executor.set_output_phase(std::chrono::microseconds(800));
+///     executor.start();
+///     group.enable();
+///     group.commit({x, y});
+///
+/// ### Remarks on thread-safety:
+///
+///   add_axis(), set_following_error_delay(), set_following_error_callback()
+///   and attach() must be called before the executor is started. All other
+///   methods are thread-safe.
+class MotionGroup {
+ public:
+  /// Following error statistics of an axis
+  struct AxisStatistics {
+    /// True if the following error below is valid
+    bool valid = false;
+
+    /// Following error of the last cycle (actual - commanded position)
+    int32_t following_error = 0;
+
+    /// Maximum absolute following error
+    uint32_t max_following_error = 0;
+
+    /// Number of cycles in which the following error limit was exceeded
+    uint64_t limit_violations = 0;
+  };
+
+  /// Type of a callback which is called from the executor thread when the
+  /// following error of an axis exceeds the limit.
+  using FollowingErrorCallback =
+      std::function<void(size_t axis, int32_t following_error)>;
+
+  /// Constructor.
+  MotionGroup() = default;
+
+  /// Copy constructor deleted because of mutexes.
+  MotionGroup(const MotionGroup&) = delete;
+
+  /// Adds an axis. The drive must be configured in
+  /// CyclicDrive::Mode::position and must not be attached to an executor
+  /// yet, because the group sets its setpoint generator and attaches it.
+  /// \returns The index of the axis
+  /// \throws canopen_error if the drive is not in position mode.
+  size_t add_axis(CyclicDrive& drive);
+
+  /// Returns the number of axes.
+  size_t get_axis_count() const;
+
+  /// Sets the number of cycles between sending a setpoint and comparing it
+  /// to the position actual value. Default: 2.
+  void set_following_error_delay(size_t cycles);
+
+  /// Sets the following error limit in position increments. Zero (default)
+  /// disables the limit.
+  void set_following_error_limit(uint32_t limit);
+
+  /// Sets a callback for following error limit violations. It is called
+  /// from the executor thread in every cycle in which an axis exceeds the
+  /// limit and therefore must not block.
+  void set_following_error_callback(const FollowingErrorCallback& callback);
+
+  /// Attaches all axes to the executor. Adds one task before the drive
+  /// tasks, which snapshots the committed setpoints, and one task after
+  /// them, which updates the following error statistics.
+  void attach(CyclicExecutor& executor);
+
+  /// Requests operation enabled on all axes. Each axis holds its current
+  /// position until the next commit().
+  void enable();
+
+  /// Requests switched on (operation disabled) on all axes.
+  void disable();
+
+  /// Commits new setpoints for all axes at once.
+  /// \param positions Target positions, one per axis in the order of
+  ///   add_axis().
+  /// \throws canopen_error if the number of positions does not match.
+  void commit(const std::vector<int32_t>& positions);
+
+  /// Returns the position actual values of all axes from the last cycle.
+  std::vector<int32_t> get_positions() const;
+
+  /// Returns the following error statistics of all axes.
+  std::vector<AxisStatistics> get_statistics() const;
+
+  /// Resets max_following_error and limit_violations of all axes.
+  void reset_statistics();
+
+ private:
+  struct Axis {
+    CyclicDrive* drive = nullptr;
+
+    // only accessed by the executor thread
+    bool enabled = false;
+    int32_t target = 0;
+    std::vector<int32_t> history;
+    uint64_t history_count = 0;
+  };
+
+  void begin_cycle(CyclicExecutor::CycleContext& context);
+  void end_cycle(CyclicExecutor::CycleContext& context);
+  int32_t next_target(size_t axis, const CyclicDrive::Feedback& feedback);
+
+  static const bool debug = false;
+
+  std::vector<Axis> m_axes;
+  size_t m_following_error_delay = 2;
+  FollowingErrorCallback m_following_error_callback;
+
+  std::vector<int32_t> m_committed;
+  std::vector<bool> m_committed_valid;
+  mutable std::mutex m_committed_mutex;
+
+  // snapshot of m_committed, only accessed by the executor thread
+  std::vector<int32_t> m_cycle_targets;
+  std::vector<bool> m_cycle_targets_valid;
+
+  uint32_t m_following_error_limit = 0;
+  std::vector<AxisStatistics> m_statistics;
+  mutable std::mutex m_statistics_mutex;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kacanopen/core/message.h"
+#include "kacanopen/master/mapping.h"
+#include "kacanopen/master/types.h"
+
+namespace kaco {
+
+// forward declaration
+class Device;
+
+/// This class decodes batches of PDOs with the same COB-ID into one column
+/// per mapped entry (structure of arrays), e.g. for replayed or offline logs.
+/// Unlike receive PDO mappings, it neither touches the dictionary nor
+/// constructs Value objects: the mapping is compiled once into shifts, masks
+/// and sign bits which are applied to whole frames at once.
+///
+/// On x86-64 CPUs with AVX2, four frames are decoded per step using gathers
+/// and vector shifts. Otherwise a portable scalar kernel is used. The kernel
+/// is selected at runtime.
+///
+/// Integer and boolean entries are decoded into 64 bit signed integers
+/// (sign-extended for signed types, uint64 values are stored as their bit
+/// pattern, booleans as 0 or 1), real32 and real64 entries into doubles.
+/// Strings can't be decoded.
+///
+/// Usage:
+///
+///     kaco::PDOBatchDecoder decoder(device, {{"Statusword", 0},
+///                                            {"Position Actual Value", 2}});
+///     kaco::PDOBatchDecoder::Columns columns;
+///     decoder.decode(frames.data(), frames.size(), columns);
+///     // columns.integers[1] now holds all positions.
+///
+/// decode() is const and can be called concurrently.
+class PDOBatchDecoder {
+ public:
+  /// A mapped field of the PDO.
+  struct Field {
+    /// Data type of the field.
+    Type type;
+
+    /// Index of the first byte of the field in the PDO.
+    uint8_t offset;
+  };
+
+  /// Decoding implementation.
+  enum class Kernel { scalar, avx2 };
+
+  /// Decoded values, one column per field.
+  struct Columns {
+    /// Values of integer and boolean fields. Empty for real fields.
+    std::vector<std::vector<int64_t>> integers;
+
+    /// Values of real32 and real64 fields. Empty for other fields.
+    std::vector<std::vector<double>> reals;
+  };
+
+  /// Compiles a mapping plan.
+  /// \param fields Mapped fields
+  /// \param kernel Decoding implementation, by default the fastest one
+  ///   supported by the CPU
+  /// \throws dictionary_error if a type has no fixed size or a field exceeds
+  ///   8 bytes
+  explicit PDOBatchDecoder(const std::vector<Field>& fields,
+                           Kernel kernel = best_kernel());
+
+  /// Compiles a mapping plan from the dictionary of a device.
+  /// \throws dictionary_error if an entry doesn't exist or can't be decoded
+  PDOBatchDecoder(Device& device, const std::vector<Mapping>& mappings,
+                  Kernel kernel = best_kernel());
+
+  /// Returns the fastest kernel supported by the CPU.
+  static Kernel best_kernel();
+
+  /// Returns the kernel which is used.
+  Kernel get_kernel() const { return m_kernel; }
+
+  /// Returns the number of fields.
+  size_t get_num_fields() const { return m_fields.size(); }
+
+  /// Returns true if the given field is decoded into Columns::reals.
+  bool is_real(size_t field) const;
+
+  /// Decodes frames and appends the values to the columns. All frames should
+  /// have the COB-ID the mapping belongs to. Frames which are too short for
+  /// the mapping are decoded as zeros.
+  /// \param frames Frames to decode
+  /// \param count Number of frames
+  /// \param columns Output. Resized to the number of fields if necessary.
+  /// \returns the number of frames which were long enough
+  size_t decode(const Message* frames, size_t count, Columns& columns) const;
+
+ private:
+  /// A field compiled into bit operations on the 64 bit little-endian frame
+  /// payload.
+  struct CompiledField {
+    enum class Kind : uint8_t { integer, boolean, real32, real64 };
+    Kind kind;
+    uint8_t shift;
+    uint64_t mask;
+    // Sign bit of signed integers, zero otherwise.
+    uint64_t sign;
+  };
+
+  void compile(const std::vector<Field>& fields);
+
+  size_t decode_scalar(const Message* frames, size_t count, size_t begin,
+                       const std::vector<int64_t*>& integers,
+                       const std::vector<double*>& reals) const;
+
+  size_t decode_avx2(const Message* frames, size_t count,
+                     const std::vector<int64_t*>& integers,
+                     const std::vector<double*>& reals) const;
+
+  static const bool debug = false;
+
+  std::vector<CompiledField> m_fields;
+  uint8_t m_min_length = 0;
+  Kernel m_kernel;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/value.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kaco {
+
+/// Magic number at the beginning of a shared process image ("KACO")
+static const uint32_t shared_image_magic = 0x4F43414B;
+
+/// Layout version of the shared process image. It must be incremented
+/// whenever SharedImageHeader or SharedImageSlot change.
+static const uint32_t shared_image_version = 1;
+
+/// Header of a shared process image segment. All fields except slot_count
+/// are written once when the segment is created.
+struct SharedImageHeader {
+  /// shared_image_magic
+  uint32_t magic;
+
+  /// shared_image_version
+  uint32_t version;
+
+  /// sizeof(SharedImageHeader)
+  uint32_t header_size;
+
+  /// sizeof(SharedImageSlot)
+  uint32_t slot_size;
+
+  /// Number of slots the segment has room for
+  uint32_t capacity;
+
+  /// Number of valid slots. Slot descriptors are written before this is
+  /// incremented.
+  std::atomic<uint32_t> slot_count;
+
+  /// Creation time of the segment (steady clock, ns). Changes when the
+  /// writer recreates the segment, e.g. after a restart.
+  uint64_t generation;
+};
+
+/// One entry value in a shared process image. The descriptor fields (node_id
+/// to name) are written once. The value fields are protected by a seqlock:
+/// sequence is odd while the writer updates them.
+struct alignas(64) SharedImageSlot {
+  /// Node ID of the device
+  uint8_t node_id;
+
+  /// Type of the value (kaco::Type)
+  uint8_t type;
+
+  /// Sub-index of the entry
+  uint8_t subindex;
+
+  /// Size of the value in bytes (at most 8)
+  uint8_t size;
+
+  /// Index of the entry
+  uint16_t index;
+
+  /// Escaped entry name, zero-terminated
+  char name[58];
+
+  /// Seqlock sequence, incremented before and after each update
+  std::atomic<uint32_t> sequence;
+
+  /// Number of updates
+  uint32_t updates;
+
+  /// Time of the last update (steady clock, ns)
+  uint64_t timestamp;
+
+  /// Value bytes in little endian
+  uint8_t data[8];
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "The shared process image needs lock-free 32 bit atomics.");
+
+/// \class SharedProcessImage
+///
+/// This class publishes entry values of devices in a POSIX shared memory
+/// segment, so that other processes on the same machine can read the bus
+/// state without running their own master. Readers use
+/// SharedProcessImageReader, which needs no system calls after opening the
+/// segment.
+///
+/// Every exported entry gets a slot, which is updated whenever the cached
+/// value of the entry changes, e.g. by a received PDO. Only entries with a
+/// size of up to 8 bytes can be exported.
+///
+/// The segment is removed by the destructor unless another publisher has
+/// taken it over in the meantime. Exported devices must outlive the image.
+///
+/// ### Remarks on thread-safety:
+///
+///   All methods are thread-safe.
+class SharedProcessImage {
+ public:
+  /// Constructor. Creates the shared memory segment.
+  /// \param name Name of the segment, e.g. "/kacanopen"
+  /// \param capacity Maximum number of slots
+  /// \param replace If a segment with the same name exists, e.g. left over
+  ///   by a crashed process, it is replaced. Readers of a live publisher's
+  ///   segment stay attached to the old one.
+  /// \throws canopen_error if the segment can't be created, or if it exists
+  ///   and replace is false.
+  SharedProcessImage(const std::string& name, size_t capacity = 1024,
+                     bool replace = false);
+
+  /// Destructor. Unmaps and removes the segment.
+  ~SharedProcessImage();
+
+  /// Copy constructor deleted because of mutexes.
+  SharedProcessImage(const SharedProcessImage&) = delete;
+
+  /// Exports a dictionary entry.
+  /// \returns The slot index
+  /// \throws dictionary_error if there is no entry with the given name
+  /// \throws canopen_error if the segment is full, the value is larger
+  ///   than 8 bytes or the escaped name is longer than 57 characters.
+  size_t add_entry(Device& device, const std::string& entry_name);
+
+  /// Exports all entries with a PDO mapping (see
+  /// Device::get_pdo_mapped_entries()). Entries larger than 8 bytes or with
+  /// names longer than 57 characters are skipped.
+  /// \returns Number of exported entries
+  /// \throws canopen_error if the segment is full.
+  size_t add_device(Device& device);
+
+  /// Returns the number of slots.
+  size_t get_slot_count() const;
+
+  /// Returns the name of the segment.
+  const std::string& get_name() const;
+
+ private:
+  struct Registration {
+    Device* device;
+    std::string entry_name;
+    uint32_t callback_id;
+  };
+
+  static bool fits(const std::string& name);
+
+  void write(size_t slot, const Value& value);
+
+  static const bool debug = false;
+
+  const std::string m_name;
+  size_t m_size = 0;
+  uint64_t m_inode = 0;
+  void* m_memory = nullptr;
+  SharedImageHeader* m_header = nullptr;
+  SharedImageSlot* m_slots = nullptr;
+
+  std::vector<Registration> m_registrations;
+  std::mutex m_add_mutex;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/master/shared_process_image.h"
+#include "kacanopen/master/types.h"
+#include "kacanopen/master/value.h"
+
+#include <cstdint>
+#include <string>
+
+namespace kaco {
+
+/// \class SharedProcessImageReader
+///
+/// This class reads a process image which has been published by
+/// SharedProcessImage in another process. The segment is mapped read-only
+/// and all reads are lock-free and without system calls: a read is retried
+/// while the writer updates the slot.
+///
+/// ### Remarks on thread-safety:
+///
+///   All methods are thread-safe.
+class SharedProcessImageReader {
+ public:
+  /// Descriptor of a slot
+  struct SlotInfo {
+    /// Node ID of the device
+    uint8_t node_id;
+
+    /// Index of the entry
+    uint16_t index;
+
+    /// Sub-index of the entry
+    uint8_t subindex;
+
+    /// Type of the value
+    Type type;
+
+    /// Escaped entry name
+    std::string name;
+  };
+
+  /// A value read from a slot
+  struct Sample {
+    /// False if the entry has not been received yet
+    bool valid = false;
+
+    /// The value
+    Value value;
+
+    /// Time of the last update (steady clock, ns)
+    uint64_t timestamp = 0;
+
+    /// Number of updates since the entry has been exported
+    uint32_t updates = 0;
+  };
+
+  /// Constructor. Opens and maps the segment.
+  /// \param name Name of the segment, e.g. "/kacanopen"
+  /// \throws canopen_error if the segment doesn't exist or has an
+  ///   incompatible layout.
+  SharedProcessImageReader(const std::string& name);
+
+  /// Destructor. Unmaps the segment.
+  ~SharedProcessImageReader();
+
+  /// Copy constructor deleted because of the mapping.
+  SharedProcessImageReader(const SharedProcessImageReader&) = delete;
+
+  /// Returns the number of slots. It grows when the writer exports more
+  /// entries.
+  size_t get_slot_count() const;
+
+  /// Returns the generation of the segment, see
+  /// SharedImageHeader::generation.
+  uint64_t get_generation() const;
+
+  /// Returns the descriptor of a slot.
+  /// \throws canopen_error if the slot doesn't exist.
+  SlotInfo get_slot_info(size_t slot) const;
+
+  /// Returns the slot of an entry.
+  /// \throws canopen_error if the entry has not been exported.
+  size_t find_slot(uint8_t node_id, const std::string& entry_name) const;
+
+  /// Reads a consistent value from a slot.
+  /// \throws canopen_error if the slot doesn't exist.
+  Sample read(size_t slot) const;
+
+ private:
+  const SharedImageSlot& get_slot(size_t slot) const;
+
+  static const bool debug = false;
+
+  const std::string m_name;
+  size_t m_size = 0;
+  const void* m_memory = nullptr;
+  const SharedImageHeader* m_header = nullptr;
+  const SharedImageSlot* m_slots = nullptr;
+};
+
+}  // end namespace kaco
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kacanopen/master/types.h"
+
+namespace kaco {
+
+// forward declaration
+class Device;
+
+/// This class records PDO mapped entries at full PDO rate into a columnar
+/// file, e.g. for controller tuning or post-mortem analysis. Unlike value
+/// changed callbacks, every received PDO produces a sample, even if the value
+/// didn't change.
+///
+/// The receive thread of the Core decodes each sample into a per-signal chunk
+/// without locks. Full chunks are handed to a background writer thread via
+/// lock-free rings, and empty chunks are returned the same way. If the
+/// writer falls behind and no chunk is available, samples are dropped and
+/// counted.
+///
+/// Usage:
+///
+///     device.add_receive_pdo_mapping(0x181, "Position Actual Value", 0);
+///     kaco::SignalCapture capture;
+///     capture.add_signal(device, "Position Actual Value");
+///     capture.start("tuning.kacocap");
+///     // ...
+///     capture.stop();
+///
+/// For long-term archives, start(path, Encoding::compressed) compresses each
+/// block with delta-of-delta timestamps and delta (integer) or XOR (real)
+/// values, see SignalCompression. Compression runs in the writer thread.
+///
+/// Read files with SignalCaptureReader.
+///
+/// File format (little-endian, all structures 8 byte aligned):
+///
+///     FileHeader, SignalInfo[num_signals]
+///     Block 0: BlockHeader, payload, padding to 8 bytes
+///     Block 1: ...
+///     Footer:  FooterHeader, SignalInfo[num_signals], BlockInfo[num_blocks]
+///     Trailer
+///
+/// The payload of a raw block is int64 timestamps[count] followed by 8 byte
+/// values[count]. The payload of a compressed block is the output of
+/// SignalCompression::encode().
+///
+/// Timestamps are nanoseconds since FileHeader::start_time_ns. Values are
+/// int64 (integer and boolean entries, sign-extended; uint64 as bit pattern)
+/// or IEEE double (real32 and real64 entries), see SignalInfo::value_kind.
+/// Blocks of different signals are interleaved in the order they were
+/// written. The footer repeats the signal table with final sample counts and
+/// indexes all blocks. A file without trailer has not been closed properly;
+/// its blocks can still be read sequentially.
+///
+/// add_signal(), start() and stop() must not be called concurrently.
+class SignalCapture {
+ public:
+  /// Magic number at the start of the file ("KACOCAP1").
+  static const uint64_t magic = 0x315041434f43414bULL;
+
+  /// Kind of the stored values.
+  enum class ValueKind : uint8_t { int64 = 0, float64 = 1 };
+
+  /// Encoding of the blocks.
+  enum class Encoding { raw, compressed };
+
+  /// Flags of FileHeader.
+  enum Flags : uint16_t { flag_compressed = 0x1 };
+
+  /// Header at the start of the file.
+  struct FileHeader {
+    /// Always SignalCapture::magic.
+    uint64_t magic;
+
+    /// Format version, currently 2.
+    uint16_t version;
+
+    /// Combination of Flags.
+    uint16_t flags;
+
+    /// Number of SignalInfo entries following the header.
+    uint32_t num_signals;
+
+    /// Wall clock time of start() in nanoseconds since the Unix epoch.
+    int64_t start_time_ns;
+  };
+
+  /// Header of a block of samples of one signal.
+  struct BlockHeader {
+    /// Signal number (index into the SignalInfo table).
+    uint32_t signal;
+
+    /// Number of samples.
+    uint32_t count;
+
+    /// Size of the payload in bytes, without padding.
+    uint32_t size;
+
+    /// Reserved, zero.
+    uint32_t reserved;
+  };
+
+  /// Header of the footer.
+  struct FooterHeader {
+    /// Number of SignalInfo entries.
+    uint32_t num_signals;
+
+    /// Reserved, zero.
+    uint32_t reserved;
+
+    /// Number of BlockInfo entries.
+    uint64_t num_blocks;
+  };
+
+  /// Description of a signal.
+  struct SignalInfo {
+    /// Escaped entry name, zero-terminated.
+    char name[48];
+
+    /// Node ID of the device.
+    uint8_t node_id;
+
+    /// Sub-index of the entry.
+    uint8_t subindex;
+
+    /// Index of the entry.
+    uint16_t index;
+
+    /// COB-ID of the PDO.
+    uint16_t cob_id;
+
+    /// Type of the entry (kaco::Type).
+    uint8_t type;
+
+    /// Kind of the stored values (ValueKind).
+    uint8_t value_kind;
+
+    /// Total number of samples.
+    uint64_t num_samples;
+  };
+
+  /// Index entry of a block.
+  struct BlockInfo {
+    /// File offset of the BlockHeader.
+    uint64_t offset;
+
+    /// Signal number.
+    uint32_t signal;
+
+    /// Number of samples.
+    uint32_t count;
+
+    /// Timestamp of the first sample.
+    int64_t first_timestamp;
+
+    /// Timestamp of the last sample.
+    int64_t last_timestamp;
+  };
+
+  /// Trailer at the end of a properly closed file.
+  struct Trailer {
+    /// File offset of the FooterHeader.
+    uint64_t footer_offset;
+
+    /// Always SignalCapture::magic.
+    uint64_t magic;
+  };
+
+  /// Capture statistics.
+  struct Statistics {
+    /// Number of recorded samples.
+    size_t samples;
+
+    /// Number of dropped samples because the writer fell behind.
+    size_t dropped;
+
+    /// Number of written blocks.
+    size_t blocks;
+  };
+
+  /// Constructor.
+  /// \param chunk_size Samples per chunk, i.e. the maximum block size
+  /// \param chunks_per_signal Number of chunks which can be in flight per
+  ///   signal before samples are dropped
+  explicit SignalCapture(size_t chunk_size = 4096,
+                         size_t chunks_per_signal = 16);
+
+  /// Stops the capture if running.
+  ~SignalCapture();
+
+  /// Copy constructor deleted because of the writer thread.
+  SignalCapture(const SignalCapture&) = delete;
+
+  /// Adds a signal. The entry must be mapped to a receive PDO of the device
+  /// (see Device::add_receive_pdo_mapping()).
+  /// \returns the signal number
+  /// \throws dictionary_error if the entry doesn't exist, isn't mapped or has
+  ///   no fixed size
+  /// \throws canopen_error if the escaped name is longer than 47 characters
+  /// \remark The capture must not run.
+  size_t add_signal(Device& device, const std::string& entry_name);
+
+  /// Creates the file and starts recording.
+  /// \param path File path
+  /// \param encoding Block encoding
+  /// \returns false if the file cannot be created
+  bool start(const std::string& path, Encoding encoding = Encoding::raw);
+
+  /// Stops recording, writes the remaining samples and the footer and closes
+  /// the file.
+  void stop();
+
+  /// Returns true if recording.
+  bool is_running() const;
+
+  /// Returns the statistics.
+  /// \remark thread-safe
+  Statistics get_statistics() const;
+
+ private:
+  struct Chunk;
+  struct Signal;
+  struct State;
+
+  void writer_loop();
+  void write_chunk(size_t signal, const Chunk& chunk);
+
+  static const bool debug = false;
+
+  const size_t m_chunk_size;
+  const size_t m_chunks_per_signal;
+
+  // Shared with the PDO callbacks, which can't be unregistered and may
+  // outlive this object.
+  std::shared_ptr<State> m_state;
+
+  // Signals per Core and COB-ID, for registering one callback each.
+  std::map<std::pair<void*, uint16_t>, std::shared_ptr<std::vector<size_t>>>
+      m_cob_signals;
+
+  std::FILE* m_file = nullptr;
+  Encoding m_encoding = Encoding::raw;
+  std::vector<uint8_t> m_encoded;
+  uint64_t m_offset = 0;
+  std::vector<BlockInfo> m_blocks;
+  std::thread m_writer_thread;
+  std::atomic<size_t> m_num_blocks{0};
+};
+
+static_assert(sizeof(SignalCapture::FileHeader) == 24,
+              "Unexpected SignalCapture::FileHeader layout");
+static_assert(sizeof(SignalCapture::BlockHeader) == 16,
+              "Unexpected SignalCapture::BlockHeader layout");
+static_assert(sizeof(SignalCapture::FooterHeader) == 16,
+              "Unexpected SignalCapture::FooterHeader layout");
+static_assert(sizeof(SignalCapture::SignalInfo) == 64,
+              "Unexpected SignalCapture::SignalInfo layout");
+static_assert(sizeof(SignalCapture::BlockInfo) == 32,
+              "Unexpected SignalCapture::BlockInfo layout");
+static_assert(sizeof(SignalCapture::Trailer) == 16,
+              "Unexpected SignalCapture::Trailer layout");
+
+}  // end namespace kaco
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kacanopen/master/signal_capture.h"
+
+namespace kaco {
+
+/// This class reads files written by SignalCapture. The file is
+/// memory-mapped, so blocks of raw files are accessed in place without
+/// copying. Blocks of compressed files are decoded on access. If the
+/// file has not been closed properly, the block index is rebuilt by scanning
+/// the blocks.
+///
+/// Usage:
+///
+///     kaco::SignalCaptureReader reader;
+///     reader.open("tuning.kacocap");
+///     const int signal = reader.find_signal(1, "position_actual_value");
+///     std::vector<int64_t> timestamps;
+///     std::vector<double> values;
+///     reader.read(signal, from_ns, to_ns, timestamps, values);
+///
+/// All const methods are thread-safe.
+class SignalCaptureReader {
+ public:
+  /// Samples of one block, pointing into the mapping.
+  struct Block {
+    /// Timestamps in nanoseconds since the start of the capture.
+    const int64_t* timestamps;
+
+    /// Values of int64 signals, nullptr otherwise.
+    const int64_t* integers;
+
+    /// Values of float64 signals, nullptr otherwise.
+    const double* reals;
+
+    /// Number of samples.
+    size_t count;
+  };
+
+  /// Constructor.
+  SignalCaptureReader() = default;
+
+  /// Closes the file if open.
+  ~SignalCaptureReader();
+
+  /// Copy constructor deleted because the reader owns a mapping.
+  SignalCaptureReader(const SignalCaptureReader&) = delete;
+
+  /// Maps a capture file.
+  /// \returns false if the file cannot be read or is not a capture file
+  bool open(const std::string& path);
+
+  /// Unmaps the file.
+  void close();
+
+  /// Returns false if the file has not been closed properly by the writer.
+  bool is_complete() const { return m_complete; }
+
+  /// Returns true if the blocks are compressed.
+  bool is_compressed() const {
+    return m_header->flags & SignalCapture::flag_compressed;
+  }
+
+  /// Returns true if the values of a signal are doubles (float64), false if
+  /// they are int64.
+  bool is_real(size_t signal) const;
+
+  /// Returns the file header.
+  const SignalCapture::FileHeader& get_header() const { return *m_header; }
+
+  /// Returns the number of signals.
+  size_t get_num_signals() const { return m_signals.size(); }
+
+  /// Returns the description of a signal.
+  const SignalCapture::SignalInfo& get_signal(size_t signal) const {
+    return m_signals.at(signal);
+  }
+
+  /// Returns the number of a signal or -1 if it doesn't exist.
+  int find_signal(uint8_t node_id, const std::string& entry_name) const;
+
+  /// Returns the number of blocks of a signal.
+  size_t get_num_blocks(size_t signal) const;
+
+  /// Returns a block of a signal without copying.
+  /// \remark The file must not be compressed.
+  Block get_block(size_t signal, size_t block) const;
+
+  /// Copies or decodes a block of a signal. Values are returned as bit
+  /// patterns of int64 or double, see is_real().
+  /// \param signal Signal number
+  /// \param block Block number
+  /// \param timestamps Output, cleared first
+  /// \param values Output, cleared first
+  /// \returns false if the block is corrupt
+  bool decode_block(size_t signal, size_t block,
+                    std::vector<int64_t>& timestamps,
+                    std::vector<uint64_t>& values) const;
+
+  /// Copies the samples of a signal within a time range. Only the blocks
+  /// overlapping the range are visited (and decoded). Integer values are
+  /// converted to double.
+  /// \param signal Signal number
+  /// \param from_ns First timestamp (inclusive)
+  /// \param to_ns Last timestamp (inclusive)
+  /// \param timestamps Output, cleared first
+  /// \param values Output, cleared first
+  /// \returns the number of samples
+  size_t read(size_t signal, int64_t from_ns, int64_t to_ns,
+              std::vector<int64_t>& timestamps,
+              std::vector<double>& values) const;
+
+ private:
+  bool scan_blocks();
+
+  static const bool debug = false;
+
+  int m_fd = -1;
+  const char* m_mapping = nullptr;
+  size_t m_mapping_size = 0;
+  bool m_complete = false;
+  const SignalCapture::FileHeader* m_header = nullptr;
+  std::vector<SignalCapture::SignalInfo> m_signals;
+  // Block index per signal, in time order.
+  std::vector<std::vector<SignalCapture::BlockInfo>> m_blocks;
+};
+
+}  // end namespace kaco
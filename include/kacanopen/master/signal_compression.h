@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kaco {
+
+/// Lossless compression of time series blocks as used by compressed
+/// SignalCapture files. Slowly changing, regularly sampled signals compress
+/// to a few bits per sample.
+///
+/// The encoding is a bit stream (most significant bit first):
+///
+///  - Timestamps: the first timestamp as 64 bits, then the zigzag-encoded
+///    delta-of-delta of every following timestamp in a variable length
+///    bucket: '0' for zero, '10' + 16 bits, '110' + 24 bits, '1110' + 32 bits
+///    or '1111' + 64 bits.
+///  - Integer values: the first value as 64 bits, then the zigzag-encoded
+///    delta to the previous value in buckets of 0, 8, 16, 32 or 64 bits.
+///  - Real values (IEEE double bit patterns): the first value as 64 bits,
+///    then the XOR with the previous value: '0' if equal; '10' + the
+///    meaningful bits if they fit into the previous window of leading and
+///    trailing zeros; otherwise '11' + 5 bits leading zeros + 6 bits
+///    (meaningful bits - 1) + the meaningful bits.
+class SignalCompression {
+ public:
+  /// Encodes a block.
+  /// \param timestamps Timestamps, count elements
+  /// \param values Values as 64 bit patterns, count elements
+  /// \param count Number of samples
+  /// \param real true for real values (XOR encoding), false for integers
+  ///   (delta encoding)
+  /// \param output Encoded bytes are appended
+  static void encode(const int64_t* timestamps, const uint64_t* values,
+                     size_t count, bool real, std::vector<uint8_t>& output);
+
+  /// Decodes a block encoded by encode().
+  /// \param data Encoded bytes
+  /// \param size Number of encoded bytes
+  /// \param count Number of samples
+  /// \param real Value encoding passed to encode()
+  /// \param timestamps Output, decoded timestamps are appended
+  /// \param values Output, decoded values are appended
+  /// \returns false if the data is truncated
+  static bool decode(const uint8_t* data, size_t size, size_t count, bool real,
+                     std::vector<int64_t>& timestamps,
+                     std::vector<uint64_t>& values);
+};
+
+}  // end namespace kaco
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/sdo_server.h"
+#include "kacanopen/master/entry.h"
+#include "kacanopen/master/mapping.h"
+#include "kacanopen/master/receive_pdo_mapping.h"
+#include "kacanopen/master/transmit_pdo_mapping.h"
+#include "kacanopen/master/types.h"
+
+#include <atomic>
+#include <chrono>
+#include <forward_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kaco {
+
+/// This class represents a local CanOpen slave node.
+///
+/// It owns an object dictionary, which can be loaded from an EDS file
+/// (including default values) or built with add_entry(). After start(),
+/// remote masters can access the dictionary via SDO (expedited, segmented
+/// and block transfers, see SDOServer), control the node via NMT and
+/// guard it via node guarding. Receive PDOs are written into the
+/// dictionary and transmit PDOs are produced from it while the node is
+/// operational.
+///
+/// ### Remarks on thread-safety:
+///
+///   Like in Device, methods which manipulate the dictionary structure
+///   (load_dictionary_from_eds(), add_entry(), add_*_pdo_mapping()) should
+///   be run in sequence before start(). Methods which access dictionary
+///   entries are thread-safe afterwards.
+class Slave {
+ public:
+  /// Constructor.
+  /// \param core Reference of a Core instance
+  /// \param node_id Node id of the local node (1-127)
+  Slave(Core& core, uint8_t node_id);
+
+  /// Copy constructor deleted because of callbacks with self-references.
+  Slave(const Slave&) = delete;
+
+  /// Move constructor deleted because of callbacks with self-references.
+  Slave(Slave&&) = delete;
+
+  /// Destructor. Stops the node if it's running.
+  ~Slave();
+
+  /// Returns the node ID of the slave.
+  /// \remark thread-safe
+  uint8_t get_node_id() const;
+
+  /// Loads the dictionary from an EDS file including the default values.
+  /// \param path Path to the EDS file.
+  /// \throws canopen_error if the EDS file cannot be loaded.
+  void load_dictionary_from_eds(const std::string& path);
+
+  /// Adds an entry to the dictionary.
+  /// \param index Index
+  /// \param subindex Sub-index
+  /// \param name Name
+  /// \param type Data type
+  /// \param access_type Access rights for remote SDO clients
+  /// \throws canopen_error if entry with this name or index already exists.
+  void add_entry(const uint16_t index, const uint8_t subindex,
+                 const std::string& name, const Type type,
+                 const AccessType access_type);
+
+  /// Adds a receive PDO mapping. Values received via this PDO while the node
+  /// is operational are written into the dictionary.
+  /// \param cob_id COB-ID of the PDO
+  /// \param entry_name Name of the dictionary entry
+  /// \param offset index of the first mapped byte in the PDO message
+  /// \throws dictionary_error if there is no entry with the given name.
+  void add_receive_pdo_mapping(uint16_t cob_id, const std::string& entry_name,
+                               uint8_t offset);
+
+  /// Adds a transmit PDO mapping. The PDO is sent on change, periodically or
+  /// after each SYNC while the node is operational. See
+  /// Device::add_transmit_pdo_mapping().
+  /// \throws dictionary_error
+  void add_transmit_pdo_mapping(
+      uint16_t cob_id, const std::vector<Mapping>& mappings,
+      TransmissionType transmission_type = TransmissionType::ON_CHANGE,
+      std::chrono::milliseconds repeat_time = std::chrono::milliseconds(0));
+
+  /// Adds the PDO mappings which are configured in the PDO communication and
+  /// mapping parameters (0x1400-0x1BFF) of the own dictionary, e.g. by
+  /// default values from the EDS file. Invalid PDOs (COB-ID bit 31) and
+  /// mappings which aren't byte-aligned are skipped. Transmit PDOs with a
+  /// synchronous transmission type (0-240) are sent after each SYNC, all
+  /// other transmit PDOs are not sent automatically. Call send_transmit_pdos()
+  /// for them.
+  /// \returns Number of mapped PDOs
+  size_t map_pdos_from_dictionary();
+
+  /// Starts the SDO server, registers the node at NMT, sends the boot-up
+  /// message and enters pre-operational state.
+  void start();
+
+  /// Unregisters the node from SDO and NMT.
+  void stop();
+
+  /// Sends all transmit PDOs except synchronous ones if the node is
+  /// operational.
+  /// \returns Number of sent PDOs
+  /// \remark thread-safe
+  size_t send_transmit_pdos();
+
+  /// Sets all entries which don't have a value (e.g. no default value in the
+  /// EDS file) to zero or to an empty string. This is useful for simulated
+  /// devices, which should be able to answer every SDO upload.
+  void set_missing_values_to_zero();
+
+  /// Sends a heartbeat message with the current NMT state.
+  /// \remark thread-safe
+  void send_heartbeat();
+
+  /// Returns the producer heartbeat time (0x1017) or 0 if there is no such
+  /// entry.
+  std::chrono::milliseconds get_heartbeat_period() const;
+
+  /// Returns the current NMT state.
+  /// \remark thread-safe
+  NMT::State get_state() const;
+
+  /// Returns true if the entry is contained in the dictionary.
+  bool has_entry(const std::string& entry_name) const;
+
+  /// Returns true if the entry is contained in the dictionary.
+  bool has_entry(const uint16_t index, const uint8_t subindex = 0) const;
+
+  /// Returns the type of a dictionary entry.
+  /// \throws dictionary_error if there is no entry with the given name
+  Type get_entry_type(const std::string& entry_name) const;
+
+  /// Returns the type of a dictionary entry.
+  /// \throws dictionary_error if there is no entry with the given address
+  Type get_entry_type(const uint16_t index, const uint8_t subindex = 0) const;
+
+  /// Returns the local value of a dictionary entry.
+  /// \throws dictionary_error if there is no entry with the given name.
+  /// \throws canopen_error if the value isn't valid.
+  const Value& get_entry(const std::string& entry_name) const;
+
+  /// Returns the local value of a dictionary entry.
+  /// \throws dictionary_error if there is no entry with the given address.
+  /// \throws canopen_error if the value isn't valid.
+  const Value& get_entry(const uint16_t index, const uint8_t subindex = 0) const;
+
+  /// Sets the local value of a dictionary entry. Transmit PDOs with
+  /// transmission type ON_CHANGE are sent if the node is operational.
+  /// \throws dictionary_error if there is no entry with the given name or the
+  /// type doesn't match.
+  void set_entry(const std::string& entry_name, const Value& value);
+
+  /// Sets the local value of a dictionary entry.
+  /// \throws dictionary_error if there is no entry with the given address or
+  /// the type doesn't match.
+  void set_entry(const uint16_t index, const uint8_t subindex,
+                 const Value& value);
+
+  /// Registers a callback which is called when the value of the entry
+  /// changes, e.g. due to an SDO download or a receive PDO.
+  /// \throws dictionary_error if there is no entry with the given name.
+  void add_value_changed_callback(const std::string& entry_name,
+                                  Entry::ValueChangedCallback callback);
+
+  /// Registers a callback which is called when the value of the entry
+  /// changes.
+  /// \throws dictionary_error if there is no entry with the given address.
+  void add_value_changed_callback(const uint16_t index, const uint8_t subindex,
+                                  Entry::ValueChangedCallback callback);
+
+  /// Prints the dictionary together with current values to command line.
+  void print_dictionary() const;
+
+ private:
+  std::vector<uint8_t> sdo_upload(uint16_t index, uint8_t subindex);
+  void sdo_download(uint16_t index, uint8_t subindex,
+                    const std::vector<uint8_t>& data);
+
+  void nmt_command(NMT::Command command);
+  void nmt_guard_request();
+  void send_boot_up();
+
+  void pdo_received_callback(const ReceivePDOMapping& mapping,
+                             const std::vector<uint8_t>& data);
+
+  /// Returns an unsigned 8, 16 or 32 bit entry value.
+  /// \returns false if the entry doesn't exist or isn't valid.
+  bool get_unsigned(uint16_t index, uint8_t subindex, uint32_t& result) const;
+
+  /// \throws sdo_error if the entry doesn't exist.
+  Entry& get_entry_for_sdo(uint16_t index, uint8_t subindex);
+
+  static const bool debug = false;
+
+  Core& m_core;
+  const uint8_t m_node_id;
+
+  std::unordered_map<Address, Entry> m_dictionary;
+  std::unordered_map<std::string, Address> m_name_to_address;
+
+  std::atomic<NMT::State> m_state{NMT::State::initializing};
+  bool m_guard_toggle = false;
+  std::unique_ptr<SDOServer> m_sdo_server;
+  uint32_t m_sync_callback_id = 0;
+
+  std::forward_list<ReceivePDOMapping> m_receive_pdo_mappings;
+  std::vector<uint16_t> m_receive_pdo_cob_ids;
+  std::forward_list<TransmitPDOMapping> m_transmit_pdo_mappings;
+};
+
+}  // end namespace kaco
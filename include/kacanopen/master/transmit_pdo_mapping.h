@@ -38,6 +38,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "kacanopen/core/message.h"
 #include "kacanopen/master/address.h"
 #include "kacanopen/master/mapping.h"
 #include "kacanopen/master/types.h"
@@ -100,6 +101,9 @@ class TransmitPDOMapping {
   /// Sends the PDO
   void send() const;
 
+  /// Returns the PDO message with the current values without sending it.
+  Message get_message() const;
+
  private:
   /// \throws dictionary_error
   void check_correctness() const;
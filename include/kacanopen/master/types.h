@@ -108,7 +108,10 @@ enum class ObjectType : uint8_t {
 enum AccessType { read_only, write_only, read_write, constant };
 
 /// Transmission type of a PDO mapping
-enum class TransmissionType { PERIODIC, ON_CHANGE };
+/// SYNCHRONOUS mappings are only sent by Device::send_synchronous_pdos(),
+/// e.g. after each SYNC. ON_REQUEST mappings are only sent by
+/// Device::send_transmit_pdo().
+enum class TransmissionType { PERIODIC, ON_CHANGE, SYNCHRONOUS, ON_REQUEST };
 
 enum class TPDO_NO {
   TPDO_1 = 0x180,
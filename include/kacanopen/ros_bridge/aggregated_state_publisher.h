@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/ros_bridge/publisher.h"
+#include "kacanopen/EntryStates.h"
+#include "ros/ros.h"
+#include "sensor_msgs/JointState.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kaco {
+
+/// This class provides a Publisher implementation for
+/// use with kaco::Bridge. It publishes the state of several
+/// devices in two aggregated messages instead of one topic
+/// per entry or device:
+///
+///   - "<prefix>/joint_states": one sensor_msgs/JointState with all joints
+///     added by add_joint(), e.g. all axes of an arm.
+///   - "<prefix>/entries": one kacanopen/EntryStates with all entries added
+///     by add_entry(), e.g. statuswords.
+///
+/// All values are read from the device caches, so the entries should be
+/// mapped to receive PDOs. If constructed with a Core, the caches are read
+/// once per SYNC cycle, so all values stem from the same cycle. At SYNC n,
+/// the caches hold the synchronous PDOs sampled at SYNC n-1, so the messages
+/// are stamped with the time of SYNC n-1. They are published by a worker
+/// thread, not in the receive thread. Otherwise, kaco::Bridge publishes them
+/// at its loop rate.
+class AggregatedStatePublisher : public Publisher {
+ public:
+  /// Constructor for publishing at the loop rate of kaco::Bridge.
+  /// \param topic_prefix Prefix of the topic names
+  AggregatedStatePublisher(const std::string& topic_prefix = "state");
+
+  /// Constructor for publishing once per SYNC cycle.
+  /// \param core The core which receives or produces the SYNC
+  /// \param topic_prefix Prefix of the topic names
+  AggregatedStatePublisher(Core& core,
+                           const std::string& topic_prefix = "state");
+
+  ~AggregatedStatePublisher();
+
+  /// Adds a joint of a CiA 402 device to the JointState message.
+  /// \param device The device
+  /// \param joint_name Name of the joint in the message
+  /// \param position_0_degree Position actual value which represents 0 rad
+  /// \param position_360_degree Position actual value which represents 2 pi
+  /// \param velocity_field Velocity entry (same scaling, per second) or
+  ///   empty
+  /// \param effort_field Torque entry (published as is) or empty
+  /// \param position_field Position entry
+  /// \throws dictionary_error if an entry doesn't exist.
+  /// \remark Must be called before advertise().
+  void add_joint(Device& device, const std::string& joint_name,
+                 int32_t position_0_degree, int32_t position_360_degree,
+                 const std::string& velocity_field = "",
+                 const std::string& effort_field = "",
+                 const std::string& position_field = "position_actual_value");
+
+  /// Adds an entry to the EntryStates message.
+  /// \throws dictionary_error if the entry doesn't exist.
+  /// \remark Must be called before advertise().
+  void add_entry(Device& device, const std::string& entry_name);
+
+  /// \see interface Publisher
+  void advertise() override;
+
+  /// \see interface Publisher
+  void publish() override;
+
+  /// \see interface Publisher
+  bool is_event_driven() const override;
+
+ private:
+  struct Joint {
+    Device* device;
+    std::string name;
+    double offset;
+    double scale;
+    std::string position_field;
+    std::string velocity_field;
+    std::string effort_field;
+  };
+
+  struct EntryField {
+    Device* device;
+    std::string name;
+    std::string entry_name;
+  };
+
+  static bool read(Device& device, const std::string& entry_name,
+                   double& value);
+  void publish_state();
+  void sync_received();
+  void fill(const ros::Time& stamp, sensor_msgs::JointState& js,
+            kacanopen::EntryStates& msg);
+  void send(const sensor_msgs::JointState& js,
+            const kacanopen::EntryStates& msg);
+  void worker_loop();
+
+  static const bool debug = false;
+
+  // TODO: let the user change this?
+  static const unsigned queue_size = 100;
+
+  Core* m_core = nullptr;
+  uint32_t m_sync_callback_id = 0;
+  std::string m_topic_prefix;
+  bool m_advertised = false;
+
+  std::vector<Joint> m_joints;
+  std::vector<EntryField> m_entries;
+
+  ros::Publisher m_joint_state_publisher;
+  ros::Publisher m_entry_publisher;
+
+  // time of the previous SYNC, only accessed in the SYNC callback
+  ros::Time m_previous_sync_stamp;
+
+  // messages handed from the SYNC callback to the worker
+  std::thread m_worker;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_pending = false;
+  bool m_stopping = false;
+  sensor_msgs::JointState m_joint_state;
+  kacanopen::EntryStates m_entry_states;
+};
+
+}  // end namespace kaco
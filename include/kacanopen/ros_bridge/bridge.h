@@ -35,29 +35,48 @@
 #include "kacanopen/ros_bridge/publisher.h"
 #include "kacanopen/ros_bridge/subscriber.h"
 
-#include <forward_list>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <queue>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace kaco {
 
 /// This class is a bridge between a ROS network and a CanOpen network.
+///
+/// Polled publishers are served by a single scheduler thread. Publishers
+/// are aligned to their rate on a common time grid, so publishers with the
+/// same (or a harmonic) rate become due at the same tick. All publishers
+/// due at a tick are grouped by node (see Publisher::get_node_id()): each
+/// node's group runs sequentially while different nodes run in parallel on
+/// a small worker pool with at most one thread per node.
 class Bridge {
  public:
 
   Bridge();
 
+  /// Stops the scheduler and waits for running publish() calls to finish.
   ~Bridge();
 
+  /// Copy constructor deleted because of threads.
+  Bridge(const Bridge&) = delete;
+
   /// Runs the ROS spinner and blocks until shutdown (e.g. via Ctrl+c).
   void run();
 
-  /// Adds a Publisher, advertises it and publishes messages repeatedly.
+  /// Adds a Publisher, advertises it and publishes messages repeatedly
+  /// unless it is event-driven.
   /// \param publisher The publisher. It's a smart pointer because references
   ///   to a publisher may never change after advertising it to ROS.
-  /// \param loop_rate Publishing rate in hertz. Default is 10 Hz.
+  /// \param loop_rate Publishing rate in hertz. Default is 10 Hz. Ignored for
+  ///   event-driven publishers (see Publisher::is_event_driven()).
   void add_publisher(std::shared_ptr<Publisher> publisher,
                      double loop_rate = 10);
 
@@ -69,12 +88,51 @@ class Bridge {
 
 
  private:
+  using Clock = std::chrono::steady_clock;
+  using PublisherGroup = std::vector<std::shared_ptr<Publisher>>;
+
+  struct ScheduledPublisher {
+    Clock::time_point due;
+    Clock::duration period;
+    int node_id;
+    std::shared_ptr<Publisher> publisher;
+
+    bool operator>(const ScheduledPublisher& other) const {
+      return due > other.due;
+    }
+  };
+
+  void scheduler_loop();
+  void worker_loop();
+
+  /// Runs all groups and returns when all of them have finished. The first
+  /// group runs in the calling thread.
+  void run_groups(std::vector<PublisherGroup>& groups);
+
+  static void publish_group(const PublisherGroup& group);
+
   static const bool debug = false;
 
+  /// Upper bound for waiting, so ros::ok() is checked regularly.
+  static constexpr std::chrono::milliseconds max_wait{100};
+
   volatile std::atomic<bool> m_running;
   std::vector<std::shared_ptr<Publisher>> m_publishers;
   std::vector<std::shared_ptr<Subscriber>> m_subscribers;
-  std::forward_list<std::future<void>> m_futures;
+
+  std::mutex m_schedule_mutex;
+  std::condition_variable m_schedule_condition;
+  std::priority_queue<ScheduledPublisher, std::vector<ScheduledPublisher>,
+                      std::greater<ScheduledPublisher>>
+      m_schedule;
+  std::thread m_scheduler;
+
+  std::mutex m_worker_mutex;
+  std::condition_variable m_worker_condition;
+  std::condition_variable m_groups_done_condition;
+  std::deque<PublisherGroup> m_worker_queue;
+  size_t m_groups_pending = 0;
+  std::vector<std::thread> m_workers;
 };
 
 }  // end namespace kaco
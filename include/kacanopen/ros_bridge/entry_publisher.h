@@ -35,6 +35,8 @@
 #include "kacanopen/ros_bridge/publisher.h"
 #include "ros/ros.h"
 
+#include <chrono>
+#include <mutex>
 #include <string>
 
 namespace kaco {
@@ -42,6 +44,11 @@ namespace kaco {
 /// This class provides a Publisher implementation for
 /// use with kaco::Bridge. It publishes a value from
 /// a device's dictionary.
+///
+/// By default, kaco::Bridge polls the entry at its loop rate, which means
+/// one SDO transfer per message if the entry isn't mapped to a PDO. In
+/// event-driven mode, the entry is published whenever its cached value
+/// changes, e.g. by a received PDO, without any polling.
 class EntryPublisher : public Publisher {
  public:
   /// Constructor
@@ -53,6 +60,16 @@ class EntryPublisher : public Publisher {
       Device& device, const std::string& entry_name,
       const ReadAccessMethod access_method = ReadAccessMethod::use_default);
 
+  /// Constructor for an event-driven publisher. The entry should be mapped
+  /// to a receive PDO, otherwise its value only changes on explicit reads.
+  /// \param device The CanOpen device
+  /// \param entry_name The name of the entry. See device profile.
+  /// \param min_interval Minimum time between two messages. Changes within
+  ///   this interval are coalesced and the latest value is published when
+  ///   the interval has elapsed. Zero publishes every change.
+  EntryPublisher(Device& device, const std::string& entry_name,
+                 std::chrono::milliseconds min_interval);
+
   ~EntryPublisher();
 
   /// \see interface Publisher
@@ -61,7 +78,17 @@ class EntryPublisher : public Publisher {
   /// \see interface Publisher
   void publish() override;
 
+  /// \see interface Publisher
+  bool is_event_driven() const override;
+
+  /// \see interface Publisher
+  int get_node_id() const override;
+
  private:
+  void value_changed(const Value& value);
+  void flush(const ros::TimerEvent& event);
+  void publish_value(const Value& value);
+
   static const bool debug = false;
 
   // TODO: let the user change this?
@@ -75,6 +102,17 @@ class EntryPublisher : public Publisher {
   std::string m_entry_name;
   ReadAccessMethod m_access_method;
   Type m_type;
+
+  // event-driven mode
+  bool m_event_driven = false;
+  std::chrono::milliseconds m_min_interval{0};
+  uint32_t m_callback_id = 0;
+  std::mutex m_mutex;
+  ros::Timer m_timer;
+  bool m_advertised = false;
+  bool m_pending = false;
+  Value m_pending_value;
+  std::chrono::steady_clock::time_point m_last_publish;
 };
 
 }  // end namespace kaco
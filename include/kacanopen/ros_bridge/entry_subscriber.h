@@ -32,6 +32,7 @@
 #pragma once
 
 #include "kacanopen/master/device.h"
+#include "kacanopen/master/entry_write_queue.h"
 #include "kacanopen/ros_bridge/subscriber.h"
 #include "ros/ros.h"
 
@@ -44,14 +45,20 @@
 #include "std_msgs/UInt32.h"
 #include "std_msgs/UInt8.h"
 
+#include <memory>
 #include <string>
-#include <thread>
 
 namespace kaco {
 
-/// This class provides a Publisher implementation for
-/// use with kaco::Bridge. It publishes a value from
+/// This class provides a Subscriber implementation for
+/// use with kaco::Bridge. It writes received values to
 /// a device's dictionary.
+///
+/// Values are not written in the ROS callback but handed to the device's
+/// shared EntryWriteQueue, so callbacks never block on SDO transfers. If
+/// several messages arrive while a write is in progress, only the latest
+/// value is written. Counters for coalesced and failed writes are available
+/// via EntryWriteQueue::shared(device)->get_statistics().
 class EntrySubscriber : public Subscriber {
  public:
   /// Constructor
@@ -91,6 +98,8 @@ class EntrySubscriber : public Subscriber {
   std::string m_entry_name;
   WriteAccessMethod m_access_method;
   Type m_type;
+
+  std::shared_ptr<EntryWriteQueue> m_write_queue;
 };
 
 }  // end namespace kaco
@@ -72,6 +72,9 @@ class JointStatePublisher : public Publisher {
   /// \see interface Publisher
   void publish() override;
 
+  /// \see interface Publisher
+  int get_node_id() const override;
+
  private:
   static const bool debug = false;
 
@@ -31,6 +31,7 @@
 
 #pragma once
 
+#include "kacanopen/master/cyclic_drive.h"
 #include "kacanopen/master/device.h"
 #include "kacanopen/ros_bridge/subscriber.h"
 #include "ros/ros.h"
@@ -51,6 +52,11 @@ namespace kaco {
 /// You have to initialize the motor on your own.
 /// The motor is expected to be in position mode and
 /// operational state.
+///
+/// If constructed with a CyclicDrive, positions are streamed
+/// via PDOs instead of SDOs: In interpolated position mode,
+/// each message is queued as trajectory point, in cyclic
+/// synchronous position mode it becomes the new target.
 class JointStateSubscriber : public Subscriber {
  public:
   /// Constructor
@@ -67,6 +73,17 @@ class JointStateSubscriber : public Subscriber {
                        int32_t position_360_degree,
                        std::string topic_name = "");
 
+  /// Constructor
+  /// \param drive a configured CyclicDrive in interpolated position or
+  /// cyclic synchronous position mode.
+  /// \param position_0_degree See above.
+  /// \param position_360_degree See above.
+  /// \param topic_name Custom topic name. Leave out for default.
+  /// \throws std::runtime_error if the drive is in another mode.
+  JointStateSubscriber(CyclicDrive& drive, int32_t position_0_degree,
+                       int32_t position_360_degree,
+                       std::string topic_name = "");
+
   /// \see interface Subscriber
   void advertise() override;
 
@@ -87,6 +104,7 @@ class JointStateSubscriber : public Subscriber {
   static constexpr double pi() { return std::acos(-1); }
 
   Device& m_device;
+  CyclicDrive* m_drive = nullptr;
   int32_t m_position_0_degree;
   int32_t m_position_360_degree;
   std::string m_topic_name;
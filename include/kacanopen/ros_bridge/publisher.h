@@ -44,6 +44,16 @@ class Publisher {
   /// This will be called repeatedly by kaco::Bridge::run()
   virtual void publish() = 0;
 
+  /// Returns true if the publisher publishes on its own, e.g. on value
+  /// changes. kaco::Bridge doesn't call publish() repeatedly then.
+  virtual bool is_event_driven() const { return false; }
+
+  /// Returns the node ID of the device this publisher reads from, or -1 if
+  /// it doesn't belong to a single node. kaco::Bridge calls publish() of
+  /// publishers with the same node ID one after another and runs different
+  /// nodes in parallel, so their SDO transfers don't wait for each other.
+  virtual int get_node_id() const { return -1; }
+
   // Virtual destructor must be defined!
   virtual ~Publisher() {}
 };
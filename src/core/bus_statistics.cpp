@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/bus_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace kaco {
+
+struct BusStatistics::Slot {
+  std::atomic<uint64_t> rx_frames{0};
+  std::atomic<uint64_t> tx_frames{0};
+  std::atomic<uint64_t> rx_bytes{0};
+  std::atomic<uint64_t> tx_bytes{0};
+  std::atomic<uint64_t> send_failures{0};
+
+  // Only written by the receive thread.
+  std::atomic<int64_t> last_rx_ns{0};
+  std::atomic<uint64_t> interarrival_min_ns{0};
+  std::atomic<uint64_t> interarrival_max_ns{0};
+  std::atomic<uint64_t> interarrival_sum_ns{0};
+  std::atomic<uint64_t> interarrival_count{0};
+  std::array<std::atomic<uint64_t>, histogram_buckets> latency;
+};
+
+struct BusStatistics::SdoSlot {
+  // Time of the last request, 0 if answered.
+  std::atomic<int64_t> request_ns{0};
+  std::array<std::atomic<uint64_t>, histogram_buckets> round_trips;
+};
+
+namespace {
+
+const auto relaxed = std::memory_order_relaxed;
+
+int64_t to_ns(BusStatistics::Clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+// Increment for counters with a single writer - cheaper than fetch_add().
+void increment(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(relaxed) + value, relaxed);
+}
+
+size_t bucket_of(int64_t ns) {
+  const int64_t us = ns / 1000;
+  if (us <= 0) {
+    return 0;
+  }
+  return std::min<size_t>(
+      BusStatistics::histogram_buckets - 1,
+      64 - __builtin_clzll(static_cast<unsigned long long>(us)));
+}
+
+}  // namespace
+
+uint64_t BusStatistics::Histogram::samples() const {
+  uint64_t samples = 0;
+  for (uint64_t count : buckets) {
+    samples += count;
+  }
+  return samples;
+}
+
+uint64_t BusStatistics::Histogram::percentile_us(double percentile) const {
+  const uint64_t total = samples();
+  if (total == 0) {
+    return 0;
+  }
+
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(percentile * total)));
+  uint64_t sum = 0;
+  for (size_t bucket = 0; bucket < histogram_buckets; ++bucket) {
+    sum += buckets[bucket];
+    if (sum >= rank) {
+      return uint64_t(1) << bucket;
+    }
+  }
+  return uint64_t(1) << (histogram_buckets - 1);
+}
+
+void BusStatistics::Histogram::add(const Histogram& other) {
+  for (size_t bucket = 0; bucket < histogram_buckets; ++bucket) {
+    buckets[bucket] += other.buckets[bucket];
+  }
+}
+
+void BusStatistics::Counters::add(const Counters& other) {
+  if (other.rx_frames > 0) {
+    const double frames = rx_frames + other.rx_frames;
+    interarrival_avg_us = (interarrival_avg_us * rx_frames +
+                           other.interarrival_avg_us * other.rx_frames) /
+                          frames;
+    if (other.interarrival_min_us > 0 &&
+        (interarrival_min_us == 0 ||
+         other.interarrival_min_us < interarrival_min_us)) {
+      interarrival_min_us = other.interarrival_min_us;
+    }
+    interarrival_max_us =
+        std::max(interarrival_max_us, other.interarrival_max_us);
+  }
+
+  rx_frames += other.rx_frames;
+  tx_frames += other.tx_frames;
+  rx_bytes += other.rx_bytes;
+  tx_bytes += other.tx_bytes;
+  send_failures += other.send_failures;
+  last_received = std::max(last_received, other.last_received);
+  latency.add(other.latency);
+}
+
+BusStatistics::BusStatistics() {
+  if (enabled()) {
+    m_slots.reset(new Slot[cob_id_count]);
+    m_sdo_slots.reset(new SdoSlot[128]);
+  }
+  reset();
+}
+
+BusStatistics::~BusStatistics() {}
+
+bool BusStatistics::enabled() {
+#ifdef BUS_STATISTICS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void BusStatistics::received(const Message& message, Clock::time_point time) {
+  Slot& slot = m_slots[message.cob_id & 0x7FF];
+  increment(slot.rx_frames, 1);
+  increment(slot.rx_bytes, message.len);
+
+  const int64_t now = to_ns(time);
+  const int64_t last = slot.last_rx_ns.load(relaxed);
+  slot.last_rx_ns.store(now, relaxed);
+
+  const uint8_t function_code = message.get_function_code();
+  if (function_code == 11 || function_code == 12) {
+    SdoSlot& sdo = m_sdo_slots[message.get_node_id()];
+    if (function_code == 12) {
+      sdo.request_ns.store(now, relaxed);
+    } else {
+      const int64_t request = sdo.request_ns.exchange(0, relaxed);
+      if (request != 0 && now >= request) {
+        sdo.round_trips[bucket_of(now - request)].fetch_add(1, relaxed);
+      }
+    }
+  }
+
+  if (last == 0 || now < last) {
+    return;
+  }
+
+  const uint64_t interarrival = now - last;
+  const uint64_t min = slot.interarrival_min_ns.load(relaxed);
+  if (min == 0 || interarrival < min) {
+    slot.interarrival_min_ns.store(interarrival, relaxed);
+  }
+  if (interarrival > slot.interarrival_max_ns.load(relaxed)) {
+    slot.interarrival_max_ns.store(interarrival, relaxed);
+  }
+  increment(slot.interarrival_sum_ns, interarrival);
+  increment(slot.interarrival_count, 1);
+}
+
+void BusStatistics::dispatched(const Message& message,
+                               Clock::time_point received) {
+  const size_t bucket = bucket_of(to_ns(Clock::now()) - to_ns(received));
+  increment(m_slots[message.cob_id & 0x7FF].latency[bucket], 1);
+}
+
+void BusStatistics::sent(const Message& message, bool success) {
+  Slot& slot = m_slots[message.cob_id & 0x7FF];
+  if (!success) {
+    slot.send_failures.fetch_add(1, relaxed);
+    return;
+  }
+  slot.tx_frames.fetch_add(1, relaxed);
+  slot.tx_bytes.fetch_add(message.len, relaxed);
+
+  if (message.get_function_code() == 12) {
+    m_sdo_slots[message.get_node_id()].request_ns.store(to_ns(Clock::now()),
+                                                        relaxed);
+  }
+}
+
+BusStatistics::Snapshot BusStatistics::snapshot() const {
+  Snapshot snapshot;
+  snapshot.enabled = enabled();
+  snapshot.duration =
+      Clock::now().time_since_epoch() -
+      std::chrono::nanoseconds(m_reset_time.load(relaxed));
+  for (size_t code = 0; code < snapshot.function_codes.size(); ++code) {
+    snapshot.function_codes[code].id = code;
+  }
+  if (!m_slots) {
+    return snapshot;
+  }
+
+  for (size_t cob_id = 0; cob_id < cob_id_count; ++cob_id) {
+    const Slot& slot = m_slots[cob_id];
+    Counters counters;
+    counters.id = cob_id;
+    counters.rx_frames = slot.rx_frames.load(relaxed);
+    counters.tx_frames = slot.tx_frames.load(relaxed);
+    counters.send_failures = slot.send_failures.load(relaxed);
+    if (counters.rx_frames == 0 && counters.tx_frames == 0 &&
+        counters.send_failures == 0) {
+      continue;
+    }
+
+    counters.rx_bytes = slot.rx_bytes.load(relaxed);
+    counters.tx_bytes = slot.tx_bytes.load(relaxed);
+    const int64_t last_rx = slot.last_rx_ns.load(relaxed);
+    if (last_rx != 0) {
+      counters.last_received =
+          Clock::time_point(std::chrono::nanoseconds(last_rx));
+    }
+    const uint64_t count = slot.interarrival_count.load(relaxed);
+    if (count > 0) {
+      counters.interarrival_min_us =
+          slot.interarrival_min_ns.load(relaxed) / 1000;
+      counters.interarrival_max_us =
+          slot.interarrival_max_ns.load(relaxed) / 1000;
+      counters.interarrival_avg_us =
+          slot.interarrival_sum_ns.load(relaxed) / 1000.0 / count;
+    }
+    for (size_t bucket = 0; bucket < histogram_buckets; ++bucket) {
+      counters.latency.buckets[bucket] = slot.latency[bucket].load(relaxed);
+    }
+
+    snapshot.function_codes[(cob_id >> 7) & 0x0F].add(counters);
+    snapshot.total.add(counters);
+    snapshot.cob_ids.push_back(counters);
+  }
+
+  for (size_t node_id = 0; node_id < 128; ++node_id) {
+    const SdoSlot& sdo = m_sdo_slots[node_id];
+    for (size_t bucket = 0; bucket < histogram_buckets; ++bucket) {
+      snapshot.sdo_round_trips[node_id].buckets[bucket] =
+          sdo.round_trips[bucket].load(relaxed);
+    }
+  }
+
+  return snapshot;
+}
+
+void BusStatistics::reset() {
+  m_reset_time.store(to_ns(Clock::now()), relaxed);
+  if (!m_slots) {
+    return;
+  }
+
+  for (size_t cob_id = 0; cob_id < cob_id_count; ++cob_id) {
+    Slot& slot = m_slots[cob_id];
+    slot.rx_frames.store(0, relaxed);
+    slot.tx_frames.store(0, relaxed);
+    slot.rx_bytes.store(0, relaxed);
+    slot.tx_bytes.store(0, relaxed);
+    slot.send_failures.store(0, relaxed);
+    slot.last_rx_ns.store(0, relaxed);
+    slot.interarrival_min_ns.store(0, relaxed);
+    slot.interarrival_max_ns.store(0, relaxed);
+    slot.interarrival_sum_ns.store(0, relaxed);
+    slot.interarrival_count.store(0, relaxed);
+    for (auto& bucket : slot.latency) {
+      bucket.store(0, relaxed);
+    }
+  }
+
+  for (size_t node_id = 0; node_id < 128; ++node_id) {
+    SdoSlot& sdo = m_sdo_slots[node_id];
+    sdo.request_ns.store(0, relaxed);
+    for (auto& bucket : sdo.round_trips) {
+      bucket.store(0, relaxed);
+    }
+  }
+}
+
+}  // end namespace kaco
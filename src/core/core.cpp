@@ -37,6 +37,7 @@
 
 #include "kacanopen/core/core.h"
 #include "kacanopen/core/logger.h"
+#include "kacanopen/core/probes.h"
 
 namespace kaco {
 
@@ -67,7 +68,7 @@ extern "C" CANHandle canOpen_driver(CANBoard*);
 extern "C" int32_t canClose_driver(CANHandle);
 extern "C" uint8_t canChangeBaudRate_driver(CANHandle, char*);
 
-Core::Core() : nmt(*this), sdo(*this), pdo(*this) {}
+Core::Core() : nmt(*this), sdo(*this), pdo(*this), sync(*this) {}
 
 Core::~Core() {
   if (m_running) {
@@ -78,6 +79,8 @@ Core::~Core() {
 bool Core::start(const std::string busname, const std::string& baudrate) {
   assert(!m_running);
 
+  m_virtual_bus = nullptr;
+
   CANBoard board = {busname.c_str(), baudrate.c_str()};
   m_handle = canOpen_driver(&board);
 
@@ -88,14 +91,16 @@ bool Core::start(const std::string busname, const std::string& baudrate) {
 
   uint16_t cob_id = 0x700 + 6;
   const Message message = {cob_id, true, 0, {0, 0, 0, 0, 0, 0, 0, 0}};
+  // send() only sends while the Core is running.
+  m_running = true;
   bool send_res = send(message);
 
   if (!send_res) {
     ERROR("Cannot send dummy message. Probably network is down");
+    m_running = false;
     return false;
   }
 
-  m_running = true;
   m_loop_thread = std::thread(&Core::receive_loop, this, std::ref(m_running));
   return true;
 }
@@ -110,10 +115,30 @@ bool Core::start(const std::string busname, const unsigned baudrate) {
   }
 }
 
+bool Core::start(VirtualBus& bus) {
+  assert(!m_running);
+
+  m_virtual_bus = &bus;
+  m_virtual_endpoint = bus.attach();
+
+  m_running = true;
+  m_loop_thread = std::thread(&Core::receive_loop, this, std::ref(m_running));
+  return true;
+}
+
 void Core::stop() {
   assert(m_running);
 
+  sync.stop_producer();
   m_running = false;
+
+  if (m_virtual_bus) {
+    // Unblocks the receive loop, so it can be joined.
+    m_virtual_bus->detach(m_virtual_endpoint.get());
+    m_loop_thread.join();
+    return;
+  }
+
   m_loop_thread.detach();
 
   DEBUG_LOG("Calling canClose.");
@@ -124,16 +149,45 @@ void Core::receive_loop(std::atomic<bool>& running) {
   Message message;
 
   while (running) {
-    canReceive_driver(m_handle, &message);
-    received_message(message);
+    if (m_virtual_bus) {
+      if (!m_virtual_bus->receive(m_virtual_endpoint.get(), message)) {
+        break;
+      }
+    } else if (canReceive_driver(m_handle, &message) != 0) {
+      // The driver reports the error. Don't dispatch a stale message.
+      continue;
+    }
+    FrameRecorder* recorder = m_recorder.load(std::memory_order_acquire);
+    if (recorder) {
+      recorder->record(message, FrameRecorder::Direction::received);
+    }
+    dispatch(message);
   }
 }
 
+void Core::dispatch(const Message& message) {
+  KACO_PROBE3(frame_receive, message.cob_id, message.len, message.data);
+  KACO_PROBE1(dispatch_begin, message.cob_id);
+#ifdef BUS_STATISTICS
+  const BusStatistics::Clock::time_point received = BusStatistics::Clock::now();
+  statistics.received(message, received);
+  received_message(message);
+  statistics.dispatched(message, received);
+#else
+  received_message(message);
+#endif
+  KACO_PROBE1(dispatch_end, message.cob_id);
+}
+
 void Core::register_receive_callback(const MessageReceivedCallback& callback) {
   std::lock_guard<std::mutex> scoped_lock(m_receive_callbacks_mutex);
   m_receive_callbacks.push_back(callback);
 }
 
+void Core::set_recorder(FrameRecorder* recorder) {
+  m_recorder.store(recorder, std::memory_order_release);
+}
+
 void Core::received_message(const Message& message) {
   DEBUG_LOG(" ");
   DEBUG_LOG("Received message:");
@@ -166,12 +220,16 @@ void Core::received_message(const Message& message) {
     case 0: {
       DEBUG_LOG("NMT Module Control");
       DEBUG(message.print();)
+      nmt.process_incoming_command(message);
       break;
     }
 
     case 1: {
       DEBUG_LOG("Sync or Emergency");
       DEBUG(message.print();)
+      if (message.cob_id == 0x80) {
+        sync.process_incoming_message(message);
+      }
       break;
     }
 
@@ -194,10 +252,7 @@ void Core::received_message(const Message& message) {
     case 6:
     case 8:
     case 10: {
-      // TODO: Implement this for slave functionality
-      // 	-> delegate to pdo.process_incoming_rpdo()
-      DEBUG_LOG("PDO receive");
-      DEBUG(message.print();)
+      pdo.process_incoming_rpdo(message);
       break;
     }
 
@@ -208,10 +263,7 @@ void Core::received_message(const Message& message) {
     }
 
     case 12: {
-      // TODO: Implement this for slave functionality
-      // 	-> delegate to sdo.process_incoming_client_sdo()
-      DEBUG_LOG("SDO (receive/client)");
-      DEBUG(message.print();)
+      sdo.process_incoming_client_sdo(message);
       break;
     }
 
@@ -231,7 +283,34 @@ void Core::received_message(const Message& message) {
   DEBUG_LOG(" ");
 }
 
+void Core::record_sent(const Message& message, bool sent) {
+#ifdef BUS_STATISTICS
+  statistics.sent(message, sent);
+#endif
+  if (sent) {
+    FrameRecorder* recorder = m_recorder.load(std::memory_order_acquire);
+    if (recorder) {
+      recorder->record(message, FrameRecorder::Direction::transmitted);
+    }
+  }
+}
+
 bool Core::send(const Message& message) {
+  if (!m_running) {
+    // Not started or stopped, e.g. while replaying a log into this Core.
+    DEBUG_LOG("Dropping message because the Core is not running.");
+    record_sent(message, false);
+    return false;
+  }
+
+  if (m_virtual_bus) {
+    DEBUG_LOG_EXHAUSTIVE("Sending message:");
+    DEBUG_EXHAUSTIVE(message.print();)
+    m_virtual_bus->send(m_virtual_endpoint.get(), message);
+    record_sent(message, true);
+    return true;
+  }
+
   if (m_lock_send) {
     m_send_mutex.lock();
   }
@@ -244,7 +323,33 @@ bool Core::send(const Message& message) {
     m_send_mutex.unlock();
   }
 
+  record_sent(message, res == 0);
   return res == 0;
 }
 
+bool Core::send(const std::vector<Message>& messages) {
+  // Hold the send lock for the whole burst, so that no other message gets
+  // in between.
+  std::lock_guard<std::mutex> lock(m_send_mutex);
+  const bool running = m_running;
+  bool success = true;
+
+  for (const Message& message : messages) {
+    DEBUG_LOG_EXHAUSTIVE("Sending message:");
+    DEBUG_EXHAUSTIVE(message.print();)
+    bool sent = true;
+    if (!running) {
+      sent = false;
+    } else if (m_virtual_bus) {
+      m_virtual_bus->send(m_virtual_endpoint.get(), message);
+    } else {
+      sent = (canSend_driver(m_handle, &message) == 0);
+    }
+    record_sent(message, sent);
+    success = sent && success;
+  }
+
+  return success;
+}
+
 }  // namespace kaco
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/frame_recorder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "kacanopen/core/logger.h"
+
+namespace kaco {
+
+FrameRecorder::~FrameRecorder() {
+  if (is_open()) {
+    close();
+  }
+}
+
+bool FrameRecorder::open(const std::string& path, size_t capacity,
+                         uint8_t bus_id) {
+  if (is_open()) {
+    close();
+  }
+
+  const size_t size = sizeof(FileHeader) + capacity * sizeof(Record);
+
+  m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (m_fd < 0) {
+    ERROR("[FrameRecorder::open] Cannot open " << path << ": "
+                                               << std::strerror(errno));
+    return false;
+  }
+
+  // Allocate all blocks now, so that writing to the mapping later neither
+  // blocks on the file system nor fails with SIGBUS on a full disk.
+  const int error = posix_fallocate(m_fd, 0, size);
+  if (error != 0) {
+    ERROR("[FrameRecorder::open] Cannot allocate " << size << " bytes for "
+                                                   << path << ": "
+                                                   << std::strerror(error));
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  m_mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, m_fd, 0);
+  if (m_mapping == MAP_FAILED) {
+    ERROR("[FrameRecorder::open] Cannot map " << path << ": "
+                                              << std::strerror(errno));
+    m_mapping = nullptr;
+    ::close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  m_mapping_size = size;
+  m_header = static_cast<FileHeader*>(m_mapping);
+  m_capacity = capacity;
+  m_bus_id = bus_id;
+  m_next = 0;
+
+  std::memset(m_header, 0, sizeof(FileHeader));
+  m_header->magic = magic;
+  m_header->header_size = sizeof(FileHeader);
+  m_header->record_size = sizeof(Record);
+  m_header->capacity = capacity;
+  m_header->start_time_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  m_start = std::chrono::steady_clock::now();
+
+  // Publish last: record() only writes once m_records is set.
+  m_records = reinterpret_cast<Record*>(static_cast<char*>(m_mapping) +
+                                        sizeof(FileHeader));
+  DEBUG_LOG("[FrameRecorder::open] Recording up to " << capacity
+                                                     << " frames to " << path);
+  return true;
+}
+
+void FrameRecorder::close() {
+  if (!is_open()) {
+    return;
+  }
+
+  m_header->count = get_count();
+  m_header->dropped = get_dropped();
+
+  msync(m_mapping, m_mapping_size, MS_SYNC);
+  munmap(m_mapping, m_mapping_size);
+  ::close(m_fd);
+
+  m_fd = -1;
+  m_mapping = nullptr;
+  m_mapping_size = 0;
+  m_header = nullptr;
+  m_records = nullptr;
+}
+
+void FrameRecorder::record(const Message& message, Direction direction) {
+  if (!m_records) {
+    return;
+  }
+
+  const size_t slot = m_next.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= m_capacity) {
+    return;
+  }
+
+  Record& record = m_records[slot];
+  record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - m_start)
+                            .count();
+  record.cob_id = message.cob_id;
+  record.bus_id = m_bus_id;
+  record.len = std::min<uint8_t>(message.len, 8);
+  std::memcpy(record.data, message.data, sizeof(record.data));
+
+  // Flags are written last and mark the record as complete.
+  uint8_t flags = static_cast<uint8_t>(direction);
+  if (message.rtr) {
+    flags |= flag_rtr;
+  }
+  __atomic_store_n(&record.flags, flags, __ATOMIC_RELEASE);
+}
+
+size_t FrameRecorder::get_count() const {
+  return std::min(m_next.load(std::memory_order_relaxed), m_capacity);
+}
+
+size_t FrameRecorder::get_dropped() const {
+  const size_t next = m_next.load(std::memory_order_relaxed);
+  return next > m_capacity ? next - m_capacity : 0;
+}
+
+}  // end namespace kaco
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/frame_replayer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/logger.h"
+
+namespace kaco {
+
+FrameReplayer::~FrameReplayer() { close(); }
+
+bool FrameReplayer::open(const std::string& path) {
+  close();
+
+  m_fd = ::open(path.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    ERROR("[FrameReplayer::open] Cannot open " << path << ": "
+                                               << std::strerror(errno));
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(m_fd, &status) != 0 ||
+      static_cast<size_t>(status.st_size) <
+          sizeof(FrameRecorder::FileHeader)) {
+    ERROR("[FrameReplayer::open] " << path << " is not a frame log.");
+    close();
+    return false;
+  }
+
+  m_mapping_size = status.st_size;
+  void* mapping = mmap(nullptr, m_mapping_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED) {
+    ERROR("[FrameReplayer::open] Cannot map " << path << ": "
+                                              << std::strerror(errno));
+    m_mapping_size = 0;
+    close();
+    return false;
+  }
+  m_mapping = mapping;
+
+  m_header = static_cast<const FrameRecorder::FileHeader*>(m_mapping);
+  if (m_header->magic != FrameRecorder::magic ||
+      m_header->header_size != sizeof(FrameRecorder::FileHeader) ||
+      m_header->record_size != sizeof(FrameRecorder::Record)) {
+    ERROR("[FrameReplayer::open] " << path
+                                   << " is not a frame log of this version.");
+    close();
+    return false;
+  }
+
+  m_records = reinterpret_cast<const FrameRecorder::Record*>(
+      static_cast<const char*>(m_mapping) + sizeof(FrameRecorder::FileHeader));
+  const size_t available = std::min<size_t>(
+      m_header->capacity,
+      (m_mapping_size - sizeof(FrameRecorder::FileHeader)) /
+          sizeof(FrameRecorder::Record));
+
+  if (m_header->count != 0) {
+    m_size = std::min<size_t>(m_header->count, available);
+  } else {
+    // The recorder has not been closed properly. Use all complete records.
+    m_size = 0;
+    while (m_size < available && m_records[m_size].flags != 0) {
+      ++m_size;
+    }
+  }
+
+  DEBUG_LOG("[FrameReplayer::open] " << path << " contains " << m_size
+                                     << " frames.");
+  return true;
+}
+
+void FrameReplayer::close() {
+  if (m_mapping) {
+    munmap(const_cast<void*>(m_mapping), m_mapping_size);
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+
+  m_fd = -1;
+  m_mapping = nullptr;
+  m_mapping_size = 0;
+  m_header = nullptr;
+  m_records = nullptr;
+  m_size = 0;
+}
+
+Message FrameReplayer::to_message(const FrameRecorder::Record& record) {
+  Message message;
+  message.cob_id = record.cob_id;
+  message.rtr = (record.flags & FrameRecorder::flag_rtr) ? 1 : 0;
+  message.len = record.len;
+  std::memcpy(message.data, record.data, sizeof(message.data));
+  return message;
+}
+
+FrameReplayer::Result FrameReplayer::replay(Core& core, double speed,
+                                            int bus_id) {
+  using Clock = std::chrono::steady_clock;
+
+  Result result{0, Clock::duration::zero(), Clock::duration::zero()};
+  m_stop = false;
+
+  const Clock::time_point start = Clock::now();
+  // Time of the first replayed frame, so that replay starts immediately.
+  uint64_t first_ns = 0;
+  bool first = true;
+
+  for (size_t i = 0; i < m_size && !m_stop.load(std::memory_order_relaxed);
+       ++i) {
+    const FrameRecorder::Record& record = m_records[i];
+    if (!(record.flags & FrameRecorder::flag_received) ||
+        (bus_id >= 0 && record.bus_id != bus_id)) {
+      continue;
+    }
+
+    if (first) {
+      first_ns = record.timestamp_ns;
+      first = false;
+    }
+
+    if (speed > 0 && record.timestamp_ns > first_ns) {
+      const Clock::time_point due =
+          start + std::chrono::duration_cast<Clock::duration>(
+                      std::chrono::duration<double, std::nano>(
+                          (record.timestamp_ns - first_ns) / speed));
+      const Clock::time_point now = Clock::now();
+      if (now < due) {
+        std::this_thread::sleep_until(due);
+      } else {
+        result.max_lag = std::max(result.max_lag, now - due);
+      }
+    }
+
+    core.dispatch(to_message(record));
+    ++result.frames;
+  }
+
+  result.elapsed = Clock::now() - start;
+  return result;
+}
+
+void FrameReplayer::stop() { m_stop = true; }
+
+}  // end namespace kaco
@@ -41,6 +41,10 @@ size_t Config::consecutive_send_pause_ms = 2;
 
 size_t Config::repeats_on_sdo_timeout = 0;
 
+size_t Config::sdo_server_max_transfer_size = 65536;
+
+size_t Config::sdo_server_transfer_timeout_ms = 2000;
+
 bool Config::eds_reader_mark_entries_as_generic = false;
 
 bool Config::eds_reader_just_add_mappings = false;
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/logger.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace kaco {
+
+namespace {
+
+int64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Bounded multi-producer single-consumer queue after Dmitry Vyukov's
+// bounded MPMC queue.
+class LogQueue {
+ public:
+  static const size_t capacity = 4096;
+
+  LogQueue() {
+    for (size_t i = 0; i < capacity; ++i) {
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(Logger::Level level, std::string&& text) {
+    size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &m_cells[position % capacity];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t difference =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (m_enqueue_position.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;  // full
+      } else {
+        position = m_enqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+    cell->level = level;
+    cell->text = std::move(text);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Single consumer only.
+  bool pop(Logger::Level& level, std::string& text) {
+    Cell& cell = m_cells[m_dequeue_position % capacity];
+    if (cell.sequence.load(std::memory_order_acquire) !=
+        m_dequeue_position + 1) {
+      return false;  // empty
+    }
+    level = cell.level;
+    text.swap(cell.text);
+    cell.sequence.store(m_dequeue_position + capacity,
+                        std::memory_order_release);
+    ++m_dequeue_position;
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    Logger::Level level;
+    std::string text;
+  };
+
+  std::array<Cell, capacity> m_cells;
+  std::atomic<size_t> m_enqueue_position{0};
+  size_t m_dequeue_position = 0;
+};
+
+class LogWriter {
+ public:
+  LogWriter() : m_thread(&LogWriter::run, this) {}
+
+  void log(Logger::Level level, std::string&& text) {
+    if (!m_asynchronous.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(m_write_mutex);
+      write(level, text);
+      flush_streams();
+      return;
+    }
+    // Never block the caller (e.g. the receive thread) if the writer can't
+    // keep up. The writer reports the number of dropped messages.
+    if (!m_queue.push(level, std::move(text))) {
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      m_pushed.fetch_add(1, std::memory_order_release);
+    }
+    wake();
+  }
+
+  void flush() {
+    const uint64_t target = m_pushed.load(std::memory_order_acquire);
+    wake();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_flushed_condition.wait(lock, [&] {
+      return m_handled >= target || !m_asynchronous.load();
+    });
+  }
+
+  void set_asynchronous(bool asynchronous) {
+    if (!asynchronous) {
+      flush();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The writer thread is gone after shutdown().
+    m_asynchronous = asynchronous && m_running;
+  }
+
+  // Called at exit: drains the queue and stops the thread. Messages logged
+  // afterwards (e.g. from static destructors) are written synchronously.
+  void shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_asynchronous = false;
+      m_running = false;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+  }
+
+ private:
+  void run() {
+    Logger::Level level;
+    std::string text;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+      lock.unlock();
+      // Cleared before draining: messages pushed from now on set it again,
+      // so the wait below can't miss them.
+      m_wakeup_pending.exchange(false, std::memory_order_acq_rel);
+      uint64_t handled = 0;
+      {
+        std::lock_guard<std::mutex> write_lock(m_write_mutex);
+        while (m_queue.pop(level, text)) {
+          write(level, text);
+          ++handled;
+        }
+        const uint64_t dropped = m_dropped.exchange(0);
+        if (dropped > 0) {
+          write(Logger::Level::warning,
+                "WARNING: [Logger] " + std::to_string(dropped) +
+                    " messages dropped because the queue was full.");
+        }
+        if (handled > 0 || dropped > 0) {
+          flush_streams();
+        }
+      }
+      lock.lock();
+
+      m_handled += handled;
+      m_flushed_condition.notify_all();
+      if (!m_running && handled == 0) {
+        break;
+      }
+      if (handled == 0) {
+        m_condition.wait(lock, [this] {
+          return m_wakeup_pending.load(std::memory_order_acquire) ||
+                 !m_running;
+        });
+      }
+    }
+  }
+
+  // Wakes up the writer. Only the first call after the writer went idle
+  // takes the mutex.
+  void wake() {
+    if (!m_wakeup_pending.exchange(true, std::memory_order_acq_rel)) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_condition.notify_one();
+    }
+  }
+
+  static void write(Logger::Level level, const std::string& text) {
+    FILE* stream = (level == Logger::Level::error) ? stderr : stdout;
+    std::fwrite(text.data(), 1, text.size(), stream);
+    std::fputc('\n', stream);
+  }
+
+  static void flush_streams() {
+    std::fflush(stdout);
+    std::fflush(stderr);
+  }
+
+  LogQueue m_queue;
+  std::atomic<bool> m_asynchronous{true};
+  std::atomic<uint64_t> m_pushed{0};
+  std::atomic<uint64_t> m_dropped{0};
+  std::atomic<bool> m_wakeup_pending{false};
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::condition_variable m_flushed_condition;
+  uint64_t m_handled = 0;
+  bool m_running = true;
+
+  // Serializes writes of the writer thread and synchronous callers.
+  std::mutex m_write_mutex;
+
+  std::thread m_thread;
+};
+
+void shutdown_writer();
+
+LogWriter& get_writer() {
+  // Never destroyed, so logging from static destructors keeps working.
+  static LogWriter* writer = [] {
+    LogWriter* writer = new LogWriter();
+    std::atexit(shutdown_writer);
+    return writer;
+  }();
+  return *writer;
+}
+
+void shutdown_writer() { get_writer().shutdown(); }
+
+}  // namespace
+
+bool Logger::RateLimit::allow() {
+  const int64_t now = now_ms();
+  int64_t window_start = m_window_start_ms.load(std::memory_order_relaxed);
+  if (now - window_start >= 1000 &&
+      m_window_start_ms.compare_exchange_strong(window_start, now)) {
+    m_count.store(0, std::memory_order_relaxed);
+  }
+  if (m_count.fetch_add(1, std::memory_order_relaxed) < max_per_second) {
+    return true;
+  }
+  m_suppressed.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+void Logger::log(Level level, std::string text) {
+  get_writer().log(level, std::move(text));
+}
+
+void Logger::log(Level level, RateLimit& rate_limit, std::string text) {
+  const uint64_t suppressed = rate_limit.take_suppressed();
+  if (suppressed > 0) {
+    text += " [" + std::to_string(suppressed) + " similar messages suppressed]";
+  }
+  get_writer().log(level, std::move(text));
+}
+
+void Logger::flush() { get_writer().flush(); }
+
+void Logger::set_asynchronous(bool asynchronous) {
+  get_writer().set_asynchronous(asynchronous);
+}
+
+}  // end namespace kaco
@@ -33,6 +33,7 @@
 #include "kacanopen/core/core.h"
 #include "kacanopen/core/global_config.h"
 #include "kacanopen/core/logger.h"
+#include "kacanopen/core/probes.h"
 
 #include <chrono>
 #include <cstdint>
@@ -95,8 +96,22 @@ void NMT::process_incoming_message(const Message& message) {
   uint8_t state = data & 0x7F;
 
   if (message.rtr) {
-    DEBUG_LOG("NMT: Ignoring remote transmission request.");
-    DEBUG_DUMP(message.cob_id);
+    std::lock_guard<std::mutex> scoped_lock(local_nodes_mutex_);
+    const auto it = local_nodes_.find(message.get_node_id());
+    if (it != local_nodes_.end() && it->second.on_guard_request) {
+      DEBUG_LOG("NMT: Node guarding request for local node.");
+      it->second.on_guard_request();
+    } else {
+      DEBUG_LOG("NMT: Ignoring remote transmission request.");
+      DEBUG_DUMP(message.cob_id);
+    }
+    return;
+  }
+
+  KACO_PROBE2(nmt_state, message.get_node_id(), state);
+
+  if (!node_management_) {
+    DEBUG_LOG("NMT: Node management disabled. Ignoring state.");
     return;
   }
 
@@ -111,6 +126,7 @@ void NMT::process_incoming_message(const Message& message) {
       break;
     }
     case 5: {
+      std::lock_guard<std::mutex> scoped_lock(alive_devices_mutex_);
       // If the device is in our map, we set it to true
       if (alive_devices_.find(message.get_node_id()) != alive_devices_.end()) {
         alive_devices_[message.get_node_id()] = DeviceState::ALIVE;
@@ -150,8 +166,11 @@ void NMT::process_incoming_message(const Message& message) {
           m_callback_futures.push_front(
               std::async(std::launch::async, callback, message.get_node_id()));
         }
+      }
+      {
         // Register into our alive device vector
-        alive_devices_.insert({message.get_node_id(), DeviceState::ALIVE});
+        std::lock_guard<std::mutex> scoped_lock(alive_devices_mutex_);
+        alive_devices_[message.get_node_id()] = DeviceState::ALIVE;
       }
       break;
     }
@@ -221,9 +240,12 @@ void NMT::change_alive_check_interval(size_t interval)
 void NMT::check_alive_devices() {
   while (thread_alive_) {
     // Set all devices to be killed
-    for (auto& device : alive_devices_) {
-      if (device.second == DeviceState::ALIVE) {
-        device.second = DeviceState::TO_BE_KILLED;
+    {
+      std::lock_guard<std::mutex> scoped_lock(alive_devices_mutex_);
+      for (auto& device : alive_devices_) {
+        if (device.second == DeviceState::ALIVE) {
+          device.second = DeviceState::TO_BE_KILLED;
+        }
       }
     }
 
@@ -231,6 +253,7 @@ void NMT::check_alive_devices() {
     std::this_thread::sleep_for(std::chrono::milliseconds(alive_check_interval_));
 
     // Check if they are alive
+    std::lock_guard<std::mutex> alive_lock(alive_devices_mutex_);
     DEBUG_LOG("Size of alive_devices_: " << alive_devices_.size());
     for (auto& device : alive_devices_) {
       if (device.second == DeviceState::TO_BE_KILLED) {
@@ -252,6 +275,42 @@ void NMT::check_alive_devices() {
   }
 }
 
+void NMT::process_incoming_command(const Message& message) {
+  if (message.len < 2) {
+    DEBUG_LOG("NMT: Ignoring malformed module control message.");
+    return;
+  }
+
+  const Command command = static_cast<Command>(message.data[0]);
+  const uint8_t node_id = message.data[1];
+
+  DEBUG_LOG("NMT: Command 0x" << std::hex << (unsigned)message.data[0]
+                              << " for node " << std::dec << (unsigned)node_id
+                              << ".");
+
+  std::lock_guard<std::mutex> scoped_lock(local_nodes_mutex_);
+  for (const auto& local_node : local_nodes_) {
+    if ((node_id == 0 || node_id == local_node.first) &&
+        local_node.second.on_command) {
+      local_node.second.on_command(command);
+    }
+  }
+}
+
+void NMT::register_local_node(uint8_t node_id,
+                              const CommandCallback& on_command,
+                              const GuardRequestCallback& on_guard_request) {
+  std::lock_guard<std::mutex> scoped_lock(local_nodes_mutex_);
+  local_nodes_[node_id] = {on_command, on_guard_request};
+}
+
+void NMT::remove_local_node(uint8_t node_id) {
+  std::lock_guard<std::mutex> scoped_lock(local_nodes_mutex_);
+  local_nodes_.erase(node_id);
+}
+
+void NMT::set_node_management(bool enabled) { node_management_ = enabled; }
+
 void NMT::register_device_dead_callback(const DeviceAliveCallback& callback) {
   std::lock_guard<std::mutex> scoped_lock(m_device_alive_callbacks_mutex);
   m_device_dead_callbacks.push_back(callback);
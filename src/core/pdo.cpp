@@ -33,6 +33,7 @@
 #include "kacanopen/core/core.h"
 #include "kacanopen/core/logger.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
@@ -95,20 +96,57 @@ void PDO::send(uint16_t cob_id, const std::vector<uint8_t>& data) {
   m_core.send(message);
 }
 
-void PDO::add_pdo_received_callback(uint16_t cob_id,
-                                    PDOReceivedCallback::Callback callback) {
+uint32_t PDO::add_pdo_received_callback(
+    uint16_t cob_id, PDOReceivedCallback::Callback callback) {
   std::lock_guard<std::mutex> scoped_lock(m_receive_callbacks_mutex);
-  m_receive_callbacks.push_back({cob_id, callback});
+  const uint32_t id = m_next_callback_id++;
+  m_receive_callbacks.push_back({cob_id, callback, id});
+  return id;
 }
 
-void PDO::remove_pdo_received_callback(uint16_t cob_id) {
+void PDO::remove_pdo_received_callback(uint32_t id) {
   std::lock_guard<std::mutex> scoped_lock(m_receive_callbacks_mutex);
   for (auto i = m_receive_callbacks.begin(); i != m_receive_callbacks.end();
        i++)
-    if ((*i).cob_id == cob_id) {
+    if ((*i).id == id) {
       m_receive_callbacks.erase(i);
       break;
     }
 }
 
+void PDO::process_incoming_rpdo(const Message& message) const {
+  const uint16_t cob_id = message.cob_id;
+
+  DEBUG_LOG("Received receive PDO with cob_id 0x"
+            << std::hex << cob_id << " length = " << message.len);
+
+  const std::vector<uint8_t> data(message.data, message.data + message.len);
+
+  std::lock_guard<std::mutex> scoped_lock(m_rpdo_receive_callbacks_mutex);
+  for (const PDOReceivedCallback& callback : m_rpdo_receive_callbacks) {
+    if (callback.cob_id == cob_id) {
+      // Synchronous like process_incoming_message(): local slave nodes must
+      // see RPDOs in the order they arrived.
+      callback.callback(data);
+    }
+  }
+}
+
+void PDO::add_rpdo_received_callback(uint16_t cob_id,
+                                     PDOReceivedCallback::Callback callback) {
+  std::lock_guard<std::mutex> scoped_lock(m_rpdo_receive_callbacks_mutex);
+  m_rpdo_receive_callbacks.push_back({cob_id, callback});
+}
+
+void PDO::remove_rpdo_received_callbacks(uint16_t cob_id) {
+  std::lock_guard<std::mutex> scoped_lock(m_rpdo_receive_callbacks_mutex);
+  m_rpdo_receive_callbacks.erase(
+      std::remove_if(m_rpdo_receive_callbacks.begin(),
+                     m_rpdo_receive_callbacks.end(),
+                     [cob_id](const PDOReceivedCallback& callback) {
+                       return callback.cob_id == cob_id;
+                     }),
+      m_rpdo_receive_callbacks.end());
+}
+
 }  // end namespace kaco
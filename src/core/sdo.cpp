@@ -33,7 +33,9 @@
 #include "kacanopen/core/core.h"
 #include "kacanopen/core/global_config.h"
 #include "kacanopen/core/logger.h"
+#include "kacanopen/core/probes.h"
 #include "kacanopen/core/sdo_error.h"
+#include "kacanopen/core/tracer.h"
 
 #include <cassert>
 #include <chrono>
@@ -50,6 +52,7 @@ void SDO::download(uint8_t node_id, uint16_t index, uint8_t subindex,
                    uint32_t size, const std::vector<uint8_t>& data) {
   assert(size > 0);
   assert(data.size() >= size);
+  TraceSpan span("sdo", "sdo download", node_id, index, subindex);
 
   if (size <= 4) {
     // expedited transfer
@@ -75,6 +78,7 @@ void SDO::download(uint8_t node_id, uint16_t index, uint8_t subindex,
 
 std::vector<uint8_t> SDO::upload(uint8_t node_id, uint16_t index,
                                  uint8_t subindex) {
+  TraceSpan span("sdo", "sdo upload", node_id, index, subindex);
   std::vector<uint8_t> result;
 
   uint8_t command = Flag::initiate_upload_request;
@@ -171,6 +175,31 @@ void SDO::process_incoming_message(const Message& message) {
   // TODO: Also call custom callbacks, not only internal ones.
 }
 
+void SDO::process_incoming_client_sdo(const Message& message) {
+  const uint8_t node_id = message.get_node_id();
+
+  DEBUG_LOG("Received SDO (receive/client) for node "
+            << (unsigned)node_id << ". thread=" << std::this_thread::get_id());
+
+  std::lock_guard<std::mutex> scoped_lock(m_request_receiver_mutexes[node_id]);
+  if (m_request_receivers[node_id]) {
+    m_request_receivers[node_id](message);
+  } else {
+    DEBUG_LOG("Client SDO is not addressed to a local node.");
+  }
+}
+
+void SDO::register_request_callback(uint8_t node_id,
+                                    const SDORequestCallback& callback) {
+  std::lock_guard<std::mutex> scoped_lock(m_request_receiver_mutexes[node_id]);
+  m_request_receivers[node_id] = callback;
+}
+
+void SDO::remove_request_callback(uint8_t node_id) {
+  std::lock_guard<std::mutex> scoped_lock(m_request_receiver_mutexes[node_id]);
+  m_request_receivers[node_id] = nullptr;
+}
+
 SDOResponse SDO::send_sdo_and_wait(uint8_t command, uint8_t node_id,
                                    uint16_t index, uint8_t subindex,
                                    const std::array<uint8_t, 4>& data) {
@@ -183,7 +212,12 @@ SDOResponse SDO::send_sdo_and_wait(uint8_t command, uint8_t node_id,
   // mixed up and m_send_and_wait_receivers[node_id] manipulation is safe. SDO
   // callbacks are specific to their node id. assert:
   // m_send_and_wait_mutex.size() == 256 > std::numeric_limits<uint8_t>::max()
-  std::lock_guard<std::mutex> scoped_lock(m_send_and_wait_mutex[node_id]);
+  std::unique_lock<std::mutex> scoped_lock(m_send_and_wait_mutex[node_id],
+                                          std::defer_lock);
+  {
+    TraceSpan span("sdo", "sdo lock wait", node_id, index, subindex);
+    scoped_lock.lock();
+  }
 
   std::promise<SDOResponse> received_promise;
   std::future<SDOResponse> received_future = received_promise.get_future();
@@ -213,6 +247,10 @@ SDOResponse SDO::send_sdo_and_wait(uint8_t command, uint8_t node_id,
   message.data[5] = data[1];
   message.data[6] = data[2];
   message.data[7] = data[3];
+
+  // from request sent until response received
+  TraceSpan span("sdo", "sdo request", node_id, index, subindex);
+  KACO_PROBE4(sdo_start, node_id, index, subindex, command);
   m_core.send(message);
 
   DEBUG_LOG_EXHAUSTIVE("SDO::send_sdo_and_wait: thread="
@@ -232,6 +270,8 @@ SDOResponse SDO::send_sdo_and_wait(uint8_t command, uint8_t node_id,
   }
 
   if (status == std::future_status::timeout) {
+    span.rename("sdo timeout");
+    KACO_PROBE3(sdo_timeout, node_id, index, subindex);
     DEBUG_LOG_EXHAUSTIVE("SDO::send_sdo_and_wait: thread="
                          << std::this_thread::get_id() << " node_id=" << node_id
                          << " command=" << command << " index=" << index
@@ -245,7 +285,9 @@ SDOResponse SDO::send_sdo_and_wait(uint8_t command, uint8_t node_id,
                        << " command=" << command << " index=" << index
                        << " subindex=" << subindex << " DONE.");
 
-  return received_future.get();
+  const SDOResponse response = received_future.get();
+  KACO_PROBE4(sdo_complete, node_id, index, subindex, response.command);
+  return response;
 }
 
 void SDO::received_unassigned_sdo(SDOResponse response) {
@@ -0,0 +1,591 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/sdo_server.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/global_config.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/core/sdo_error.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace kaco {
+
+SDOServer::SDOServer(Core& core, uint8_t node_id, UploadHandler upload_handler,
+                     DownloadHandler download_handler)
+    : m_core(core),
+      m_node_id(node_id),
+      m_upload_handler(upload_handler),
+      m_download_handler(download_handler) {
+  assert(node_id > 0 && node_id < 128);
+  m_core.sdo.register_request_callback(
+      m_node_id,
+      std::bind(&SDOServer::process_request, this, std::placeholders::_1));
+}
+
+SDOServer::~SDOServer() { m_core.sdo.remove_request_callback(m_node_id); }
+
+uint8_t SDOServer::get_node_id() const { return m_node_id; }
+
+void SDOServer::process_request(const Message& message) {
+  std::lock_guard<std::mutex> scoped_lock(m_mutex);
+
+  if (message.rtr || message.len < 8) {
+    DEBUG_LOG("Ignoring malformed client SDO.");
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (m_state != State::idle &&
+      now - m_last_request >
+          std::chrono::milliseconds(Config::sdo_server_transfer_timeout_ms)) {
+    DEBUG_LOG("Dropping stale transfer of 0x" << std::hex << m_index << "sub"
+                                              << (unsigned)m_subindex);
+    reset();
+  }
+  m_last_request = now;
+
+  // Block download segments have no command specifier, so any byte may be a
+  // segment, including repeated or out-of-sequence ones which look like a
+  // new request. Sequence numbers start at 1, so 0x80 is always a client
+  // abort. Everything else is a segment until the transfer is aborted or
+  // has timed out.
+  if (m_state == State::download_block) {
+    if (message.data[0] == 0x80) {
+      DEBUG_LOG("Client aborted the transfer.");
+      reset();
+      return;
+    }
+    block_download_segment(message);
+    return;
+  }
+
+  const uint8_t ccs = message.data[0] >> 5;
+
+  switch (ccs) {
+    case 0: {
+      download_segment(message);
+      break;
+    }
+    case 1: {
+      initiate_download(message);
+      break;
+    }
+    case 2: {
+      initiate_upload(message);
+      break;
+    }
+    case 3: {
+      upload_segment(message);
+      break;
+    }
+    case 4: {
+      DEBUG_LOG("Client aborted the transfer.");
+      reset();
+      break;
+    }
+    case 5: {
+      block_upload(message);
+      break;
+    }
+    case 6: {
+      block_download(message);
+      break;
+    }
+    default: {
+      abort(m_index, m_subindex,
+            static_cast<uint32_t>(sdo_error::type::command_specifier));
+      break;
+    }
+  }
+}
+
+void SDOServer::initiate_download(const Message& message) {
+  reset();
+  m_index = message.data[1] | (message.data[2] << 8);
+  m_subindex = message.data[3];
+
+  const uint8_t command = message.data[0];
+  const bool expedited = command & 0x02;
+  const bool size_indicated = command & 0x01;
+
+  DEBUG_LOG("Initiate download of 0x" << std::hex << m_index << "sub"
+                                      << (unsigned)m_subindex);
+
+  if (expedited) {
+    const uint8_t size = size_indicated ? 4 - ((command >> 2) & 0x03) : 4;
+    const std::vector<uint8_t> data(message.data + 4, message.data + 4 + size);
+    try {
+      m_download_handler(m_index, m_subindex, data);
+    } catch (const sdo_error& error) {
+      abort(m_index, m_subindex, static_cast<uint32_t>(error.get_type()));
+      return;
+    }
+    send({0x60, message.data[1], message.data[2], m_subindex, 0, 0, 0, 0});
+    return;
+  }
+
+  m_size_indicated = size_indicated;
+  if (m_size_indicated) {
+    m_expected_size = message.data[4] | (message.data[5] << 8) |
+                      (message.data[6] << 16) | (message.data[7] << 24);
+    if (m_expected_size > Config::sdo_server_max_transfer_size) {
+      abort(m_index, m_subindex,
+            static_cast<uint32_t>(sdo_error::type::memory));
+      return;
+    }
+  }
+
+  m_state = State::download_segmented;
+  send({0x60, message.data[1], message.data[2], m_subindex, 0, 0, 0, 0});
+}
+
+void SDOServer::download_segment(const Message& message) {
+  if (m_state != State::download_segmented) {
+    abort(m_index, m_subindex,
+          static_cast<uint32_t>(sdo_error::type::command_specifier));
+    return;
+  }
+
+  const uint8_t command = message.data[0];
+  const bool toggle = command & 0x10;
+  const uint8_t size = 7 - ((command >> 1) & 0x07);
+  const bool last = command & 0x01;
+
+  if (toggle != m_toggle) {
+    abort(m_index, m_subindex,
+          static_cast<uint32_t>(sdo_error::type::toggle_bit));
+    return;
+  }
+
+  if (m_buffer.size() + size > Config::sdo_server_max_transfer_size) {
+    abort(m_index, m_subindex, static_cast<uint32_t>(sdo_error::type::memory));
+    return;
+  }
+
+  m_buffer.insert(m_buffer.end(), message.data + 1, message.data + 1 + size);
+
+  if (last) {
+    if (m_size_indicated && m_buffer.size() != m_expected_size) {
+      abort(m_index, m_subindex,
+            static_cast<uint32_t>(
+                m_buffer.size() > m_expected_size
+                    ? sdo_error::type::service_parameter_too_high
+                    : sdo_error::type::service_parameter_too_low));
+      return;
+    }
+    try {
+      m_download_handler(m_index, m_subindex, m_buffer);
+    } catch (const sdo_error& error) {
+      abort(m_index, m_subindex, static_cast<uint32_t>(error.get_type()));
+      return;
+    }
+  }
+
+  send({static_cast<uint8_t>(0x20 | (toggle ? 0x10 : 0x00)), 0, 0, 0, 0, 0, 0,
+        0});
+  m_toggle = !m_toggle;
+
+  if (last) {
+    reset();
+  }
+}
+
+void SDOServer::initiate_upload(const Message& message) {
+  reset();
+  m_index = message.data[1] | (message.data[2] << 8);
+  m_subindex = message.data[3];
+
+  DEBUG_LOG("Initiate upload of 0x" << std::hex << m_index << "sub"
+                                    << (unsigned)m_subindex);
+
+  try {
+    m_buffer = m_upload_handler(m_index, m_subindex);
+  } catch (const sdo_error& error) {
+    abort(m_index, m_subindex, static_cast<uint32_t>(error.get_type()));
+    return;
+  }
+
+  const size_t size = m_buffer.size();
+
+  if (size > 0 && size <= 4) {
+    // expedited transfer
+    std::vector<uint8_t> response = {
+        static_cast<uint8_t>(0x43 | ((4 - size) << 2)), message.data[1],
+        message.data[2], m_subindex, 0, 0, 0, 0};
+    std::copy(m_buffer.begin(), m_buffer.end(), response.begin() + 4);
+    send(response);
+    reset();
+    return;
+  }
+
+  // segmented transfer
+  m_state = State::upload_segmented;
+  send({0x41, message.data[1], message.data[2], m_subindex,
+        static_cast<uint8_t>(size & 0xFF),
+        static_cast<uint8_t>((size >> 8) & 0xFF),
+        static_cast<uint8_t>((size >> 16) & 0xFF),
+        static_cast<uint8_t>((size >> 24) & 0xFF)});
+}
+
+void SDOServer::upload_segment(const Message& message) {
+  if (m_state != State::upload_segmented) {
+    abort(m_index, m_subindex,
+          static_cast<uint32_t>(sdo_error::type::command_specifier));
+    return;
+  }
+
+  const bool toggle = message.data[0] & 0x10;
+
+  if (toggle != m_toggle) {
+    abort(m_index, m_subindex,
+          static_cast<uint32_t>(sdo_error::type::toggle_bit));
+    return;
+  }
+
+  const size_t size = std::min<size_t>(7, m_buffer.size() - m_position);
+  const bool last = (m_position + size == m_buffer.size());
+
+  std::vector<uint8_t> response(8, 0);
+  response[0] = (toggle ? 0x10 : 0x00) | ((7 - size) << 1) | (last ? 0x01 : 0x00);
+  std::copy(m_buffer.begin() + m_position, m_buffer.begin() + m_position + size,
+            response.begin() + 1);
+  send(response);
+
+  m_position += size;
+  m_toggle = !m_toggle;
+
+  if (last) {
+    reset();
+  }
+}
+
+void SDOServer::block_download(const Message& message) {
+  const uint8_t command = message.data[0];
+
+  if ((command & 0x01) == 0) {
+    // initiate
+    reset();
+    m_index = message.data[1] | (message.data[2] << 8);
+    m_subindex = message.data[3];
+    m_crc_supported = command & 0x04;
+    m_size_indicated = command & 0x02;
+
+    DEBUG_LOG("Initiate block download of 0x" << std::hex << m_index << "sub"
+                                              << (unsigned)m_subindex);
+
+    if (m_size_indicated) {
+      m_expected_size = message.data[4] | (message.data[5] << 8) |
+                        (message.data[6] << 16) | (message.data[7] << 24);
+      if (m_expected_size > Config::sdo_server_max_transfer_size) {
+        abort(m_index, m_subindex,
+              static_cast<uint32_t>(sdo_error::type::memory));
+        return;
+      }
+    }
+
+    m_block_size = max_block_size;
+    m_state = State::download_block;
+    send({0xA4, message.data[1], message.data[2], m_subindex, m_block_size, 0,
+          0, 0});
+    return;
+  }
+
+  // end
+  if (m_state != State::download_block_end) {
+    abort(m_index, m_subindex,
+          static_cast<uint32_t>(sdo_error::type::command_specifier));
+    return;
+  }
+
+  const uint8_t unused = (command >> 2) & 0x07;
+  if (unused > m_buffer.size()) {
+    abort(m_index, m_subindex,
+          static_cast<uint32_t>(sdo_error::type::service_parameter));
+    return;
+  }
+  m_buffer.resize(m_buffer.size() - unused);
+
+  if (m_size_indicated && m_buffer.size() != m_expected_size) {
+    abort(m_index, m_subindex,
+          static_cast<uint32_t>(
+              m_buffer.size() > m_expected_size
+                  ? sdo_error::type::service_parameter_too_high
+                  : sdo_error::type::service_parameter_too_low));
+    return;
+  }
+
+  if (m_crc_supported) {
+    const uint16_t crc = message.data[1] | (message.data[2] << 8);
+    if (crc != crc16(m_buffer, m_buffer.size())) {
+      abort(m_index, m_subindex, static_cast<uint32_t>(sdo_error::type::crc));
+      return;
+    }
+  }
+
+  try {
+    m_download_handler(m_index, m_subindex, m_buffer);
+  } catch (const sdo_error& error) {
+    abort(m_index, m_subindex, static_cast<uint32_t>(error.get_type()));
+    return;
+  }
+
+  send({0xA1, 0, 0, 0, 0, 0, 0, 0});
+  reset();
+}
+
+void SDOServer::block_download_segment(const Message& message) {
+  const uint8_t sequence_number = message.data[0] & 0x7F;
+  const bool last = message.data[0] & 0x80;
+
+  if (sequence_number == m_sequence_number + 1 && !m_last_segment_received) {
+    if (m_buffer.size() >= Config::sdo_server_max_transfer_size) {
+      abort(m_index, m_subindex,
+            static_cast<uint32_t>(sdo_error::type::memory));
+      return;
+    }
+    m_buffer.insert(m_buffer.end(), message.data + 1, message.data + 8);
+    m_sequence_number = sequence_number;
+    m_last_segment_received = last;
+  } else {
+    DEBUG_LOG("Unexpected block segment " << (unsigned)sequence_number
+                                          << ". Waiting for end of block.");
+  }
+
+  // Acknowledge at the end of each block. On sequence errors, the client
+  // repeats all segments after the acknowledged one.
+  if (sequence_number >= m_block_size || last) {
+    send({0xA2, m_sequence_number, m_block_size, 0, 0, 0, 0, 0});
+    m_sequence_number = 0;
+    if (m_last_segment_received) {
+      m_state = State::download_block_end;
+    }
+  }
+}
+
+void SDOServer::block_upload(const Message& message) {
+  const uint8_t command = message.data[0];
+
+  switch (command & 0x03) {
+    case 0: {
+      // initiate
+      reset();
+      m_index = message.data[1] | (message.data[2] << 8);
+      m_subindex = message.data[3];
+      m_crc_supported = command & 0x04;
+      m_block_size = message.data[4];
+      const uint8_t protocol_switch_threshold = message.data[5];
+
+      DEBUG_LOG("Initiate block upload of 0x" << std::hex << m_index << "sub"
+                                              << (unsigned)m_subindex);
+
+      if (m_block_size == 0 || m_block_size > max_block_size) {
+        abort(m_index, m_subindex,
+              static_cast<uint32_t>(sdo_error::type::block_size));
+        return;
+      }
+
+      try {
+        m_buffer = m_upload_handler(m_index, m_subindex);
+      } catch (const sdo_error& error) {
+        abort(m_index, m_subindex, static_cast<uint32_t>(error.get_type()));
+        return;
+      }
+
+      if (m_buffer.size() <= protocol_switch_threshold) {
+        // Switch to the SDO upload protocol. The client interprets the
+        // initiate upload response accordingly.
+        Message request = message;
+        request.data[0] = 0x40;
+        m_buffer.clear();
+        initiate_upload(request);
+        return;
+      }
+
+      const size_t size = m_buffer.size();
+      m_state = State::upload_block_initiated;
+      send({0xC6, message.data[1], message.data[2], m_subindex,
+            static_cast<uint8_t>(size & 0xFF),
+            static_cast<uint8_t>((size >> 8) & 0xFF),
+            static_cast<uint8_t>((size >> 16) & 0xFF),
+            static_cast<uint8_t>((size >> 24) & 0xFF)});
+      break;
+    }
+
+    case 3: {
+      // start
+      if (m_state != State::upload_block_initiated) {
+        abort(m_index, m_subindex,
+              static_cast<uint32_t>(sdo_error::type::command_specifier));
+        return;
+      }
+      m_state = State::upload_block;
+      send_upload_block();
+      break;
+    }
+
+    case 2: {
+      // block acknowledge
+      if (m_state != State::upload_block) {
+        abort(m_index, m_subindex,
+              static_cast<uint32_t>(sdo_error::type::command_specifier));
+        return;
+      }
+
+      const uint8_t acknowledged = message.data[1];
+      const uint8_t block_size = message.data[2];
+
+      if (acknowledged > m_last_block_segments) {
+        abort(m_index, m_subindex,
+              static_cast<uint32_t>(sdo_error::type::sequence_number));
+        return;
+      }
+
+      if (block_size == 0 || block_size > max_block_size) {
+        abort(m_index, m_subindex,
+              static_cast<uint32_t>(sdo_error::type::block_size));
+        return;
+      }
+
+      m_position += acknowledged;
+      m_block_size = block_size;
+
+      const size_t segments = std::max<size_t>(1, (m_buffer.size() + 6) / 7);
+      if (m_position >= segments) {
+        const uint8_t unused = segments * 7 - m_buffer.size();
+        const uint16_t crc =
+            m_crc_supported ? crc16(m_buffer, m_buffer.size()) : 0;
+        m_state = State::upload_block_end;
+        send({static_cast<uint8_t>(0xC1 | (unused << 2)),
+              static_cast<uint8_t>(crc & 0xFF),
+              static_cast<uint8_t>((crc >> 8) & 0xFF), 0, 0, 0, 0, 0});
+      } else {
+        send_upload_block();
+      }
+      break;
+    }
+
+    case 1: {
+      // end
+      if (m_state != State::upload_block_end) {
+        abort(m_index, m_subindex,
+              static_cast<uint32_t>(sdo_error::type::command_specifier));
+        return;
+      }
+      reset();
+      break;
+    }
+  }
+}
+
+void SDOServer::send_upload_block() {
+  // m_position counts segments which have been acknowledged by the client.
+  const size_t segments = std::max<size_t>(1, (m_buffer.size() + 6) / 7);
+  m_last_block_segments =
+      static_cast<uint8_t>(std::min<size_t>(m_block_size, segments - m_position));
+
+  for (uint8_t sequence_number = 1; sequence_number <= m_last_block_segments;
+       ++sequence_number) {
+    const size_t segment = m_position + sequence_number - 1;
+    const size_t offset = segment * 7;
+    const size_t size = std::min<size_t>(7, m_buffer.size() - offset);
+    const bool last = (segment + 1 == segments);
+
+    std::vector<uint8_t> data(8, 0);
+    data[0] = sequence_number | (last ? 0x80 : 0x00);
+    std::copy(m_buffer.begin() + offset, m_buffer.begin() + offset + size,
+              data.begin() + 1);
+    send(data);
+  }
+}
+
+void SDOServer::send(const std::vector<uint8_t>& data) {
+  assert(data.size() == 8);
+  Message message;
+  message.cob_id = 0x580 + m_node_id;
+  message.rtr = false;
+  message.len = 8;
+  std::copy(data.begin(), data.end(), message.data);
+
+  DEBUG_LOG_EXHAUSTIVE("Sending the following SDO response:");
+  DEBUG_EXHAUSTIVE(message.print();)
+
+  m_core.send(message);
+}
+
+void SDOServer::abort(uint16_t index, uint8_t subindex, uint32_t code) {
+  // Custom KaCanOpen error types must not appear on the bus.
+  if (code >= static_cast<uint32_t>(sdo_error::type::response_timeout)) {
+    code = static_cast<uint32_t>(sdo_error::type::general);
+  }
+
+  DEBUG_LOG("Aborting SDO transfer of 0x" << std::hex << index << "sub"
+                                          << (unsigned)subindex << " with code 0x"
+                                          << code);
+
+  send({0x80, static_cast<uint8_t>(index & 0xFF),
+        static_cast<uint8_t>((index >> 8) & 0xFF), subindex,
+        static_cast<uint8_t>(code & 0xFF),
+        static_cast<uint8_t>((code >> 8) & 0xFF),
+        static_cast<uint8_t>((code >> 16) & 0xFF),
+        static_cast<uint8_t>((code >> 24) & 0xFF)});
+  reset();
+}
+
+void SDOServer::reset() {
+  m_state = State::idle;
+  m_buffer.clear();
+  m_expected_size = 0;
+  m_size_indicated = false;
+  m_position = 0;
+  m_toggle = false;
+  m_crc_supported = false;
+  m_block_size = max_block_size;
+  m_sequence_number = 0;
+  m_last_block_segments = 0;
+  m_last_segment_received = false;
+}
+
+uint16_t SDOServer::crc16(const std::vector<uint8_t>& data, size_t length) {
+  // CRC-16-CCITT, polynomial 0x1021, initial value 0 (CiA 301)
+  uint16_t crc = 0;
+  for (size_t i = 0; i < length; ++i) {
+    crc ^= static_cast<uint16_t>(data[i]) << 8;
+    for (unsigned bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+}  // end namespace kaco
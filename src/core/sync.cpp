@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/sync.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/logger.h"
+
+#include <cassert>
+
+namespace kaco {
+
+SYNC::SYNC(Core& core) : m_core(core) {}
+
+SYNC::~SYNC() { stop_producer(); }
+
+void SYNC::process_incoming_message(const Message& message) const {
+  const uint8_t counter = (message.len > 0) ? message.data[0] : 0;
+  DEBUG_LOG("Received SYNC with counter " << (unsigned)counter);
+  call_callbacks(counter);
+}
+
+void SYNC::send(uint8_t counter) const {
+  const Message message = {0x80,
+                           false,
+                           static_cast<uint8_t>((counter > 0) ? 1 : 0),
+                           {counter, 0, 0, 0, 0, 0, 0, 0}};
+  m_core.send(message);
+  call_callbacks(counter);
+}
+
+void SYNC::start_producer(std::chrono::microseconds period,
+                          uint8_t counter_overflow) {
+  assert(period.count() > 0);
+  stop_producer();
+  std::lock_guard<std::mutex> lock(m_producer_mutex);
+  m_producing = true;
+  m_producer_thread =
+      std::thread(&SYNC::produce, this, period, counter_overflow);
+}
+
+void SYNC::stop_producer() {
+  {
+    std::lock_guard<std::mutex> lock(m_producer_mutex);
+    if (!m_producing) {
+      return;
+    }
+    m_producing = false;
+  }
+  m_producer_condition.notify_all();
+  m_producer_thread.join();
+}
+
+bool SYNC::is_producing() const {
+  std::lock_guard<std::mutex> lock(m_producer_mutex);
+  return m_producing;
+}
+
+uint32_t SYNC::add_sync_received_callback(SyncReceivedCallback callback) {
+  std::lock_guard<std::mutex> lock(m_receive_callbacks_mutex);
+  const uint32_t id = m_next_callback_id++;
+  m_receive_callbacks.push_back({id, callback});
+  return id;
+}
+
+void SYNC::remove_sync_received_callback(uint32_t id) {
+  std::lock_guard<std::mutex> lock(m_receive_callbacks_mutex);
+  for (auto it = m_receive_callbacks.begin(); it != m_receive_callbacks.end();
+       ++it) {
+    if (it->id == id) {
+      m_receive_callbacks.erase(it);
+      break;
+    }
+  }
+}
+
+void SYNC::call_callbacks(uint8_t counter) const {
+  std::lock_guard<std::mutex> lock(m_receive_callbacks_mutex);
+  for (const SyncReceiver& receiver : m_receive_callbacks) {
+    receiver.callback(counter);
+  }
+}
+
+void SYNC::produce(std::chrono::microseconds period, uint8_t counter_overflow) {
+  auto next = std::chrono::steady_clock::now();
+  uint8_t counter = 0;
+
+  std::unique_lock<std::mutex> lock(m_producer_mutex);
+  while (m_producing) {
+    if (counter_overflow > 0) {
+      counter = (counter >= counter_overflow) ? 1 : counter + 1;
+    }
+
+    lock.unlock();
+    send(counter);
+    lock.lock();
+
+    next += period;
+    const auto now = std::chrono::steady_clock::now();
+    if (next < now) {
+      DEBUG_LOG("SYNC producer missed " << (now - next) / period + 1
+                                        << " cycles.");
+      // Don't send a burst of SYNCs to catch up.
+      next += ((now - next) / period + 1) * period;
+    }
+    m_producer_condition.wait_until(lock, next,
+                                    [this] { return !m_producing; });
+  }
+}
+
+}  // end namespace kaco
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace kaco {
+
+namespace {
+
+struct Event {
+  const char* category;
+  const char* name;
+  int64_t start_ns;
+  int64_t duration_ns;
+  uint16_t index;
+  uint8_t node_id;
+  uint8_t subindex;
+};
+
+// Written by its thread only. Events below count are never modified again,
+// so they can be read after an acquire load of count.
+struct ThreadBuffer {
+  uint32_t thread_number;
+  std::vector<Event> events;
+  std::atomic<size_t> count{0};
+  std::atomic<uint64_t> dropped{0};
+};
+
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+size_t registry_capacity = 1 << 16;
+uint32_t next_thread_number = 1;
+
+thread_local std::shared_ptr<ThreadBuffer> thread_buffer;
+
+ThreadBuffer& get_thread_buffer() {
+  if (!thread_buffer) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    thread_buffer = std::make_shared<ThreadBuffer>();
+    thread_buffer->thread_number = next_thread_number++;
+    thread_buffer->events.resize(registry_capacity);
+    registry.push_back(thread_buffer);
+  }
+  return *thread_buffer;
+}
+
+}  // namespace
+
+std::atomic<bool> Tracer::m_enabled{false};
+
+void Tracer::start(size_t events_per_thread) {
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry_capacity = events_per_thread;
+  }
+  m_enabled = true;
+}
+
+void Tracer::stop() { m_enabled = false; }
+
+void Tracer::clear() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  // Buffers of finished threads are only referenced by the registry.
+  registry.erase(
+      std::remove_if(registry.begin(), registry.end(),
+                     [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                       return buffer.use_count() == 1;
+                     }),
+      registry.end());
+  for (auto& buffer : registry) {
+    buffer->count = 0;
+    buffer->dropped = 0;
+  }
+}
+
+int64_t Tracer::now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Tracer::record(const char* category, const char* name, int64_t start_ns,
+                    int64_t duration_ns, uint8_t node_id, uint16_t index,
+                    uint8_t subindex) {
+  ThreadBuffer& buffer = get_thread_buffer();
+  const size_t count = buffer.count.load(std::memory_order_relaxed);
+  if (count >= buffer.events.size()) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer.events[count] = {category, name,    start_ns, duration_ns,
+                          index,    node_id, subindex};
+  buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void Tracer::write_chrome_trace(std::ostream& stream) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+
+  int64_t origin_ns = std::numeric_limits<int64_t>::max();
+  uint64_t dropped = 0;
+  for (const auto& buffer : registry) {
+    const size_t count = buffer->count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+      origin_ns = std::min(origin_ns, buffer->events[i].start_ns);
+    }
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+
+  // Restore the caller's formatting at the end.
+  const std::ios::fmtflags flags = stream.flags();
+  const std::streamsize precision = stream.precision();
+  const char fill = stream.fill();
+
+  stream << "{\"traceEvents\":[";
+  bool first = true;
+  stream << std::fixed << std::setprecision(3);
+  for (const auto& buffer : registry) {
+    const size_t count = buffer->count.load(std::memory_order_acquire);
+    if (count == 0) {
+      continue;
+    }
+
+    stream << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\","
+           << "\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_number
+           << ",\"args\":{\"name\":\"thread " << buffer->thread_number
+           << "\"}}";
+    first = false;
+
+    for (size_t i = 0; i < count; ++i) {
+      const Event& event = buffer->events[i];
+      stream << ",\n{\"name\":\"" << event.name << "\",\"cat\":\""
+             << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+             << buffer->thread_number
+             << ",\"ts\":" << (event.start_ns - origin_ns) / 1000.0
+             << ",\"dur\":" << event.duration_ns / 1000.0
+             << ",\"args\":{\"node\":" << unsigned(event.node_id)
+             << ",\"index\":\"0x" << std::hex << std::setw(4)
+             << std::setfill('0') << event.index << std::dec
+             << std::setfill(' ') << "\",\"subindex\":"
+             << unsigned(event.subindex) << "}}";
+    }
+  }
+  stream << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":"
+         << dropped << "}}\n";
+
+  stream.flags(flags);
+  stream.precision(precision);
+  stream.fill(fill);
+}
+
+bool Tracer::save_chrome_trace(const std::string& path) {
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+  write_chrome_trace(file);
+  return static_cast<bool>(file);
+}
+
+}  // end namespace kaco
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/virtual_bus.h"
+
+#include <algorithm>
+
+namespace kaco {
+
+size_t VirtualBus::get_message_count() const {
+  std::lock_guard<std::mutex> scoped_lock(m_endpoints_mutex);
+  return m_message_count;
+}
+
+std::shared_ptr<VirtualBus::Endpoint> VirtualBus::attach() {
+  std::lock_guard<std::mutex> scoped_lock(m_endpoints_mutex);
+  m_endpoints.push_back(std::make_shared<Endpoint>());
+  return m_endpoints.back();
+}
+
+void VirtualBus::detach(Endpoint* endpoint) {
+  std::lock_guard<std::mutex> scoped_lock(m_endpoints_mutex);
+  {
+    std::lock_guard<std::mutex> endpoint_lock(endpoint->mutex);
+    endpoint->open = false;
+    endpoint->queue.clear();
+  }
+  endpoint->condition.notify_all();
+  m_endpoints.erase(
+      std::remove_if(m_endpoints.begin(), m_endpoints.end(),
+                     [endpoint](const std::shared_ptr<Endpoint>& attached) {
+                       return attached.get() == endpoint;
+                     }),
+      m_endpoints.end());
+}
+
+void VirtualBus::send(const Endpoint* sender, const Message& message) {
+  std::lock_guard<std::mutex> scoped_lock(m_endpoints_mutex);
+  ++m_message_count;
+  for (const auto& endpoint : m_endpoints) {
+    if (endpoint.get() == sender) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> endpoint_lock(endpoint->mutex);
+      if (!endpoint->open) {
+        continue;
+      }
+      endpoint->queue.push_back(message);
+    }
+    endpoint->condition.notify_one();
+  }
+}
+
+bool VirtualBus::receive(Endpoint* endpoint, Message& message) {
+  std::unique_lock<std::mutex> lock(endpoint->mutex);
+  endpoint->condition.wait(
+      lock, [endpoint]() { return !endpoint->queue.empty() || !endpoint->open; });
+  if (!endpoint->open) {
+    return false;
+  }
+  message = endpoint->queue.front();
+  endpoint->queue.pop_front();
+  return true;
+}
+
+}  // end namespace kaco
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/bus_manager.h"
+
+#include <signal.h>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Daemon which owns one or more buses and shares them with local clients
+// (kaco::BusClient) over a Unix domain socket.
+//
+// Usage: kacanopen_daemon [-s <socket>] [-w <workers>] <busname> <baudrate>
+//                         [<busname> <baudrate> ...]
+//
+// The buses are numbered in the order of the arguments, starting at 0.
+
+static volatile int keepRunning = 1;
+
+void intHandler(int dummy) {
+  (void)dummy;
+  keepRunning = 0;
+}
+
+int main(int argc, char* argv[]) {
+  signal(SIGINT, intHandler);
+  signal(SIGTERM, intHandler);
+
+  std::string socket_path = "/tmp/kacanopen.sock";
+  size_t workers = 4;
+  std::vector<std::pair<std::string, std::string>> buses;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+      workers = std::stoul(argv[++i]);
+    } else if (i + 1 < argc) {
+      buses.emplace_back(argv[i], argv[i + 1]);
+      ++i;
+    } else {
+      buses.clear();
+      break;
+    }
+  }
+
+  if (buses.empty()) {
+    PRINT("Usage: " << argv[0]
+                    << " [-s <socket>] [-w <workers>] <busname> <baudrate> "
+                       "[<busname> <baudrate> ...]");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::unique_ptr<kaco::Core>> cores;
+  kaco::BusManager manager(socket_path, workers);
+
+  for (const auto& bus : buses) {
+    cores.emplace_back(new kaco::Core());
+    if (!cores.back()->start(bus.first, bus.second)) {
+      ERROR("Starting bus " << bus.first << " failed.");
+      return EXIT_FAILURE;
+    }
+    const unsigned number = manager.add_bus(*cores.back());
+    PRINT("Bus " << number << ": " << bus.first << " (" << bus.second << ")");
+  }
+
+  try {
+    manager.start();
+  } catch (const kaco::canopen_error& error) {
+    ERROR(error.what());
+    return EXIT_FAILURE;
+  }
+  PRINT("Listening on " << socket_path << ".");
+
+  while (keepRunning) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  manager.stop();
+  const kaco::BusManager::Statistics statistics = manager.get_statistics();
+  PRINT("Clients: " << statistics.clients << ", requests: "
+                    << statistics.requests
+                    << ", SDO transfers: " << statistics.sdo_transfers
+                    << ", merged: " << statistics.merged_requests
+                    << ", forwarded PDOs: " << statistics.forwarded_pdos
+                    << ", dropped PDOs: " << statistics.dropped_pdos);
+
+  for (auto& core : cores) {
+    core->stop();
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/frame_recorder.h"
+#include "kacanopen/core/frame_replayer.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/address.h"
+#include "kacanopen/master/eds_reader.h"
+#include "kacanopen/master/entry.h"
+#include "kacanopen/master/utils.h"
+#include "kacanopen/master/value.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Offline decoder which turns a frame log into one CSV time series per PDO
+// mapped signal. The log is either candump text (candump -l, or candump -t a
+// / -t z display output) or a binary kaco::FrameRecorder log. Delta
+// timestamps (candump -t d) are not supported, because chunks are decoded
+// independently. The log is split into chunks which are decoded in
+// parallel; every chunk is written as soon as it and all earlier chunks are
+// decoded, so memory use doesn't grow with the log size.
+//
+// Usage: kaco-decode [-j <threads>] [-b <bus>] <mapping file> <log file>
+//                    <output directory>
+//
+// -b selects the CAN interface name of candump logs or the bus ID of binary
+// logs. The mapping file describes nodes and their PDO mappings, one
+// statement per line ('#' starts a comment):
+//
+//   node <node id> <EDS or DCF file>
+//   pdo <COB-ID> <node id> <entry name or index/subindex> <byte offset>
+//
+// Example:
+//
+//   node 1 resources/eds_library/CiA_profiles/402.eds
+//   pdo 0x181 1 statusword 0
+//   pdo 0x181 1 0x6064/0 2
+//
+// Relative EDS paths are relative to the mapping file. Every signal is
+// written to <output directory>/<node id>_<entry name>.csv with columns time
+// (seconds) and value. The '/' in names of sub-entries (e.g.
+// read_input_8_bit/digital_inputs_1_8) is replaced by '.'.
+
+namespace {
+
+struct Frame {
+  double time;
+  uint16_t cob_id;
+  uint8_t len;
+  uint8_t data[8];
+};
+
+struct Signal {
+  std::string name;
+  kaco::Type type;
+  uint8_t offset;
+  // 0 for strings which extend to the end of the frame.
+  uint8_t size;
+};
+
+struct Node {
+  std::unordered_map<kaco::Address, kaco::Entry> dictionary;
+  std::unordered_map<std::string, kaco::Address> name_to_address;
+};
+
+// Decoded samples of one chunk, formatted as CSV rows per signal.
+using ChunkResult = std::vector<std::string>;
+
+// Signals of all COB-IDs, indexed by the 11 bit COB-ID.
+std::vector<std::vector<size_t>> signals_by_cob_id(2048);
+std::vector<Signal> signals;
+
+bool parse_entry(const Node& node, const std::string& token,
+                 kaco::Address& address) {
+  const size_t slash = token.find('/');
+  if (slash != std::string::npos) {
+    address.index = std::stoul(token.substr(0, slash), nullptr, 0);
+    address.subindex = std::stoul(token.substr(slash + 1), nullptr, 0);
+    return node.dictionary.count(address) > 0;
+  }
+  const auto it = node.name_to_address.find(kaco::Utils::escape(token));
+  if (it == node.name_to_address.end()) {
+    return false;
+  }
+  address = it->second;
+  return true;
+}
+
+bool load_mapping(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    ERROR("Cannot open mapping file " << path << ".");
+    return false;
+  }
+
+  std::map<unsigned, Node> nodes;
+  std::string line;
+  for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream stream(line);
+    std::string keyword;
+    if (!(stream >> keyword)) {
+      continue;
+    }
+
+    try {
+      if (keyword == "node") {
+        std::string node_id;
+        std::string eds_path;
+        if (!(stream >> node_id >> eds_path)) {
+          ERROR(path << ":" << line_number << ": Expected node <id> <eds>.");
+          return false;
+        }
+        const size_t slash = path.rfind('/');
+        if (eds_path[0] != '/' && slash != std::string::npos) {
+          eds_path = path.substr(0, slash + 1) + eds_path;
+        }
+        Node& node = nodes[std::stoul(node_id, nullptr, 0)];
+        kaco::EDSReader reader(node.dictionary, node.name_to_address);
+        if (!reader.load_file(eds_path) || !reader.import_entries()) {
+          ERROR(path << ":" << line_number << ": Cannot load " << eds_path
+                     << ".");
+          return false;
+        }
+
+      } else if (keyword == "pdo") {
+        std::string cob_id;
+        std::string node_id;
+        std::string entry;
+        unsigned offset;
+        if (!(stream >> cob_id >> node_id >> entry >> offset)) {
+          ERROR(path << ":" << line_number
+                     << ": Expected pdo <cob id> <node id> <entry> <offset>.");
+          return false;
+        }
+        const auto node = nodes.find(std::stoul(node_id, nullptr, 0));
+        if (node == nodes.end()) {
+          ERROR(path << ":" << line_number << ": Unknown node " << node_id
+                     << ".");
+          return false;
+        }
+        kaco::Address address;
+        if (!parse_entry(node->second, entry, address)) {
+          ERROR(path << ":" << line_number << ": Unknown entry " << entry
+                     << ".");
+          return false;
+        }
+
+        const kaco::Entry& dictionary_entry =
+            node->second.dictionary.at(address);
+        Signal signal;
+        signal.name = std::to_string(node->first) + "_" + dictionary_entry.name;
+        std::replace(signal.name.begin(), signal.name.end(), '/', '.');
+        signal.type = dictionary_entry.type;
+        signal.offset = offset;
+        signal.size = (signal.type == kaco::Type::string ||
+                       signal.type == kaco::Type::octet_string)
+                          ? 0
+                          : kaco::Utils::get_type_size(signal.type);
+
+        const unsigned cob = std::stoul(cob_id, nullptr, 0);
+        if (cob >= signals_by_cob_id.size() || offset + signal.size > 8) {
+          ERROR(path << ":" << line_number << ": Invalid COB-ID or offset.");
+          return false;
+        }
+        signals_by_cob_id[cob].push_back(signals.size());
+        signals.push_back(signal);
+
+      } else {
+        ERROR(path << ":" << line_number << ": Unknown keyword " << keyword
+                   << ".");
+        return false;
+      }
+    } catch (const std::exception& error) {
+      ERROR(path << ":" << line_number << ": " << error.what());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void decode_frame(const Frame& frame, ChunkResult& result) {
+  char time[32];
+  bool time_formatted = false;
+
+  for (size_t index : signals_by_cob_id[frame.cob_id]) {
+    const Signal& signal = signals[index];
+    const size_t size = signal.size ? signal.size : frame.len - signal.offset;
+    if (signal.offset + size > frame.len ||
+        (signal.size == 0 && signal.offset >= frame.len)) {
+      continue;
+    }
+
+    if (!time_formatted) {
+      std::snprintf(time, sizeof(time), "%.6f", frame.time);
+      time_formatted = true;
+    }
+
+    const std::vector<uint8_t> bytes(frame.data + signal.offset,
+                                     frame.data + signal.offset + size);
+    std::string& rows = result[index];
+    rows += time;
+    rows += ',';
+    rows += kaco::Value(signal.type, bytes).to_string();
+    rows += '\n';
+  }
+}
+
+int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+const char* skip_spaces(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t')) ++p;
+  return p;
+}
+
+// Parses a hexadecimal number and advances p.
+bool parse_hex(const char*& p, const char* end, unsigned& value) {
+  const char* start = p;
+  value = 0;
+  while (p < end && hex_digit(*p) >= 0) {
+    value = (value << 4) | hex_digit(*p++);
+  }
+  return p != start;
+}
+
+// Parses one line of candump output. Supported formats:
+//   (1436509052.249713) can0 181#0102030405060708
+//   (1436509052.249713)  can0  181   [8]  01 02 03 04 05 06 07 08
+// Lines without data (RTR), with extended or CAN FD frames, or of other
+// interfaces are skipped.
+bool parse_candump_line(const char* p, const char* end,
+                        const std::string& interface, Frame& frame) {
+  p = skip_spaces(p, end);
+  frame.time = 0;
+  if (p < end && *p == '(') {
+    char* time_end;
+    frame.time = std::strtod(p + 1, &time_end);
+    p = time_end;
+    if (p < end && *p == ')') ++p;
+    p = skip_spaces(p, end);
+  }
+
+  const char* name = p;
+  while (p < end && *p != ' ' && *p != '\t') ++p;
+  if (!interface.empty() &&
+      interface.compare(0, std::string::npos, name, p - name) != 0) {
+    return false;
+  }
+  p = skip_spaces(p, end);
+
+  unsigned cob_id;
+  const char* id_start = p;
+  if (!parse_hex(p, end, cob_id) || p - id_start > 3 || cob_id > 0x7FF) {
+    return false;
+  }
+  frame.cob_id = cob_id;
+  frame.len = 0;
+
+  if (p < end && *p == '#') {
+    ++p;
+    while (p + 1 < end && hex_digit(p[0]) >= 0 && hex_digit(p[1]) >= 0) {
+      if (frame.len == 8) return false;
+      frame.data[frame.len++] = (hex_digit(p[0]) << 4) | hex_digit(p[1]);
+      p += 2;
+    }
+    return p == end || *p == ' ' || *p == '\r';
+  }
+
+  p = skip_spaces(p, end);
+  unsigned len;
+  if (p >= end || *p != '[') return false;
+  ++p;
+  if (!parse_hex(p, end, len) || len > 8 || p >= end || *p != ']') {
+    return false;
+  }
+  ++p;
+  for (unsigned i = 0; i < len; ++i) {
+    p = skip_spaces(p, end);
+    unsigned byte;
+    const char* byte_start = p;
+    if (!parse_hex(p, end, byte) || p - byte_start != 2) return false;
+    frame.data[frame.len++] = byte;
+  }
+  return true;
+}
+
+// A read-only memory mapping of a whole file.
+struct MappedFile {
+  const char* data = nullptr;
+  size_t size = 0;
+
+  explicit MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0) {
+      if (fd >= 0) ::close(fd);
+      return;
+    }
+    size = status.st_size;
+    if (size > 0) {
+      void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      data = (mapping == MAP_FAILED) ? nullptr
+                                     : static_cast<const char*>(mapping);
+      if (data) madvise(mapping, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  ~MappedFile() {
+    if (data) munmap(const_cast<char*>(data), size);
+  }
+};
+
+// Runs decode(chunk, result) for all chunks on the given number of threads
+// and write(result) for every chunk in chunk order. Threads don't run more
+// than a few chunks ahead of the oldest unwritten chunk.
+template <class Decode, class Write>
+void run_parallel(size_t num_chunks, size_t num_threads, const Decode& decode,
+                  const Write& write) {
+  const size_t window = 4 * num_threads;
+  std::vector<ChunkResult> results(num_chunks);
+  std::vector<bool> done(num_chunks, false);
+  size_t next = 0;
+  size_t next_to_write = 0;
+  bool writing = false;
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        condition.wait(lock, [&]() {
+          return next >= num_chunks || next < next_to_write + window;
+        });
+        if (next >= num_chunks) {
+          break;
+        }
+        const size_t chunk = next++;
+        lock.unlock();
+
+        ChunkResult result(signals.size());
+        decode(chunk, result);
+
+        lock.lock();
+        results[chunk] = std::move(result);
+        done[chunk] = true;
+        // One thread at a time writes all consecutive decoded chunks.
+        while (!writing && next_to_write < num_chunks &&
+               done[next_to_write]) {
+          writing = true;
+          const ChunkResult pending = std::move(results[next_to_write]);
+          lock.unlock();
+          write(pending);
+          lock.lock();
+          writing = false;
+          ++next_to_write;
+          condition.notify_all();
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // end anonymous namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string bus;
+  std::vector<std::string> arguments;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      num_threads = std::max(1ul, std::stoul(argv[++i]));
+    } else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      bus = argv[++i];
+    } else {
+      arguments.push_back(argv[i]);
+    }
+  }
+
+  if (arguments.size() != 3) {
+    PRINT("Usage: " << argv[0]
+                    << " [-j <threads>] [-b <bus>] <mapping file> <log file> "
+                       "<output directory>");
+    return EXIT_FAILURE;
+  }
+
+  if (!load_mapping(arguments[0])) {
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::ofstream> files;
+  for (const Signal& signal : signals) {
+    const std::string path = arguments[2] + "/" + signal.name + ".csv";
+    files.emplace_back(path);
+    if (!files.back()) {
+      ERROR("Cannot write " << path << ".");
+      return EXIT_FAILURE;
+    }
+    files.back() << "time,value\n";
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::atomic<size_t> num_frames{0};
+  std::atomic<size_t> num_skipped{0};
+  size_t num_samples = 0;
+
+  // Appends the rows of a chunk to the CSV files. Called in log order.
+  const auto write = [&](const ChunkResult& result) {
+    for (size_t index = 0; index < signals.size(); ++index) {
+      files[index] << result[index];
+      num_samples +=
+          std::count(result[index].begin(), result[index].end(), '\n');
+    }
+  };
+
+  // Fixed chunk sizes bound the memory held by decoded but unwritten chunks.
+  const size_t records_per_chunk = 65536;
+  const size_t bytes_per_chunk = 4 * 1024 * 1024;
+
+  uint64_t magic = 0;
+  std::ifstream(arguments[1], std::ios::binary)
+      .read(reinterpret_cast<char*>(&magic), sizeof(magic));
+
+  kaco::FrameReplayer binary_log;
+  if (magic == kaco::FrameRecorder::magic) {
+    if (!binary_log.open(arguments[1])) {
+      return EXIT_FAILURE;
+    }
+    const kaco::FrameRecorder::FileHeader& header = binary_log.get_header();
+    char* bus_end = nullptr;
+    const int bus_id = bus.empty() ? -1 : std::strtol(bus.c_str(), &bus_end, 0);
+    if (!bus.empty() && *bus_end != '\0') {
+      ERROR("The bus of a binary log must be a bus ID.");
+      return EXIT_FAILURE;
+    }
+    const size_t num_chunks =
+        (binary_log.size() + records_per_chunk - 1) / records_per_chunk;
+
+    run_parallel(
+        num_chunks, num_threads,
+        [&](size_t chunk, ChunkResult& result) {
+          const size_t end =
+              std::min(binary_log.size(), (chunk + 1) * records_per_chunk);
+          size_t frames = 0;
+          for (size_t i = chunk * records_per_chunk; i < end; ++i) {
+            const kaco::FrameRecorder::Record& record =
+                binary_log.get_record(i);
+            if ((bus_id >= 0 && record.bus_id != bus_id) ||
+                (record.flags & kaco::FrameRecorder::flag_rtr) ||
+                record.cob_id >= signals_by_cob_id.size()) {
+              continue;
+            }
+            Frame frame;
+            frame.time = (header.start_time_ns + record.timestamp_ns) * 1e-9;
+            frame.cob_id = record.cob_id;
+            frame.len = std::min<uint8_t>(record.len, 8);
+            std::memcpy(frame.data, record.data, sizeof(frame.data));
+            decode_frame(frame, result);
+            ++frames;
+          }
+          num_frames += frames;
+        },
+        write);
+
+  } else {
+    const MappedFile log(arguments[1]);
+    if (!log.data && log.size > 0) {
+      ERROR("Cannot read " << arguments[1] << ".");
+      return EXIT_FAILURE;
+    }
+
+    // Chunk boundaries are moved to the next line start.
+    const size_t num_chunks =
+        std::max<size_t>((log.size + bytes_per_chunk - 1) / bytes_per_chunk,
+                         1);
+    std::vector<const char*> boundaries;
+    boundaries.push_back(log.data);
+    for (size_t chunk = 1; chunk < num_chunks; ++chunk) {
+      const char* end = log.data + log.size;
+      const char* p =
+          std::max(boundaries.back(), log.data + chunk * log.size / num_chunks);
+      p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+      boundaries.push_back(p ? p + 1 : end);
+    }
+    boundaries.push_back(log.data + log.size);
+
+    run_parallel(
+        num_chunks, num_threads,
+        [&](size_t chunk, ChunkResult& result) {
+          const char* p = boundaries[chunk];
+          const char* end = boundaries[chunk + 1];
+          size_t frames = 0;
+          size_t skipped = 0;
+          while (p < end) {
+            const char* line_end =
+                static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!line_end) line_end = end;
+            Frame frame;
+            if (parse_candump_line(p, line_end, bus, frame)) {
+              decode_frame(frame, result);
+              ++frames;
+            } else if (line_end > p) {
+              ++skipped;
+            }
+            p = line_end + 1;
+          }
+          num_frames += frames;
+          num_skipped += skipped;
+        },
+        write);
+  }
+
+  for (size_t index = 0; index < signals.size(); ++index) {
+    files[index].close();
+    if (!files[index]) {
+      ERROR("Cannot write " << arguments[2] << "/" << signals[index].name
+                            << ".csv.");
+      return EXIT_FAILURE;
+    }
+  }
+
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  PRINT("Decoded " << num_frames << " frames into " << num_samples
+                   << " samples of " << signals.size() << " signals in "
+                   << seconds << " s using " << num_threads << " threads ("
+                   << num_skipped << " lines skipped).");
+  return EXIT_SUCCESS;
+}
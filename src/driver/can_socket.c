@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef RTCAN_SOCKET
 #include "rtdm/rtcan.h"
@@ -64,6 +65,19 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "kacanopen/driver/can_driver.h"
 
+/* Allows at most one error message per second and call site, so that a
+ * fault storm doesn't stall the receive or send path on terminal I/O. The
+ * state is owned by the call site; callers are serialized by Core. */
+static int error_message_allowed(time_t *last, unsigned *suppressed) {
+  time_t now = time(NULL);
+  if (now == *last) {
+    ++*suppressed;
+    return 0;
+  }
+  *last = now;
+  return 1;
+}
+
 /*********functions which permit to communicate with the board****************/
 UNS8 canReceive_driver(CAN_HANDLE fd0, Message *m) {
   int res;
@@ -71,7 +85,13 @@ UNS8 canReceive_driver(CAN_HANDLE fd0, Message *m) {
 
   res = CAN_RECV(*(int *)fd0, &frame, sizeof(frame), 0);
   if (res < 0) {
-    fprintf(stderr, "Recv failed: %s\n", strerror(CAN_ERRNO(res)));
+    static time_t last_message = 0;
+    static unsigned suppressed = 0;
+    if (error_message_allowed(&last_message, &suppressed)) {
+      fprintf(stderr, "Recv failed: %s (%u similar messages suppressed)\n",
+              strerror(CAN_ERRNO(res)), suppressed);
+      suppressed = 0;
+    }
     return 1;
   }
 
@@ -109,7 +129,13 @@ UNS8 canSend_driver(CAN_HANDLE fd0, Message const *m) {
 #endif
   res = CAN_SEND(*(int *)fd0, &frame, sizeof(frame), 0);
   if (res < 0) {
-    fprintf(stderr, "Send failed: %s\n", strerror(CAN_ERRNO(res)));
+    static time_t last_message = 0;
+    static unsigned suppressed = 0;
+    if (error_message_allowed(&last_message, &suppressed)) {
+      fprintf(stderr, "Send failed: %s (%u similar messages suppressed)\n",
+              strerror(CAN_ERRNO(res)), suppressed);
+      suppressed = 0;
+    }
     return 1;
   }
 
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/bus_client.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/core/sdo_error.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace kaco {
+
+BusClient::BusClient(const std::string& socket_path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    throw canopen_error("[BusClient] Socket path too long: " + socket_path);
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_fd < 0 || connect(m_fd, reinterpret_cast<sockaddr*>(&address),
+                          sizeof(address)) != 0) {
+    const std::string error = std::strerror(errno);
+    if (m_fd >= 0) {
+      close(m_fd);
+    }
+    throw canopen_error("[BusClient] Cannot connect to " + socket_path + ": " +
+                        error);
+  }
+
+  m_connected = true;
+  m_receive_thread = std::thread(&BusClient::receive_loop, this);
+}
+
+BusClient::~BusClient() {
+  shutdown(m_fd, SHUT_RDWR);
+  m_receive_thread.join();
+  close(m_fd);
+}
+
+std::vector<uint8_t> BusClient::upload(uint8_t bus, uint8_t node_id,
+                                       uint16_t index, uint8_t subindex,
+                                       BusPriority priority) {
+  BusMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = static_cast<uint8_t>(BusMessageType::sdo_upload);
+  header.bus = bus;
+  header.node_id = node_id;
+  header.index = index;
+  header.subindex = subindex;
+  header.priority = static_cast<uint8_t>(priority);
+
+  Response response = request(header);
+  check(response, "upload");
+  return std::move(response.payload);
+}
+
+void BusClient::download(uint8_t bus, uint8_t node_id, uint16_t index,
+                         uint8_t subindex, const std::vector<uint8_t>& data,
+                         BusPriority priority) {
+  BusMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = static_cast<uint8_t>(BusMessageType::sdo_download);
+  header.bus = bus;
+  header.node_id = node_id;
+  header.index = index;
+  header.subindex = subindex;
+  header.priority = static_cast<uint8_t>(priority);
+
+  check(request(header, data), "download");
+}
+
+void BusClient::send_nmt(uint8_t bus, uint8_t node_id, NMT::Command command) {
+  BusMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = static_cast<uint8_t>(BusMessageType::nmt);
+  header.bus = bus;
+  header.node_id = node_id;
+  header.subindex = static_cast<uint8_t>(command);
+
+  check(request(header), "send_nmt");
+}
+
+void BusClient::subscribe_pdo(uint8_t bus, uint16_t cob_id,
+                              const PDOCallback& callback) {
+  {
+    std::lock_guard<std::mutex> lock(m_pdo_callbacks_mutex);
+    m_pdo_callbacks[(bus << 16) | cob_id] = callback;
+  }
+
+  BusMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = static_cast<uint8_t>(BusMessageType::subscribe_pdo);
+  header.bus = bus;
+  header.index = cob_id;
+
+  check(request(header), "subscribe_pdo");
+}
+
+void BusClient::unsubscribe_pdo(uint8_t bus, uint16_t cob_id) {
+  BusMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = static_cast<uint8_t>(BusMessageType::unsubscribe_pdo);
+  header.bus = bus;
+  header.index = cob_id;
+
+  check(request(header), "unsubscribe_pdo");
+
+  std::lock_guard<std::mutex> lock(m_pdo_callbacks_mutex);
+  m_pdo_callbacks.erase((bus << 16) | cob_id);
+}
+
+BusClient::Response BusClient::request(BusMessageHeader header,
+                                       const std::vector<uint8_t>& payload) {
+  if (payload.size() > UINT16_MAX) {
+    throw canopen_error("[BusClient::request] Payload too large.");
+  }
+
+  std::future<Response> future;
+  {
+    std::lock_guard<std::mutex> lock(m_pending_mutex);
+    if (!m_connected) {
+      throw canopen_error("[BusClient::request] Not connected.");
+    }
+    header.request_id = m_next_request_id++;
+    future = m_pending[header.request_id].get_future();
+  }
+  header.size = payload.size();
+
+  std::vector<uint8_t> frame(sizeof(header) + payload.size());
+  std::memcpy(frame.data(), &header, sizeof(header));
+  std::copy(payload.begin(), payload.end(), frame.begin() + sizeof(header));
+
+  {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    size_t written = 0;
+    while (written < frame.size()) {
+      const ssize_t result = send(m_fd, frame.data() + written,
+                                  frame.size() - written, MSG_NOSIGNAL);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result < 0) {
+        std::lock_guard<std::mutex> pending_lock(m_pending_mutex);
+        m_pending.erase(header.request_id);
+        throw canopen_error(std::string("[BusClient::request] send(): ") +
+                            std::strerror(errno));
+      }
+      written += result;
+    }
+  }
+
+  return future.get();
+}
+
+void BusClient::check(const Response& response, const std::string& method) {
+  const std::string message(response.payload.begin(),
+                            response.payload.end());
+
+  switch (response.status) {
+    case BusStatus::ok:
+      return;
+    case BusStatus::sdo_error: {
+      uint32_t code = static_cast<uint32_t>(sdo_error::type::unknown);
+      if (response.payload.size() >= 4) {
+        std::memcpy(&code, response.payload.data(), 4);
+      }
+      // The message repeats the error type, which sdo_error adds itself.
+      throw sdo_error(static_cast<sdo_error::type>(code),
+                      "[BusClient::" + method + "]");
+    }
+    case BusStatus::unknown_bus:
+      throw canopen_error("[BusClient::" + method + "] Unknown bus.");
+    default:
+      throw canopen_error("[BusClient::" + method + "] " + message);
+  }
+}
+
+void BusClient::receive_loop() {
+  const auto read_all = [this](uint8_t* buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+      const ssize_t result = recv(m_fd, buffer + received, size - received, 0);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        return false;
+      }
+      received += result;
+    }
+    return true;
+  };
+
+  while (true) {
+    BusMessageHeader header;
+    if (!read_all(reinterpret_cast<uint8_t*>(&header), sizeof(header))) {
+      break;
+    }
+    std::vector<uint8_t> payload(header.size);
+    if (!read_all(payload.data(), payload.size())) {
+      break;
+    }
+
+    const auto type = static_cast<BusMessageType>(header.type);
+    if (type == BusMessageType::response) {
+      std::lock_guard<std::mutex> lock(m_pending_mutex);
+      auto it = m_pending.find(header.request_id);
+      if (it != m_pending.end()) {
+        it->second.set_value(
+            {static_cast<BusStatus>(header.status), std::move(payload)});
+        m_pending.erase(it);
+      }
+    } else if (type == BusMessageType::pdo) {
+      std::lock_guard<std::mutex> lock(m_pdo_callbacks_mutex);
+      auto it = m_pdo_callbacks.find((header.bus << 16) | header.index);
+      if (it != m_pdo_callbacks.end()) {
+        it->second(payload);
+      }
+    } else {
+      DEBUG_LOG("[BusClient] Ignoring message type " << (unsigned)header.type);
+    }
+  }
+
+  // Connection lost: fail all pending requests.
+  const std::string message = "Connection lost.";
+  std::lock_guard<std::mutex> lock(m_pending_mutex);
+  m_connected = false;
+  for (auto& pending : m_pending) {
+    pending.second.set_value(
+        {BusStatus::invalid_request,
+         std::vector<uint8_t>(message.begin(), message.end())});
+  }
+  m_pending.clear();
+}
+
+}  // end namespace kaco
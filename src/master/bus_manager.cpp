@@ -0,0 +1,660 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/bus_manager.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/core/sdo_error.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+namespace kaco {
+
+/// A connected client
+struct BusManager::Client {
+  int fd;
+
+  // Write end of the manager's wake-up pipe
+  int wake_fd;
+
+  // Received bytes which don't form a complete message yet. Only accessed by
+  // the I/O thread.
+  std::vector<uint8_t> buffer;
+
+  // Subscribed PDOs (bus << 16 | cob_id). Only accessed by the I/O thread.
+  std::set<uint32_t> subscriptions;
+
+  // Protects fd, open, lost and output
+  std::mutex write_mutex;
+  bool open = true;
+  bool lost = false;
+
+  // Messages which could not be sent yet. The I/O thread flushes them when
+  // the socket becomes writable.
+  std::vector<uint8_t> output;
+
+  /// Queues one message and sends as much of the queue as possible without
+  /// blocking. If may_drop is set, the message is dropped when more than
+  /// max_pdo_backlog bytes are pending. If more than max_backlog bytes are
+  /// pending, the client is considered lost.
+  /// \returns false if the message has been dropped.
+  bool write(const BusMessageHeader& header,
+             const std::vector<uint8_t>& payload, bool may_drop) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    if (!open || lost) {
+      return false;
+    }
+    if (may_drop && output.size() > max_pdo_backlog) {
+      return false;
+    }
+    if (output.size() > max_backlog) {
+      lost = true;
+      wake();
+      return false;
+    }
+
+    const bool was_empty = output.empty();
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+    output.insert(output.end(), bytes, bytes + sizeof(header));
+    output.insert(output.end(), payload.begin(), payload.end());
+
+    if (was_empty) {
+      flush_locked();
+      if (!output.empty() || lost) {
+        // Let the I/O thread wait for POLLOUT.
+        wake();
+      }
+    }
+    return true;
+  }
+
+  /// Sends pending messages without blocking. Called by the I/O thread.
+  /// \returns false if the connection is lost.
+  bool flush() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    flush_locked();
+    return !lost;
+  }
+
+  /// Returns true if messages are pending.
+  bool has_output() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    return !output.empty();
+  }
+
+  /// Returns true if the connection is lost or the client stalled.
+  bool is_lost() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    return lost;
+  }
+
+ private:
+  void flush_locked() {
+    size_t written = 0;
+    while (open && !lost && written < output.size()) {
+      const ssize_t result = send(fd, output.data() + written,
+                                  output.size() - written,
+                                  MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          lost = true;
+        }
+        break;
+      }
+      written += result;
+    }
+    output.erase(output.begin(), output.begin() + written);
+  }
+
+  void wake() {
+    const uint8_t byte = 0;
+    if (::write(wake_fd, &byte, 1) < 0) {
+      // The pipe is full, so the I/O thread wakes up anyway.
+    }
+  }
+};
+
+BusManager::BusManager(const std::string& socket_path, size_t workers)
+    : m_socket_path(socket_path), m_worker_count(std::max<size_t>(1, workers)) {}
+
+BusManager::~BusManager() { stop(); }
+
+uint8_t BusManager::add_bus(Core& core) {
+  assert(!m_running);
+  m_buses.push_back(&core);
+  return m_buses.size() - 1;
+}
+
+void BusManager::start() {
+  if (m_running) {
+    return;
+  }
+
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (m_socket_path.size() >= sizeof(address.sun_path)) {
+    throw canopen_error("[BusManager::start] Socket path too long: " +
+                        m_socket_path);
+  }
+  std::strncpy(address.sun_path, m_socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  m_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (m_listen_fd < 0) {
+    throw canopen_error(std::string("[BusManager::start] socket(): ") +
+                        std::strerror(errno));
+  }
+  unlink(m_socket_path.c_str());
+  if (bind(m_listen_fd, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(m_listen_fd, 16) != 0) {
+    const std::string error = std::strerror(errno);
+    close(m_listen_fd);
+    m_listen_fd = -1;
+    throw canopen_error("[BusManager::start] Cannot listen on " +
+                        m_socket_path + ": " + error);
+  }
+
+  if (pipe2(m_wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    const std::string error = std::strerror(errno);
+    close(m_listen_fd);
+    m_listen_fd = -1;
+    throw canopen_error("[BusManager::start] pipe(): " + error);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    m_statistics = Statistics();
+  }
+
+  m_running = true;
+  m_io_thread = std::thread(&BusManager::io_loop, this);
+  for (size_t i = 0; i < m_worker_count; ++i) {
+    m_workers.emplace_back(&BusManager::worker_loop, this);
+  }
+  DEBUG_LOG("[BusManager] Listening on " << m_socket_path << ".");
+}
+
+void BusManager::stop() {
+  if (!m_running) {
+    return;
+  }
+
+  m_running = false;
+  const uint8_t wake = 0;
+  if (::write(m_wake_pipe[1], &wake, 1) < 0) {
+    WARN("[BusManager::stop] Cannot wake up the I/O thread.");
+  }
+  m_io_thread.join();
+
+  {
+    std::lock_guard<std::mutex> lock(m_jobs_mutex);
+    m_jobs_condition.notify_all();
+  }
+  for (std::thread& worker : m_workers) {
+    worker.join();
+  }
+  m_workers.clear();
+  m_jobs.clear();
+  m_busy_nodes.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+    for (const auto& registered : m_registered_pdos) {
+      m_buses[registered.first >> 16]->pdo.remove_pdo_received_callback(
+          registered.second);
+    }
+    m_registered_pdos.clear();
+    m_subscribers.clear();
+  }
+
+  close(m_wake_pipe[0]);
+  close(m_wake_pipe[1]);
+  close(m_listen_fd);
+  m_listen_fd = -1;
+  unlink(m_socket_path.c_str());
+}
+
+BusManager::Statistics BusManager::get_statistics() const {
+  std::lock_guard<std::mutex> lock(m_statistics_mutex);
+  return m_statistics;
+}
+
+void BusManager::io_loop() {
+  std::vector<pollfd> fds;
+
+  while (m_running) {
+    fds.clear();
+    fds.push_back({m_listen_fd, POLLIN, 0});
+    fds.push_back({m_wake_pipe[0], POLLIN, 0});
+    for (const auto& client : m_clients) {
+      const short events = POLLIN | (client->has_output() ? POLLOUT : 0);
+      fds.push_back({client->fd, events, 0});
+    }
+
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno != EINTR) {
+        ERROR("[BusManager] poll(): " << std::strerror(errno));
+        break;
+      }
+      continue;
+    }
+
+    if (fds[1].revents) {
+      uint8_t buffer[16];
+      while (read(m_wake_pipe[0], buffer, sizeof(buffer)) > 0) {
+      }
+    }
+
+    // m_clients may change below, so collect the ready clients first.
+    std::vector<std::shared_ptr<Client>> ready;
+    std::vector<std::shared_ptr<Client>> writable;
+    std::vector<std::shared_ptr<Client>> lost;
+    for (size_t i = 2; i < fds.size(); ++i) {
+      const auto& client = m_clients[i - 2];
+      if (fds[i].revents & ~POLLOUT) {
+        ready.push_back(client);
+      }
+      if (fds[i].revents & POLLOUT) {
+        writable.push_back(client);
+      }
+    }
+    for (const auto& client : writable) {
+      client->flush();
+    }
+    for (const auto& client : ready) {
+      if (!read_client(client)) {
+        close_client(client);
+      }
+    }
+    for (const auto& client : m_clients) {
+      if (client->is_lost()) {
+        lost.push_back(client);
+      }
+    }
+    for (const auto& client : lost) {
+      WARN("[BusManager] Closing stalled or lost client " << client->fd
+                                                          << ".");
+      close_client(client);
+    }
+
+    if (fds[0].revents & POLLIN) {
+      accept_client();
+    }
+  }
+
+  while (!m_clients.empty()) {
+    close_client(m_clients.back());
+  }
+}
+
+void BusManager::accept_client() {
+  const int fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd < 0) {
+    WARN("[BusManager] accept(): " << std::strerror(errno));
+    return;
+  }
+
+  auto client = std::make_shared<Client>();
+  client->fd = fd;
+  client->wake_fd = m_wake_pipe[1];
+  m_clients.push_back(client);
+
+  std::lock_guard<std::mutex> lock(m_statistics_mutex);
+  ++m_statistics.clients;
+  DEBUG_LOG("[BusManager] Client " << fd << " connected.");
+}
+
+bool BusManager::read_client(const std::shared_ptr<Client>& client) {
+  uint8_t buffer[4096];
+  const ssize_t received =
+      recv(client->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+  if (received == 0) {
+    return false;
+  }
+  if (received < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+
+  std::vector<uint8_t>& data = client->buffer;
+  data.insert(data.end(), buffer, buffer + received);
+
+  size_t offset = 0;
+  while (data.size() - offset >= sizeof(BusMessageHeader)) {
+    BusMessageHeader header;
+    std::memcpy(&header, data.data() + offset, sizeof(header));
+    const size_t frame_size = sizeof(header) + header.size;
+    if (data.size() - offset < frame_size) {
+      break;
+    }
+    std::vector<uint8_t> payload(data.begin() + offset + sizeof(header),
+                                 data.begin() + offset + frame_size);
+    offset += frame_size;
+    handle_request(client, header, std::move(payload));
+  }
+  data.erase(data.begin(), data.begin() + offset);
+  return true;
+}
+
+void BusManager::close_client(const std::shared_ptr<Client>& client) {
+  {
+    std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+    for (uint32_t key : client->subscriptions) {
+      auto& subscribers = m_subscribers[key];
+      subscribers.erase(
+          std::remove(subscribers.begin(), subscribers.end(), client),
+          subscribers.end());
+    }
+  }
+  client->subscriptions.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(client->write_mutex);
+    client->open = false;
+    close(client->fd);
+  }
+
+  m_clients.erase(std::remove(m_clients.begin(), m_clients.end(), client),
+                  m_clients.end());
+  DEBUG_LOG("[BusManager] Client " << client->fd << " disconnected.");
+}
+
+void BusManager::handle_request(const std::shared_ptr<Client>& client,
+                                const BusMessageHeader& header,
+                                std::vector<uint8_t> payload) {
+  {
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    ++m_statistics.requests;
+  }
+
+  if (header.bus >= m_buses.size()) {
+    respond(*client, header.request_id, BusStatus::unknown_bus);
+    return;
+  }
+  Core& core = *m_buses[header.bus];
+  const uint32_t pdo_key = (header.bus << 16) | header.index;
+
+  switch (static_cast<BusMessageType>(header.type)) {
+    case BusMessageType::sdo_upload:
+    case BusMessageType::sdo_download:
+      enqueue(client, header, std::move(payload));
+      return;
+
+    case BusMessageType::nmt: {
+      const auto command = static_cast<NMT::Command>(header.subindex);
+      if (header.node_id == 0) {
+        core.nmt.broadcast_nmt_message(command);
+      } else {
+        core.nmt.send_nmt_message(header.node_id, command);
+      }
+      respond(*client, header.request_id, BusStatus::ok);
+      return;
+    }
+
+    case BusMessageType::subscribe_pdo: {
+      std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+      if (client->subscriptions.insert(pdo_key).second) {
+        m_subscribers[pdo_key].push_back(client);
+      }
+      if (m_registered_pdos.count(pdo_key) == 0) {
+        // One callback per bus and COB-ID, no matter how many clients
+        // subscribe.
+        const uint8_t bus = header.bus;
+        const uint16_t cob_id = header.index;
+        m_registered_pdos[pdo_key] = core.pdo.add_pdo_received_callback(
+            cob_id, [this, bus, cob_id](const std::vector<uint8_t>& data) {
+              forward_pdo(bus, cob_id, data);
+            });
+      }
+      break;
+    }
+
+    case BusMessageType::unsubscribe_pdo: {
+      std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+      if (client->subscriptions.erase(pdo_key) > 0) {
+        auto& subscribers = m_subscribers[pdo_key];
+        subscribers.erase(
+            std::remove(subscribers.begin(), subscribers.end(), client),
+            subscribers.end());
+      }
+      break;
+    }
+
+    default: {
+      const std::string message =
+          "Unknown message type " + std::to_string(header.type);
+      respond(*client, header.request_id, BusStatus::invalid_request,
+              std::vector<uint8_t>(message.begin(), message.end()));
+      return;
+    }
+  }
+
+  respond(*client, header.request_id, BusStatus::ok);
+}
+
+void BusManager::enqueue(const std::shared_ptr<Client>& client,
+                         const BusMessageHeader& header,
+                         std::vector<uint8_t> payload) {
+  const auto type = static_cast<BusMessageType>(header.type);
+  const auto same_entry = [&header](const Job& job) {
+    return job.bus == header.bus && job.node_id == header.node_id &&
+           job.index == header.index && job.subindex == header.subindex;
+  };
+
+  std::lock_guard<std::mutex> lock(m_jobs_mutex);
+
+  // Look for an identical queued job which isn't followed by another
+  // queued job for the same entry, so merging doesn't reorder reads and
+  // writes.
+  Job* identical = nullptr;
+  for (Job& job : m_jobs) {
+    if (!same_entry(job)) {
+      continue;
+    }
+    if (job.type == type &&
+        (type == BusMessageType::sdo_upload || job.data == payload)) {
+      identical = &job;
+    } else if (job.type == BusMessageType::sdo_download ||
+               type == BusMessageType::sdo_download) {
+      identical = nullptr;
+    }
+  }
+
+  if (identical) {
+    identical->waiters.push_back({client, header.request_id});
+    identical->priority = std::max(identical->priority, header.priority);
+    std::lock_guard<std::mutex> statistics_lock(m_statistics_mutex);
+    ++m_statistics.merged_requests;
+    return;
+  }
+
+  Job job;
+  job.sequence = m_next_sequence++;
+  job.type = type;
+  job.bus = header.bus;
+  job.node_id = header.node_id;
+  job.index = header.index;
+  job.subindex = header.subindex;
+  job.priority = header.priority;
+  job.data = std::move(payload);
+  job.waiters.push_back({client, header.request_id});
+  m_jobs.push_back(std::move(job));
+  m_jobs_condition.notify_one();
+}
+
+void BusManager::worker_loop() {
+  std::unique_lock<std::mutex> lock(m_jobs_mutex);
+
+  std::set<uint64_t> entries;
+
+  while (m_running) {
+    // Highest priority first, then oldest, skipping nodes which have a
+    // transfer running. Jobs for the same entry keep their order, so that
+    // a prioritized upload doesn't overtake an earlier download.
+    auto next = m_jobs.end();
+    entries.clear();
+    for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it) {
+      const uint64_t entry = (uint64_t(it->bus) << 32) |
+                             (uint64_t(it->node_id) << 24) |
+                             (uint64_t(it->index) << 8) | it->subindex;
+      if (!entries.insert(entry).second) {
+        continue;
+      }
+      if (m_busy_nodes.count((it->bus << 8) | it->node_id) > 0) {
+        continue;
+      }
+      if (next == m_jobs.end() || it->priority > next->priority) {
+        next = it;
+      }
+    }
+
+    if (next == m_jobs.end()) {
+      m_jobs_condition.wait(lock);
+      continue;
+    }
+
+    Job job = std::move(*next);
+    m_jobs.erase(next);
+    const uint16_t node = (job.bus << 8) | job.node_id;
+    m_busy_nodes.insert(node);
+
+    lock.unlock();
+    execute(job);
+    lock.lock();
+
+    m_busy_nodes.erase(node);
+    m_jobs_condition.notify_all();
+  }
+}
+
+void BusManager::execute(Job& job) {
+  Core& core = *m_buses[job.bus];
+  BusStatus status = BusStatus::ok;
+  std::vector<uint8_t> payload;
+
+  try {
+    if (job.type == BusMessageType::sdo_upload) {
+      payload = core.sdo.upload(job.node_id, job.index, job.subindex);
+    } else {
+      core.sdo.download(job.node_id, job.index, job.subindex, job.data.size(),
+                        job.data);
+    }
+  } catch (const sdo_error& error) {
+    status = BusStatus::sdo_error;
+    const uint32_t code = static_cast<uint32_t>(error.get_type());
+    const std::string message = error.what();
+    payload.resize(4);
+    std::memcpy(payload.data(), &code, 4);
+    payload.insert(payload.end(), message.begin(), message.end());
+  } catch (const canopen_error& error) {
+    status = BusStatus::invalid_request;
+    const std::string message = error.what();
+    payload.assign(message.begin(), message.end());
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    ++m_statistics.sdo_transfers;
+  }
+
+  for (const Waiter& waiter : job.waiters) {
+    respond(*waiter.client, waiter.request_id, status, payload);
+  }
+}
+
+void BusManager::forward_pdo(uint8_t bus, uint16_t cob_id,
+                             const std::vector<uint8_t>& data) {
+  std::vector<std::shared_ptr<Client>> subscribers;
+  {
+    std::lock_guard<std::mutex> lock(m_subscribers_mutex);
+    auto it = m_subscribers.find((bus << 16) | cob_id);
+    if (it == m_subscribers.end() || it->second.empty()) {
+      return;
+    }
+    subscribers = it->second;
+  }
+
+  BusMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = static_cast<uint8_t>(BusMessageType::pdo);
+  header.bus = bus;
+  header.index = cob_id;
+  header.size = data.size();
+
+  uint64_t forwarded = 0;
+  uint64_t dropped = 0;
+  for (const auto& client : subscribers) {
+    if (client->write(header, data, true)) {
+      ++forwarded;
+    } else {
+      ++dropped;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_statistics_mutex);
+  m_statistics.forwarded_pdos += forwarded;
+  m_statistics.dropped_pdos += dropped;
+}
+
+void BusManager::respond(Client& client, uint32_t request_id,
+                         BusStatus status,
+                         const std::vector<uint8_t>& payload) {
+  BusMessageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.request_id = request_id;
+  header.type = static_cast<uint8_t>(BusMessageType::response);
+  header.status = static_cast<uint8_t>(status);
+  if (payload.size() > UINT16_MAX) {
+    header.size = UINT16_MAX;
+    client.write(header,
+                 std::vector<uint8_t>(payload.begin(),
+                                      payload.begin() + UINT16_MAX),
+                 false);
+    return;
+  }
+  header.size = payload.size();
+  client.write(header, payload, false);
+}
+
+}  // end namespace kaco
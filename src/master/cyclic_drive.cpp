@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/cyclic_drive.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/core/sdo_error.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace kaco {
+
+CyclicDrive::CyclicDrive(Device& device, Mode mode, size_t ring_capacity)
+    : m_device(device), m_mode(mode), m_points(ring_capacity) {}
+
+void CyclicDrive::configure(std::chrono::microseconds cycle_period,
+                           bool map_in_device) {
+  m_device.set_entry("modes_of_operation", static_cast<int8_t>(m_mode),
+                     WriteAccessMethod::sdo);
+
+  // Interpolation time period: value * 10^exponent seconds
+  if (m_device.has_entry(0x60C2, 1) && m_device.has_entry(0x60C2, 2)) {
+    int64_t value = cycle_period.count();
+    int8_t exponent = -6;
+    while (exponent < -3 && value % 10 == 0) {
+      value /= 10;
+      ++exponent;
+    }
+    if (value > 0 && value <= 255) {
+      try {
+        m_device.set_entry(0x60C2, 1, static_cast<uint8_t>(value),
+                           WriteAccessMethod::sdo);
+        m_device.set_entry(0x60C2, 2, exponent, WriteAccessMethod::sdo);
+      } catch (const sdo_error& error) {
+        DEBUG_LOG("[CyclicDrive::configure] Drive doesn't accept 0x60C2: "
+                  << error.what());
+      }
+    }
+  }
+
+  if (m_mode == Mode::interpolated_position) {
+    configure_interpolation();
+  }
+
+  uint32_t target_mapping = 0;
+  std::string target_name;
+  switch (m_mode) {
+    case Mode::interpolated_position:
+      break;
+    case Mode::position:
+      target_mapping = 0x607A0020;
+      target_name = "target_position";
+      break;
+    case Mode::velocity:
+      target_mapping = 0x60FF0020;
+      target_name = "target_velocity";
+      break;
+    default:
+      target_mapping = 0x60710010;
+      target_name = "target_torque";
+      break;
+  }
+
+  if (map_in_device) {
+    // Transmission type 1: synchronous, every SYNC
+    m_device.map_tpdo_in_device(TPDO_NO::TPDO_1, {0x60410010, 0x60640020}, 1);
+    m_device.map_tpdo_in_device(TPDO_NO::TPDO_2, {0x606C0020, 0x60770010}, 1);
+    if (m_mode == Mode::interpolated_position) {
+      m_device.map_rpdo_in_device(RPDO_NO::RPDO_1, {0x60400010}, 1);
+      // Asynchronous: The drive queues every received point.
+      m_device.map_rpdo_in_device(RPDO_NO::RPDO_2, {0x60C10120}, 255);
+    } else {
+      m_device.map_rpdo_in_device(RPDO_NO::RPDO_1,
+                                  {0x60400010, target_mapping}, 1);
+    }
+  }
+
+  const auto cob_id = [this](uint16_t communication_index) {
+    const uint32_t value = m_device.get_entry(communication_index, 1,
+                                              ReadAccessMethod::sdo);
+    return static_cast<uint16_t>(value & 0x7FF);
+  };
+  const uint16_t tpdo1 = cob_id(0x1800);
+  const uint16_t tpdo2 = cob_id(0x1801);
+  const uint16_t rpdo1 = cob_id(0x1400);
+
+  m_device.add_receive_pdo_mapping(tpdo1, "statusword", 0);
+  m_device.add_receive_pdo_mapping(tpdo1, "position_actual_value", 2);
+  m_device.add_receive_pdo_mapping(tpdo2, "velocity_actual_value", 0);
+  m_device.add_receive_pdo_mapping(tpdo2, "torque_actual_value", 4);
+
+  m_device.set_entry("controlword", static_cast<uint16_t>(0),
+                     WriteAccessMethod::cache);
+
+  if (m_mode == Mode::interpolated_position) {
+    m_point_cob_id = cob_id(0x1401);
+    m_device.set_entry(0x60C1, 1, static_cast<int32_t>(0),
+                       WriteAccessMethod::cache);
+    m_device.add_transmit_pdo_mapping(rpdo1, {{"controlword", 0}},
+                                      TransmissionType::SYNCHRONOUS);
+    m_device.add_transmit_pdo_mapping(
+        m_point_cob_id, std::vector<MappingByIndex>{{0x60C1, 1, 0}},
+        TransmissionType::ON_REQUEST);
+  } else {
+    m_device.set_entry(target_name, make_target(0), WriteAccessMethod::cache);
+    m_device.add_transmit_pdo_mapping(rpdo1,
+                                      {{"controlword", 0}, {target_name, 2}},
+                                      TransmissionType::SYNCHRONOUS);
+  }
+}
+
+void CyclicDrive::configure_interpolation() {
+  size_t capacity = 1;
+
+  try {
+    // linear interpolation
+    if (m_device.has_entry(0x60C0)) {
+      m_device.set_entry(0x60C0, 0, static_cast<int16_t>(0),
+                         WriteAccessMethod::sdo);
+    }
+
+    if (m_device.has_entry(0x60C4, 1) && m_device.has_entry(0x60C4, 2) &&
+        m_device.has_entry(0x60C4, 6)) {
+      const uint32_t maximum =
+          m_device.get_entry(0x60C4, 1, ReadAccessMethod::sdo);
+      if (maximum > 0) {
+        capacity = maximum;
+      }
+      m_device.set_entry(0x60C4, 2, static_cast<uint32_t>(capacity),
+                         WriteAccessMethod::sdo);
+      // clear and enable the input buffer
+      m_device.set_entry(0x60C4, 6, static_cast<uint8_t>(0),
+                         WriteAccessMethod::sdo);
+      m_device.set_entry(0x60C4, 6, static_cast<uint8_t>(1),
+                         WriteAccessMethod::sdo);
+    }
+  } catch (const sdo_error& error) {
+    DEBUG_LOG("[CyclicDrive::configure] Drive doesn't support the IP buffer "
+              "configuration: "
+              << error.what());
+  }
+
+  std::lock_guard<std::mutex> lock(m_buffer_statistics_mutex);
+  m_buffer_statistics = BufferStatistics();
+  m_buffer_statistics.drive_capacity = capacity;
+  m_buffer_statistics.min_drive_level = capacity;
+}
+
+void CyclicDrive::attach(CyclicExecutor& executor) {
+  m_statusword_input = executor.add_input(m_device, "statusword");
+  m_position_input = executor.add_input(m_device, "position_actual_value");
+  m_velocity_input = executor.add_input(m_device, "velocity_actual_value");
+  m_torque_input = executor.add_input(m_device, "torque_actual_value");
+  m_controlword_output = executor.add_output(m_device, "controlword");
+
+  switch (m_mode) {
+    case Mode::interpolated_position:
+      // Points are sent by feed_points().
+      break;
+    case Mode::position:
+      m_target_output = executor.add_output(m_device, "target_position");
+      break;
+    case Mode::velocity:
+      m_target_output = executor.add_output(m_device, "target_velocity");
+      break;
+    default:
+      m_target_output = executor.add_output(m_device, "target_torque");
+      break;
+  }
+
+  executor.add_task(
+      std::bind(&CyclicDrive::cycle, this, std::placeholders::_1));
+}
+
+void CyclicDrive::enable() { m_enable = true; }
+
+void CyclicDrive::disable() { m_enable = false; }
+
+void CyclicDrive::set_target(int32_t target) { m_target = target; }
+
+void CyclicDrive::set_setpoint_generator(const SetpointGenerator& generator) {
+  m_generator = generator;
+}
+
+CyclicDrive::Feedback CyclicDrive::get_feedback() const {
+  std::lock_guard<std::mutex> lock(m_feedback_mutex);
+  return m_feedback;
+}
+
+bool CyclicDrive::push_point(int32_t position) {
+  return m_points.push(position);
+}
+
+CyclicDrive::BufferStatistics CyclicDrive::get_buffer_statistics() const {
+  std::lock_guard<std::mutex> lock(m_buffer_statistics_mutex);
+  BufferStatistics statistics = m_buffer_statistics;
+  statistics.ring_level = m_points.size();
+  statistics.ring_capacity = m_points.capacity();
+  return statistics;
+}
+
+void CyclicDrive::reset_buffer_statistics() {
+  std::lock_guard<std::mutex> lock(m_buffer_statistics_mutex);
+  m_buffer_statistics.points_sent = 0;
+  m_buffer_statistics.underruns = 0;
+  m_buffer_statistics.min_drive_level = m_buffer_statistics.drive_level;
+}
+
+CyclicDrive::Mode CyclicDrive::get_mode() const { return m_mode; }
+
+Device& CyclicDrive::get_device() { return m_device; }
+
+void CyclicDrive::cycle(CyclicExecutor::CycleContext& context) {
+  Feedback feedback;
+  const Value& statusword = context.get_input(m_statusword_input);
+  const Value& position = context.get_input(m_position_input);
+  const Value& velocity = context.get_input(m_velocity_input);
+  const Value& torque = context.get_input(m_torque_input);
+
+  if (statusword.type != Type::invalid) {
+    feedback.valid = true;
+    feedback.statusword = statusword;
+    feedback.state = DriveStateMachine::decode_state(feedback.statusword);
+  }
+  if (position.type != Type::invalid) {
+    feedback.position = position;
+  }
+  if (velocity.type != Type::invalid) {
+    feedback.velocity = velocity;
+  }
+  if (torque.type != Type::invalid) {
+    feedback.torque = torque;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_feedback_mutex);
+    m_feedback = feedback;
+  }
+
+  if (!feedback.valid) {
+    // Nothing received from the drive yet.
+    return;
+  }
+
+  if (m_mode == Mode::interpolated_position) {
+    m_last_controlword = next_controlword(feedback.state);
+    if (feedback.state == State::operation_enabled &&
+        m_last_controlword == 0x000F) {
+      // enable IP mode
+      m_last_controlword |= 0x0010;
+    }
+    m_last_state = feedback.state;
+    feed_points(feedback);
+    context.set_output(m_controlword_output, m_last_controlword);
+    return;
+  }
+
+  const int32_t hold = (m_mode == Mode::position) ? feedback.position : 0;
+  int32_t target = hold;
+
+  if (feedback.state == State::operation_enabled) {
+    if (m_last_state != State::operation_enabled) {
+      DEBUG_LOG("[CyclicDrive] Node " << (unsigned)m_device.get_node_id()
+                                      << ": operation enabled.");
+      m_target = hold;
+    }
+    target = m_generator ? m_generator(feedback) : m_target.load();
+  }
+
+  m_last_controlword = next_controlword(feedback.state);
+  m_last_state = feedback.state;
+
+  context.set_output(m_controlword_output, m_last_controlword);
+  context.set_output(m_target_output, make_target(target));
+}
+
+void CyclicDrive::feed_points(const Feedback& feedback) {
+  std::lock_guard<std::mutex> lock(m_buffer_statistics_mutex);
+  BufferStatistics& statistics = m_buffer_statistics;
+
+  if (feedback.state != State::operation_enabled) {
+    // The drive drops its buffer when leaving operation enabled.
+    statistics.drive_level = 0;
+    return;
+  }
+
+  // IP mode active: the drive consumes one point per cycle.
+  const bool active = (feedback.statusword & 0x1000) != 0;
+  if (active && statistics.drive_level > 0) {
+    --statistics.drive_level;
+  }
+
+  int32_t point;
+  while (statistics.drive_level < statistics.drive_capacity &&
+         m_points.pop(point)) {
+    m_device.set_entry(0x60C1, 1, point, WriteAccessMethod::cache);
+    m_device.send_transmit_pdo(m_point_cob_id);
+    ++statistics.drive_level;
+    ++statistics.points_sent;
+  }
+
+  if (active) {
+    statistics.min_drive_level =
+        std::min(statistics.min_drive_level, statistics.drive_level);
+    if (statistics.drive_level == 0) {
+      ++statistics.underruns;
+    }
+  }
+}
+
+uint16_t CyclicDrive::next_controlword(State state) {
+  const bool enable = m_enable;
+
+  if (state == State::fault) {
+    // fault reset on the rising edge of bit 7
+    if (enable) {
+      return (m_last_controlword & 0x0080) ? 0x0000 : 0x0080;
+    }
+    return 0x0000;
+  }
+
+  return DriveStateMachine::next_command(
+      state, enable ? State::operation_enabled : State::switched_on);
+}
+
+Value CyclicDrive::make_target(int32_t target) const {
+  if (m_mode == Mode::torque) {
+    target = std::min<int32_t>(
+        std::max<int32_t>(target, std::numeric_limits<int16_t>::min()),
+        std::numeric_limits<int16_t>::max());
+    return Value(static_cast<int16_t>(target));
+  }
+  return Value(target);
+}
+
+}  // end namespace kaco
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/cyclic_executor.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/dictionary_error.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+
+namespace kaco {
+
+const Value& CyclicExecutor::CycleContext::get_input(size_t input) const {
+  return m_inputs.at(input);
+}
+
+void CyclicExecutor::CycleContext::set_output(size_t output,
+                                              const Value& value) {
+  m_outputs.at(output) = value;
+}
+
+CyclicExecutor::CyclicExecutor(Core& core, std::chrono::microseconds phase,
+                               std::chrono::microseconds window)
+    : m_core(core), m_phase(phase), m_window(window) {}
+
+CyclicExecutor::~CyclicExecutor() { stop(); }
+
+size_t CyclicExecutor::add_input(Device& device,
+                                 const std::string& entry_name) {
+  if (!device.has_entry(entry_name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, entry_name);
+  }
+  m_inputs.push_back({&device, entry_name});
+  return m_inputs.size() - 1;
+}
+
+size_t CyclicExecutor::add_output(Device& device,
+                                  const std::string& entry_name) {
+  if (!device.has_entry(entry_name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, entry_name);
+  }
+  m_outputs.push_back({&device, entry_name});
+  if (std::find(m_output_devices.begin(), m_output_devices.end(), &device) ==
+      m_output_devices.end()) {
+    m_output_devices.push_back(&device);
+  }
+  return m_outputs.size() - 1;
+}
+
+void CyclicExecutor::add_task(const Task& task) { m_tasks.push_back(task); }
+
+void CyclicExecutor::set_cycle_callback(
+    const std::function<void(const CycleResult&)>& callback) {
+  m_cycle_callback = callback;
+}
+
+void CyclicExecutor::set_output_phase(std::chrono::microseconds output_phase) {
+  m_output_phase = output_phase;
+}
+
+void CyclicExecutor::start() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(!m_running);
+    m_running = true;
+    m_pending = false;
+    m_cycle_counter = 0;
+    m_statistics = Statistics();
+  }
+  m_thread = std::thread(&CyclicExecutor::run, this);
+  m_sync_callback_id = m_core.sync.add_sync_received_callback(
+      std::bind(&CyclicExecutor::sync_received, this, std::placeholders::_1));
+}
+
+void CyclicExecutor::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) {
+      return;
+    }
+    m_running = false;
+  }
+  m_core.sync.remove_sync_received_callback(m_sync_callback_id);
+  m_condition.notify_all();
+  m_thread.join();
+}
+
+CyclicExecutor::Statistics CyclicExecutor::get_statistics() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+void CyclicExecutor::reset_statistics() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_statistics = Statistics();
+}
+
+void CyclicExecutor::print_statistics() const {
+  const Statistics statistics = get_statistics();
+  PRINT("Cycles:             " << statistics.cycles);
+  PRINT("Deadline misses:    " << statistics.deadline_misses);
+  PRINT("Overruns:           " << statistics.overruns);
+  PRINT("Errors:             " << statistics.errors);
+  PRINT("Max start latency:  " << statistics.max_start_latency.count()
+                               << " us");
+  PRINT("Max execution time: " << statistics.max_execution_time.count()
+                               << " us");
+  PRINT("Execution time histogram:");
+  for (size_t i = 0; i < histogram_size; ++i) {
+    if (statistics.execution_time_histogram[i] == 0) {
+      continue;
+    }
+    const std::string lower = (i == 0) ? "0" : std::to_string(1u << (i - 1));
+    const std::string upper =
+        (i == histogram_size - 1) ? "inf" : std::to_string(1u << i);
+    PRINT("  [" << std::setw(5) << lower << ", " << std::setw(5) << upper
+                << ") us: " << statistics.execution_time_histogram[i]);
+  }
+}
+
+void CyclicExecutor::sync_received(uint8_t counter) {
+  const auto sync_time = std::chrono::steady_clock::now();
+
+  // Called from the receive loop: The snapshot contains exactly the PDOs
+  // which have been received before this SYNC.
+  std::vector<Value> inputs;
+  inputs.reserve(m_inputs.size());
+  for (const EntryReference& input : m_inputs) {
+    try {
+      inputs.push_back(
+          input.device->get_entry(input.entry_name, ReadAccessMethod::cache));
+    } catch (const canopen_error&) {
+      // no value received yet
+      inputs.push_back(Value());
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) {
+      return;
+    }
+    if (m_pending) {
+      ++m_statistics.overruns;
+    }
+    m_pending = true;
+    m_next_cycle.sync_counter = counter;
+    m_next_cycle.sync_time = sync_time;
+    m_next_cycle.m_inputs.swap(inputs);
+  }
+  m_condition.notify_all();
+}
+
+void CyclicExecutor::run() {
+  CycleContext context;
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_condition.wait(lock, [this] { return m_pending || !m_running; });
+    if (!m_running) {
+      break;
+    }
+
+    m_pending = false;
+    context.cycle = m_cycle_counter++;
+    context.sync_counter = m_next_cycle.sync_counter;
+    context.sync_time = m_next_cycle.sync_time;
+    context.m_inputs.swap(m_next_cycle.m_inputs);
+
+    const auto planned_start = context.sync_time + m_phase;
+    m_condition.wait_until(lock, planned_start, [this] { return !m_running; });
+    if (!m_running) {
+      break;
+    }
+    lock.unlock();
+
+    const auto start = std::chrono::steady_clock::now();
+    context.m_outputs.assign(m_outputs.size(), Value());
+    m_output_messages.clear();
+
+    bool error = false;
+    try {
+      for (const Task& task : m_tasks) {
+        task(context);
+      }
+      write_outputs(context);
+    } catch (const std::exception& e) {
+      ERROR("[CyclicExecutor] Cycle " << context.cycle << ": " << e.what());
+      error = true;
+    }
+    const auto executed = std::chrono::steady_clock::now();
+
+    // After an error, no PDOs are sent rather than stale or partial ones.
+    if (!error) {
+      if (m_output_phase.count() > 0) {
+        std::this_thread::sleep_until(context.sync_time + m_output_phase);
+      }
+      m_core.send(m_output_messages);
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    CycleResult result;
+    result.cycle = context.cycle;
+    result.start_latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        start - planned_start);
+    result.execution_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(executed - start);
+    result.deadline_missed = (end > context.sync_time + m_window);
+
+    if (m_cycle_callback) {
+      m_cycle_callback(result);
+    }
+
+    lock.lock();
+    record(result);
+    if (error) {
+      ++m_statistics.errors;
+    }
+  }
+}
+
+void CyclicExecutor::write_outputs(const CycleContext& context) {
+  for (size_t i = 0; i < m_outputs.size(); ++i) {
+    if (context.m_outputs[i].type != Type::invalid) {
+      m_outputs[i].device->set_entry(m_outputs[i].entry_name,
+                                     context.m_outputs[i],
+                                     WriteAccessMethod::cache);
+    }
+  }
+
+  m_output_messages.clear();
+  for (Device* device : m_output_devices) {
+    device->collect_synchronous_pdos(m_output_messages);
+  }
+}
+
+void CyclicExecutor::record(const CycleResult& result) {
+  ++m_statistics.cycles;
+  if (result.deadline_missed) {
+    ++m_statistics.deadline_misses;
+    DEBUG_LOG("[CyclicExecutor] Deadline missed in cycle " << result.cycle);
+  }
+  m_statistics.max_start_latency =
+      std::max(m_statistics.max_start_latency, result.start_latency);
+  m_statistics.max_execution_time =
+      std::max(m_statistics.max_execution_time, result.execution_time);
+
+  size_t bucket = 0;
+  for (auto us = result.execution_time.count(); us > 0; us >>= 1) {
+    ++bucket;
+  }
+  ++m_statistics.execution_time_histogram[std::min(bucket, histogram_size - 1)];
+}
+
+}  // end namespace kaco
@@ -33,7 +33,9 @@
 #include "kacanopen/core/core.h"
 #include "kacanopen/core/global_config.h"
 #include "kacanopen/core/logger.h"
+#include "kacanopen/core/probes.h"
 #include "kacanopen/core/sdo_error.h"
+#include "kacanopen/core/tracer.h"
 #include "kacanopen/master/dictionary_error.h"
 #include "kacanopen/master/profiles.h"
 #include "kacanopen/master/utils.h"
@@ -52,7 +54,9 @@ Device::Device(Core& core, uint8_t node_id)
       terminating_(false) {}
 
 Device::~Device() {
-  for (auto& cob_id : cob_ids_) m_core.pdo.remove_pdo_received_callback(cob_id);
+  for (uint32_t id : pdo_callback_ids_) {
+    m_core.pdo.remove_pdo_received_callback(id);
+  }
   stop_request_heartbeat();
 }
 
@@ -71,6 +75,8 @@ void Device::start() {
 
 uint8_t Device::get_node_id() const { return m_node_id; }
 
+Core& Device::get_core() { return m_core; }
+
 bool Device::has_entry(const std::string& entry_name) {
   const std::string name = Utils::escape(entry_name);
   return m_name_to_address.count(name) > 0 &&
@@ -99,6 +105,46 @@ Type Device::get_entry_type(const uint16_t index, const uint8_t subindex) {
   return m_dictionary[Address{index, subindex}].get_type();
 }
 
+Address Device::get_entry_address(const std::string& entry_name) {
+  const std::string name = Utils::escape(entry_name);
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+  return m_name_to_address[name];
+}
+
+std::vector<ReceivePDOMapping> Device::get_receive_pdo_mappings() {
+  std::lock_guard<std::mutex> lock(m_receive_pdo_mappings_mutex);
+  return std::vector<ReceivePDOMapping>(m_receive_pdo_mappings.begin(),
+                                        m_receive_pdo_mappings.end());
+}
+
+std::vector<std::string> Device::get_pdo_mapped_entries() {
+  std::vector<std::string> names;
+  const auto add = [&names](const std::string& entry_name) {
+    const std::string name = Utils::escape(entry_name);
+    if (std::find(names.begin(), names.end(), name) == names.end()) {
+      names.push_back(name);
+    }
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(m_receive_pdo_mappings_mutex);
+    for (const ReceivePDOMapping& mapping : m_receive_pdo_mappings) {
+      add(mapping.entry_name);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_transmit_pdo_mappings_mutex);
+    for (const TransmitPDOMapping& pdo : m_transmit_pdo_mappings) {
+      for (const Mapping& mapping : pdo.mappings) {
+        add(mapping.entry_name);
+      }
+    }
+  }
+  return names;
+}
+
 const Value& Device::get_entry(const std::string& entry_name,
                                const ReadAccessMethod access_method) {
   const std::string name = Utils::escape(entry_name);
@@ -169,6 +215,26 @@ void Device::set_entry(const uint16_t index, const uint8_t subindex,
   }
 }
 
+uint32_t Device::add_value_changed_callback(
+    const std::string& entry_name, Entry::ValueChangedCallback callback) {
+  const std::string name = Utils::escape(entry_name);
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+  return m_dictionary.at(m_name_to_address.at(name))
+      .add_value_changed_callback(callback);
+}
+
+void Device::remove_value_changed_callback(const std::string& entry_name,
+                                           uint32_t id) {
+  const std::string name = Utils::escape(entry_name);
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+  m_dictionary.at(m_name_to_address.at(name))
+      .remove_value_changed_callback(id);
+}
+
 void Device::add_entry(const uint16_t index, const uint8_t subindex,
                        const std::string& name, const Type type,
                        const AccessType access_type) {
@@ -224,8 +290,8 @@ void Device::add_receive_pdo_mapping(uint16_t cob_id,
   // value.
   auto binding = std::bind(&Device::pdo_received_callback, this, pdo,
                            std::placeholders::_1);
-  cob_ids_.push_back(cob_id);
-  m_core.pdo.add_pdo_received_callback(cob_id, std::move(binding));
+  pdo_callback_ids_.push_back(
+      m_core.pdo.add_pdo_received_callback(cob_id, std::move(binding)));
 }
 
 void Device::add_receive_pdo_mapping(
@@ -264,7 +330,8 @@ void Device::add_receive_pdo_mapping(
   // TODO: this only works while add_pdo_received_callback takes callback by
   // value.
   auto binding = std::bind(funtion, pdo, std::placeholders::_1);
-  m_core.pdo.add_pdo_received_callback(cob_id, std::move(binding));
+  pdo_callback_ids_.push_back(
+      m_core.pdo.add_pdo_received_callback(cob_id, std::move(binding)));
 }
 
 void Device::add_receive_pdo_mapping(uint16_t cob_id, uint16_t entry_index,
@@ -292,8 +359,8 @@ void Device::add_receive_pdo_mapping(uint16_t cob_id, uint16_t entry_index,
   ReceivePDOMapping& pdo = *pdo_temp;
   auto binding = std::bind(&Device::pdo_received_callback, this, pdo,
                            std::placeholders::_1);
-  cob_ids_.push_back(cob_id);
-  m_core.pdo.add_pdo_received_callback(cob_id, std::move(binding));
+  pdo_callback_ids_.push_back(
+      m_core.pdo.add_pdo_received_callback(cob_id, std::move(binding)));
 }
 
 void Device::add_transmit_pdo_mapping(uint16_t cob_id,
@@ -328,8 +395,7 @@ void Device::add_transmit_pdo_mapping(uint16_t cob_id,
       });
     }
 
-  } else {
-    // transmission_type==TransmissionType::PERIODIC
+  } else if (transmission_type == TransmissionType::PERIODIC) {
 
     if (repeat_time == std::chrono::milliseconds(0)) {
       WARN(
@@ -393,8 +459,7 @@ void Device::add_transmit_pdo_mapping(
       });
     }
 
-  } else {
-    // transmission_type==TransmissionType::PERIODIC
+  } else if (transmission_type == TransmissionType::PERIODIC) {
 
     if (repeat_time == std::chrono::milliseconds(0)) {
       WARN(
@@ -414,6 +479,38 @@ void Device::add_transmit_pdo_mapping(
   }
 }
 
+size_t Device::send_synchronous_pdos() {
+  std::vector<Message> messages;
+  collect_synchronous_pdos(messages);
+  m_core.send(messages);
+  return messages.size();
+}
+
+size_t Device::collect_synchronous_pdos(std::vector<Message>& messages) {
+  std::lock_guard<std::mutex> lock(m_transmit_pdo_mappings_mutex);
+  size_t count = 0;
+  for (const TransmitPDOMapping& pdo : m_transmit_pdo_mappings) {
+    if (pdo.transmission_type == TransmissionType::SYNCHRONOUS) {
+      messages.push_back(pdo.get_message());
+      KACO_PROBE2(tpdo_send, messages.back().cob_id, messages.back().len);
+      ++count;
+    }
+  }
+  return count;
+}
+
+bool Device::send_transmit_pdo(uint16_t cob_id) {
+  std::lock_guard<std::mutex> lock(m_transmit_pdo_mappings_mutex);
+  bool found = false;
+  for (const TransmitPDOMapping& pdo : m_transmit_pdo_mappings) {
+    if (pdo.cob_id == cob_id) {
+      pdo.send();
+      found = true;
+    }
+  }
+  return found;
+}
+
 void Device::pdo_received_callback(const ReceivePDOMapping& mapping,
                                    std::vector<uint8_t> data) {
   DEBUG_LOG("[Device::pdo_received_callback] Received a PDO for mapping '"
@@ -432,10 +529,9 @@ void Device::pdo_received_callback(const ReceivePDOMapping& mapping,
 
   if (data.size() < offset + type_size) {
     // We don't throw an exception here, because this could be a network error.
-    WARN("[Device::pdo_received_callback] PDO has wrong size. Ignoring it...");
-    DUMP(data.size());
-    DUMP(offset);
-    DUMP(type_size);
+    WARN("[Device::pdo_received_callback] PDO has wrong size (data.size() = "
+         << data.size() << ", offset = " << unsigned(offset)
+         << ", type_size = " << unsigned(type_size) << "). Ignoring it...");
     return;
   }
 
@@ -444,6 +540,8 @@ void Device::pdo_received_callback(const ReceivePDOMapping& mapping,
   // data.begin()+offset+type_size);
   std::vector<uint8_t> bytes(data.begin() + offset,
                              data.begin() + offset + type_size);
+  KACO_PROBE4(pdo_unpack, m_node_id, mapping.cob_id, entry.index,
+              entry.subindex);
   entry.set_value(Value(entry.type, bytes));
 }
 
@@ -455,6 +553,7 @@ uint16_t Device::get_device_profile_number() {
 }
 
 Value Device::get_entry_via_sdo(uint32_t index, uint8_t subindex, Type type) {
+  TraceSpan span("device", "device read", m_node_id, index, subindex);
   sdo_error last_error(sdo_error::type::unknown);
 
   for (size_t i = 0; i < Config::repeats_on_sdo_timeout + 1; ++i) {
@@ -468,6 +567,8 @@ Value Device::get_entry_via_sdo(uint32_t index, uint8_t subindex, Type type) {
                   << std::to_string(m_node_id) << " " << error.what()
                   << " -> Repetition " << std::to_string(i + 1) << " of "
                   << std::to_string(Config::repeats_on_sdo_timeout + 1) << ".");
+        TraceSpan sleep_span("device", "sdo retry sleep", m_node_id, index,
+                             subindex);
         std::this_thread::sleep_for(
             std::chrono::milliseconds(kaco::Config::sdo_response_timeout_ms));
       }
@@ -484,6 +585,7 @@ Value Device::get_entry_via_sdo(uint32_t index, uint8_t subindex, Type type) {
 
 void Device::set_entry_via_sdo(uint32_t index, uint8_t subindex,
                                const Value& value) {
+  TraceSpan span("device", "device write", m_node_id, index, subindex);
   sdo_error last_error(sdo_error::type::unknown);
 
   for (size_t i = 0; i < Config::repeats_on_sdo_timeout + 1; ++i) {
@@ -498,6 +600,8 @@ void Device::set_entry_via_sdo(uint32_t index, uint8_t subindex,
                   << std::to_string(m_node_id) << " " << error.what()
                   << " -> Repetition " << std::to_string(i + 1) << " of "
                   << std::to_string(Config::repeats_on_sdo_timeout + 1) << ".");
+        TraceSpan sleep_span("device", "sdo retry sleep", m_node_id, index,
+                             subindex);
         std::this_thread::sleep_for(
             std::chrono::milliseconds(kaco::Config::sdo_response_timeout_ms));
       }
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/device_farm.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/dictionary_error.h"
+#include "kacanopen/master/utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace kaco {
+
+DeviceFarm::DeviceFarm(Core& core) : m_core(core) {}
+
+DeviceFarm::~DeviceFarm() {
+  if (m_running) {
+    stop();
+  }
+}
+
+Slave& DeviceFarm::add_node(uint8_t node_id, const std::string& eds_path) {
+  if (find_node(node_id)) {
+    throw canopen_error("[DeviceFarm::add_node] Node " +
+                        std::to_string(node_id) + " already exists.");
+  }
+
+  std::unique_ptr<Node> node(new Node);
+  node->slave.reset(new Slave(m_core, node_id));
+  Slave& slave = *node->slave;
+
+  slave.load_dictionary_from_eds(eds_path);
+  slave.set_missing_values_to_zero();
+
+  uint16_t profile = 0;
+  if (slave.has_entry(0x1000) && slave.get_entry_type(0x1000) == Type::uint32) {
+    profile = static_cast<uint32_t>(slave.get_entry(0x1000)) & 0xFFFF;
+    if (profile == 0) {
+      // Generic CiA profile EDS files don't specify the device type.
+      if (slave.has_entry(0x6040) && slave.has_entry(0x6041)) {
+        profile = 402;
+      } else if (slave.has_entry(0x6000, 1) || slave.has_entry(0x6200, 1)) {
+        profile = 401;
+      }
+      slave.set_entry(0x1000, 0, static_cast<uint32_t>(profile));
+    }
+  }
+
+  add_default_pdo_mappings(slave, profile);
+  const size_t num_pdos = slave.map_pdos_from_dictionary();
+  add_profile_reactions(slave, profile);
+
+  DEBUG_LOG("[DeviceFarm::add_node] Node " << (unsigned)node_id << ": profile "
+                                           << profile << ", " << num_pdos
+                                           << " PDOs.");
+
+  m_nodes.push_back(std::move(node));
+  return slave;
+}
+
+void DeviceFarm::add_nodes(uint8_t first_node_id, size_t count,
+                           const std::string& eds_path) {
+  for (size_t i = 0; i < count; ++i) {
+    add_node(static_cast<uint8_t>(first_node_id + i), eds_path);
+  }
+}
+
+Slave& DeviceFarm::get_node(uint8_t node_id) {
+  Node* node = find_node(node_id);
+  if (!node) {
+    throw canopen_error("[DeviceFarm::get_node] Node " +
+                        std::to_string(node_id) + " doesn't exist.");
+  }
+  return *node->slave;
+}
+
+size_t DeviceFarm::num_nodes() const { return m_nodes.size(); }
+
+void DeviceFarm::add_echo(uint8_t node_id, const Address& from,
+                          const Address& to) {
+  Slave& slave = get_node(node_id);
+
+  for (const Address& address : {from, to}) {
+    if (!slave.has_entry(address.index, address.subindex)) {
+      throw dictionary_error(dictionary_error::type::unknown_entry,
+                             std::to_string(address.index) + "sub" +
+                                 std::to_string(address.subindex));
+    }
+  }
+
+  if (slave.get_entry_type(from.index, from.subindex) !=
+      slave.get_entry_type(to.index, to.subindex)) {
+    throw dictionary_error(dictionary_error::type::wrong_type,
+                           std::to_string(to.index) + "sub" +
+                               std::to_string(to.subindex));
+  }
+
+  slave.add_value_changed_callback(
+      from.index, from.subindex, [&slave, to](const Value& value) {
+        slave.set_entry(to.index, to.subindex, value);
+      });
+}
+
+void DeviceFarm::set_tpdo_period(std::chrono::microseconds period) {
+  for (const auto& node : m_nodes) {
+    node->tpdo_period_us = period.count();
+  }
+  m_scheduler_condition.notify_all();
+}
+
+void DeviceFarm::set_tpdo_period(uint8_t node_id,
+                                 std::chrono::microseconds period) {
+  Node* node = find_node(node_id);
+  if (node) {
+    node->tpdo_period_us = period.count();
+    m_scheduler_condition.notify_all();
+  }
+}
+
+void DeviceFarm::set_heartbeat_period(std::chrono::milliseconds period) {
+  m_heartbeat_period_ms = period.count();
+  m_scheduler_condition.notify_all();
+}
+
+void DeviceFarm::start() {
+  assert(!m_running);
+
+  for (const auto& node : m_nodes) {
+    node->slave->start();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+    m_running = true;
+  }
+  m_scheduler_thread = std::thread(&DeviceFarm::scheduler_loop, this);
+}
+
+void DeviceFarm::stop() {
+  assert(m_running);
+
+  {
+    std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+    m_running = false;
+  }
+  m_scheduler_condition.notify_all();
+  m_scheduler_thread.join();
+
+  for (const auto& node : m_nodes) {
+    node->slave->stop();
+  }
+}
+
+size_t DeviceFarm::get_tpdo_count() const { return m_tpdo_count; }
+
+size_t DeviceFarm::get_heartbeat_count() const { return m_heartbeat_count; }
+
+void DeviceFarm::scheduler_loop() {
+  const Clock::time_point start = Clock::now();
+  for (const auto& node : m_nodes) {
+    node->next_tpdo = start;
+    node->next_heartbeat = start;
+  }
+
+  std::unique_lock<std::mutex> lock(m_scheduler_mutex);
+
+  while (m_running) {
+    const Clock::time_point now = Clock::now();
+    // Wake up at least once per second to pick up rate changes.
+    Clock::time_point next_wakeup = now + std::chrono::seconds(1);
+
+    for (const auto& node : m_nodes) {
+      Slave& slave = *node->slave;
+
+      const std::chrono::microseconds tpdo_period(node->tpdo_period_us);
+      if (tpdo_period.count() > 0) {
+        if (node->next_tpdo <= now) {
+          m_tpdo_count += slave.send_transmit_pdos();
+          // Don't try to catch up if we are late.
+          node->next_tpdo = std::max(node->next_tpdo + tpdo_period, now);
+        }
+        next_wakeup = std::min(next_wakeup, node->next_tpdo);
+      }
+
+      std::chrono::milliseconds heartbeat_period(m_heartbeat_period_ms);
+      if (heartbeat_period.count() == 0) {
+        heartbeat_period = slave.get_heartbeat_period();
+      }
+      if (heartbeat_period.count() > 0) {
+        if (node->next_heartbeat <= now) {
+          slave.send_heartbeat();
+          ++m_heartbeat_count;
+          node->next_heartbeat =
+              std::max(node->next_heartbeat + heartbeat_period, now);
+        }
+        next_wakeup = std::min(next_wakeup, node->next_heartbeat);
+      }
+    }
+
+    m_scheduler_condition.wait_until(lock, next_wakeup);
+  }
+}
+
+void DeviceFarm::add_default_pdo_mappings(Slave& slave, uint16_t profile) {
+  // Mapped entries for TPDO1 and RPDO1: address and size in bits
+  using MappedEntries = std::vector<std::pair<Address, uint8_t>>;
+  MappedEntries transmit;
+  MappedEntries receive;
+
+  if (profile == 401) {
+    transmit = {{{0x6000, 1}, 8}, {{0x6000, 2}, 8}};
+    receive = {{{0x6200, 1}, 8}, {{0x6200, 2}, 8}};
+  } else if (profile == 402) {
+    transmit = {{{0x6041, 0}, 16}, {{0x6064, 0}, 32}};
+    receive = {{{0x6040, 0}, 16}, {{0x607A, 0}, 32}};
+  } else {
+    return;
+  }
+
+  const auto write_mapping = [&slave](uint16_t mapping_index,
+                                      const MappedEntries& entries) {
+    if (!slave.has_entry(mapping_index, 0) ||
+        slave.get_entry_type(mapping_index, 0) != Type::uint8) {
+      return;
+    }
+    if (static_cast<uint8_t>(slave.get_entry(mapping_index, 0)) != 0) {
+      // The EDS file has its own mapping.
+      return;
+    }
+
+    uint8_t subindex = 0;
+    for (const auto& entry : entries) {
+      const Address& address = entry.first;
+      if (!slave.has_entry(address.index, address.subindex) ||
+          !slave.has_entry(mapping_index, subindex + 1) ||
+          slave.get_entry_type(mapping_index, subindex + 1) != Type::uint32) {
+        continue;
+      }
+      ++subindex;
+      slave.set_entry(mapping_index, subindex,
+                      static_cast<uint32_t>((address.index << 16) |
+                                            (address.subindex << 8) |
+                                            entry.second));
+    }
+    slave.set_entry(mapping_index, 0, subindex);
+  };
+
+  write_mapping(0x1A00, transmit);
+  write_mapping(0x1600, receive);
+}
+
+void DeviceFarm::add_profile_reactions(Slave& slave, uint16_t profile) {
+  const auto echo = [&slave](const Address& from, const Address& to) {
+    if (slave.has_entry(from.index, from.subindex) &&
+        slave.has_entry(to.index, to.subindex) &&
+        slave.get_entry_type(from.index, from.subindex) ==
+            slave.get_entry_type(to.index, to.subindex)) {
+      slave.add_value_changed_callback(
+          from.index, from.subindex, [&slave, to](const Value& value) {
+            slave.set_entry(to.index, to.subindex, value);
+          });
+    }
+  };
+
+  if (profile == 401) {
+    // digital outputs -> digital inputs (8, 16 and 32 bit)
+    for (uint16_t offset = 0; offset < 3; ++offset) {
+      for (uint16_t subindex = 1; subindex <= 0xFE; ++subindex) {
+        echo({static_cast<uint16_t>(0x6200 + offset * 0x20),
+              static_cast<uint8_t>(subindex)},
+             {static_cast<uint16_t>(0x6000 + offset * 0x20),
+              static_cast<uint8_t>(subindex)});
+      }
+    }
+
+  } else if (profile == 402) {
+    echo({0x607A, 0}, {0x6064, 0});  // target -> actual position
+    echo({0x60FF, 0}, {0x606C, 0});  // target -> actual velocity
+    echo({0x6071, 0}, {0x6077, 0});  // target -> actual torque
+    echo({0x6060, 0}, {0x6061, 0});  // modes of operation -> display
+
+    if (slave.has_entry(0x6040) && slave.has_entry(0x6041) &&
+        slave.get_entry_type(0x6040) == Type::uint16 &&
+        slave.get_entry_type(0x6041) == Type::uint16) {
+      // Simplified CiA 402 power state machine: the statusword directly
+      // follows the controlword command.
+      slave.set_entry(0x6041, 0, static_cast<uint16_t>(0x0240));
+      slave.add_value_changed_callback(0x6040, 0, [&slave](const Value& value) {
+        const uint16_t controlword = value;
+        uint16_t statusword = 0x0040;  // switch on disabled
+        if ((controlword & 0x0080) || !(controlword & 0x0002)) {
+          // fault reset or disable voltage
+        } else if (!(controlword & 0x0004)) {
+          // quick stop
+          statusword = 0x0007;
+        } else if ((controlword & 0x000F) == 0x000F) {
+          // enable operation
+          statusword = 0x0437;
+        } else if ((controlword & 0x0007) == 0x0007) {
+          // switch on
+          statusword = 0x0033;
+        } else if ((controlword & 0x0007) == 0x0006) {
+          // shutdown
+          statusword = 0x0031;
+        }
+        slave.set_entry(0x6041, 0, static_cast<uint16_t>(statusword | 0x0200));
+      });
+    }
+  }
+}
+
+DeviceFarm::Node* DeviceFarm::find_node(uint8_t node_id) {
+  for (const auto& node : m_nodes) {
+    if (node->slave->get_node_id() == node_id) {
+      return node.get();
+    }
+  }
+  return nullptr;
+}
+
+}  // end namespace kaco
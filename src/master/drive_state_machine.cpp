@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/drive_state_machine.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/dictionary_error.h"
+
+namespace kaco {
+
+DriveStateMachine::DriveStateMachine(Device& device)
+    : m_device(device) {
+  if (!m_device.has_entry("statusword")) {
+    throw dictionary_error(dictionary_error::type::unknown_entry,
+                           "statusword");
+  }
+  if (!m_device.has_entry("controlword")) {
+    throw dictionary_error(dictionary_error::type::unknown_entry,
+                           "controlword");
+  }
+
+  try {
+    m_controlword = m_device.get_entry("controlword", ReadAccessMethod::cache);
+  } catch (const canopen_error&) {
+    // no value yet
+  }
+  try {
+    const uint16_t statusword =
+        m_device.get_entry("statusword", ReadAccessMethod::cache);
+    m_state = decode_state(statusword);
+  } catch (const canopen_error&) {
+    // no statusword received yet
+  }
+
+  m_callback_id = m_device.add_value_changed_callback(
+      "statusword",
+      [this](const Value& value) { statusword_changed(value); });
+}
+
+DriveStateMachine::~DriveStateMachine() {
+  m_device.remove_value_changed_callback("statusword", m_callback_id);
+}
+
+void DriveStateMachine::request(State target) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_target = target;
+  send_transition();
+}
+
+bool DriveStateMachine::wait(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  const bool reached = m_condition.wait_for(lock, timeout, [this] {
+    return m_state == m_target ||
+           (m_state == State::fault && !m_auto_fault_reset);
+  });
+  return reached && m_state == m_target;
+}
+
+std::future<bool> DriveStateMachine::request_async(
+    State target, std::chrono::milliseconds timeout) {
+  request(target);
+  return std::async(std::launch::async,
+                    [this, timeout]() { return wait(timeout); });
+}
+
+void DriveStateMachine::set_auto_fault_reset(bool enabled) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_auto_fault_reset = enabled;
+}
+
+void DriveStateMachine::reset_fault() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_controlword & 0x0080) {
+    send_controlword(0x0000);
+  }
+  send_controlword(0x0080);
+}
+
+DriveStateMachine::State DriveStateMachine::get_state() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_state;
+}
+
+DriveStateMachine::State DriveStateMachine::get_target() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_target;
+}
+
+void DriveStateMachine::add_state_changed_callback(
+    const StateChangedCallback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_callbacks.push_back(callback);
+}
+
+DriveStateMachine::State DriveStateMachine::decode_state(uint16_t statusword) {
+  if ((statusword & 0x4F) == 0x00) {
+    return State::not_ready_to_switch_on;
+  } else if ((statusword & 0x4F) == 0x40) {
+    return State::switch_on_disabled;
+  } else if ((statusword & 0x6F) == 0x21) {
+    return State::ready_to_switch_on;
+  } else if ((statusword & 0x6F) == 0x23) {
+    return State::switched_on;
+  } else if ((statusword & 0x6F) == 0x27) {
+    return State::operation_enabled;
+  } else if ((statusword & 0x6F) == 0x07) {
+    return State::quick_stop_active;
+  } else if ((statusword & 0x4F) == 0x0F) {
+    return State::fault_reaction_active;
+  } else if ((statusword & 0x4F) == 0x08) {
+    return State::fault;
+  }
+  return State::unknown;
+}
+
+uint16_t DriveStateMachine::next_command(State current, State target) {
+  if (current == State::fault) {
+    // fault reset
+    return 0x0080;
+  }
+
+  switch (target) {
+    case State::operation_enabled:
+      switch (current) {
+        case State::switch_on_disabled:
+          return 0x0006;  // shutdown
+        case State::ready_to_switch_on:
+          return 0x0007;  // switch on
+        case State::switched_on:
+        case State::operation_enabled:
+          return 0x000F;  // enable operation
+        default:
+          return 0x0000;  // disable voltage
+      }
+    case State::switched_on:
+      switch (current) {
+        case State::switch_on_disabled:
+          return 0x0006;  // shutdown
+        case State::ready_to_switch_on:
+        case State::switched_on:
+        case State::operation_enabled:
+          return 0x0007;  // switch on / disable operation
+        default:
+          return 0x0000;  // disable voltage
+      }
+    case State::ready_to_switch_on:
+      switch (current) {
+        case State::switch_on_disabled:
+        case State::ready_to_switch_on:
+        case State::switched_on:
+        case State::operation_enabled:
+          return 0x0006;  // shutdown
+        default:
+          return 0x0000;  // disable voltage
+      }
+    case State::quick_stop_active:
+      if (current == State::operation_enabled ||
+          current == State::quick_stop_active) {
+        return 0x0002;  // quick stop
+      }
+      return 0x0000;  // disable voltage
+    default:
+      return 0x0000;  // disable voltage
+  }
+}
+
+const char* DriveStateMachine::state_to_string(State state) {
+  switch (state) {
+    case State::not_ready_to_switch_on:
+      return "not ready to switch on";
+    case State::switch_on_disabled:
+      return "switch on disabled";
+    case State::ready_to_switch_on:
+      return "ready to switch on";
+    case State::switched_on:
+      return "switched on";
+    case State::operation_enabled:
+      return "operation enabled";
+    case State::quick_stop_active:
+      return "quick stop active";
+    case State::fault_reaction_active:
+      return "fault reaction active";
+    case State::fault:
+      return "fault";
+    default:
+      return "unknown";
+  }
+}
+
+void DriveStateMachine::statusword_changed(uint16_t statusword) {
+  std::vector<StateChangedCallback> callbacks;
+  State state;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    state = decode_state(statusword);
+    if (state == m_state) {
+      // e.g. only a mode specific bit changed
+      return;
+    }
+
+    DEBUG_LOG("[DriveStateMachine] Node " << (unsigned)m_device.get_node_id()
+                                          << ": " << state_to_string(m_state)
+                                          << " -> " << state_to_string(state));
+    m_state = state;
+    send_transition();
+    callbacks = m_callbacks;
+  }
+
+  m_condition.notify_all();
+  for (const StateChangedCallback& callback : callbacks) {
+    callback(state);
+  }
+}
+
+void DriveStateMachine::send_transition() {
+  if (m_target == State::unknown || m_state == m_target) {
+    return;
+  }
+
+  switch (m_state) {
+    case State::unknown:
+    case State::not_ready_to_switch_on:
+    case State::fault_reaction_active:
+      // automatic transitions, wait for the next statusword
+      return;
+    case State::fault:
+      if (!m_auto_fault_reset) {
+        return;
+      }
+      // generate a rising edge of bit 7
+      if (m_controlword & 0x0080) {
+        send_controlword(0x0000);
+      }
+      send_controlword(0x0080);
+      return;
+    default:
+      send_controlword(next_command(m_state, m_target));
+      return;
+  }
+}
+
+void DriveStateMachine::send_controlword(uint16_t command) {
+  m_controlword = (m_controlword & ~0x008F) | command;
+  m_device.set_entry("controlword", m_controlword, WriteAccessMethod::pdo);
+}
+
+}  // end namespace kaco
@@ -40,7 +40,7 @@
 #include <string>
 #include <utility>
 
-#include <boost/algorithm/string/predicate.hpp>  // string::starts_with()
+#include <boost/algorithm/string/predicate.hpp>  // string::starts_with(), iequals()
 #include <boost/algorithm/string/trim.hpp>       // trim()
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/property_tree/ptree.hpp>  // property_tree
@@ -104,6 +104,135 @@ bool EDSReader::import_entries() {
   return success;
 }
 
+bool EDSReader::import_default_values(uint8_t node_id) {
+  const std::regex index_regex("[[:xdigit:]]{1,4}");
+  const std::regex subindex_regex("([[:xdigit:]]{1,4})sub([[:xdigit:]]{1,2})");
+
+  for (const auto& section_node : m_ini) {
+    const std::string& section_name = section_node.first;
+    Address address;
+    std::smatch matches;
+
+    if (std::regex_match(section_name, index_regex)) {
+      address = Address{(uint16_t)Utils::hexstr_to_uint(section_name), 0};
+    } else if (std::regex_match(section_name, matches, subindex_regex)) {
+      assert(matches.size() > 2);
+      address = Address{(uint16_t)Utils::hexstr_to_uint(matches[1]),
+                        (uint8_t)Utils::hexstr_to_uint(matches[2])};
+    } else {
+      continue;
+    }
+
+    const auto it = m_dictionary.find(address);
+    if (it == m_dictionary.end()) {
+      // e.g. array/record sections or unsupported data types
+      continue;
+    }
+
+    const std::string str_default_value =
+        trim(m_ini.get(section_name + ".DefaultValue", ""));
+    if (str_default_value.empty()) {
+      continue;
+    }
+
+    Entry& entry = it->second;
+    Value value;
+    if (!parse_default_value(str_default_value, entry.type, node_id, value)) {
+      DEBUG_LOG("[EDSReader::import_default_values] "
+                << entry.name << ": Ignoring unsupported default value \""
+                << str_default_value << "\".");
+      continue;
+    }
+
+    entry.set_value(value);
+  }
+
+  return true;
+}
+
+bool EDSReader::parse_default_value(const std::string& str, Type type,
+                                    uint8_t node_id, Value& value) const {
+  if (type == Type::string) {
+    value = Value(str);
+    return true;
+  }
+
+  if (type == Type::octet_string || type == Type::invalid) {
+    return false;
+  }
+
+  try {
+    if (type == Type::real32 || type == Type::real64) {
+      size_t pos = 0;
+      const double number = std::stod(str, &pos);
+      if (pos != str.size()) {
+        return false;
+      }
+      value = (type == Type::real32) ? Value((float)number) : Value(number);
+      return true;
+    }
+
+    // Integers may be sums containing $NODEID (e.g. "$NODEID+0x180").
+    long long number = 0;
+    std::string::size_type begin = 0;
+    while (begin <= str.size()) {
+      std::string::size_type end = str.find('+', begin);
+      if (end == std::string::npos) {
+        end = str.size();
+      }
+      std::string term = str.substr(begin, end - begin);
+      boost::algorithm::trim(term);
+      if (boost::algorithm::iequals(term, "$NODEID")) {
+        number += node_id;
+      } else {
+        size_t pos = 0;
+        number += std::stoll(term, &pos, 0);
+        if (pos != term.size()) {
+          return false;
+        }
+      }
+      begin = end + 1;
+    }
+
+    switch (type) {
+      case Type::uint8:
+        value = Value((uint8_t)number);
+        break;
+      case Type::uint16:
+        value = Value((uint16_t)number);
+        break;
+      case Type::uint32:
+        value = Value((uint32_t)number);
+        break;
+      case Type::uint64:
+        value = Value((uint64_t)number);
+        break;
+      case Type::int8:
+        value = Value((int8_t)number);
+        break;
+      case Type::int16:
+        value = Value((int16_t)number);
+        break;
+      case Type::int32:
+        value = Value((int32_t)number);
+        break;
+      case Type::int64:
+        value = Value((int64_t)number);
+        break;
+      case Type::boolean:
+        value = Value(number != 0);
+        break;
+      default:
+        return false;
+    }
+    return true;
+
+  } catch (const std::exception&) {
+    // std::invalid_argument or std::out_of_range
+    return false;
+  }
+}
+
 bool EDSReader::parse_index(const std::string& section, uint16_t index) {
   std::string str_object_type = trim(m_ini.get(section + ".ObjectType", ""));
 
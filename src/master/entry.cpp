@@ -31,6 +31,7 @@
 
 #include "kacanopen/master/entry.h"
 #include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/probes.h"
 
 #include <cassert>
 #include <future>
@@ -82,13 +83,15 @@ void Entry::set_value(const Value& value) {
     m_valid = true;
   }
 
+  KACO_PROBE3(entry_set_value, index, subindex, value_changed);
+
   if (value_changed) {
     std::lock_guard<std::mutex> lock(*m_value_changed_callbacks_mutex);
-    for (auto& callback : m_value_changed_callbacks) {
+    for (auto& receiver : m_value_changed_callbacks) {
       // TODO: currently callbacks are only internal and it's ok to call them
       // synchonously.
       // std::async(std::launch::async, callback, value);
-      callback(value);
+      receiver.callback(value);
     }
   }
 }
@@ -106,9 +109,22 @@ bool Entry::valid() const { return m_valid; }
 
 Type Entry::get_type() const { return type; }
 
-void Entry::add_value_changed_callback(ValueChangedCallback callback) {
+uint32_t Entry::add_value_changed_callback(ValueChangedCallback callback) {
+  std::lock_guard<std::mutex> lock(*m_value_changed_callbacks_mutex);
+  const uint32_t id = m_next_callback_id++;
+  m_value_changed_callbacks.push_back({id, std::move(callback)});
+  return id;
+}
+
+void Entry::remove_value_changed_callback(uint32_t id) {
   std::lock_guard<std::mutex> lock(*m_value_changed_callbacks_mutex);
-  m_value_changed_callbacks.push_back(std::move(callback));
+  for (auto it = m_value_changed_callbacks.begin();
+       it != m_value_changed_callbacks.end(); ++it) {
+    if (it->id == id) {
+      m_value_changed_callbacks.erase(it);
+      break;
+    }
+  }
 }
 
 void Entry::print() const {
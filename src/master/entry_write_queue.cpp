@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/entry_write_queue.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/utils.h"
+
+namespace kaco {
+
+EntryWriteQueue::EntryWriteQueue(Device& device)
+    : m_device(device), m_thread(&EntryWriteQueue::run, this) {}
+
+EntryWriteQueue::~EntryWriteQueue() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    if (!m_pending.empty()) {
+      WARN("[EntryWriteQueue] Discarding " << m_pending.size()
+                                           << " pending values of device "
+                                           << (unsigned)m_device.get_node_id()
+                                           << ".");
+    }
+    m_pending.clear();
+    m_order.clear();
+  }
+  m_condition.notify_all();
+  m_thread.join();
+}
+
+std::shared_ptr<EntryWriteQueue> EntryWriteQueue::shared(Device& device) {
+  static std::mutex mutex;
+  static std::map<Device*, std::weak_ptr<EntryWriteQueue>> queues;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<EntryWriteQueue> queue = queues[&device].lock();
+  if (!queue) {
+    queue = std::make_shared<EntryWriteQueue>(device);
+    queues[&device] = queue;
+  }
+  return queue;
+}
+
+void EntryWriteQueue::push(const std::string& entry_name, const Value& value,
+                           WriteAccessMethod access_method) {
+  const std::string name = Utils::escape(entry_name);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_statistics.pushed;
+    auto it = m_pending.find(name);
+    if (it != m_pending.end()) {
+      ++m_statistics.coalesced;
+      it->second = Pending{value, access_method};
+      return;
+    }
+    m_pending.emplace(name, Pending{value, access_method});
+    m_order.push_back(name);
+  }
+  m_condition.notify_one();
+}
+
+void EntryWriteQueue::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle_condition.wait(
+      lock, [this] { return (m_order.empty() && !m_writing) || !m_running; });
+}
+
+size_t EntryWriteQueue::get_pending() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_order.size();
+}
+
+EntryWriteQueue::Statistics EntryWriteQueue::get_statistics() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_statistics;
+}
+
+void EntryWriteQueue::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_condition.wait(lock, [this] { return !m_order.empty() || !m_running; });
+    if (!m_running) {
+      break;
+    }
+
+    const std::string name = std::move(m_order.front());
+    m_order.pop_front();
+    auto it = m_pending.find(name);
+    const Pending pending = std::move(it->second);
+    m_pending.erase(it);
+    m_writing = true;
+    lock.unlock();
+
+    bool success = true;
+    try {
+      m_device.set_entry(name, pending.value, pending.access_method);
+    } catch (const canopen_error& error) {
+      ERROR("[EntryWriteQueue] Writing " << name << " of device "
+                                         << (unsigned)m_device.get_node_id()
+                                         << " failed: " << error.what());
+      success = false;
+    }
+
+    lock.lock();
+    m_writing = false;
+    if (success) {
+      ++m_statistics.written;
+    } else {
+      ++m_statistics.failed;
+    }
+    if (m_order.empty()) {
+      m_idle_condition.notify_all();
+    }
+  }
+
+  m_idle_condition.notify_all();
+}
+
+}  // end namespace kaco
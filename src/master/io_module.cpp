@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/io_module.h"
+#include "kacanopen/core/logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace kaco {
+
+namespace {
+
+/// Writes count bits (count <= 64) of value into the packed bitfield at
+/// bit first and records changed bits in changed.
+void write_bits(std::vector<uint64_t>& words, std::vector<uint64_t>& changed,
+                size_t first, size_t count, uint64_t value) {
+  const size_t word = first / 64;
+  const size_t shift = first % 64;
+  const uint64_t mask =
+      (count >= 64) ? std::numeric_limits<uint64_t>::max() : ((1ULL << count) - 1);
+
+  const auto apply = [&](size_t index, uint64_t bits, uint64_t bit_mask) {
+    const uint64_t old_word = words[index];
+    const uint64_t new_word = (old_word & ~bit_mask) | (bits & bit_mask);
+    changed[index] |= old_word ^ new_word;
+    words[index] = new_word;
+  };
+
+  apply(word, value << shift, mask << shift);
+  if (shift > 0 && shift + count > 64) {
+    apply(word + 1, value >> (64 - shift), mask >> (64 - shift));
+  }
+}
+
+/// Reads count bits (count <= 64) from the packed bitfield at bit first.
+uint64_t read_bits(const std::vector<uint64_t>& words, size_t first,
+                   size_t count) {
+  const size_t word = first / 64;
+  const size_t shift = first % 64;
+  const uint64_t mask =
+      (count >= 64) ? std::numeric_limits<uint64_t>::max() : ((1ULL << count) - 1);
+
+  uint64_t value = words[word] >> shift;
+  if (shift > 0 && shift + count > 64) {
+    value |= words[word + 1] << (64 - shift);
+  }
+  return value & mask;
+}
+
+size_t words_for(size_t channels) { return (channels + 63) / 64; }
+
+}  // end anonymous namespace
+
+IOModule::IOModule(Device& device)
+    : m_device(device), m_core(device.get_core()) {}
+
+IOModule::~IOModule() {
+  for (uint32_t id : m_pdo_callback_ids) {
+    m_core.pdo.remove_pdo_received_callback(id);
+  }
+}
+
+void IOModule::configure() {
+  for (uint16_t pdo = 0; pdo < 4; ++pdo) {
+    for (bool transmit : {true, false}) {
+      const uint16_t communication_index = (transmit ? 0x1800 : 0x1400) + pdo;
+      const uint16_t mapping_index = (transmit ? 0x1A00 : 0x1600) + pdo;
+      if (!m_device.has_entry(communication_index, 1) ||
+          !m_device.has_entry(mapping_index, 0)) {
+        continue;
+      }
+
+      const uint32_t cob_id_entry = m_device.get_entry(
+          communication_index, 1, ReadAccessMethod::sdo);
+      if (cob_id_entry & 0x80000000) {
+        // PDO not valid
+        continue;
+      }
+      const uint16_t cob_id = cob_id_entry & 0x7FF;
+      const uint8_t count =
+          m_device.get_entry(mapping_index, 0, ReadAccessMethod::sdo);
+
+      size_t bit_offset = 0;
+      for (uint8_t subindex = 1; subindex <= count; ++subindex) {
+        const uint32_t mapping = m_device.get_entry(mapping_index, subindex,
+                                                    ReadAccessMethod::sdo);
+        const uint16_t index = mapping >> 16;
+        const uint8_t entry_subindex = (mapping >> 8) & 0xFF;
+        const uint8_t bits = mapping & 0xFF;
+        const size_t offset = bit_offset;
+        bit_offset += bits;
+
+        if (offset % 8 != 0 || bits == 0 || bits % 8 != 0 ||
+            entry_subindex == 0 || offset + bits > 64) {
+          DEBUG_LOG("[IOModule::configure] Skipping mapping 0x"
+                    << std::hex << mapping << ".");
+          continue;
+        }
+
+        const uint8_t byte_offset = offset / 8;
+        const uint8_t bytes = bits / 8;
+        const uint16_t group = transmit ? index : index - 0x200;
+
+        if (group == 0x6000 || group == 0x6100 || group == 0x6120) {
+          // 8, 16 or 32 bit view of the same digital channels
+          const size_t first_channel = (entry_subindex - 1) * bits;
+          if (transmit) {
+            map_digital_inputs(cob_id, byte_offset, bytes, first_channel);
+          } else {
+            map_digital_outputs(cob_id, byte_offset, bytes, first_channel);
+          }
+        } else if (index == (transmit ? 0x6401 : 0x6411) && bits == 16) {
+          if (transmit) {
+            map_analog_inputs(cob_id, byte_offset, 1, entry_subindex - 1);
+          } else {
+            map_analog_outputs(cob_id, byte_offset, 1, entry_subindex - 1);
+          }
+        } else {
+          DEBUG_LOG("[IOModule::configure] Skipping mapping 0x"
+                    << std::hex << mapping << ".");
+        }
+      }
+    }
+  }
+}
+
+void IOModule::map_digital_inputs(uint16_t cob_id, uint8_t byte_offset,
+                                  uint8_t num_bytes, size_t first_channel) {
+  assert(byte_offset + num_bytes <= 8);
+  Frame& frame = get_frame(m_input_frames, cob_id);
+  frame.digital.push_back({byte_offset, num_bytes, first_channel});
+  frame.length = std::max<uint8_t>(frame.length, byte_offset + num_bytes);
+  resize_inputs(std::max(m_digital_input_count, first_channel + num_bytes * 8),
+                m_analog_input_count);
+}
+
+void IOModule::map_analog_inputs(uint16_t cob_id, uint8_t byte_offset,
+                                 uint8_t num_channels, size_t first_channel) {
+  assert(byte_offset + 2 * num_channels <= 8);
+  Frame& frame = get_frame(m_input_frames, cob_id);
+  frame.analog.push_back({byte_offset, num_channels, first_channel});
+  frame.length = std::max<uint8_t>(frame.length, byte_offset + 2 * num_channels);
+  resize_inputs(m_digital_input_count,
+                std::max(m_analog_input_count, first_channel + num_channels));
+}
+
+void IOModule::map_digital_outputs(uint16_t cob_id, uint8_t byte_offset,
+                                   uint8_t num_bytes, size_t first_channel) {
+  assert(byte_offset + num_bytes <= 8);
+  std::lock_guard<std::mutex> lock(m_outputs_mutex);
+  Frame& frame = get_frame(m_output_frames, cob_id);
+  frame.digital.push_back({byte_offset, num_bytes, first_channel});
+  frame.length = std::max<uint8_t>(frame.length, byte_offset + num_bytes);
+  resize_outputs(std::max(m_digital_output_count, first_channel + num_bytes * 8),
+                 m_analog_output_count);
+}
+
+void IOModule::map_analog_outputs(uint16_t cob_id, uint8_t byte_offset,
+                                  uint8_t num_channels, size_t first_channel) {
+  assert(byte_offset + 2 * num_channels <= 8);
+  std::lock_guard<std::mutex> lock(m_outputs_mutex);
+  Frame& frame = get_frame(m_output_frames, cob_id);
+  frame.analog.push_back({byte_offset, num_channels, first_channel});
+  frame.length = std::max<uint8_t>(frame.length, byte_offset + 2 * num_channels);
+  resize_outputs(m_digital_output_count,
+                 std::max(m_analog_output_count, first_channel + num_channels));
+}
+
+void IOModule::set_analog_input_scaling(float gain, float offset) {
+  std::lock_guard<std::mutex> lock(m_inputs_mutex);
+  std::fill(m_input_gain.begin(), m_input_gain.end(), gain);
+  std::fill(m_input_offset.begin(), m_input_offset.end(), offset);
+}
+
+void IOModule::set_analog_input_scaling(size_t channel, float gain,
+                                        float offset) {
+  std::lock_guard<std::mutex> lock(m_inputs_mutex);
+  m_input_gain.at(channel) = gain;
+  m_input_offset.at(channel) = offset;
+}
+
+void IOModule::set_analog_output_scaling(float gain, float offset) {
+  std::lock_guard<std::mutex> lock(m_outputs_mutex);
+  std::fill(m_output_gain.begin(), m_output_gain.end(), gain);
+  std::fill(m_output_offset.begin(), m_output_offset.end(), offset);
+}
+
+void IOModule::set_analog_output_scaling(size_t channel, float gain,
+                                         float offset) {
+  std::lock_guard<std::mutex> lock(m_outputs_mutex);
+  m_output_gain.at(channel) = gain;
+  m_output_offset.at(channel) = offset;
+}
+
+void IOModule::set_analog_deadband(uint16_t counts) {
+  std::lock_guard<std::mutex> lock(m_inputs_mutex);
+  m_analog_deadband = counts;
+}
+
+void IOModule::set_input_callback(const InputCallback& callback) {
+  m_input_callback = callback;
+}
+
+IOModule::InputImage IOModule::get_inputs() const {
+  std::lock_guard<std::mutex> lock(m_inputs_mutex);
+  return m_inputs;
+}
+
+size_t IOModule::get_digital_input_count() const {
+  return m_digital_input_count;
+}
+
+size_t IOModule::get_analog_input_count() const {
+  return m_analog_input_count;
+}
+
+size_t IOModule::get_digital_output_count() const {
+  return m_digital_output_count;
+}
+
+size_t IOModule::get_analog_output_count() const {
+  return m_analog_output_count;
+}
+
+void IOModule::set_digital_output(size_t channel, bool value) {
+  set_digital_outputs(channel / 64, static_cast<uint64_t>(value) << (channel % 64),
+                      1ULL << (channel % 64));
+}
+
+void IOModule::set_digital_outputs(size_t word, uint64_t values,
+                                   uint64_t mask) {
+  std::lock_guard<std::mutex> lock(m_outputs_mutex);
+  uint64_t& current = m_digital_outputs.at(word);
+  const uint64_t changed = (current ^ values) & mask;
+  if (changed == 0) {
+    return;
+  }
+  current ^= changed;
+  for (size_t bit = 0; bit < 64; ++bit) {
+    if ((changed >> bit) & 1) {
+      mark_dirty(word * 64 + bit, true);
+    }
+  }
+}
+
+void IOModule::set_analog_output(size_t channel, float value) {
+  int16_t raw;
+  {
+    std::lock_guard<std::mutex> lock(m_outputs_mutex);
+    const float gain = m_output_gain.at(channel);
+    const float scaled =
+        std::round((value - m_output_offset[channel]) / (gain != 0 ? gain : 1));
+    raw = static_cast<int16_t>(std::max<float>(
+        std::numeric_limits<int16_t>::min(),
+        std::min<float>(std::numeric_limits<int16_t>::max(), scaled)));
+  }
+  set_analog_output_raw(channel, raw);
+}
+
+void IOModule::set_analog_output_raw(size_t channel, int16_t value) {
+  std::lock_guard<std::mutex> lock(m_outputs_mutex);
+  if (m_analog_outputs.at(channel) != value) {
+    m_analog_outputs[channel] = value;
+    mark_dirty(channel, false);
+  }
+}
+
+size_t IOModule::flush(bool all) {
+  std::vector<Message> messages;
+
+  {
+    std::lock_guard<std::mutex> lock(m_outputs_mutex);
+    for (Frame& frame : m_output_frames) {
+      if (!all && !frame.dirty) {
+        continue;
+      }
+      frame.dirty = false;
+
+      Message message;
+      message.cob_id = frame.cob_id;
+      message.rtr = false;
+      message.len = frame.length;
+      std::fill(message.data, message.data + 8, 0);
+
+      for (const Segment& segment : frame.digital) {
+        const uint64_t value =
+            read_bits(m_digital_outputs, segment.first_channel, segment.size * 8);
+        for (uint8_t i = 0; i < segment.size; ++i) {
+          message.data[segment.byte_offset + i] = (value >> (8 * i)) & 0xFF;
+        }
+      }
+      for (const Segment& segment : frame.analog) {
+        for (uint8_t i = 0; i < segment.size; ++i) {
+          const uint16_t raw = m_analog_outputs[segment.first_channel + i];
+          message.data[segment.byte_offset + 2 * i] = raw & 0xFF;
+          message.data[segment.byte_offset + 2 * i + 1] = raw >> 8;
+        }
+      }
+      messages.push_back(message);
+    }
+  }
+
+  m_core.send(messages);
+  return messages.size();
+}
+
+IOModule::Frame& IOModule::get_frame(std::vector<Frame>& frames,
+                                     uint16_t cob_id) {
+  for (Frame& frame : frames) {
+    if (frame.cob_id == cob_id) {
+      return frame;
+    }
+  }
+
+  frames.emplace_back();
+  frames.back().cob_id = cob_id;
+
+  if (&frames == &m_input_frames) {
+    const size_t frame_index = frames.size() - 1;
+    m_pdo_callback_ids.push_back(m_core.pdo.add_pdo_received_callback(
+        cob_id, [this, frame_index](const std::vector<uint8_t>& data) {
+          process_frame(frame_index, data);
+        }));
+  }
+
+  return frames.back();
+}
+
+void IOModule::process_frame(size_t frame_index,
+                             const std::vector<uint8_t>& data) {
+  const Frame& frame = m_input_frames[frame_index];
+  if (data.size() < frame.length) {
+    DEBUG_LOG("[IOModule::process_frame] PDO 0x"
+              << std::hex << frame.cob_id << " too short: " << std::dec
+              << data.size() << " < " << (unsigned)frame.length << ".");
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_inputs_mutex);
+    InputImage& image = m_inputs;
+    std::fill(image.digital_changed.begin(), image.digital_changed.end(), 0);
+    std::fill(image.analog_changed.begin(), image.analog_changed.end(), 0);
+
+    for (const Segment& segment : frame.digital) {
+      uint64_t value = 0;
+      for (uint8_t i = 0; i < segment.size; ++i) {
+        value |= static_cast<uint64_t>(data[segment.byte_offset + i]) << (8 * i);
+      }
+      write_bits(image.digital, image.digital_changed, segment.first_channel,
+                 segment.size * 8, value);
+    }
+
+    for (const Segment& segment : frame.analog) {
+      const size_t first = segment.first_channel;
+      const size_t last = first + segment.size;
+
+      for (size_t channel = first; channel < last; ++channel) {
+        const size_t byte = segment.byte_offset + 2 * (channel - first);
+        const int16_t raw =
+            static_cast<int16_t>(data[byte] | (data[byte + 1] << 8));
+        image.analog_raw[channel] = raw;
+        if (std::abs(raw - m_analog_reported[channel]) > m_analog_deadband) {
+          m_analog_reported[channel] = raw;
+          image.analog_changed[channel / 64] |= 1ULL << (channel % 64);
+        }
+      }
+
+      // Plain loop over contiguous arrays so that the compiler can vectorize
+      // the scaling.
+      const int16_t* raw = image.analog_raw.data();
+      const float* gain = m_input_gain.data();
+      const float* offset = m_input_offset.data();
+      float* value = image.analog.data();
+      for (size_t channel = first; channel < last; ++channel) {
+        value[channel] = raw[channel] * gain[channel] + offset[channel];
+      }
+    }
+
+    ++image.frames;
+    if (m_input_callback) {
+      m_callback_inputs = m_inputs;
+    }
+  }
+
+  if (m_input_callback) {
+    m_input_callback(m_callback_inputs);
+  }
+}
+
+void IOModule::resize_inputs(size_t digital_channels, size_t analog_channels) {
+  std::lock_guard<std::mutex> lock(m_inputs_mutex);
+  m_digital_input_count = digital_channels;
+  m_analog_input_count = analog_channels;
+  m_inputs.digital.resize(words_for(digital_channels), 0);
+  m_inputs.digital_changed.resize(words_for(digital_channels), 0);
+  m_inputs.analog_raw.resize(analog_channels, 0);
+  m_inputs.analog.resize(analog_channels, 0);
+  m_inputs.analog_changed.resize(words_for(analog_channels), 0);
+  m_analog_reported.resize(analog_channels, 0);
+  m_input_gain.resize(analog_channels, 1);
+  m_input_offset.resize(analog_channels, 0);
+}
+
+void IOModule::resize_outputs(size_t digital_channels,
+                              size_t analog_channels) {
+  m_digital_output_count = digital_channels;
+  m_analog_output_count = analog_channels;
+  m_digital_outputs.resize(words_for(digital_channels), 0);
+  m_analog_outputs.resize(analog_channels, 0);
+  m_output_gain.resize(analog_channels, 1);
+  m_output_offset.resize(analog_channels, 0);
+}
+
+void IOModule::mark_dirty(size_t channel, bool digital) {
+  for (Frame& frame : m_output_frames) {
+    for (const Segment& segment : digital ? frame.digital : frame.analog) {
+      const size_t count = digital ? segment.size * 8 : segment.size;
+      if (channel >= segment.first_channel &&
+          channel < segment.first_channel + count) {
+        frame.dirty = true;
+      }
+    }
+  }
+}
+
+}  // end namespace kaco
@@ -73,19 +73,35 @@ bool Master::start(const std::string busname, const unsigned baudrate) {
   return true;
 }
 
+bool Master::start(VirtualBus &bus) {
+  bool success = core.start(bus);
+  if (!success) {
+    return false;
+  }
+  m_running = true;
+  core.nmt.discover_nodes();
+  return true;
+}
+
 void Master::stop() {
   m_running = false;
   core.stop();
 }
 
-size_t Master::num_devices() const { return m_devices.size(); }
+size_t Master::num_devices() const {
+  std::lock_guard<std::mutex> scoped_lock(m_devices_mutex);
+  return m_devices.size();
+}
 
 Device &Master::get_device(size_t index) const {
+  std::lock_guard<std::mutex> scoped_lock(m_devices_mutex);
   assert(m_devices.size() > index);
   return *(m_devices.at(index).get());
 }
 
 void Master::device_alive_callback(const uint8_t node_id) {
+  // Alive callbacks of different nodes run concurrently.
+  std::lock_guard<std::mutex> scoped_lock(m_devices_mutex);
   if (!m_device_alive.test(node_id)) {
     m_device_alive.set(node_id);
     m_devices.emplace_back(new Device(core, node_id));
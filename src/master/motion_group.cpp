@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/motion_group.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+namespace kaco {
+
+size_t MotionGroup::add_axis(CyclicDrive& drive) {
+  if (drive.get_mode() != CyclicDrive::Mode::position) {
+    throw canopen_error("[MotionGroup::add_axis] Node " +
+                        std::to_string(drive.get_device().get_node_id()) +
+                        " is not in cyclic synchronous position mode.");
+  }
+
+  const size_t index = m_axes.size();
+  Axis axis;
+  axis.drive = &drive;
+  m_axes.push_back(axis);
+
+  {
+    std::lock_guard<std::mutex> lock(m_committed_mutex);
+    m_committed.push_back(0);
+    m_committed_valid.push_back(false);
+  }
+  m_cycle_targets.push_back(0);
+  m_cycle_targets_valid.push_back(false);
+
+  {
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    m_statistics.emplace_back();
+  }
+
+  drive.set_setpoint_generator(
+      [this, index](const CyclicDrive::Feedback& feedback) {
+        return next_target(index, feedback);
+      });
+
+  return index;
+}
+
+size_t MotionGroup::get_axis_count() const {
+  return m_axes.size();
+}
+
+void MotionGroup::set_following_error_delay(size_t cycles) {
+  m_following_error_delay = cycles;
+}
+
+void MotionGroup::set_following_error_limit(uint32_t limit) {
+  std::lock_guard<std::mutex> lock(m_statistics_mutex);
+  m_following_error_limit = limit;
+}
+
+void MotionGroup::set_following_error_callback(
+    const FollowingErrorCallback& callback) {
+  m_following_error_callback = callback;
+}
+
+void MotionGroup::attach(CyclicExecutor& executor) {
+  for (Axis& axis : m_axes) {
+    axis.history.assign(m_following_error_delay + 1, 0);
+    axis.history_count = 0;
+  }
+
+  executor.add_task([this](CyclicExecutor::CycleContext& context) {
+    begin_cycle(context);
+  });
+  for (Axis& axis : m_axes) {
+    axis.drive->attach(executor);
+  }
+  executor.add_task([this](CyclicExecutor::CycleContext& context) {
+    end_cycle(context);
+  });
+}
+
+void MotionGroup::enable() {
+  {
+    // Don't jump to setpoints committed before the axes were enabled.
+    std::lock_guard<std::mutex> lock(m_committed_mutex);
+    m_committed_valid.assign(m_committed_valid.size(), false);
+  }
+  for (Axis& axis : m_axes) {
+    axis.drive->enable();
+  }
+}
+
+void MotionGroup::disable() {
+  for (Axis& axis : m_axes) {
+    axis.drive->disable();
+  }
+}
+
+void MotionGroup::commit(const std::vector<int32_t>& positions) {
+  if (positions.size() != m_axes.size()) {
+    throw canopen_error("[MotionGroup::commit] Got " +
+                        std::to_string(positions.size()) +
+                        " positions for " + std::to_string(m_axes.size()) +
+                        " axes.");
+  }
+
+  std::lock_guard<std::mutex> lock(m_committed_mutex);
+  m_committed = positions;
+  m_committed_valid.assign(m_committed_valid.size(), true);
+}
+
+std::vector<int32_t> MotionGroup::get_positions() const {
+  std::vector<int32_t> positions;
+  positions.reserve(m_axes.size());
+  for (const Axis& axis : m_axes) {
+    positions.push_back(axis.drive->get_feedback().position);
+  }
+  return positions;
+}
+
+std::vector<MotionGroup::AxisStatistics> MotionGroup::get_statistics() const {
+  std::lock_guard<std::mutex> lock(m_statistics_mutex);
+  return m_statistics;
+}
+
+void MotionGroup::reset_statistics() {
+  std::lock_guard<std::mutex> lock(m_statistics_mutex);
+  for (AxisStatistics& statistics : m_statistics) {
+    statistics.max_following_error = 0;
+    statistics.limit_violations = 0;
+  }
+}
+
+void MotionGroup::begin_cycle(CyclicExecutor::CycleContext&) {
+  // One consistent snapshot of all setpoints per cycle
+  std::lock_guard<std::mutex> lock(m_committed_mutex);
+  m_cycle_targets = m_committed;
+  m_cycle_targets_valid = m_committed_valid;
+}
+
+int32_t MotionGroup::next_target(size_t axis_index,
+                                 const CyclicDrive::Feedback& feedback) {
+  Axis& axis = m_axes[axis_index];
+  if (!axis.enabled) {
+    // Operation has just been enabled: hold the current position.
+    axis.target = feedback.position;
+  }
+  if (m_cycle_targets_valid[axis_index]) {
+    axis.target = m_cycle_targets[axis_index];
+  }
+  return axis.target;
+}
+
+void MotionGroup::end_cycle(CyclicExecutor::CycleContext&) {
+  std::vector<std::pair<size_t, int32_t>> violations;
+
+  {
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    for (size_t i = 0; i < m_axes.size(); ++i) {
+      Axis& axis = m_axes[i];
+      AxisStatistics& statistics = m_statistics[i];
+      const CyclicDrive::Feedback feedback = axis.drive->get_feedback();
+
+      if (!feedback.valid ||
+          feedback.state != CyclicDrive::State::operation_enabled) {
+        if (axis.enabled) {
+          DEBUG_LOG("[MotionGroup] Axis " << i << " left operation enabled.");
+          // Hold the position when the axis gets enabled again.
+          std::lock_guard<std::mutex> committed_lock(m_committed_mutex);
+          m_committed_valid[i] = false;
+        }
+        axis.enabled = false;
+        axis.history_count = 0;
+        statistics.valid = false;
+        continue;
+      }
+
+      axis.enabled = true;
+      axis.history[axis.history_count % axis.history.size()] = axis.target;
+      ++axis.history_count;
+
+      if (axis.history_count <= m_following_error_delay) {
+        continue;
+      }
+
+      const uint64_t commanded_index =
+          axis.history_count - 1 - m_following_error_delay;
+      const int32_t commanded =
+          axis.history[commanded_index % axis.history.size()];
+      const int64_t error =
+          static_cast<int64_t>(feedback.position) - commanded;
+      const uint32_t magnitude = static_cast<uint32_t>(std::llabs(error));
+
+      statistics.valid = true;
+      statistics.following_error = static_cast<int32_t>(error);
+      if (magnitude > statistics.max_following_error) {
+        statistics.max_following_error = magnitude;
+      }
+      if (m_following_error_limit > 0 &&
+          magnitude > m_following_error_limit) {
+        ++statistics.limit_violations;
+        violations.emplace_back(i, statistics.following_error);
+      }
+    }
+  }
+
+  if (m_following_error_callback) {
+    for (const auto& violation : violations) {
+      m_following_error_callback(violation.first, violation.second);
+    }
+  }
+}
+
+}  // end namespace kaco
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/pdo_batch_decoder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/dictionary_error.h"
+#include "kacanopen/master/utils.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define KACO_BATCH_DECODER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace kaco {
+
+static_assert(sizeof(Message) == 12 && offsetof(Message, data) == 4,
+              "PDOBatchDecoder requires a packed Message layout.");
+
+namespace {
+
+// Returns the 8 data bytes of a frame as a little-endian integer.
+inline uint64_t load_payload(const Message& frame) {
+  uint64_t payload;
+  std::memcpy(&payload, frame.data, sizeof(payload));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  payload = __builtin_bswap64(payload);
+#endif
+  return payload;
+}
+
+bool is_signed(Type type) {
+  return type == Type::int8 || type == Type::int16 || type == Type::int32 ||
+         type == Type::int64;
+}
+
+}  // end anonymous namespace
+
+PDOBatchDecoder::PDOBatchDecoder(const std::vector<Field>& fields,
+                                 Kernel kernel)
+    : m_kernel(kernel) {
+  compile(fields);
+}
+
+PDOBatchDecoder::PDOBatchDecoder(Device& device,
+                                 const std::vector<Mapping>& mappings,
+                                 Kernel kernel)
+    : m_kernel(kernel) {
+  std::vector<Field> fields;
+  for (const Mapping& mapping : mappings) {
+    // throws dictionary_error if the entry doesn't exist
+    fields.push_back({device.get_entry_type(mapping.entry_name),
+                      mapping.offset});
+  }
+  compile(fields);
+}
+
+void PDOBatchDecoder::compile(const std::vector<Field>& fields) {
+  for (const Field& field : fields) {
+    if (field.type == Type::string || field.type == Type::octet_string ||
+        field.type == Type::invalid) {
+      throw dictionary_error(dictionary_error::type::wrong_type, "",
+                             "PDOBatchDecoder supports fixed size types only.");
+    }
+
+    const unsigned size = Utils::get_type_size(field.type);
+    if (field.offset + size > 8) {
+      throw dictionary_error(dictionary_error::type::mapping_size, "",
+                             "Field exceeds the PDO.");
+    }
+
+    CompiledField compiled;
+    compiled.kind = (field.type == Type::real32)
+                        ? CompiledField::Kind::real32
+                        : (field.type == Type::real64)
+                              ? CompiledField::Kind::real64
+                              : (field.type == Type::boolean)
+                                    ? CompiledField::Kind::boolean
+                                    : CompiledField::Kind::integer;
+    compiled.shift = 8 * field.offset;
+    compiled.mask = (size == 8) ? ~0ULL : (1ULL << (8 * size)) - 1;
+    compiled.sign = is_signed(field.type) ? 1ULL << (8 * size - 1) : 0;
+    m_fields.push_back(compiled);
+
+    m_min_length = std::max<uint8_t>(m_min_length, field.offset + size);
+  }
+
+#ifndef KACO_BATCH_DECODER_AVX2
+  m_kernel = Kernel::scalar;
+#endif
+  if (m_kernel == Kernel::avx2 && best_kernel() != Kernel::avx2) {
+    WARN("[PDOBatchDecoder] AVX2 is not supported. Using scalar kernel.");
+    m_kernel = Kernel::scalar;
+  }
+}
+
+PDOBatchDecoder::Kernel PDOBatchDecoder::best_kernel() {
+#ifdef KACO_BATCH_DECODER_AVX2
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2 ? Kernel::avx2 : Kernel::scalar;
+#else
+  return Kernel::scalar;
+#endif
+}
+
+bool PDOBatchDecoder::is_real(size_t field) const {
+  const CompiledField::Kind kind = m_fields.at(field).kind;
+  return kind == CompiledField::Kind::real32 ||
+         kind == CompiledField::Kind::real64;
+}
+
+size_t PDOBatchDecoder::decode(const Message* frames, size_t count,
+                               Columns& columns) const {
+  columns.integers.resize(m_fields.size());
+  columns.reals.resize(m_fields.size());
+
+  // Output pointers to the appended part of each column.
+  std::vector<int64_t*> integers(m_fields.size(), nullptr);
+  std::vector<double*> reals(m_fields.size(), nullptr);
+  for (size_t f = 0; f < m_fields.size(); ++f) {
+    if (!is_real(f)) {
+      std::vector<int64_t>& column = columns.integers[f];
+      column.resize(column.size() + count);
+      integers[f] = column.data() + column.size() - count;
+    } else {
+      std::vector<double>& column = columns.reals[f];
+      column.resize(column.size() + count);
+      reals[f] = column.data() + column.size() - count;
+    }
+  }
+
+  if (m_kernel == Kernel::avx2) {
+    return decode_avx2(frames, count, integers, reals);
+  }
+  return decode_scalar(frames, count, 0, integers, reals);
+}
+
+size_t PDOBatchDecoder::decode_scalar(const Message* frames, size_t count,
+                                      size_t begin,
+                                      const std::vector<int64_t*>& integers,
+                                      const std::vector<double*>& reals) const {
+  size_t valid = 0;
+
+  for (size_t i = begin; i < count; ++i) {
+    const bool long_enough = frames[i].len >= m_min_length;
+    const uint64_t payload = long_enough ? load_payload(frames[i]) : 0;
+    valid += long_enough;
+
+    for (size_t f = 0; f < m_fields.size(); ++f) {
+      const CompiledField& field = m_fields[f];
+      uint64_t bits = (payload >> field.shift) & field.mask;
+
+      switch (field.kind) {
+        case CompiledField::Kind::integer: {
+          // Sign extension: flipping and subtracting the sign bit.
+          integers[f][i] = static_cast<int64_t>((bits ^ field.sign) -
+                                                field.sign);
+          break;
+        }
+        case CompiledField::Kind::boolean: {
+          integers[f][i] = (bits != 0);
+          break;
+        }
+        case CompiledField::Kind::real32: {
+          const uint32_t bits32 = static_cast<uint32_t>(bits);
+          float value;
+          std::memcpy(&value, &bits32, sizeof(value));
+          reals[f][i] = value;
+          break;
+        }
+        case CompiledField::Kind::real64: {
+          double value;
+          std::memcpy(&value, &bits, sizeof(value));
+          reals[f][i] = value;
+          break;
+        }
+      }
+    }
+  }
+
+  return valid;
+}
+
+#ifdef KACO_BATCH_DECODER_AVX2
+
+__attribute__((target("avx2"))) size_t PDOBatchDecoder::decode_avx2(
+    const Message* frames, size_t count, const std::vector<int64_t*>& integers,
+    const std::vector<double*>& reals) const {
+  // Byte offsets of four consecutive frames.
+  const __m256i frame_offsets =
+      _mm256_setr_epi64x(0, sizeof(Message), 2 * sizeof(Message),
+                         3 * sizeof(Message));
+  const __m256i min_length = _mm256_set1_epi64x(m_min_length);
+  const __m256i byte_mask = _mm256_set1_epi64x(0xFF);
+  // Moves the low 32 bits of each 64 bit lane into the low 128 bits.
+  const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+  size_t valid = 0;
+  size_t i = 0;
+
+  for (; i + 4 <= count; i += 4) {
+    const char* base = reinterpret_cast<const char*>(frames + i);
+    // Header (cob_id, rtr, len, data[0..3]) and payload of four frames.
+    const __m256i header = _mm256_i64gather_epi64(
+        reinterpret_cast<const long long*>(base), frame_offsets, 1);
+    __m256i payload = _mm256_i64gather_epi64(
+        reinterpret_cast<const long long*>(base + offsetof(Message, data)),
+        frame_offsets, 1);
+
+    const __m256i length =
+        _mm256_and_si256(_mm256_srli_epi64(header, 24), byte_mask);
+    // All ones for frames which are long enough.
+    const __m256i long_enough = _mm256_xor_si256(
+        _mm256_cmpgt_epi64(min_length, length), _mm256_set1_epi64x(-1));
+    payload = _mm256_and_si256(payload, long_enough);
+    valid += __builtin_popcount(
+        _mm256_movemask_pd(_mm256_castsi256_pd(long_enough)));
+
+    for (size_t f = 0; f < m_fields.size(); ++f) {
+      const CompiledField& field = m_fields[f];
+      __m256i bits = _mm256_and_si256(
+          _mm256_srli_epi64(payload, field.shift),
+          _mm256_set1_epi64x(static_cast<long long>(field.mask)));
+
+      switch (field.kind) {
+        case CompiledField::Kind::integer: {
+          const __m256i sign =
+              _mm256_set1_epi64x(static_cast<long long>(field.sign));
+          bits = _mm256_sub_epi64(_mm256_xor_si256(bits, sign), sign);
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(integers[f] + i),
+                              bits);
+          break;
+        }
+        case CompiledField::Kind::boolean: {
+          // Zero -> 0, anything else -> 1
+          bits = _mm256_andnot_si256(
+              _mm256_cmpeq_epi64(bits, _mm256_setzero_si256()),
+              _mm256_set1_epi64x(1));
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(integers[f] + i),
+                              bits);
+          break;
+        }
+        case CompiledField::Kind::real32: {
+          const __m128 values = _mm_castsi128_ps(_mm256_castsi256_si128(
+              _mm256_permutevar8x32_epi32(bits, low_halves)));
+          _mm256_storeu_pd(reals[f] + i, _mm256_cvtps_pd(values));
+          break;
+        }
+        case CompiledField::Kind::real64: {
+          _mm256_storeu_pd(reals[f] + i, _mm256_castsi256_pd(bits));
+          break;
+        }
+      }
+    }
+  }
+
+  return valid + decode_scalar(frames, count, i, integers, reals);
+}
+
+#else
+
+size_t PDOBatchDecoder::decode_avx2(const Message* frames, size_t count,
+                                    const std::vector<int64_t*>& integers,
+                                    const std::vector<double*>& reals) const {
+  return decode_scalar(frames, count, 0, integers, reals);
+}
+
+#endif
+
+}  // end namespace kaco
@@ -82,6 +82,9 @@ const std::map<uint16_t, std::map<std::string, const Value>>
           {"torque_profile_mode", static_cast<int8_t>(4)},
           {"homing_mode", static_cast<int8_t>(6)},
           {"interpolated_position_mode", static_cast<int8_t>(7)},
+          {"cyclic_synchronous_position_mode", static_cast<int8_t>(8)},
+          {"cyclic_synchronous_velocity_mode", static_cast<int8_t>(9)},
+          {"cyclic_synchronous_torque_mode", static_cast<int8_t>(10)},
 
           // control word flags general
           {"controlword_switch_on", static_cast<uint16_t>(1 << 0)},
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/shared_process_image.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/utils.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+namespace kaco {
+
+namespace {
+
+uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string segment_name(const std::string& name) {
+  return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+}  // end anonymous namespace
+
+SharedProcessImage::SharedProcessImage(const std::string& name,
+                                       size_t capacity, bool replace)
+    : m_name(segment_name(name)) {
+  m_size = sizeof(SharedImageHeader) + capacity * sizeof(SharedImageSlot);
+
+  int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0 && errno == EEXIST && replace) {
+    WARN("[SharedProcessImage] Replacing existing shared memory " << m_name
+                                                                  << ".");
+    shm_unlink(m_name.c_str());
+    fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  }
+  if (fd < 0) {
+    const int error = errno;
+    throw canopen_error("[SharedProcessImage] Cannot create shared memory " +
+                        m_name + ": " + std::strerror(error) +
+                        (error == EEXIST
+                             ? " (Is another publisher running? Pass "
+                               "replace=true to take over a stale segment.)"
+                             : ""));
+  }
+  struct stat status;
+  if (fstat(fd, &status) == 0) {
+    m_inode = status.st_ino;
+  }
+  if (ftruncate(fd, m_size) != 0) {
+    const std::string error = std::strerror(errno);
+    close(fd);
+    shm_unlink(m_name.c_str());
+    throw canopen_error("[SharedProcessImage] Cannot resize shared memory " +
+                        m_name + ": " + error);
+  }
+  m_memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m_memory == MAP_FAILED) {
+    shm_unlink(m_name.c_str());
+    throw canopen_error("[SharedProcessImage] Cannot map shared memory " +
+                        m_name + ": " + std::strerror(errno));
+  }
+
+  // The slots are zeroed by ftruncate().
+  m_slots = reinterpret_cast<SharedImageSlot*>(
+      static_cast<uint8_t*>(m_memory) + sizeof(SharedImageHeader));
+  m_header = new (m_memory) SharedImageHeader();
+  m_header->version = shared_image_version;
+  m_header->header_size = sizeof(SharedImageHeader);
+  m_header->slot_size = sizeof(SharedImageSlot);
+  m_header->capacity = capacity;
+  m_header->slot_count.store(0);
+  m_header->generation = now_ns();
+  // Readers check the magic number last.
+  std::atomic_thread_fence(std::memory_order_release);
+  m_header->magic = shared_image_magic;
+
+  DEBUG_LOG("[SharedProcessImage] Created " << m_name << " with " << capacity
+                                            << " slots.");
+}
+
+SharedProcessImage::~SharedProcessImage() {
+  for (const Registration& registration : m_registrations) {
+    registration.device->remove_value_changed_callback(
+        registration.entry_name, registration.callback_id);
+  }
+  munmap(m_memory, m_size);
+
+  // Don't remove a segment which has been taken over by another publisher.
+  const int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+  if (fd >= 0) {
+    struct stat status;
+    const bool own = fstat(fd, &status) == 0 && status.st_ino == m_inode;
+    close(fd);
+    if (own) {
+      shm_unlink(m_name.c_str());
+    }
+  }
+}
+
+size_t SharedProcessImage::add_entry(Device& device,
+                                     const std::string& entry_name) {
+  const std::string name = Utils::escape(entry_name);
+  const Address address = device.get_entry_address(name);
+  const Type type = device.get_entry_type(name);
+  if (type == Type::string || type == Type::octet_string ||
+      Utils::get_type_size(type) > 8) {
+    throw canopen_error("[SharedProcessImage::add_entry] Entry " + name +
+                        " is larger than 8 bytes.");
+  }
+  if (!fits(name)) {
+    throw canopen_error("[SharedProcessImage::add_entry] Entry name " + name +
+                        " is longer than " +
+                        std::to_string(sizeof(SharedImageSlot::name) - 1) +
+                        " characters.");
+  }
+
+  std::lock_guard<std::mutex> add_lock(m_add_mutex);
+  const size_t slot_index = m_header->slot_count.load();
+  if (slot_index >= m_header->capacity) {
+    throw canopen_error("[SharedProcessImage::add_entry] " + m_name +
+                        " is full.");
+  }
+
+  SharedImageSlot& slot = m_slots[slot_index];
+  slot.node_id = device.get_node_id();
+  slot.type = static_cast<uint8_t>(type);
+  slot.index = address.index;
+  slot.subindex = address.subindex;
+  slot.size = Utils::get_type_size(type);
+  std::strncpy(slot.name, name.c_str(), sizeof(slot.name));
+  m_header->slot_count.store(slot_index + 1, std::memory_order_release);
+
+  try {
+    write(slot_index, device.get_entry(name, ReadAccessMethod::cache));
+  } catch (const canopen_error&) {
+    // no value cached yet
+  }
+
+  const uint32_t callback_id = device.add_value_changed_callback(
+      name,
+      [this, slot_index](const Value& value) { write(slot_index, value); });
+  m_registrations.push_back({&device, name, callback_id});
+
+  return slot_index;
+}
+
+size_t SharedProcessImage::add_device(Device& device) {
+  size_t count = 0;
+  for (const std::string& name : device.get_pdo_mapped_entries()) {
+    const Type type = device.get_entry_type(name);
+    if (type == Type::string || type == Type::octet_string ||
+        Utils::get_type_size(type) > 8 || !fits(name)) {
+      DEBUG_LOG("[SharedProcessImage::add_device] Skipping " << name << ".");
+      continue;
+    }
+    add_entry(device, name);
+    ++count;
+  }
+  return count;
+}
+
+size_t SharedProcessImage::get_slot_count() const {
+  return m_header->slot_count.load();
+}
+
+const std::string& SharedProcessImage::get_name() const { return m_name; }
+
+bool SharedProcessImage::fits(const std::string& name) {
+  // The name must be zero-terminated, see SharedProcessImageReader.
+  return name.size() < sizeof(SharedImageSlot::name);
+}
+
+void SharedProcessImage::write(size_t slot_index, const Value& value) {
+  // Called from add_entry() before the callback is registered or with the
+  // callback mutex of the entry locked, so there is only one writer per slot.
+  SharedImageSlot& slot = m_slots[slot_index];
+  const std::vector<uint8_t> bytes = value.get_bytes();
+
+  const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memset(slot.data, 0, sizeof(slot.data));
+  std::memcpy(slot.data, bytes.data(), std::min(bytes.size(), sizeof(slot.data)));
+  slot.timestamp = now_ns();
+  ++slot.updates;
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+}  // end namespace kaco
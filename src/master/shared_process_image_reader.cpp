@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/shared_process_image_reader.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/master/utils.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace kaco {
+
+SharedProcessImageReader::SharedProcessImageReader(const std::string& name)
+    : m_name((!name.empty() && name[0] == '/') ? name : "/" + name) {
+  const int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw canopen_error("[SharedProcessImageReader] Cannot open shared memory " +
+                        m_name + ": " + std::strerror(errno));
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < sizeof(SharedImageHeader)) {
+    close(fd);
+    throw canopen_error("[SharedProcessImageReader] " + m_name +
+                        " is not a process image.");
+  }
+  m_size = status.st_size;
+  m_memory = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m_memory == MAP_FAILED) {
+    throw canopen_error("[SharedProcessImageReader] Cannot map shared memory " +
+                        m_name + ": " + std::strerror(errno));
+  }
+
+  m_header = static_cast<const SharedImageHeader*>(m_memory);
+  m_slots = reinterpret_cast<const SharedImageSlot*>(
+      static_cast<const uint8_t*>(m_memory) + sizeof(SharedImageHeader));
+
+  const uint32_t magic = m_header->magic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (magic != shared_image_magic ||
+      m_header->version != shared_image_version ||
+      m_header->header_size != sizeof(SharedImageHeader) ||
+      m_header->slot_size != sizeof(SharedImageSlot) ||
+      m_size < sizeof(SharedImageHeader) +
+                   m_header->capacity * sizeof(SharedImageSlot)) {
+    munmap(const_cast<void*>(m_memory), m_size);
+    throw canopen_error("[SharedProcessImageReader] " + m_name +
+                        " has an incompatible layout.");
+  }
+}
+
+SharedProcessImageReader::~SharedProcessImageReader() {
+  munmap(const_cast<void*>(m_memory), m_size);
+}
+
+size_t SharedProcessImageReader::get_slot_count() const {
+  return m_header->slot_count.load(std::memory_order_acquire);
+}
+
+uint64_t SharedProcessImageReader::get_generation() const {
+  return m_header->generation;
+}
+
+SharedProcessImageReader::SlotInfo SharedProcessImageReader::get_slot_info(
+    size_t slot_index) const {
+  const SharedImageSlot& slot = get_slot(slot_index);
+  SlotInfo info;
+  info.node_id = slot.node_id;
+  info.index = slot.index;
+  info.subindex = slot.subindex;
+  info.type = static_cast<Type>(slot.type);
+  info.name = std::string(slot.name, strnlen(slot.name, sizeof(slot.name)));
+  return info;
+}
+
+size_t SharedProcessImageReader::find_slot(
+    uint8_t node_id, const std::string& entry_name) const {
+  const std::string name = Utils::escape(entry_name);
+  const size_t count = get_slot_count();
+  for (size_t i = 0; i < count; ++i) {
+    const SharedImageSlot& slot = m_slots[i];
+    if (slot.node_id == node_id &&
+        strncmp(slot.name, name.c_str(), sizeof(slot.name)) == 0) {
+      return i;
+    }
+  }
+  throw canopen_error("[SharedProcessImageReader::find_slot] Entry " + name +
+                      " of node " + std::to_string(node_id) +
+                      " has not been exported.");
+}
+
+SharedProcessImageReader::Sample SharedProcessImageReader::read(
+    size_t slot_index) const {
+  const SharedImageSlot& slot = get_slot(slot_index);
+  uint8_t data[8];
+  Sample sample;
+
+  uint32_t before, after;
+  do {
+    before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      // writer active
+      after = before + 1;
+      continue;
+    }
+    std::memcpy(data, slot.data, sizeof(data));
+    sample.timestamp = slot.timestamp;
+    sample.updates = slot.updates;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = slot.sequence.load(std::memory_order_relaxed);
+  } while (before != after);
+
+  if (sample.updates == 0) {
+    return sample;
+  }
+
+  sample.valid = true;
+  sample.value = Value(static_cast<Type>(slot.type),
+                       std::vector<uint8_t>(data, data + slot.size));
+  return sample;
+}
+
+const SharedImageSlot& SharedProcessImageReader::get_slot(
+    size_t slot_index) const {
+  if (slot_index >= get_slot_count()) {
+    throw canopen_error("[SharedProcessImageReader] Slot " +
+                        std::to_string(slot_index) + " doesn't exist.");
+  }
+  return m_slots[slot_index];
+}
+
+}  // end namespace kaco
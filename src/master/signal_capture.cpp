@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/signal_capture.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/core/spsc_ring.h"
+#include "kacanopen/master/device.h"
+#include "kacanopen/master/dictionary_error.h"
+#include "kacanopen/master/signal_compression.h"
+#include "kacanopen/master/utils.h"
+
+namespace kaco {
+
+/// A buffer of samples of one signal. Owned by the receive thread while it
+/// is filled and by the writer thread while it is written.
+struct SignalCapture::Chunk {
+  std::vector<int64_t> timestamps;
+  std::vector<uint64_t> values;
+  size_t count = 0;
+
+  explicit Chunk(size_t size) : timestamps(size), values(size) {}
+};
+
+struct SignalCapture::Signal {
+  SignalInfo info;
+  uint8_t offset;
+  uint8_t size;
+  Type type;
+
+  // Only accessed by the receive thread while running.
+  Chunk* current = nullptr;
+
+  // Filled chunks (receive thread -> writer) and empty chunks (writer ->
+  // receive thread).
+  SPSCRing<Chunk*> full;
+  SPSCRing<Chunk*> empty;
+  std::vector<std::unique_ptr<Chunk>> chunks;
+
+  std::atomic<size_t> samples{0};
+  std::atomic<size_t> dropped{0};
+
+  Signal(size_t chunk_size, size_t num_chunks)
+      : full(num_chunks), empty(num_chunks) {
+    for (size_t i = 0; i < num_chunks; ++i) {
+      chunks.emplace_back(new Chunk(chunk_size));
+      empty.push(chunks.back().get());
+    }
+  }
+
+  /// Decodes the little-endian value bytes into the stored representation.
+  uint64_t decode(const uint8_t* bytes) const {
+    uint64_t raw = 0;
+    for (size_t i = size; i-- > 0;) {
+      raw = (raw << 8) | bytes[i];
+    }
+
+    switch (type) {
+      case Type::int8:
+      case Type::int16:
+      case Type::int32: {
+        // Sign extension
+        const uint64_t sign = 1ULL << (8 * size - 1);
+        return (raw ^ sign) - sign;
+      }
+      case Type::boolean:
+        return raw != 0;
+      case Type::real32: {
+        const uint32_t bits = static_cast<uint32_t>(raw);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        const double converted = value;
+        std::memcpy(&raw, &converted, sizeof(raw));
+        return raw;
+      }
+      default:
+        return raw;
+    }
+  }
+
+  /// Appends a sample. Called by the receive thread.
+  void record(int64_t timestamp, const std::vector<uint8_t>& data,
+              size_t chunk_size) {
+    if (offset + size > data.size()) {
+      return;
+    }
+    if (!current && !empty.pop(current)) {
+      ++dropped;
+      return;
+    }
+    current->timestamps[current->count] = timestamp;
+    current->values[current->count] = decode(data.data() + offset);
+    if (++current->count == chunk_size) {
+      // Never fails because there are only as many chunks as ring slots.
+      full.push(current);
+      current = nullptr;
+    }
+    samples.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+struct SignalCapture::State {
+  std::atomic<bool> running{false};
+  std::atomic<bool> writer_running{false};
+
+  // Number of PDO callbacks currently recording.
+  std::atomic<size_t> active{0};
+
+  std::vector<std::unique_ptr<Signal>> signals;
+  size_t chunk_size;
+  std::chrono::steady_clock::time_point start;
+};
+
+SignalCapture::SignalCapture(size_t chunk_size, size_t chunks_per_signal)
+    : m_chunk_size(std::max<size_t>(chunk_size, 1)),
+      m_chunks_per_signal(std::max<size_t>(chunks_per_signal, 2)),
+      m_state(std::make_shared<State>()) {
+  m_state->chunk_size = m_chunk_size;
+}
+
+SignalCapture::~SignalCapture() {
+  if (is_running()) {
+    stop();
+  }
+}
+
+size_t SignalCapture::add_signal(Device& device,
+                                 const std::string& entry_name) {
+  assert(!is_running());
+
+  const std::string name = Utils::escape(entry_name);
+  const Address address = device.get_entry_address(name);
+  const Type type = device.get_entry_type(name);
+
+  if (type == Type::string || type == Type::octet_string) {
+    throw dictionary_error(dictionary_error::type::wrong_type, name,
+                           "Only entries with a fixed size can be captured.");
+  }
+  if (name.size() >= sizeof(SignalInfo::name)) {
+    throw canopen_error("[SignalCapture::add_signal] Entry name " + name +
+                        " is longer than " +
+                        std::to_string(sizeof(SignalInfo::name) - 1) +
+                        " characters.");
+  }
+
+  const std::vector<ReceivePDOMapping> mappings =
+      device.get_receive_pdo_mappings();
+  const auto mapping =
+      std::find_if(mappings.begin(), mappings.end(),
+                   [&name](const ReceivePDOMapping& receive_mapping) {
+                     return receive_mapping.entry_name == name;
+                   });
+  if (mapping == mappings.end()) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name,
+                           "The entry is not mapped to a receive PDO.");
+  }
+
+  std::unique_ptr<Signal> signal(
+      new Signal(m_chunk_size, m_chunks_per_signal));
+  std::memset(&signal->info, 0, sizeof(signal->info));
+  std::strncpy(signal->info.name, name.c_str(), sizeof(signal->info.name));
+  signal->info.node_id = device.get_node_id();
+  signal->info.index = address.index;
+  signal->info.subindex = address.subindex;
+  signal->info.cob_id = mapping->cob_id;
+  signal->info.type = static_cast<uint8_t>(type);
+  signal->info.value_kind =
+      static_cast<uint8_t>((type == Type::real32 || type == Type::real64)
+                               ? ValueKind::float64
+                               : ValueKind::int64);
+  signal->offset = mapping->offset;
+  signal->size = Utils::get_type_size(type);
+  signal->type = type;
+
+  const size_t number = m_state->signals.size();
+  m_state->signals.push_back(std::move(signal));
+
+  // One callback per Core and COB-ID records all signals of the PDO.
+  Core& core = device.get_core();
+  std::shared_ptr<std::vector<size_t>>& cob_signals =
+      m_cob_signals[std::make_pair(static_cast<void*>(&core),
+                                   mapping->cob_id)];
+  if (!cob_signals) {
+    cob_signals = std::make_shared<std::vector<size_t>>();
+    std::shared_ptr<State> state = m_state;
+    std::shared_ptr<std::vector<size_t>> numbers = cob_signals;
+    core.pdo.add_pdo_received_callback(
+        mapping->cob_id, [state, numbers](std::vector<uint8_t> data) {
+          ++state->active;
+          if (state->running) {
+            const int64_t timestamp =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - state->start)
+                    .count();
+            for (size_t number : *numbers) {
+              state->signals[number]->record(timestamp, data,
+                                             state->chunk_size);
+            }
+          }
+          --state->active;
+        });
+  }
+  cob_signals->push_back(number);
+
+  return number;
+}
+
+bool SignalCapture::start(const std::string& path, Encoding encoding) {
+  assert(!is_running());
+
+  m_file = std::fopen(path.c_str(), "wb");
+  if (!m_file) {
+    ERROR("[SignalCapture::start] Cannot create " << path << ".");
+    return false;
+  }
+  std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+
+  FileHeader header;
+  header.magic = magic;
+  header.version = 2;
+  header.flags = (encoding == Encoding::compressed) ? flag_compressed : 0;
+  header.num_signals = m_state->signals.size();
+  header.start_time_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  std::fwrite(&header, sizeof(header), 1, m_file);
+  m_offset = sizeof(header);
+
+  for (const auto& signal : m_state->signals) {
+    signal->info.num_samples = 0;
+    signal->samples = 0;
+    signal->dropped = 0;
+    std::fwrite(&signal->info, sizeof(SignalInfo), 1, m_file);
+    m_offset += sizeof(SignalInfo);
+  }
+
+  m_encoding = encoding;
+  m_blocks.clear();
+  m_num_blocks = 0;
+
+  m_state->start = std::chrono::steady_clock::now();
+  m_state->writer_running = true;
+  m_writer_thread = std::thread(&SignalCapture::writer_loop, this);
+  m_state->running = true;
+  return true;
+}
+
+void SignalCapture::stop() {
+  assert(is_running());
+
+  // Wait for PDO callbacks which are recording right now.
+  m_state->running = false;
+  while (m_state->active > 0) {
+    std::this_thread::yield();
+  }
+
+  m_state->writer_running = false;
+  m_writer_thread.join();
+
+  // Write the remaining full and partially filled chunks.
+  for (size_t number = 0; number < m_state->signals.size(); ++number) {
+    Signal& signal = *m_state->signals[number];
+    Chunk* chunk;
+    while (signal.full.pop(chunk)) {
+      write_chunk(number, *chunk);
+      chunk->count = 0;
+      signal.empty.push(chunk);
+    }
+    if (signal.current) {
+      write_chunk(number, *signal.current);
+      signal.current->count = 0;
+      signal.empty.push(signal.current);
+      signal.current = nullptr;
+    }
+  }
+
+  // Footer and trailer
+  Trailer trailer;
+  trailer.footer_offset = m_offset;
+  trailer.magic = magic;
+
+  FooterHeader footer;
+  footer.num_signals = m_state->signals.size();
+  footer.reserved = 0;
+  footer.num_blocks = m_blocks.size();
+  std::fwrite(&footer, sizeof(footer), 1, m_file);
+  for (const auto& signal : m_state->signals) {
+    std::fwrite(&signal->info, sizeof(SignalInfo), 1, m_file);
+  }
+  std::fwrite(m_blocks.data(), sizeof(BlockInfo), m_blocks.size(), m_file);
+  std::fwrite(&trailer, sizeof(trailer), 1, m_file);
+
+  if (std::fclose(m_file) != 0) {
+    ERROR("[SignalCapture::stop] Writing the file failed.");
+  }
+  m_file = nullptr;
+
+  const Statistics statistics = get_statistics();
+  DEBUG_LOG("[SignalCapture::stop] Captured "
+            << statistics.samples << " samples in " << statistics.blocks
+            << " blocks, dropped " << statistics.dropped << ".");
+}
+
+bool SignalCapture::is_running() const { return m_state->running; }
+
+SignalCapture::Statistics SignalCapture::get_statistics() const {
+  Statistics statistics{0, 0, m_num_blocks};
+  for (const auto& signal : m_state->signals) {
+    statistics.samples += signal->samples.load(std::memory_order_relaxed);
+    statistics.dropped += signal->dropped.load(std::memory_order_relaxed);
+  }
+  return statistics;
+}
+
+void SignalCapture::writer_loop() {
+  while (m_state->writer_running) {
+    for (size_t number = 0; number < m_state->signals.size(); ++number) {
+      Signal& signal = *m_state->signals[number];
+      Chunk* chunk;
+      while (signal.full.pop(chunk)) {
+        write_chunk(number, *chunk);
+        chunk->count = 0;
+        signal.empty.push(chunk);
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+}
+
+void SignalCapture::write_chunk(size_t number, const Chunk& chunk) {
+  if (chunk.count == 0) {
+    return;
+  }
+
+  const Signal& signal = *m_state->signals[number];
+
+  BlockHeader header;
+  header.signal = number;
+  header.count = chunk.count;
+  header.reserved = 0;
+
+  if (m_encoding == Encoding::compressed) {
+    m_encoded.clear();
+    SignalCompression::encode(
+        chunk.timestamps.data(), chunk.values.data(), chunk.count,
+        signal.info.value_kind == static_cast<uint8_t>(ValueKind::float64),
+        m_encoded);
+    header.size = m_encoded.size();
+  } else {
+    header.size = 2 * sizeof(int64_t) * chunk.count;
+  }
+
+  BlockInfo info;
+  info.offset = m_offset;
+  info.signal = number;
+  info.count = chunk.count;
+  info.first_timestamp = chunk.timestamps.front();
+  info.last_timestamp = chunk.timestamps[chunk.count - 1];
+  m_blocks.push_back(info);
+
+  std::fwrite(&header, sizeof(header), 1, m_file);
+  if (m_encoding == Encoding::compressed) {
+    static const uint8_t padding[8] = {};
+    std::fwrite(m_encoded.data(), 1, m_encoded.size(), m_file);
+    std::fwrite(padding, 1, (8 - header.size % 8) % 8, m_file);
+  } else {
+    std::fwrite(chunk.timestamps.data(), sizeof(int64_t), chunk.count, m_file);
+    std::fwrite(chunk.values.data(), sizeof(uint64_t), chunk.count, m_file);
+  }
+  m_offset += sizeof(header) + (header.size + 7) / 8 * 8;
+
+  m_state->signals[number]->info.num_samples += chunk.count;
+  ++m_num_blocks;
+}
+
+}  // end namespace kaco
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/signal_capture_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/signal_compression.h"
+
+namespace kaco {
+
+SignalCaptureReader::~SignalCaptureReader() { close(); }
+
+bool SignalCaptureReader::open(const std::string& path) {
+  close();
+
+  m_fd = ::open(path.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    ERROR("[SignalCaptureReader::open] Cannot open " << path << ": "
+                                                     << std::strerror(errno));
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(m_fd, &status) != 0 ||
+      static_cast<size_t>(status.st_size) <
+          sizeof(SignalCapture::FileHeader)) {
+    ERROR("[SignalCaptureReader::open] " << path << " is not a capture file.");
+    close();
+    return false;
+  }
+
+  m_mapping_size = status.st_size;
+  void* mapping =
+      mmap(nullptr, m_mapping_size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (mapping == MAP_FAILED) {
+    ERROR("[SignalCaptureReader::open] Cannot map " << path << ": "
+                                                    << std::strerror(errno));
+    m_mapping_size = 0;
+    close();
+    return false;
+  }
+  m_mapping = static_cast<const char*>(mapping);
+
+  m_header = reinterpret_cast<const SignalCapture::FileHeader*>(m_mapping);
+  const size_t signals_end =
+      sizeof(SignalCapture::FileHeader) +
+      m_header->num_signals * sizeof(SignalCapture::SignalInfo);
+  if (m_header->magic != SignalCapture::magic || m_header->version != 2 ||
+      signals_end > m_mapping_size) {
+    ERROR("[SignalCaptureReader::open] " << path
+                                         << " is not a capture file of this "
+                                            "version.");
+    close();
+    return false;
+  }
+
+  // Use the footer if the file has been closed properly.
+  const SignalCapture::Trailer* trailer = nullptr;
+  if (m_mapping_size >= signals_end + sizeof(SignalCapture::Trailer)) {
+    trailer = reinterpret_cast<const SignalCapture::Trailer*>(
+        m_mapping + m_mapping_size - sizeof(SignalCapture::Trailer));
+  }
+
+  if (trailer && trailer->magic == SignalCapture::magic &&
+      trailer->footer_offset >= signals_end &&
+      trailer->footer_offset <=
+          m_mapping_size - sizeof(SignalCapture::FooterHeader)) {
+    const auto* footer = reinterpret_cast<const SignalCapture::FooterHeader*>(
+        m_mapping + trailer->footer_offset);
+    // Check the footer before any pointer arithmetic with its counts.
+    const size_t blocks_offset =
+        trailer->footer_offset + sizeof(SignalCapture::FooterHeader) +
+        m_header->num_signals * sizeof(SignalCapture::SignalInfo);
+    if (footer->num_signals == m_header->num_signals &&
+        blocks_offset <= m_mapping_size &&
+        footer->num_blocks <= (m_mapping_size - blocks_offset) /
+                                  sizeof(SignalCapture::BlockInfo)) {
+      const auto* signals =
+          reinterpret_cast<const SignalCapture::SignalInfo*>(footer + 1);
+      const auto* blocks = reinterpret_cast<const SignalCapture::BlockInfo*>(
+          m_mapping + blocks_offset);
+      m_signals.assign(signals, signals + footer->num_signals);
+      m_blocks.resize(m_signals.size());
+      for (size_t i = 0; i < footer->num_blocks; ++i) {
+        if (blocks[i].signal < m_blocks.size()) {
+          m_blocks[blocks[i].signal].push_back(blocks[i]);
+        }
+      }
+      m_complete = true;
+      return true;
+    }
+  }
+
+  WARN("[SignalCaptureReader::open] " << path
+                                      << " has not been closed properly. "
+                                         "Scanning blocks.");
+  const auto* signals = reinterpret_cast<const SignalCapture::SignalInfo*>(
+      m_header + 1);
+  m_signals.assign(signals, signals + m_header->num_signals);
+  return scan_blocks();
+}
+
+bool SignalCaptureReader::scan_blocks() {
+  m_blocks.assign(m_signals.size(), {});
+  for (SignalCapture::SignalInfo& signal : m_signals) {
+    signal.num_samples = 0;
+  }
+
+  size_t offset = sizeof(SignalCapture::FileHeader) +
+                  m_signals.size() * sizeof(SignalCapture::SignalInfo);
+  while (offset + sizeof(SignalCapture::BlockHeader) <= m_mapping_size) {
+    const auto* header = reinterpret_cast<const SignalCapture::BlockHeader*>(
+        m_mapping + offset);
+    const size_t size = sizeof(SignalCapture::BlockHeader) +
+                        (static_cast<size_t>(header->size) + 7) / 8 * 8;
+    if (header->count == 0 || header->signal >= m_signals.size() ||
+        offset + size > m_mapping_size) {
+      // Truncated block or start of the footer.
+      break;
+    }
+
+    SignalCapture::BlockInfo info{offset, header->signal, header->count, 0,
+                                  0};
+    std::vector<int64_t> timestamps;
+    if (is_compressed()) {
+      std::vector<uint64_t> values;
+      if (!SignalCompression::decode(
+              reinterpret_cast<const uint8_t*>(header + 1), header->size,
+              header->count, is_real(header->signal), timestamps,
+              values)) {
+        break;
+      }
+    } else {
+      const int64_t* raw = reinterpret_cast<const int64_t*>(header + 1);
+      timestamps.assign(raw, raw + header->count);
+    }
+    info.first_timestamp = timestamps.front();
+    info.last_timestamp = timestamps.back();
+    m_blocks[header->signal].push_back(info);
+    m_signals[header->signal].num_samples += header->count;
+    offset += size;
+  }
+
+  return true;
+}
+
+void SignalCaptureReader::close() {
+  if (m_mapping) {
+    munmap(const_cast<char*>(m_mapping), m_mapping_size);
+  }
+  if (m_fd >= 0) {
+    ::close(m_fd);
+  }
+
+  m_fd = -1;
+  m_mapping = nullptr;
+  m_mapping_size = 0;
+  m_complete = false;
+  m_header = nullptr;
+  m_signals.clear();
+  m_blocks.clear();
+}
+
+int SignalCaptureReader::find_signal(uint8_t node_id,
+                                     const std::string& entry_name) const {
+  for (size_t i = 0; i < m_signals.size(); ++i) {
+    if (m_signals[i].node_id == node_id && entry_name == m_signals[i].name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+size_t SignalCaptureReader::get_num_blocks(size_t signal) const {
+  return m_blocks.at(signal).size();
+}
+
+SignalCaptureReader::Block SignalCaptureReader::get_block(size_t signal,
+                                                          size_t block) const {
+  assert(!is_compressed());
+
+  const SignalCapture::BlockInfo& info = m_blocks.at(signal).at(block);
+  const int64_t* timestamps = reinterpret_cast<const int64_t*>(
+      m_mapping + info.offset + sizeof(SignalCapture::BlockHeader));
+  const char* values =
+      reinterpret_cast<const char*>(timestamps + info.count);
+
+  Block result{timestamps, nullptr, nullptr, info.count};
+  if (is_real(signal)) {
+    result.reals = reinterpret_cast<const double*>(values);
+  } else {
+    result.integers = reinterpret_cast<const int64_t*>(values);
+  }
+  return result;
+}
+
+bool SignalCaptureReader::decode_block(size_t signal, size_t block,
+                                       std::vector<int64_t>& timestamps,
+                                       std::vector<uint64_t>& values) const {
+  timestamps.clear();
+  values.clear();
+
+  const SignalCapture::BlockInfo& info = m_blocks.at(signal).at(block);
+  const auto* header = reinterpret_cast<const SignalCapture::BlockHeader*>(
+      m_mapping + info.offset);
+
+  if (is_compressed()) {
+    return SignalCompression::decode(
+        reinterpret_cast<const uint8_t*>(header + 1), header->size,
+        header->count, is_real(signal), timestamps, values);
+  }
+
+  const int64_t* raw_timestamps = reinterpret_cast<const int64_t*>(header + 1);
+  const uint64_t* raw_values =
+      reinterpret_cast<const uint64_t*>(raw_timestamps + header->count);
+  timestamps.assign(raw_timestamps, raw_timestamps + header->count);
+  values.assign(raw_values, raw_values + header->count);
+  return true;
+}
+
+bool SignalCaptureReader::is_real(size_t signal) const {
+  return m_signals.at(signal).value_kind ==
+         static_cast<uint8_t>(SignalCapture::ValueKind::float64);
+}
+
+size_t SignalCaptureReader::read(size_t signal, int64_t from_ns, int64_t to_ns,
+                                 std::vector<int64_t>& timestamps,
+                                 std::vector<double>& values) const {
+  timestamps.clear();
+  values.clear();
+
+  const std::vector<SignalCapture::BlockInfo>& blocks = m_blocks.at(signal);
+  // First block which ends at or after from_ns.
+  auto it = std::lower_bound(
+      blocks.begin(), blocks.end(), from_ns,
+      [](const SignalCapture::BlockInfo& block, int64_t time) {
+        return block.last_timestamp < time;
+      });
+
+  const bool real = is_real(signal);
+  std::vector<int64_t> block_timestamps;
+  std::vector<uint64_t> block_values;
+
+  for (; it != blocks.end() && it->first_timestamp <= to_ns; ++it) {
+    if (!decode_block(signal, it - blocks.begin(), block_timestamps,
+                      block_values)) {
+      ERROR("[SignalCaptureReader::read] Block at offset "
+            << it->offset << " is corrupt.");
+      break;
+    }
+    const auto begin = std::lower_bound(block_timestamps.begin(),
+                                        block_timestamps.end(), from_ns);
+    const auto end =
+        std::upper_bound(begin, block_timestamps.end(), to_ns);
+    for (auto t = begin; t != end; ++t) {
+      const uint64_t bits = block_values[t - block_timestamps.begin()];
+      double value;
+      if (real) {
+        std::memcpy(&value, &bits, sizeof(value));
+      } else {
+        value = static_cast<double>(static_cast<int64_t>(bits));
+      }
+      timestamps.push_back(*t);
+      values.push_back(value);
+    }
+  }
+
+  return timestamps.size();
+}
+
+}  // end namespace kaco
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/signal_compression.h"
+
+namespace kaco {
+
+namespace {
+
+// Payload sizes of the variable length buckets for '10', '110', '1110' and
+// '1111' prefixes.
+const unsigned timestamp_buckets[4] = {16, 24, 32, 64};
+const unsigned integer_buckets[4] = {8, 16, 32, 64};
+
+uint64_t zigzag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>& output) : m_output(output) {}
+
+  ~BitWriter() {
+    if (m_bits > 0) {
+      m_output.push_back(static_cast<uint8_t>(m_buffer << (8 - m_bits)));
+    }
+  }
+
+  void write(uint64_t value, unsigned bits) {
+    while (bits > 0) {
+      const unsigned n = (bits < 8 - m_bits) ? bits : 8 - m_bits;
+      bits -= n;
+      m_buffer = (m_buffer << n) |
+                 static_cast<unsigned>((value >> bits) & ((1u << n) - 1));
+      m_bits += n;
+      if (m_bits == 8) {
+        m_output.push_back(static_cast<uint8_t>(m_buffer));
+        m_buffer = 0;
+        m_bits = 0;
+      }
+    }
+  }
+
+  void write_bucket(uint64_t value, const unsigned* buckets) {
+    if (value == 0) {
+      write(0, 1);
+      return;
+    }
+    for (unsigned i = 0; i < 3; ++i) {
+      if (value >> buckets[i] == 0) {
+        // i + 1 ones followed by a zero
+        write(((1u << (i + 1)) - 1) << 1, i + 2);
+        write(value, buckets[i]);
+        return;
+      }
+    }
+    write(0xF, 4);
+    write(value, buckets[3]);
+  }
+
+ private:
+  std::vector<uint8_t>& m_output;
+  unsigned m_buffer = 0;
+  unsigned m_bits = 0;
+};
+
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+  bool read(unsigned bits, uint64_t& value) {
+    if (m_position + bits > 8 * m_size) {
+      return false;
+    }
+    value = 0;
+    while (bits > 0) {
+      const unsigned offset = m_position % 8;
+      const unsigned n = (bits < 8 - offset) ? bits : 8 - offset;
+      const unsigned byte = m_data[m_position / 8];
+      value = (value << n) | ((byte >> (8 - offset - n)) & ((1u << n) - 1));
+      m_position += n;
+      bits -= n;
+    }
+    return true;
+  }
+
+  bool read_bucket(const unsigned* buckets, uint64_t& value) {
+    unsigned ones = 0;
+    uint64_t bit = 1;
+    while (ones < 4) {
+      if (!read(1, bit)) {
+        return false;
+      }
+      if (bit == 0) {
+        break;
+      }
+      ++ones;
+    }
+    if (ones == 0) {
+      value = 0;
+      return true;
+    }
+    return read(buckets[ones - 1], value);
+  }
+
+ private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_position = 0;
+};
+
+}  // end anonymous namespace
+
+void SignalCompression::encode(const int64_t* timestamps,
+                               const uint64_t* values, size_t count, bool real,
+                               std::vector<uint8_t>& output) {
+  if (count == 0) {
+    return;
+  }
+
+  BitWriter writer(output);
+
+  // Timestamps: delta-of-delta
+  writer.write(static_cast<uint64_t>(timestamps[0]), 64);
+  int64_t previous_delta = 0;
+  for (size_t i = 1; i < count; ++i) {
+    const int64_t delta = timestamps[i] - timestamps[i - 1];
+    writer.write_bucket(zigzag(delta - previous_delta), timestamp_buckets);
+    previous_delta = delta;
+  }
+
+  writer.write(values[0], 64);
+
+  if (!real) {
+    for (size_t i = 1; i < count; ++i) {
+      const int64_t delta = static_cast<int64_t>(values[i] - values[i - 1]);
+      writer.write_bucket(zigzag(delta), integer_buckets);
+    }
+    return;
+  }
+
+  // Real values: XOR with leading/trailing zero window
+  unsigned window_leading = 64;
+  unsigned window_trailing = 0;
+  for (size_t i = 1; i < count; ++i) {
+    const uint64_t x = values[i] ^ values[i - 1];
+    if (x == 0) {
+      writer.write(0, 1);
+      continue;
+    }
+
+    unsigned leading = __builtin_clzll(x);
+    const unsigned trailing = __builtin_ctzll(x);
+    if (leading > 31) {
+      leading = 31;
+    }
+
+    if (window_leading <= leading && window_trailing <= trailing) {
+      writer.write(0x2, 2);
+      writer.write(x >> window_trailing, 64 - window_leading - window_trailing);
+    } else {
+      const unsigned meaningful = 64 - leading - trailing;
+      writer.write(0x3, 2);
+      writer.write(leading, 5);
+      writer.write(meaningful - 1, 6);
+      writer.write(x >> trailing, meaningful);
+      window_leading = leading;
+      window_trailing = trailing;
+    }
+  }
+}
+
+bool SignalCompression::decode(const uint8_t* data, size_t size, size_t count,
+                               bool real, std::vector<int64_t>& timestamps,
+                               std::vector<uint64_t>& values) {
+  if (count == 0) {
+    return true;
+  }
+
+  BitReader reader(data, size);
+  uint64_t bits;
+
+  if (!reader.read(64, bits)) {
+    return false;
+  }
+  int64_t timestamp = static_cast<int64_t>(bits);
+  int64_t delta = 0;
+  timestamps.push_back(timestamp);
+  for (size_t i = 1; i < count; ++i) {
+    if (!reader.read_bucket(timestamp_buckets, bits)) {
+      return false;
+    }
+    delta += unzigzag(bits);
+    timestamp += delta;
+    timestamps.push_back(timestamp);
+  }
+
+  if (!reader.read(64, bits)) {
+    return false;
+  }
+  uint64_t value = bits;
+  values.push_back(value);
+
+  if (!real) {
+    for (size_t i = 1; i < count; ++i) {
+      if (!reader.read_bucket(integer_buckets, bits)) {
+        return false;
+      }
+      value += static_cast<uint64_t>(unzigzag(bits));
+      values.push_back(value);
+    }
+    return true;
+  }
+
+  unsigned window_leading = 64;
+  unsigned window_trailing = 0;
+  for (size_t i = 1; i < count; ++i) {
+    if (!reader.read(1, bits)) {
+      return false;
+    }
+    if (bits == 1) {
+      if (!reader.read(1, bits)) {
+        return false;
+      }
+      if (bits == 1) {
+        uint64_t leading;
+        uint64_t meaningful;
+        if (!reader.read(5, leading) || !reader.read(6, meaningful)) {
+          return false;
+        }
+        window_leading = leading;
+        window_trailing = 64 - leading - (meaningful + 1);
+      }
+      if (window_leading + window_trailing >= 64 ||
+          !reader.read(64 - window_leading - window_trailing, bits)) {
+        return false;
+      }
+      value ^= bits << window_trailing;
+    }
+    values.push_back(value);
+  }
+  return true;
+}
+
+}  // end namespace kaco
@@ -0,0 +1,606 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/master/slave.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/core/sdo_error.h"
+#include "kacanopen/master/dictionary_error.h"
+#include "kacanopen/master/eds_reader.h"
+#include "kacanopen/master/utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <thread>
+
+namespace kaco {
+
+Slave::Slave(Core& core, uint8_t node_id) : m_core(core), m_node_id(node_id) {
+  assert(node_id > 0 && node_id < 128);
+}
+
+Slave::~Slave() {
+  if (m_sdo_server) {
+    stop();
+  }
+  for (uint16_t cob_id : m_receive_pdo_cob_ids) {
+    m_core.pdo.remove_rpdo_received_callbacks(cob_id);
+  }
+}
+
+uint8_t Slave::get_node_id() const { return m_node_id; }
+
+void Slave::load_dictionary_from_eds(const std::string& path) {
+  EDSReader reader(m_dictionary, m_name_to_address);
+
+  if (!reader.load_file(path)) {
+    throw canopen_error(
+        "[Slave::load_dictionary_from_eds] Loading file not successful: " +
+        path);
+  }
+
+  if (!reader.import_entries()) {
+    throw canopen_error(
+        "[Slave::load_dictionary_from_eds] Importing entries failed for "
+        "file " +
+        path);
+  }
+
+  reader.import_default_values(m_node_id);
+}
+
+void Slave::add_entry(const uint16_t index, const uint8_t subindex,
+                      const std::string& name, const Type type,
+                      const AccessType access_type) {
+  const std::string entry_name = Utils::escape(name);
+  if (m_name_to_address.count(entry_name) > 0) {
+    throw canopen_error("[Slave::add_entry] Entry with name \"" + entry_name +
+                        "\" already exists.");
+  }
+  if (has_entry(index, subindex)) {
+    throw canopen_error("[Slave::add_entry] Entry with index " +
+                        std::to_string(index) + "sub" +
+                        std::to_string(subindex) + " already exists.");
+  }
+  Entry entry(index, subindex, entry_name, type, access_type);
+  const Address address{index, subindex};
+  m_dictionary.insert(std::make_pair(address, std::move(entry)));
+  m_name_to_address.insert(std::make_pair(entry_name, address));
+}
+
+void Slave::add_receive_pdo_mapping(uint16_t cob_id,
+                                    const std::string& entry_name,
+                                    uint8_t offset) {
+  const std::string name = Utils::escape(entry_name);
+
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+
+  const Entry& entry = m_dictionary.at(m_name_to_address.at(name));
+  const uint8_t type_size = Utils::get_type_size(entry.type);
+
+  if (offset + type_size > 8) {
+    throw dictionary_error(dictionary_error::type::mapping_size, name,
+                           "offset (" + std::to_string(offset) +
+                               ") + type_size (" + std::to_string(type_size) +
+                               ") > 8.");
+  }
+
+  m_receive_pdo_mappings.push_front({cob_id, name, offset});
+  const ReceivePDOMapping& mapping = m_receive_pdo_mappings.front();
+
+  if (std::find(m_receive_pdo_cob_ids.begin(), m_receive_pdo_cob_ids.end(),
+                cob_id) == m_receive_pdo_cob_ids.end()) {
+    m_receive_pdo_cob_ids.push_back(cob_id);
+  }
+  m_core.pdo.add_rpdo_received_callback(
+      cob_id, [this, &mapping](const std::vector<uint8_t>& data) {
+        pdo_received_callback(mapping, data);
+      });
+}
+
+void Slave::add_transmit_pdo_mapping(uint16_t cob_id,
+                                     const std::vector<Mapping>& mappings,
+                                     TransmissionType transmission_type,
+                                     std::chrono::milliseconds repeat_time) {
+  // Contructor can throw dictionary_error. Letting user handle this.
+  m_transmit_pdo_mappings.emplace_front(m_core, m_dictionary,
+                                        m_name_to_address, cob_id,
+                                        transmission_type, repeat_time,
+                                        mappings);
+  TransmitPDOMapping& pdo = m_transmit_pdo_mappings.front();
+
+  if (transmission_type == TransmissionType::ON_CHANGE) {
+    for (const Mapping& mapping : pdo.mappings) {
+      const std::string entry_name = Utils::escape(mapping.entry_name);
+
+      // entry exists because check_correctness() == true.
+      Entry& entry = m_dictionary.at(m_name_to_address.at(entry_name));
+
+      entry.add_value_changed_callback([this, &pdo](const Value&) {
+        if (m_state == NMT::State::operational) {
+          pdo.send();
+        }
+      });
+    }
+
+  } else if (transmission_type == TransmissionType::PERIODIC) {
+
+    if (repeat_time == std::chrono::milliseconds(0)) {
+      WARN(
+          "[Slave::add_transmit_pdo_mapping] Repeat time is 0. This could "
+          "overload the bus.");
+    }
+
+    pdo.run_periodic_transmitter = true;
+    pdo.periodic_transmitter = std::unique_ptr<std::thread>(
+        new std::thread([this, &pdo, repeat_time]() {
+          while (pdo.run_periodic_transmitter) {
+            if (m_state == NMT::State::operational) {
+              pdo.send();
+            }
+            std::this_thread::sleep_for(repeat_time);
+          }
+        }));
+  }
+}
+
+size_t Slave::map_pdos_from_dictionary() {
+  size_t count = 0;
+
+  // 512 receive and 512 transmit PDOs are possible (CiA 301).
+  for (uint16_t pdo = 0; pdo < 0x200; ++pdo) {
+    for (const bool transmit : {false, true}) {
+      const uint16_t communication_index = (transmit ? 0x1800 : 0x1400) + pdo;
+      const uint16_t mapping_index = communication_index + 0x200;
+
+      uint32_t cob_id;
+      uint32_t num_mapped;
+      if (!get_unsigned(communication_index, 1, cob_id) ||
+          !get_unsigned(mapping_index, 0, num_mapped)) {
+        continue;
+      }
+
+      if ((cob_id & 0x80000000) || num_mapped == 0 || num_mapped > 64) {
+        // PDO is invalid or nothing is mapped
+        continue;
+      }
+
+      std::vector<Mapping> mappings;
+      uint8_t offset = 0;
+      bool valid = true;
+
+      for (uint8_t subindex = 1; subindex <= num_mapped && valid; ++subindex) {
+        uint32_t mapping;
+        valid = get_unsigned(mapping_index, subindex, mapping);
+        if (!valid) {
+          break;
+        }
+
+        const Address address{static_cast<uint16_t>(mapping >> 16),
+                               static_cast<uint8_t>((mapping >> 8) & 0xFF)};
+        const uint8_t bits = mapping & 0xFF;
+        const auto it = m_dictionary.find(address);
+
+        valid = (it != m_dictionary.end() && bits % 8 == 0 &&
+                 bits / 8 == Utils::get_type_size(it->second.type) &&
+                 offset + bits / 8 <= 8);
+        if (valid) {
+          mappings.push_back({it->second.name, offset});
+          offset += bits / 8;
+        }
+      }
+
+      if (!valid) {
+        DEBUG_LOG("[Slave::map_pdos_from_dictionary] Skipping unsupported "
+                  "mapping 0x"
+                  << std::hex << mapping_index);
+        continue;
+      }
+
+      const uint16_t pdo_cob_id = cob_id & 0x7FF;
+
+      if (transmit) {
+        // Cyclic synchronous types (2-240) are sent on every SYNC as well.
+        uint32_t transmission_type;
+        const bool synchronous =
+            get_unsigned(communication_index, 2, transmission_type) &&
+            transmission_type <= 240;
+        m_transmit_pdo_mappings.emplace_front(
+            m_core, m_dictionary, m_name_to_address, pdo_cob_id,
+            synchronous ? TransmissionType::SYNCHRONOUS
+                        : TransmissionType::PERIODIC,
+            std::chrono::milliseconds(0), mappings);
+      } else {
+        for (const Mapping& mapping : mappings) {
+          add_receive_pdo_mapping(pdo_cob_id, mapping.entry_name,
+                                  mapping.offset);
+        }
+      }
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+void Slave::start() {
+  assert(!m_sdo_server);
+
+  m_sdo_server.reset(new SDOServer(
+      m_core, m_node_id,
+      std::bind(&Slave::sdo_upload, this, std::placeholders::_1,
+                std::placeholders::_2),
+      std::bind(&Slave::sdo_download, this, std::placeholders::_1,
+                std::placeholders::_2, std::placeholders::_3)));
+
+  m_core.nmt.register_local_node(
+      m_node_id, std::bind(&Slave::nmt_command, this, std::placeholders::_1),
+      std::bind(&Slave::nmt_guard_request, this));
+
+  m_sync_callback_id = m_core.sync.add_sync_received_callback([this](uint8_t) {
+    if (m_state != NMT::State::operational) {
+      return;
+    }
+    for (const TransmitPDOMapping& pdo : m_transmit_pdo_mappings) {
+      if (pdo.transmission_type == TransmissionType::SYNCHRONOUS) {
+        pdo.send();
+      }
+    }
+  });
+
+  send_boot_up();
+}
+
+void Slave::stop() {
+  assert(m_sdo_server);
+  m_core.nmt.remove_local_node(m_node_id);
+  m_core.sync.remove_sync_received_callback(m_sync_callback_id);
+  m_sdo_server.reset();
+  m_state = NMT::State::stopped;
+}
+
+size_t Slave::send_transmit_pdos() {
+  if (m_state != NMT::State::operational) {
+    return 0;
+  }
+  size_t count = 0;
+  for (const TransmitPDOMapping& pdo : m_transmit_pdo_mappings) {
+    if (pdo.transmission_type != TransmissionType::SYNCHRONOUS) {
+      pdo.send();
+      ++count;
+    }
+  }
+  return count;
+}
+
+void Slave::set_missing_values_to_zero() {
+  for (auto& pair : m_dictionary) {
+    Entry& entry = pair.second;
+    if (entry.valid() || entry.type == Type::invalid) {
+      continue;
+    }
+    if (entry.type == Type::string) {
+      entry.set_value(Value(std::string()));
+    } else if (entry.type == Type::octet_string) {
+      entry.set_value(Value(std::vector<uint8_t>()));
+    } else {
+      const std::vector<uint8_t> zero(Utils::get_type_size(entry.type), 0);
+      entry.set_value(Value(entry.type, zero));
+    }
+  }
+}
+
+void Slave::send_heartbeat() {
+  const Message message = {
+      static_cast<uint16_t>(0x700 + m_node_id),
+      false,
+      1,
+      {static_cast<uint8_t>(m_state.load()), 0, 0, 0, 0, 0, 0, 0}};
+  m_core.send(message);
+}
+
+std::chrono::milliseconds Slave::get_heartbeat_period() const {
+  uint32_t period = 0;
+  get_unsigned(0x1017, 0, period);
+  return std::chrono::milliseconds(period);
+}
+
+NMT::State Slave::get_state() const { return m_state; }
+
+bool Slave::has_entry(const std::string& entry_name) const {
+  const std::string name = Utils::escape(entry_name);
+  return m_name_to_address.count(name) > 0 &&
+         has_entry(m_name_to_address.at(name).index,
+                   m_name_to_address.at(name).subindex);
+}
+
+bool Slave::has_entry(const uint16_t index, const uint8_t subindex) const {
+  return m_dictionary.count(Address{index, subindex}) > 0;
+}
+
+Type Slave::get_entry_type(const std::string& entry_name) const {
+  const std::string name = Utils::escape(entry_name);
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+  return m_dictionary.at(m_name_to_address.at(name)).get_type();
+}
+
+Type Slave::get_entry_type(const uint16_t index, const uint8_t subindex) const {
+  if (!has_entry(index, subindex)) {
+    throw dictionary_error(
+        dictionary_error::type::unknown_entry,
+        std::to_string(index) + "sub" + std::to_string(subindex));
+  }
+  return m_dictionary.at(Address{index, subindex}).get_type();
+}
+
+const Value& Slave::get_entry(const std::string& entry_name) const {
+  const std::string name = Utils::escape(entry_name);
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+  return m_dictionary.at(m_name_to_address.at(name)).get_value();
+}
+
+const Value& Slave::get_entry(const uint16_t index,
+                              const uint8_t subindex) const {
+  if (!has_entry(index, subindex)) {
+    throw dictionary_error(
+        dictionary_error::type::unknown_entry,
+        std::to_string(index) + "sub" + std::to_string(subindex));
+  }
+  return m_dictionary.at(Address{index, subindex}).get_value();
+}
+
+void Slave::set_entry(const std::string& entry_name, const Value& value) {
+  const std::string name = Utils::escape(entry_name);
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+  const Address address = m_name_to_address.at(name);
+  set_entry(address.index, address.subindex, value);
+}
+
+void Slave::set_entry(const uint16_t index, const uint8_t subindex,
+                      const Value& value) {
+  const std::string index_string =
+      std::to_string(index) + "sub" + std::to_string(subindex);
+  if (!has_entry(index, subindex)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, index_string);
+  }
+  Entry& entry = m_dictionary.at(Address{index, subindex});
+  if (value.type != entry.type) {
+    throw dictionary_error(
+        dictionary_error::type::wrong_type, index_string,
+        "Entry type: " + Utils::type_to_string(entry.type) +
+            ", given type: " + Utils::type_to_string(value.type));
+  }
+  entry.set_value(value);
+}
+
+void Slave::add_value_changed_callback(const std::string& entry_name,
+                                       Entry::ValueChangedCallback callback) {
+  const std::string name = Utils::escape(entry_name);
+  if (!has_entry(name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, name);
+  }
+  m_dictionary.at(m_name_to_address.at(name))
+      .add_value_changed_callback(callback);
+}
+
+void Slave::add_value_changed_callback(const uint16_t index,
+                                       const uint8_t subindex,
+                                       Entry::ValueChangedCallback callback) {
+  if (!has_entry(index, subindex)) {
+    throw dictionary_error(
+        dictionary_error::type::unknown_entry,
+        std::to_string(index) + "sub" + std::to_string(subindex));
+  }
+  m_dictionary.at(Address{index, subindex}).add_value_changed_callback(callback);
+}
+
+void Slave::print_dictionary() const {
+  using EntryRef = std::reference_wrapper<const kaco::Entry>;
+  std::vector<EntryRef> entries;
+
+  for (const auto& pair : m_dictionary) {
+    entries.push_back(std::ref(pair.second));
+  }
+
+  // sort by index and subindex
+  std::sort(
+      entries.begin(), entries.end(),
+      [](const EntryRef& l, const EntryRef& r) { return l.get() < r.get(); });
+
+  for (const auto& entry : entries) {
+    entry.get().print();
+  }
+}
+
+bool Slave::get_unsigned(uint16_t index, uint8_t subindex,
+                         uint32_t& result) const {
+  const auto it = m_dictionary.find(Address{index, subindex});
+  if (it == m_dictionary.end() || !it->second.valid()) {
+    return false;
+  }
+
+  const Value& value = it->second.get_value();
+  switch (value.type) {
+    case Type::uint8:
+      result = value.uint8;
+      return true;
+    case Type::uint16:
+      result = value.uint16;
+      return true;
+    case Type::uint32:
+      result = value.uint32;
+      return true;
+    default:
+      return false;
+  }
+}
+
+Entry& Slave::get_entry_for_sdo(uint16_t index, uint8_t subindex) {
+  if (m_state == NMT::State::stopped) {
+    throw sdo_error(sdo_error::type::transfer_or_storage_device_state);
+  }
+
+  const auto it = m_dictionary.find(Address{index, subindex});
+  if (it != m_dictionary.end()) {
+    return it->second;
+  }
+
+  // Distinguish between unknown object and unknown subindex.
+  for (const auto& pair : m_dictionary) {
+    if (pair.first.index == index) {
+      throw sdo_error(sdo_error::type::subindex);
+    }
+  }
+  throw sdo_error(sdo_error::type::not_in_dictionary);
+}
+
+std::vector<uint8_t> Slave::sdo_upload(uint16_t index, uint8_t subindex) {
+  const Entry& entry = get_entry_for_sdo(index, subindex);
+
+  if (entry.access_type == AccessType::write_only) {
+    throw sdo_error(sdo_error::type::write_only);
+  }
+
+  if (!entry.valid()) {
+    throw sdo_error(sdo_error::type::no_data);
+  }
+
+  DEBUG_LOG("[Slave::sdo_upload] " << entry.name);
+  return entry.get_value().get_bytes();
+}
+
+void Slave::sdo_download(uint16_t index, uint8_t subindex,
+                         const std::vector<uint8_t>& data) {
+  Entry& entry = get_entry_for_sdo(index, subindex);
+
+  if (entry.access_type == AccessType::read_only ||
+      entry.access_type == AccessType::constant) {
+    throw sdo_error(sdo_error::type::read_only);
+  }
+
+  if (entry.type == Type::invalid) {
+    throw sdo_error(sdo_error::type::internal_incompatibility);
+  }
+
+  if (entry.type != Type::string && entry.type != Type::octet_string) {
+    const uint8_t type_size = Utils::get_type_size(entry.type);
+    if (data.size() > type_size) {
+      throw sdo_error(sdo_error::type::service_parameter_too_high);
+    } else if (data.size() < type_size) {
+      throw sdo_error(sdo_error::type::service_parameter_too_low);
+    }
+  }
+
+  DEBUG_LOG("[Slave::sdo_download] " << entry.name);
+  entry.set_value(Value(entry.type, data));
+}
+
+void Slave::nmt_command(NMT::Command command) {
+  switch (command) {
+    case NMT::Command::start_node: {
+      m_state = NMT::State::operational;
+      break;
+    }
+    case NMT::Command::stop_node: {
+      m_state = NMT::State::stopped;
+      break;
+    }
+    case NMT::Command::enter_preoperational: {
+      m_state = NMT::State::preoperational;
+      break;
+    }
+    case NMT::Command::reset_node:
+    case NMT::Command::reset_communication: {
+      send_boot_up();
+      break;
+    }
+    default: {
+      DEBUG_LOG("[Slave::nmt_command] Unknown NMT command.");
+      break;
+    }
+  }
+}
+
+void Slave::nmt_guard_request() {
+  const uint8_t state = static_cast<uint8_t>(m_state.load());
+  const Message message = {
+      static_cast<uint16_t>(0x700 + m_node_id),
+      false,
+      1,
+      {static_cast<uint8_t>(state | (m_guard_toggle ? 0x80 : 0x00)), 0, 0, 0,
+       0, 0, 0, 0}};
+  m_guard_toggle = !m_guard_toggle;
+  m_core.send(message);
+}
+
+void Slave::send_boot_up() {
+  m_guard_toggle = false;
+  const Message message = {static_cast<uint16_t>(0x700 + m_node_id),
+                           false,
+                           1,
+                           {0, 0, 0, 0, 0, 0, 0, 0}};
+  m_core.send(message);
+  m_state = NMT::State::preoperational;
+}
+
+void Slave::pdo_received_callback(const ReceivePDOMapping& mapping,
+                                  const std::vector<uint8_t>& data) {
+  if (m_state != NMT::State::operational) {
+    return;
+  }
+
+  Entry& entry = m_dictionary.at(m_name_to_address.at(mapping.entry_name));
+  const uint8_t type_size = Utils::get_type_size(entry.type);
+
+  if (data.size() < mapping.offset + type_size) {
+    // We don't throw an exception here, because this could be a network error.
+    WARN("[Slave::pdo_received_callback] PDO has wrong size. Ignoring it...");
+    DUMP(data.size());
+    DUMP(mapping.offset);
+    DUMP(type_size);
+    return;
+  }
+
+  const std::vector<uint8_t> bytes(data.begin() + mapping.offset,
+                                   data.begin() + mapping.offset + type_size);
+  entry.set_value(Value(entry.type, bytes));
+}
+
+}  // end namespace kaco
@@ -32,9 +32,11 @@
 #include "kacanopen/master/transmit_pdo_mapping.h"
 #include "kacanopen/core/core.h"
 #include "kacanopen/core/logger.h"
+#include "kacanopen/core/probes.h"
 #include "kacanopen/master/dictionary_error.h"
 #include "kacanopen/master/entry.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace kaco {
@@ -63,11 +65,19 @@ TransmitPDOMapping::~TransmitPDOMapping() {
 }
 
 void TransmitPDOMapping::send() const {
-  std::vector<uint8_t> data(8, 0);
-  size_t size = 0;
-
   DEBUG_LOG("[TransmitPDOMapping::send] Sending transmit PDO with cob_id 0x"
             << std::hex << cob_id);
+  const Message message = get_message();
+  KACO_PROBE2(tpdo_send, message.cob_id, message.len);
+  m_core.send(message);
+}
+
+Message TransmitPDOMapping::get_message() const {
+  Message message;
+  message.cob_id = cob_id;
+  message.rtr = false;
+  message.len = 0;
+  std::fill(message.data, message.data + 8, 0);
 
   for (const Mapping& mapping : mappings) {
     const std::string entry_name = Utils::escape(mapping.entry_name);
@@ -76,22 +86,22 @@ void TransmitPDOMapping::send() const {
     const std::vector<uint8_t> bytes = value.get_bytes();
     assert(mapping.offset + bytes.size() <= 8);
 
-    DEBUG_LOG("[TransmitPDOMapping::send] Mapping:");
+    DEBUG_LOG("[TransmitPDOMapping::get_message] Mapping:");
     DEBUG_DUMP(mapping.offset);
     DEBUG_DUMP(entry_name);
     DEBUG_DUMP_HEX(value);
 
     uint8_t count = 0;
     for (uint8_t i = mapping.offset; i < mapping.offset + bytes.size(); ++i) {
-      data[i] = bytes[count++];
+      message.data[i] = bytes[count++];
     }
 
-    size = std::max(size, mapping.offset + bytes.size());
+    message.len = std::max<uint8_t>(message.len, mapping.offset + bytes.size());
   }
 
-  assert(size <= 8 && "[TransmitPDOMapping::send] Malformed PDO mapping.");
-  data.resize(size);
-  m_core.pdo.send(cob_id, data);
+  assert(message.len <= 8 &&
+         "[TransmitPDOMapping::get_message] Malformed PDO mapping.");
+  return message;
 }
 
 void TransmitPDOMapping::check_correctness() const {
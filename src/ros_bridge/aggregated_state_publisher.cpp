@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/ros_bridge/aggregated_state_publisher.h"
+#include "kacanopen/core/canopen_error.h"
+#include "kacanopen/core/logger.h"
+#include "kacanopen/master/dictionary_error.h"
+#include "kacanopen/master/utils.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace kaco {
+
+AggregatedStatePublisher::AggregatedStatePublisher(
+    const std::string& topic_prefix)
+    : m_topic_prefix(topic_prefix) {}
+
+AggregatedStatePublisher::AggregatedStatePublisher(
+    Core& core, const std::string& topic_prefix)
+    : m_core(&core), m_topic_prefix(topic_prefix) {}
+
+AggregatedStatePublisher::~AggregatedStatePublisher() {
+  if (m_core && m_advertised) {
+    m_core->sync.remove_sync_received_callback(m_sync_callback_id);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_worker.join();
+  }
+  m_joint_state_publisher.shutdown();
+  m_entry_publisher.shutdown();
+}
+
+void AggregatedStatePublisher::add_joint(
+    Device& device, const std::string& joint_name, int32_t position_0_degree,
+    int32_t position_360_degree, const std::string& velocity_field,
+    const std::string& effort_field, const std::string& position_field) {
+  assert(!m_advertised);
+  for (const std::string& field :
+       {position_field, velocity_field, effort_field}) {
+    if (!field.empty() && !device.has_entry(field)) {
+      throw dictionary_error(dictionary_error::type::unknown_entry, field);
+    }
+  }
+
+  Joint joint;
+  joint.device = &device;
+  joint.name = joint_name;
+  joint.offset = position_0_degree;
+  joint.scale = 2 * M_PI / (static_cast<double>(position_360_degree) -
+                            position_0_degree);
+  joint.position_field = position_field;
+  joint.velocity_field = velocity_field;
+  joint.effort_field = effort_field;
+  m_joints.push_back(joint);
+}
+
+void AggregatedStatePublisher::add_entry(Device& device,
+                                         const std::string& entry_name) {
+  assert(!m_advertised);
+  if (!device.has_entry(entry_name)) {
+    throw dictionary_error(dictionary_error::type::unknown_entry, entry_name);
+  }
+
+  EntryField entry;
+  entry.device = &device;
+  entry.name = "device" + std::to_string(device.get_node_id()) + "/" +
+               Utils::escape(entry_name);
+  entry.entry_name = entry_name;
+  m_entries.push_back(entry);
+}
+
+void AggregatedStatePublisher::advertise() {
+  ros::NodeHandle nh;
+  if (!m_joints.empty()) {
+    DEBUG_LOG("Advertising " << m_topic_prefix << "/joint_states");
+    m_joint_state_publisher = nh.advertise<sensor_msgs::JointState>(
+        m_topic_prefix + "/joint_states", queue_size);
+  }
+  if (!m_entries.empty()) {
+    DEBUG_LOG("Advertising " << m_topic_prefix << "/entries");
+    m_entry_publisher = nh.advertise<kacanopen::EntryStates>(
+        m_topic_prefix + "/entries", queue_size);
+  }
+  m_advertised = true;
+
+  if (m_core) {
+    m_worker = std::thread(&AggregatedStatePublisher::worker_loop, this);
+    m_sync_callback_id = m_core->sync.add_sync_received_callback(
+        [this](uint8_t) { sync_received(); });
+  }
+}
+
+void AggregatedStatePublisher::publish() {
+  if (!m_core) {
+    publish_state();
+  }
+}
+
+bool AggregatedStatePublisher::is_event_driven() const {
+  return m_core != nullptr;
+}
+
+bool AggregatedStatePublisher::read(Device& device,
+                                    const std::string& entry_name,
+                                    double& value) {
+  try {
+    const Value& cached = device.get_entry(entry_name, ReadAccessMethod::cache);
+    switch (cached.type) {
+      case Type::boolean:
+        value = static_cast<bool>(cached);
+        return true;
+      case Type::uint8:
+        value = static_cast<uint8_t>(cached);
+        return true;
+      case Type::uint16:
+        value = static_cast<uint16_t>(cached);
+        return true;
+      case Type::uint32:
+        value = static_cast<uint32_t>(cached);
+        return true;
+      case Type::uint64:
+        value = static_cast<uint64_t>(cached);
+        return true;
+      case Type::int8:
+        value = static_cast<int8_t>(cached);
+        return true;
+      case Type::int16:
+        value = static_cast<int16_t>(cached);
+        return true;
+      case Type::int32:
+        value = static_cast<int32_t>(cached);
+        return true;
+      case Type::int64:
+        value = static_cast<int64_t>(cached);
+        return true;
+      case Type::real32:
+        value = static_cast<float>(cached);
+        return true;
+      case Type::real64:
+        value = static_cast<double>(cached);
+        return true;
+      default:
+        break;
+    }
+  } catch (const canopen_error&) {
+    // no value received yet
+  }
+  value = std::numeric_limits<double>::quiet_NaN();
+  return false;
+}
+
+void AggregatedStatePublisher::publish_state() {
+  if (!m_advertised) {
+    return;
+  }
+  sensor_msgs::JointState joint_state;
+  kacanopen::EntryStates entry_states;
+  fill(ros::Time::now(), joint_state, entry_states);
+  send(joint_state, entry_states);
+}
+
+void AggregatedStatePublisher::sync_received() {
+  // Runs in the receive thread: only read the caches here.
+  const ros::Time stamp = ros::Time::now();
+  if (!m_previous_sync_stamp.isZero()) {
+    sensor_msgs::JointState joint_state;
+    kacanopen::EntryStates entry_states;
+    fill(m_previous_sync_stamp, joint_state, entry_states);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      // An unpublished previous cycle is replaced.
+      m_joint_state = std::move(joint_state);
+      m_entry_states = std::move(entry_states);
+      m_pending = true;
+    }
+    m_condition.notify_one();
+  }
+  m_previous_sync_stamp = stamp;
+}
+
+void AggregatedStatePublisher::worker_loop() {
+  sensor_msgs::JointState joint_state;
+  kacanopen::EntryStates entry_states;
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while (true) {
+    m_condition.wait(lock, [this] { return m_pending || m_stopping; });
+    if (m_stopping) {
+      break;
+    }
+    joint_state = std::move(m_joint_state);
+    entry_states = std::move(m_entry_states);
+    m_pending = false;
+    lock.unlock();
+    send(joint_state, entry_states);
+    lock.lock();
+  }
+}
+
+void AggregatedStatePublisher::fill(const ros::Time& stamp,
+                                    sensor_msgs::JointState& js,
+                                    kacanopen::EntryStates& msg) {
+  if (!m_joints.empty()) {
+    js.header.stamp = stamp;
+    js.name.reserve(m_joints.size());
+    js.position.reserve(m_joints.size());
+
+    bool has_velocity = false;
+    bool has_effort = false;
+    for (const Joint& joint : m_joints) {
+      has_velocity = has_velocity || !joint.velocity_field.empty();
+      has_effort = has_effort || !joint.effort_field.empty();
+    }
+
+    for (const Joint& joint : m_joints) {
+      double value;
+      js.name.push_back(joint.name);
+      read(*joint.device, joint.position_field, value);
+      js.position.push_back((value - joint.offset) * joint.scale);
+      if (has_velocity) {
+        if (joint.velocity_field.empty() ||
+            !read(*joint.device, joint.velocity_field, value)) {
+          value = std::numeric_limits<double>::quiet_NaN();
+        }
+        js.velocity.push_back(value * joint.scale);
+      }
+      if (has_effort) {
+        if (joint.effort_field.empty() ||
+            !read(*joint.device, joint.effort_field, value)) {
+          value = std::numeric_limits<double>::quiet_NaN();
+        }
+        js.effort.push_back(value);
+      }
+    }
+  }
+
+  if (!m_entries.empty()) {
+    msg.header.stamp = stamp;
+    msg.name.reserve(m_entries.size());
+    msg.value.reserve(m_entries.size());
+    msg.valid.reserve(m_entries.size());
+
+    for (const EntryField& entry : m_entries) {
+      double value;
+      const bool valid = read(*entry.device, entry.entry_name, value);
+      msg.name.push_back(entry.name);
+      msg.value.push_back(value);
+      msg.valid.push_back(valid);
+    }
+  }
+}
+
+void AggregatedStatePublisher::send(const sensor_msgs::JointState& js,
+                                    const kacanopen::EntryStates& msg) {
+  if (!m_joints.empty()) {
+    m_joint_state_publisher.publish(js);
+  }
+  if (!m_entries.empty()) {
+    m_entry_publisher.publish(msg);
+  }
+}
+
+}  // end namespace kaco
@@ -34,34 +34,52 @@
 #include "kacanopen/core/sdo_error.h"
 #include "ros/ros.h"
 
-#include <future>
+#include <algorithm>
+#include <exception>
+#include <map>
 
 namespace kaco {
 
+constexpr std::chrono::milliseconds Bridge::max_wait;
+
 Bridge::Bridge() : m_running(true) { }
 
-Bridge::~Bridge() { 
+Bridge::~Bridge() {
   m_running = false;
-  // wait for publisher loops to finish
-  m_futures.remove_if([](const std::future<void> &f) {
-    // return true if publisher has finished
-    return (f.wait_for(std::chrono::steady_clock::duration::zero()) ==
-            std::future_status::ready);
-  });
+  m_schedule_condition.notify_all();
+  if (m_scheduler.joinable()) {
+    m_scheduler.join();
+  }
+  m_worker_condition.notify_all();
+  for (std::thread& worker : m_workers) {
+    worker.join();
+  }
 }
 
 void Bridge::add_publisher(std::shared_ptr<Publisher> publisher,
                            double loop_rate) {
   m_publishers.push_back(publisher);
   publisher->advertise();
-  m_futures.push_front(
-      std::async(std::launch::async, [publisher, loop_rate, this]() {
-        ros::Rate rate(loop_rate);
-        while (ros::ok() && m_running) {
-          publisher->publish();
-          rate.sleep();
-        }
-      }));
+  if (publisher->is_event_driven()) {
+    return;
+  }
+
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / loop_rate));
+  // Align to the rate grid so that publishers with equal rates are due
+  // at the same tick.
+  const Clock::duration since_epoch = Clock::now().time_since_epoch();
+  const Clock::time_point due(since_epoch - since_epoch % period + period);
+
+  {
+    std::lock_guard<std::mutex> lock(m_schedule_mutex);
+    m_schedule.push({due, period, publisher->get_node_id(), publisher});
+    // Started lazily because ros::ok() is false before ros::init().
+    if (!m_scheduler.joinable()) {
+      m_scheduler = std::thread(&Bridge::scheduler_loop, this);
+    }
+  }
+  m_schedule_condition.notify_one();
 }
 
 void Bridge::add_subscriber(std::shared_ptr<Subscriber> subscriber) {
@@ -75,4 +93,114 @@ void Bridge::run() {
   ros::waitForShutdown();
 }
 
+void Bridge::scheduler_loop() {
+  std::vector<ScheduledPublisher> due;
+  std::vector<PublisherGroup> groups;
+
+  while (m_running && ros::ok()) {
+    {
+      std::unique_lock<std::mutex> lock(m_schedule_mutex);
+      Clock::time_point wake_up = Clock::now() + max_wait;
+      if (!m_schedule.empty()) {
+        wake_up = std::min(wake_up, m_schedule.top().due);
+      }
+      m_schedule_condition.wait_until(lock, wake_up);
+
+      const Clock::time_point now = Clock::now();
+      while (!m_schedule.empty() && m_schedule.top().due <= now) {
+        due.push_back(m_schedule.top());
+        m_schedule.pop();
+      }
+    }
+
+    if (due.empty()) {
+      continue;
+    }
+
+    std::map<int, PublisherGroup> by_node;
+    for (const ScheduledPublisher& entry : due) {
+      by_node[entry.node_id].push_back(entry.publisher);
+    }
+    for (auto& pair : by_node) {
+      groups.push_back(std::move(pair.second));
+    }
+    DEBUG_LOG("Publishing " << due.size() << " publishers in "
+                            << groups.size() << " node groups.");
+
+    run_groups(groups);
+    groups.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(m_schedule_mutex);
+      const Clock::time_point now = Clock::now();
+      for (ScheduledPublisher& entry : due) {
+        entry.due += entry.period;
+        if (entry.due <= now) {
+          // Overrun: skip missed ticks instead of publishing a burst.
+          const Clock::duration late = now - entry.due;
+          entry.due += late - late % entry.period + entry.period;
+        }
+        m_schedule.push(std::move(entry));
+      }
+    }
+    due.clear();
+  }
+
+  DEBUG_LOG("Scheduler finished.");
+}
+
+void Bridge::run_groups(std::vector<PublisherGroup>& groups) {
+  if (groups.size() > 1) {
+    std::lock_guard<std::mutex> lock(m_worker_mutex);
+    // One thread per node at most - more wouldn't help because transfers
+    // to the same node are sequential anyway.
+    while (m_workers.size() < groups.size() - 1) {
+      m_workers.emplace_back(&Bridge::worker_loop, this);
+    }
+    for (size_t i = 1; i < groups.size(); ++i) {
+      m_worker_queue.push_back(std::move(groups[i]));
+    }
+    m_groups_pending += groups.size() - 1;
+  }
+  m_worker_condition.notify_all();
+
+  publish_group(groups.front());
+
+  std::unique_lock<std::mutex> lock(m_worker_mutex);
+  m_groups_done_condition.wait(lock, [this] { return m_groups_pending == 0; });
+}
+
+void Bridge::worker_loop() {
+  std::unique_lock<std::mutex> lock(m_worker_mutex);
+  while (true) {
+    m_worker_condition.wait(
+        lock, [this] { return !m_worker_queue.empty() || !m_running; });
+    if (m_worker_queue.empty()) {
+      // not running anymore
+      return;
+    }
+
+    PublisherGroup group = std::move(m_worker_queue.front());
+    m_worker_queue.pop_front();
+    lock.unlock();
+    publish_group(group);
+    lock.lock();
+
+    --m_groups_pending;
+    if (m_groups_pending == 0) {
+      m_groups_done_condition.notify_one();
+    }
+  }
+}
+
+void Bridge::publish_group(const PublisherGroup& group) {
+  for (const auto& publisher : group) {
+    try {
+      publisher->publish();
+    } catch (const std::exception& error) {
+      ERROR("Exception in Bridge while publishing: " << error.what());
+    }
+  }
+}
+
 }  // end namespace kaco
@@ -44,7 +44,9 @@
 #include "std_msgs/UInt32.h"
 #include "std_msgs/UInt8.h"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 namespace kaco {
 
@@ -60,8 +62,29 @@ EntryPublisher::EntryPublisher(Device& device, const std::string& entry_name,
   m_type = device.get_entry_type(entry_name);
 }
 
+EntryPublisher::EntryPublisher(Device& device, const std::string& entry_name,
+                               std::chrono::milliseconds min_interval)
+    : EntryPublisher(device, entry_name, ReadAccessMethod::cache) {
+  m_event_driven = true;
+  m_min_interval = min_interval;
+
+  const std::vector<std::string> mapped = device.get_pdo_mapped_entries();
+  if (std::find(mapped.begin(), mapped.end(), m_name) == mapped.end()) {
+    WARN("[EntryPublisher] " << m_name
+                             << " is not mapped to a PDO. It will only be "
+                                "published when it is read explicitly.");
+  }
+
+  m_callback_id = device.add_value_changed_callback(
+      entry_name, [this](const Value& value) { value_changed(value); });
+}
+
 EntryPublisher::~EntryPublisher()
 {
+  if (m_event_driven) {
+    m_device.remove_value_changed_callback(m_entry_name, m_callback_id);
+  }
+  m_timer.stop();
   m_publisher.shutdown();
 }
 
@@ -98,68 +121,114 @@ void EntryPublisher::advertise() {
     default:
       ERROR("[EntryPublisher::advertise] Invalid entry type.")
   }
+
+  if (m_event_driven) {
+    if (m_min_interval.count() > 0) {
+      m_timer = nh.createTimer(ros::Duration(m_min_interval.count() / 1000.0),
+                               &EntryPublisher::flush, this);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_advertised = true;
+  }
 }
 
 void EntryPublisher::publish() {
-  try {
-    Value value = m_device.get_entry(m_entry_name, m_access_method);
-
-    switch (m_type) {
-      case Type::uint8: {
-        std_msgs::UInt8 msg;
-        msg.data = value;  // auto cast!
-        m_publisher.publish(msg);
-        break;
-      }
-      case Type::uint16: {
-        std_msgs::UInt16 msg;
-        msg.data = value;  // auto cast!
-        m_publisher.publish(msg);
-        break;
-      }
-      case Type::uint32: {
-        std_msgs::UInt32 msg;
-        msg.data = value;  // auto cast!
-        m_publisher.publish(msg);
-        break;
-      }
-      case Type::int8: {
-        std_msgs::Int8 msg;
-        msg.data = value;  // auto cast!
-        m_publisher.publish(msg);
-        break;
-      }
-      case Type::int16: {
-        std_msgs::Int16 msg;
-        msg.data = value;  // auto cast!
-        m_publisher.publish(msg);
-        break;
-      }
-      case Type::int32: {
-        std_msgs::Int32 msg;
-        msg.data = value;  // auto cast!
-        m_publisher.publish(msg);
-        break;
-      }
-      case Type::boolean: {
-        std_msgs::Bool msg;
-        msg.data = value;  // auto cast!
-        m_publisher.publish(msg);
-        break;
-      }
-      case Type::string: {
-        std_msgs::String msg;
-        msg.data = (std::string)value;
-        m_publisher.publish(msg);
-        break;
-      }
-      default: { ERROR("[EntryPublisher::advertise] Invalid entry type.") }
-    }
+  if (m_event_driven) {
+    // published by value_changed()
+    return;
+  }
 
+  try {
+    publish_value(m_device.get_entry(m_entry_name, m_access_method));
   } catch (const sdo_error& error) {
     // TODO: only catch timeouts?
     ERROR("Exception in EntryPublisher::publish(): " << error.what());
   }
 }
 
+bool EntryPublisher::is_event_driven() const { return m_event_driven; }
+
+int EntryPublisher::get_node_id() const { return m_device.get_node_id(); }
+
+void EntryPublisher::value_changed(const Value& value) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_advertised) {
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (now - m_last_publish >= m_min_interval) {
+    m_last_publish = now;
+    m_pending = false;
+    publish_value(value);
+  } else {
+    m_pending = true;
+    m_pending_value = value;
+  }
+}
+
+void EntryPublisher::flush(const ros::TimerEvent&) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto now = std::chrono::steady_clock::now();
+  if (m_pending && now - m_last_publish >= m_min_interval) {
+    m_last_publish = now;
+    m_pending = false;
+    publish_value(m_pending_value);
+  }
+}
+
+void EntryPublisher::publish_value(const Value& value) {
+  switch (m_type) {
+    case Type::uint8: {
+      std_msgs::UInt8 msg;
+      msg.data = value;  // auto cast!
+      m_publisher.publish(msg);
+      break;
+    }
+    case Type::uint16: {
+      std_msgs::UInt16 msg;
+      msg.data = value;  // auto cast!
+      m_publisher.publish(msg);
+      break;
+    }
+    case Type::uint32: {
+      std_msgs::UInt32 msg;
+      msg.data = value;  // auto cast!
+      m_publisher.publish(msg);
+      break;
+    }
+    case Type::int8: {
+      std_msgs::Int8 msg;
+      msg.data = value;  // auto cast!
+      m_publisher.publish(msg);
+      break;
+    }
+    case Type::int16: {
+      std_msgs::Int16 msg;
+      msg.data = value;  // auto cast!
+      m_publisher.publish(msg);
+      break;
+    }
+    case Type::int32: {
+      std_msgs::Int32 msg;
+      msg.data = value;  // auto cast!
+      m_publisher.publish(msg);
+      break;
+    }
+    case Type::boolean: {
+      std_msgs::Bool msg;
+      msg.data = value;  // auto cast!
+      m_publisher.publish(msg);
+      break;
+    }
+    case Type::string: {
+      std_msgs::String msg;
+      msg.data = (std::string)value;
+      m_publisher.publish(msg);
+      break;
+    }
+    default: { ERROR("[EntryPublisher::publish] Invalid entry type.") }
+  }
+}
+
 }  // end namespace kaco
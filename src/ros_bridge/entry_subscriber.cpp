@@ -31,7 +31,6 @@
 
 #include "kacanopen/ros_bridge/entry_subscriber.h"
 #include "kacanopen/core/logger.h"
-#include "kacanopen/core/sdo_error.h"
 #include "kacanopen/master/utils.h"
 #include "ros/ros.h"
 
@@ -43,7 +42,8 @@ EntrySubscriber::EntrySubscriber(Device& device, const std::string& entry_name,
                                  const WriteAccessMethod access_method)
     : m_device(device),
       m_entry_name(entry_name),
-      m_access_method(access_method) {
+      m_access_method(access_method),
+      m_write_queue(EntryWriteQueue::shared(device)) {
   uint8_t node_id = device.get_node_id();
   m_device_prefix = "device" + std::to_string(node_id) + "/";
   // no spaces and '-' allowed in ros names
@@ -100,91 +100,51 @@ void EntrySubscriber::advertise() {
 }
 
 void EntrySubscriber::receive_uint8(const std_msgs::UInt8& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_uint8(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 void EntrySubscriber::receive_uint16(const std_msgs::UInt16& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_uint16(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 void EntrySubscriber::receive_uint32(const std_msgs::UInt32& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_uint32(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 void EntrySubscriber::receive_int8(const std_msgs::Int8& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_int8(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 void EntrySubscriber::receive_int16(const std_msgs::Int16& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_int16(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 void EntrySubscriber::receive_int32(const std_msgs::Int32& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_int32(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 void EntrySubscriber::receive_boolean(const std_msgs::Bool& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_boolean(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 void EntrySubscriber::receive_string(const std_msgs::String& msg) {
-  try {
-    DEBUG_LOG("Recieved msg: " << msg.data);
-    m_device.set_entry(m_entry_name, msg.data,
-                       m_access_method);  // auto cast to Value!
-  } catch (const sdo_error& error) {
-    // TODO: only catch timeouts?
-    ERROR("Exception in EntrySubscriber::receive_string(): " << error.what());
-  }
+  DEBUG_LOG("Recieved msg: " << msg.data);
+  m_write_queue->push(m_entry_name, msg.data,
+                      m_access_method);  // auto cast to Value!
 }
 
 }  // end namespace kaco
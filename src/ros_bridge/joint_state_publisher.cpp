@@ -123,6 +123,10 @@ void JointStatePublisher::publish() {
   }
 }
 
+int JointStatePublisher::get_node_id() const {
+  return m_device.get_node_id();
+}
+
 double JointStatePublisher::pos_to_rad(int32_t pos) const {
   const double p = pos;
   const double min = m_position_0_degree;
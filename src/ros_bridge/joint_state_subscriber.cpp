@@ -78,6 +78,29 @@ JointStateSubscriber::JointStateSubscriber(Device& device,
   }
 }
 
+JointStateSubscriber::JointStateSubscriber(CyclicDrive& drive,
+                                           int32_t position_0_degree,
+                                           int32_t position_360_degree,
+                                           std::string topic_name)
+    : m_device(drive.get_device()),
+      m_drive(&drive),
+      m_position_0_degree(position_0_degree),
+      m_position_360_degree(position_360_degree),
+      m_topic_name(topic_name),
+      m_initialized(false) {
+  if (drive.get_mode() != CyclicDrive::Mode::interpolated_position &&
+      drive.get_mode() != CyclicDrive::Mode::position) {
+    throw std::runtime_error(
+        "[JointStateSubscriber] The CyclicDrive must be in interpolated "
+        "position or cyclic synchronous position mode.");
+  }
+
+  if (m_topic_name.empty()) {
+    uint8_t node_id = m_device.get_node_id();
+    m_topic_name = "device" + std::to_string(node_id) + "/set_joint_state";
+  }
+}
+
 void JointStateSubscriber::advertise() {
   assert(!m_topic_name.empty());
   DEBUG_LOG("Advertising " << m_topic_name);
@@ -96,7 +119,17 @@ void JointStateSubscriber::receive(const sensor_msgs::JointState& msg) {
     DEBUG_DUMP(pos);
     DEBUG_DUMP(msg.position[0]);
 
-    m_device.execute("set_target_position", pos);
+    if (!m_drive) {
+      m_device.execute("set_target_position", pos);
+    } else if (m_drive->get_mode() ==
+               CyclicDrive::Mode::interpolated_position) {
+      if (!m_drive->push_point(pos)) {
+        WARN("[JointStateSubscriber] Trajectory point buffer is full. "
+             "Dropping point.");
+      }
+    } else {
+      m_drive->set_target(pos);
+    }
 
   } catch (const sdo_error& error) {
     // TODO: only catch timeouts?
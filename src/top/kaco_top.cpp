@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2015, Thomas Keh
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ *    3. Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kacanopen/core/bus_statistics.h"
+#include "kacanopen/core/core.h"
+#include "kacanopen/core/logger.h"
+
+#include <signal.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Terminal monitor which attaches to a bus and shows live traffic per node:
+// frame rates, estimated bus load, SDO round trip times, heartbeat age and
+// emergency counts. It is based on kaco::BusStatistics and only listens,
+// except for the dummy frame which Core::start() sends.
+//
+// Usage: kaco-top [-r <refresh rate in Hz>] <busname> <baudrate>
+
+using Clock = kaco::BusStatistics::Clock;
+using Counters = kaco::BusStatistics::Counters;
+
+static volatile int keepRunning = 1;
+
+void intHandler(int dummy) {
+  (void)dummy;
+  keepRunning = 0;
+}
+
+// Parses "500K", "1M" or "125000".
+static unsigned parse_bitrate(const std::string& baudrate) {
+  const unsigned value = std::stoul(baudrate);
+  switch (baudrate.back()) {
+    case 'K':
+    case 'k':
+      return value * 1000;
+    case 'M':
+    case 'm':
+      return value * 1000000;
+    default:
+      return value;
+  }
+}
+
+// Bits on the wire for standard frames including worst-case bit stuffing:
+// 47 + 8n frame bits, of which 34 + 8n (SOF..CRC) are subject to stuffing
+// with at most one stuff bit per four bits after the first.
+static double frame_bits(double frames, double bytes) {
+  const double stuffable = 34 * frames + 8 * bytes;
+  return 47 * frames + 8 * bytes + (stuffable - frames) / 4;
+}
+
+static std::string cob_name(uint16_t cob_id) {
+  switch (cob_id >> 7) {
+    case 0:
+      return "NMT";
+    case 1:
+      return ((cob_id & 0x7F) == 0) ? "SYNC" : "EMCY";
+    case 2:
+      return "TIME";
+    case 3:
+    case 5:
+    case 7:
+    case 9:
+      return "TPDO" + std::to_string(cob_id >> 8);
+    case 4:
+    case 6:
+    case 8:
+    case 10:
+      return "RPDO" + std::to_string((cob_id >> 8) - 1);
+    case 11:
+      return "SDO tx";
+    case 12:
+      return "SDO rx";
+    case 14:
+      return "HB";
+    default:
+      return "?";
+  }
+}
+
+struct NodeRow {
+  double rx_rate = 0;
+  double tx_rate = 0;
+  double bits = 0;
+  uint64_t emergencies = 0;
+  Clock::time_point last_heartbeat;
+  bool active = false;
+};
+
+struct CobRow {
+  uint16_t cob_id;
+  double rate;
+  double bits;
+  double interarrival_avg_us;
+  uint64_t interarrival_max_us;
+};
+
+static void render(const kaco::BusStatistics::Snapshot& snapshot,
+                   const std::map<uint16_t, Counters>& previous,
+                   double seconds, unsigned bitrate) {
+  const Clock::time_point now = Clock::now();
+  std::map<uint8_t, NodeRow> nodes;
+  std::vector<CobRow> cobs;
+  double total_bits = 0;
+  double total_rate = 0;
+
+  for (const Counters& counters : snapshot.cob_ids) {
+    Counters delta = counters;
+    const auto it = previous.find(counters.id);
+    if (it != previous.end()) {
+      delta.rx_frames -= it->second.rx_frames;
+      delta.tx_frames -= it->second.tx_frames;
+      delta.rx_bytes -= it->second.rx_bytes;
+      delta.tx_bytes -= it->second.tx_bytes;
+    }
+    const double frames = delta.rx_frames + delta.tx_frames;
+    const double bits =
+        frame_bits(frames, delta.rx_bytes + delta.tx_bytes) / seconds;
+    total_bits += bits;
+    total_rate += frames / seconds;
+    cobs.push_back({counters.id, frames / seconds, bits,
+                    counters.interarrival_avg_us,
+                    counters.interarrival_max_us});
+
+    const uint8_t function_code = counters.id >> 7;
+    const uint8_t node_id = counters.id & 0x7F;
+    if (node_id == 0 || function_code == 0 || function_code == 2) {
+      continue;
+    }
+    NodeRow& node = nodes[node_id];
+    node.active = true;
+    node.rx_rate += delta.rx_frames / seconds;
+    node.tx_rate += delta.tx_frames / seconds;
+    node.bits += bits;
+    if (function_code == 1) {
+      node.emergencies = counters.rx_frames;
+    } else if (function_code == 14) {
+      node.last_heartbeat = counters.last_received;
+    }
+  }
+
+  std::ostringstream out;
+  out << "\033[2J\033[H" << std::fixed;
+  out << "kaco-top - " << bitrate / 1000 << " kbit/s, "
+      << std::setprecision(0) << total_rate << " frames/s, load "
+      << std::setprecision(1) << 100 * total_bits / bitrate
+      << " % (worst-case stuffing)\n\n";
+
+  out << " NODE    RX/s    TX/s  LOAD%  HB AGE ms  EMCY  SDO p50 us  p99 us\n";
+  for (const auto& pair : nodes) {
+    const NodeRow& node = pair.second;
+    const kaco::BusStatistics::Histogram& sdo =
+        snapshot.sdo_round_trips[pair.first];
+    out << std::setw(5) << unsigned(pair.first) << std::setprecision(0)
+        << std::setw(8) << node.rx_rate << std::setw(8) << node.tx_rate
+        << std::setprecision(1) << std::setw(7) << 100 * node.bits / bitrate;
+    if (node.last_heartbeat == Clock::time_point()) {
+      out << std::setw(11) << "-";
+    } else {
+      out << std::setw(11)
+          << std::chrono::duration_cast<std::chrono::milliseconds>(
+                 now - node.last_heartbeat)
+                 .count();
+    }
+    out << std::setw(6) << node.emergencies;
+    if (sdo.samples() == 0) {
+      out << std::setw(12) << "-" << std::setw(8) << "-";
+    } else {
+      out << std::setw(12) << sdo.percentile_us(0.5) << std::setw(8)
+          << sdo.percentile_us(0.99);
+    }
+    out << "\n";
+  }
+
+  std::sort(cobs.begin(), cobs.end(),
+            [](const CobRow& a, const CobRow& b) { return a.bits > b.bits; });
+  out << "\n COB-ID  TYPE      FRAMES/s  LOAD%  PERIOD avg/max us\n";
+  for (size_t i = 0; i < cobs.size() && i < 10; ++i) {
+    const CobRow& cob = cobs[i];
+    out << "  0x" << std::hex << std::setw(3) << std::setfill('0')
+        << cob.cob_id << std::dec << std::setfill(' ') << "  " << std::left
+        << std::setw(8) << cob_name(cob.cob_id) << std::right
+        << std::setprecision(0) << std::setw(10) << cob.rate
+        << std::setprecision(1) << std::setw(7) << 100 * cob.bits / bitrate
+        << std::setprecision(0) << std::setw(10) << cob.interarrival_avg_us
+        << "/" << cob.interarrival_max_us << "\n";
+  }
+
+  std::cout << out.str() << std::flush;
+}
+
+static void monitor(kaco::Core& core, unsigned bitrate, double refresh_rate) {
+  std::map<uint16_t, Counters> previous;
+  Clock::time_point last = Clock::now();
+
+  while (keepRunning) {
+    std::this_thread::sleep_for(
+        std::chrono::duration<double>(1.0 / refresh_rate));
+    const kaco::BusStatistics::Snapshot snapshot = core.statistics.snapshot();
+    const Clock::time_point now = Clock::now();
+    render(snapshot, previous,
+           std::chrono::duration<double>(now - last).count(), bitrate);
+
+    last = now;
+    previous.clear();
+    for (const Counters& counters : snapshot.cob_ids) {
+      previous[counters.id] = counters;
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  signal(SIGINT, intHandler);
+  signal(SIGTERM, intHandler);
+
+  double refresh_rate = 2;
+  std::vector<std::string> arguments;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      refresh_rate = std::stod(argv[++i]);
+    } else {
+      arguments.push_back(argv[i]);
+    }
+  }
+
+  if (arguments.size() != 2 || refresh_rate <= 0) {
+    PRINT("Usage: " << argv[0]
+                    << " [-r <refresh rate in Hz>] <busname> <baudrate>");
+    return EXIT_FAILURE;
+  }
+
+  if (!kaco::BusStatistics::enabled()) {
+    ERROR("KaCanOpen has been built without BUS_STATISTICS.");
+    return EXIT_FAILURE;
+  }
+
+  kaco::Core core;
+  // Only listen: don't answer boot-ups or reset nodes.
+  core.nmt.set_node_management(false);
+  if (!core.start(arguments[0], arguments[1])) {
+    ERROR("Starting core failed.");
+    return EXIT_FAILURE;
+  }
+
+  monitor(core, parse_bitrate(arguments[1]), refresh_rate);
+
+  core.stop();
+  return EXIT_SUCCESS;
+}